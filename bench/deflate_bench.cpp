@@ -0,0 +1,194 @@
+// Compression speed & ratio of each Deflater level.
+//
+// usage: deflate_bench [file...]
+//
+// Without arguments a built-in corpus of prose-like text, smooth RGB image
+// rows & random bytes is used. PNG files are decoded & their pixel data
+// compressed, as the encoder would; other files are compressed as is.
+
+#include "common/deflate.hpp"
+#include "common/inflate.hpp"
+#include "png/png_decoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using Corpus = std::pair<std::string, std::vector<std::byte>>;
+
+// Each level is timed over repeated runs until this much time has passed.
+constexpr std::chrono::duration<double> min_duration{ 0.5 };
+
+constexpr std::size_t corpus_size{ 4 << 20 };
+
+constexpr std::array<std::pair<ZLIB::CompressionLevel, std::string_view>, 4>
+    levels{ { { ZLIB::CompressionLevel::STORE, "STORE" },
+              { ZLIB::CompressionLevel::FAST, "FAST" },
+              { ZLIB::CompressionLevel::DEFAULT, "DEFAULT" },
+              { ZLIB::CompressionLevel::BEST, "BEST" } } };
+
+std::vector<std::byte>
+text_corpus( const std::size_t size ) {
+    constexpr std::array<std::string_view, 16> words{
+        "the ",    "of ",     "and ",    "compression ", "window ",
+        "match ",  "length ", "block ",  "huffman ",     "code ",
+        "stream ", "a ",      "in ",     "distance, ",   "literal. ",
+        "\n"
+    };
+    std::vector<std::byte> bytes;
+    bytes.reserve( size );
+    std::uint32_t state{ 1 };
+    while ( bytes.size() < size ) {
+        state = state * 1103515245U + 12345U;
+        for ( const auto c : words[( state >> 16 ) % words.size()] ) {
+            bytes.push_back( static_cast<std::byte>( c ) );
+        }
+    }
+    bytes.resize( size );
+    return bytes;
+}
+
+// RGB rows of overlapping gradients with a little noise.
+std::vector<std::byte>
+image_corpus( const std::size_t size ) {
+    constexpr std::size_t width{ 1024 };
+    std::vector<std::byte> bytes( size );
+    std::uint32_t          state{ 1 };
+    for ( std::size_t i{ 0 }; i < size; ++i ) {
+        const auto pixel{ i / 3 };
+        const auto x{ pixel % width };
+        const auto y{ pixel / width };
+        state = state * 1103515245U + 12345U;
+        const auto noise{ ( state >> 16 ) % 4 };
+        bytes[i] = static_cast<std::byte>(
+            ( ( i % 3 == 0 ? x : ( i % 3 == 1 ? y : x + y ) ) / 4 + noise )
+            & 0xFF );
+    }
+    return bytes;
+}
+
+std::vector<std::byte>
+random_corpus( const std::size_t size ) {
+    std::vector<std::byte> bytes( size );
+    std::uint64_t          state{ 0x9E37'79B9'7F4A'7C15 };
+    for ( auto & byte : bytes ) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        byte = static_cast<std::byte>( state >> 56 );
+    }
+    return bytes;
+}
+
+std::vector<std::byte>
+read_corpus( const std::filesystem::path & path ) {
+    std::ifstream in_file{ path, std::ios::binary };
+    if ( !in_file ) {
+        throw std::runtime_error( "cannot read " + path.string() );
+    }
+    const std::vector<char> chars{ std::istreambuf_iterator<char>( in_file ),
+                                   std::istreambuf_iterator<char>() };
+    std::vector<std::byte> bytes( chars.size() );
+    std::ranges::copy( std::as_bytes( std::span{ chars } ), bytes.begin() );
+    if ( path.extension() == ".png" ) {
+        PNG::PngDecoder decoder{ bytes };
+        return decoder.decode();
+    }
+    return bytes;
+}
+
+// Compresses `data` once, returning the stream.
+std::vector<std::byte>
+compress( ZLIB::Deflater & deflater, const std::span<const std::byte> data ) {
+    std::vector<std::byte> stream;
+    stream.reserve( data.size() + data.size() / 100 + 64 );
+    deflater.reset();
+    deflater.deflate( data, ZLIB::deflate_flush_t::FINISH, stream );
+    return stream;
+}
+
+bool
+round_trips( const std::span<const std::byte> stream,
+             const std::span<const std::byte> data ) {
+    const auto     segments{ std::vector<ZLIB::segment_t>{ stream } };
+    ZLIB::Inflater inflater{};
+    inflater.reset( segments );
+    std::vector<std::byte> output( data.size() + 1 );
+    output.resize( inflater.read( output ) );
+    return inflater.finish() == ZLIB::inflate_status_t::STREAM_END
+           && std::ranges::equal( output, data );
+}
+
+// Prints one line per level, returning false if a stream didn't inflate
+// back to its input.
+bool
+bench_corpus( const Corpus & corpus ) {
+    const auto & [name, data]{ corpus };
+    std::println( "{} ({} bytes)", name, data.size() );
+    auto all_round_trip{ true };
+    for ( const auto & [level, level_name] : levels ) {
+        ZLIB::Deflater deflater{ level };
+        const auto     stream{ compress( deflater, data ) };
+
+        using clock = std::chrono::steady_clock;
+        std::size_t runs{ 0 };
+        const auto  start{ clock::now() };
+        auto        elapsed{ std::chrono::duration<double>{ 0 } };
+        do {
+            [[maybe_unused]] const auto repeat{ compress( deflater, data ) };
+            ++runs;
+            elapsed = clock::now() - start;
+        } while ( elapsed < min_duration );
+
+        const auto megabytes{ static_cast<double>( data.size() * runs )
+                              / 1e6 };
+        const auto ratio{ static_cast<double>( data.size() )
+                          / static_cast<double>( stream.size() ) };
+        const auto valid{ round_trips( stream, data ) };
+        all_round_trip = all_round_trip && valid;
+        std::println( "  {:<8}{:>10.1f} MB/s{:>9.3f}x{:>12} bytes{}",
+                      level_name, megabytes / elapsed.count(), ratio,
+                      stream.size(), valid ? "" : "  ROUND TRIP FAILED" );
+    }
+    return all_round_trip;
+}
+
+} // namespace
+
+int
+main( int argc, char * argv[] ) {
+    std::vector<Corpus> corpora;
+    try {
+        for ( int i{ 1 }; i < argc; ++i ) {
+            corpora.emplace_back( argv[i], read_corpus( argv[i] ) );
+        }
+    }
+    catch ( const std::exception & error ) {
+        std::println( stderr, "deflate_bench: {}", error.what() );
+        return 1;
+    }
+    if ( corpora.empty() ) {
+        corpora.emplace_back( "text", text_corpus( corpus_size ) );
+        corpora.emplace_back( "image", image_corpus( corpus_size ) );
+        corpora.emplace_back( "random", random_corpus( corpus_size ) );
+    }
+
+    auto all_round_trip{ true };
+    for ( const auto & corpus : corpora ) {
+        all_round_trip = bench_corpus( corpus ) && all_round_trip;
+    }
+    return all_round_trip ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ZLIB
+{
+
+// Largest prime smaller than 2^16, see RFC 1950.
+constexpr inline std::uint32_t adler_modulus{ 65521 };
+
+class Adler32
+{
+    public:
+    constexpr Adler32() noexcept : m_a( 1 ), m_b( 0 ) {}
+    constexpr explicit Adler32( const std::uint32_t initial_value ) noexcept :
+        m_a( initial_value & 0xFFFF ), m_b( initial_value >> 16 ) {}
+
+    void update( const std::span<const std::byte> input_bytes ) noexcept;
+
+    constexpr void reset() noexcept {
+        m_a = 1;
+        m_b = 0;
+    }
+
+    [[nodiscard]] constexpr std::uint32_t value() const noexcept {
+        return ( m_b << 16 ) | m_a;
+    }
+
+    private:
+    std::uint32_t m_a;
+    std::uint32_t m_b;
+};
+
+// Adler-32 of the concatenation of two inputs, from the checksum of each &
+// the length of the second, as zlib's adler32_combine.
+constexpr std::uint32_t
+adler32_combine( const std::uint32_t first, const std::uint32_t second,
+                 const std::uint64_t second_length ) noexcept {
+    const auto remainder{ static_cast<std::uint32_t>( second_length
+                                                      % adler_modulus ) };
+    auto       a{ first & 0xFFFF };
+    auto       b{ static_cast<std::uint32_t>(
+        ( std::uint64_t{ remainder } * a ) % adler_modulus ) };
+
+    a += ( second & 0xFFFF ) + adler_modulus - 1;
+    b += ( first >> 16 ) + ( second >> 16 ) + adler_modulus - remainder;
+    a %= adler_modulus;
+    b %= adler_modulus;
+    return ( b << 16 ) | a;
+}
+
+} // namespace ZLIB
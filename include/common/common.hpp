@@ -224,17 +224,20 @@ template <typename T, std::endian SourceEndian,
              && ValidEndian<SourceEndian> && ValidEndian<TargetEndian>
 constexpr T
 span_to_integer_2( const std::span<const std::byte> & data ) {
+    // Operands promote to int, narrow the result back explicitly
     if constexpr ( TargetEndian == std::endian::little ) {
-        return static_cast<const T>( data[lsB<T, SourceEndian>] )
-               | static_cast<T>(
-                     data[static_cast<std::size_t>( msB<T, SourceEndian> )] )
-                     << static_cast<T>( byte_bits );
+        return static_cast<T>(
+            static_cast<const T>( data[lsB<T, SourceEndian>] )
+            | static_cast<T>(
+                  data[static_cast<std::size_t>( msB<T, SourceEndian> )] )
+                  << static_cast<T>( byte_bits ) );
     }
     else if constexpr ( TargetEndian == std::endian::big ) {
-        return static_cast<const T>( data[msB<T, SourceEndian>] )
-               | static_cast<T>(
-                     data[static_cast<std::size_t>( lsB<T, SourceEndian> )] )
-                     << static_cast<T>( byte_bits );
+        return static_cast<T>(
+            static_cast<const T>( data[msB<T, SourceEndian>] )
+            | static_cast<T>(
+                  data[static_cast<std::size_t>( lsB<T, SourceEndian> )] )
+                  << static_cast<T>( byte_bits ) );
     }
 }
 
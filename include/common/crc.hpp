@@ -41,24 +41,32 @@ class CrcTable32
     CrcTable32() = delete;
     explicit CrcTable32( const crc_t & polynomial ) :
         is_table_computed( false ),
-        table( std::array<crc_t, table_size>{} ),
+        tables{},
         polynomial( polynomial ) {
         calculate_table();
     }
 
-    [[nodiscard]] crc_t crc( const std::span<const std::byte> input_bytes );
+    [[nodiscard]] crc_t
+    crc( const std::span<const std::byte> input_bytes ) const;
+    // Continues `previous_crc`, the CRC of preceding input, over
+    // `input_bytes`, so data can be checksummed piece by piece.
+    [[nodiscard]] crc_t crc( const std::span<const std::byte> input_bytes,
+                             const crc_t & previous_crc ) const;
 
     private:
     static constexpr std::size_t table_size{ 256 };
+    // Bytes consumed per step of the slicing-by-8 update
+    static constexpr std::size_t slice_count{ 8 };
 
     void calculate_table() noexcept;
     [[nodiscard]] crc_t
     update_crc( const crc_t &                    initial_crc,
-                const std::span<const std::byte> input_bytes ) noexcept;
+                const std::span<const std::byte> input_bytes ) const noexcept;
 
-    bool                          is_table_computed;
-    std::array<crc_t, table_size> table;
-    crc_t                         polynomial;
+    bool is_table_computed;
+    // tables[k][b]: CRC register update for byte b followed by k zero bytes
+    std::array<std::array<std::uint32_t, table_size>, slice_count> tables;
+    crc_t                                                          polynomial;
 };
 
 } // namespace CRC
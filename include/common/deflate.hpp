@@ -0,0 +1,207 @@
+#pragma once
+
+#include "common/adler32.hpp"
+#include "common/common.hpp"
+#include "common/deflate_format.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ZLIB
+{
+
+// Compression effort of a Deflater, in the order of the FLEVEL field of the
+// zlib header it is written to.
+enum class CompressionLevel : std::uint8_t {
+    // clang-format off
+    STORE   = 0, // Stored blocks only, no compression
+    FAST    = 1, // Greedy matching on a shallow hash table, for real-time use
+    DEFAULT = 2, // Lazy matching on hash chains
+    BEST    = 3  // Near-optimal parse over all chained matches, for archival
+    // clang-format on
+};
+
+// What Deflater::deflate does with buffered input once `input` is consumed.
+enum class deflate_flush_t : std::uint8_t {
+    // clang-format off
+    NONE   = 0, // Keep input buffered until a block is worth emitting
+    FULL   = 1, // Emit everything & end with an empty stored block, later
+                // output never refers back past this point
+    FINISH = 2, // Emit everything as the final block, then the trailer
+    SYNC   = 3  // Emit everything & end with an empty stored block, later
+                // output may still refer back past this point
+    // clang-format on
+};
+
+// BitWriter: LSB-first bit writer, the counterpart of SegmentedBitReader.
+// Whole bytes are appended to the output vector passed in, partial bytes
+// are kept until the next write.
+class BitWriter
+{
+    public:
+    // Writes the low `count` (<= 32) bits of `value`.
+    void write_bits( const std::uint32_t value, const std::uint32_t count,
+                     std::vector<std::byte> & out ) {
+        m_bit_buffer |= std::uint64_t{ value } << m_bit_count;
+        m_bit_count += count;
+        while ( m_bit_count >= byte_bits ) {
+            out.push_back( static_cast<std::byte>( m_bit_buffer & 0xFF ) );
+            m_bit_buffer >>= byte_bits;
+            m_bit_count -= byte_bits;
+        }
+    }
+
+    // Pads with zero bits up to the next byte boundary.
+    void align_to_byte( std::vector<std::byte> & out ) {
+        if ( m_bit_count != 0 ) {
+            write_bits( 0, byte_bits - m_bit_count, out );
+        }
+    }
+
+    constexpr void reset() noexcept {
+        m_bit_buffer = 0;
+        m_bit_count = 0;
+    }
+
+    [[nodiscard]] constexpr std::uint32_t bit_count() const noexcept {
+        return m_bit_count;
+    }
+
+    private:
+    std::uint64_t m_bit_buffer{ 0 };
+    std::uint32_t m_bit_count{ 0 };
+};
+
+// Deflater: streaming zlib (RFC 1950) / raw deflate (RFC 1951) encoder.
+// Input is pushed in arbitrarily sized pieces & compressed output appended
+// to a caller owned vector, so a producer can compress one scanline at a
+// time without holding the whole stream.
+//
+// Compressing levels find LZ77 matches through a hash of the next 3 bytes
+// over a window of twice window_size, slid down as input arrives, & emit
+// each block as whichever of dynamic Huffman, fixed Huffman or stored is
+// smallest.
+class Deflater
+{
+    public:
+    static constexpr std::size_t window_size{ 32768 };
+    static constexpr std::size_t max_stored_block{ 65535 };
+
+    explicit Deflater( const CompressionLevel level = CompressionLevel::STORE,
+                       const bool             zlib_wrapped = true );
+
+    // Starts a new stream.
+    void reset();
+    // Starts a new stream, zlib wrapped or raw deflate.
+    void reset( const bool zlib_wrapped );
+
+    // Primes the window with `dictionary`, the data that precedes this
+    // stream's input, so matches may refer back into it. Only the last
+    // window_size bytes are used. Call before any input. The dictionary
+    // isn't signalled in the zlib header nor counted by total_in() or
+    // adler(): the decoder must already hold it, as when one stream is
+    // compressed in pieces & stitched together. Ignored at STORE.
+    void set_dictionary( const std::span<const std::byte> dictionary );
+
+    // Compresses `input`, appending any output to `out`. Without a flush,
+    // some input may be held back until more arrives. Nothing may be
+    // written after a FINISH flush until reset().
+    void deflate( const std::span<const std::byte> input,
+                  const deflate_flush_t flush, std::vector<std::byte> & out );
+
+    [[nodiscard]] constexpr std::uint64_t total_in() const noexcept {
+        return m_total_in;
+    }
+    // Whole bytes of output so far. After a flush this is the offset of
+    // the next output byte within the stream.
+    [[nodiscard]] constexpr std::uint64_t total_out() const noexcept {
+        return m_total_out;
+    }
+    // Adler-32 of the input so far, the zlib trailer once finished.
+    [[nodiscard]] constexpr std::uint32_t adler() const noexcept {
+        return m_adler.value();
+    }
+    [[nodiscard]] constexpr bool finished() const noexcept {
+        return m_finished;
+    }
+    [[nodiscard]] constexpr CompressionLevel level() const noexcept {
+        return m_level;
+    }
+
+    private:
+    // One LZ77 output symbol, a literal byte when distance is 0.
+    struct Symbol
+    {
+        std::uint16_t value;
+        std::uint16_t distance;
+    };
+
+    void write_zlib_header( std::vector<std::byte> & out );
+    void write_stored( const std::span<const std::byte> block,
+                       const bool is_final, std::vector<std::byte> & out );
+    // STORE: emits the buffered input as one or more blocks.
+    void write_pending( const bool is_final, std::vector<std::byte> & out );
+
+    // Appends `input` to the window, matching as far as the lookahead
+    // allows, or to the end of the input if `drain` is set.
+    void compress( std::span<const std::byte> input, const bool drain,
+                   std::vector<std::byte> & out );
+    void match_greedy( const bool drain, std::vector<std::byte> & out );
+    void match_lazy( const bool drain, std::vector<std::byte> & out );
+    void match_optimal( const bool drain, std::vector<std::byte> & out );
+    // Parses the next `count` bytes by shortest path over the matches at
+    // each position, then emits them as one block.
+    void parse_optimal( const std::size_t count, std::vector<std::byte> & out );
+    // Discards the older half of the window, emitting the current block
+    // first if it starts there.
+    void slide_window( std::vector<std::byte> & out );
+
+    void insert_hash( const std::size_t position ) noexcept;
+    // Longest match at `position` of at most `limit` bytes that beats
+    // `best_length`, 0 if none.
+    [[nodiscard]] std::uint32_t find_match( const std::size_t position,
+                                            const std::uint32_t best_length,
+                                            const std::uint32_t limit,
+                                            std::uint32_t & distance ) const;
+    void push_literal( const std::byte value ) noexcept;
+    void push_match( const std::uint32_t length,
+                     const std::uint32_t distance ) noexcept;
+    // Emits the symbols since the last block, covering the window from
+    // m_block_start to m_position.
+    void write_block( const bool is_final, std::vector<std::byte> & out );
+    void write_symbols( const std::span<const std::uint8_t> literal_lengths,
+                        const std::span<const std::uint8_t> distance_lengths,
+                        std::vector<std::byte> &           out );
+
+    CompressionLevel       m_level;
+    bool                   m_zlib_wrapped;
+    BitWriter              m_writer{};
+    Adler32                m_adler{};
+    std::vector<std::byte> m_pending{};
+    // Match state, compressing levels only
+    std::vector<std::byte> m_window{};
+    std::size_t            m_window_end{ 0 };
+    std::size_t            m_position{ 0 };
+    std::size_t            m_block_start{ 0 };
+    // Most recent position + 1 per hash & the previous one with the same
+    // hash per position, 0 for none
+    std::vector<std::uint32_t> m_head{};
+    std::vector<std::uint32_t> m_previous{};
+    std::vector<Symbol>        m_symbols{};
+    std::array<std::uint32_t, max_literal_codes>  m_literal_counts{};
+    std::array<std::uint32_t, max_distance_codes> m_distance_counts{};
+    // BEST: matches of increasing length per position & the parse
+    std::vector<Symbol>        m_candidates{};
+    std::vector<std::uint32_t> m_candidate_index{};
+    std::vector<std::uint32_t> m_costs{};
+    std::vector<Symbol>        m_steps{};
+    std::uint64_t          m_total_in{ 0 };
+    std::uint64_t          m_total_out{ 0 };
+    bool                   m_header_written{ false };
+    bool                   m_finished{ false };
+};
+
+} // namespace ZLIB
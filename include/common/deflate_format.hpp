@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Constants of the DEFLATE format (RFC 1951) shared by the Inflater &
+// Deflater.
+namespace ZLIB
+{
+
+// Length & distance code tables, RFC 1951 section 3.2.5.
+inline constexpr std::array<std::uint16_t, 29> length_base{
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+inline constexpr std::array<std::uint8_t, 29> length_extra_bits{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+inline constexpr std::array<std::uint16_t, 30> distance_base{
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577
+};
+inline constexpr std::array<std::uint8_t, 30> distance_extra_bits{
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order in which code length code lengths are transmitted.
+inline constexpr std::array<std::uint8_t, 19> code_length_order{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+inline constexpr std::uint32_t end_of_block{ 256 };
+inline constexpr std::uint32_t max_literal_codes{ 286 };
+inline constexpr std::uint32_t max_distance_codes{ 30 };
+inline constexpr std::uint32_t min_match{ 3 };
+inline constexpr std::uint32_t max_match{ 258 };
+
+// Fixed Huffman code lengths, RFC 1951 section 3.2.6. Both alphabets
+// include the two codes that never occur in a valid stream.
+inline constexpr std::size_t fixed_literal_codes{ 288 };
+inline constexpr std::size_t fixed_distance_codes{ 32 };
+inline constexpr std::uint8_t fixed_distance_length{ 5 };
+
+constexpr std::array<std::uint8_t, fixed_literal_codes>
+fixed_literal_lengths() {
+    std::array<std::uint8_t, fixed_literal_codes> lengths{};
+    for ( std::size_t i{ 0 }; i < lengths.size(); ++i ) {
+        lengths[i] = i < 144 ? 8 : ( i < 256 ? 9 : ( i < 280 ? 7 : 8 ) );
+    }
+    return lengths;
+}
+
+// Huffman codes are defined MSB-first but packed LSB-first.
+constexpr std::uint32_t
+reverse_bits( std::uint32_t code, const std::uint32_t length ) noexcept {
+    std::uint32_t result{ 0 };
+    for ( std::uint32_t i{ 0 }; i < length; ++i ) {
+        result = ( result << 1 ) | ( code & 1 );
+        code >>= 1;
+    }
+    return result;
+}
+
+} // namespace ZLIB
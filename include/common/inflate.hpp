@@ -0,0 +1,273 @@
+#pragma once
+
+#include "common/adler32.hpp"
+#include "common/common.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <vector>
+
+namespace ZLIB
+{
+
+// A compressed stream may be split over several non-contiguous buffers, e.g.
+// the payloads of consecutive IDAT chunks.
+using segment_t = std::span<const std::byte>;
+
+enum class inflate_status_t : std::uint8_t {
+    // clang-format off
+    OK                = 0, // More output may follow
+    STREAM_END        = 1, // Final block decoded & trailer verified
+    TRUNCATED         = 2, // Input exhausted before the end of the stream
+    BAD_ZLIB_HEADER   = 3,
+    BAD_BLOCK_TYPE    = 4,
+    BAD_STORED_LENGTH = 5,
+    BAD_HUFFMAN_TABLE = 6,
+    BAD_SYMBOL        = 7,
+    BAD_DISTANCE      = 8,
+    BAD_ADLER32       = 9
+    // clang-format on
+};
+
+std::ostream & operator<<( std::ostream &         out_stream,
+                           const inflate_status_t status );
+
+// SegmentedBitReader: LSB-first bit reader over a list of byte segments.
+// Segments are treated as one contiguous stream, so codes may straddle
+// segment boundaries.
+class SegmentedBitReader
+{
+    public:
+    SegmentedBitReader() noexcept = default;
+    explicit SegmentedBitReader(
+        const std::span<const segment_t> segments ) noexcept {
+        reset( segments );
+    }
+
+    void reset( const std::span<const segment_t> segments ) noexcept;
+
+    // Buffers at least `count` (<= 57) bits, returns false if the input is
+    // exhausted first. Any bits that could be buffered remain available.
+    [[nodiscard]] bool fill( const std::uint32_t count ) noexcept {
+        if ( m_bit_count < count ) {
+            refill();
+        }
+        return m_bit_count >= count;
+    }
+
+    // Bits past the end of the buffered input read as zero.
+    [[nodiscard]] constexpr std::uint32_t
+    peek( const std::uint32_t count ) const noexcept {
+        return static_cast<std::uint32_t>( m_bit_buffer
+                                           & ( ( 1ULL << count ) - 1 ) );
+    }
+
+    constexpr void consume( const std::uint32_t count ) noexcept {
+        m_bit_buffer >>= count;
+        m_bit_count -= count;
+    }
+
+    [[nodiscard]] bool read_bits( const std::uint32_t count,
+                                  std::uint32_t &     value ) noexcept {
+        if ( !fill( count ) ) {
+            return false;
+        }
+        value = peek( count );
+        consume( count );
+        return true;
+    }
+
+    constexpr void align_to_byte() noexcept { consume( m_bit_count % 8 ); }
+
+    // Copies whole bytes into `out`, the reader must be byte aligned.
+    // Returns the number of bytes copied, which is only less than
+    // out.size() if the input is exhausted.
+    [[nodiscard]] std::size_t copy_bytes( std::span<std::byte> out ) noexcept;
+
+    // Repositions the reader at an absolute bit offset into the stream.
+    [[nodiscard]] bool seek( const std::uint64_t bit_position ) noexcept;
+
+    [[nodiscard]] constexpr std::uint32_t bit_count() const noexcept {
+        return m_bit_count;
+    }
+    [[nodiscard]] constexpr std::uint64_t bit_position() const noexcept {
+        return m_bytes_fetched * byte_bits - m_bit_count;
+    }
+
+    private:
+    void refill() noexcept;
+
+    std::span<const segment_t> m_segments{};
+    std::size_t                m_segment_index{ 0 };
+    std::size_t                m_segment_offset{ 0 };
+    std::uint64_t              m_bytes_fetched{ 0 };
+    std::uint64_t              m_bit_buffer{ 0 };
+    std::uint32_t              m_bit_count{ 0 };
+};
+
+// HuffmanTable: canonical Huffman decoding table. Codes of up to fast_bits
+// bits are resolved with a single lookup, longer codes fall back to a
+// canonical walk over the per-length code counts.
+class HuffmanTable
+{
+    public:
+    static constexpr std::uint32_t max_code_length{ 15 };
+    static constexpr std::uint32_t max_symbols{ 288 };
+    static constexpr std::uint32_t fast_bits{ 10 };
+
+    static constexpr int bad_symbol{ -1 };
+    static constexpr int truncated{ -2 };
+
+    // Returns false if the code lengths over-subscribe the code space.
+    [[nodiscard]] bool
+    build( const std::span<const std::uint8_t> code_lengths ) noexcept;
+
+    // Returns the decoded symbol, bad_symbol or truncated.
+    [[nodiscard]] int decode( SegmentedBitReader & reader ) const noexcept;
+
+    private:
+    // Fast entries are ( length << symbol_bits ) | symbol, 0 if the code is
+    // longer than fast_bits.
+    static constexpr std::uint32_t symbol_bits{ 9 };
+
+    std::array<std::uint16_t, 1U << fast_bits>       m_fast{};
+    std::array<std::uint16_t, max_code_length + 1> m_counts{};
+    std::array<std::uint16_t, max_symbols>          m_symbols{};
+};
+
+// InflateCheckpoint: complete Inflater state at some point of a stream, from
+// which inflating can resume without decoding the preceding input, as in
+// zlib's zran example. Unlike zran, checkpoints are not restricted to block
+// boundaries: the code lengths of the current block are kept, so its
+// Huffman tables can be rebuilt.
+struct InflateCheckpoint
+{
+    // Literal/length & distance code lengths, fixed codes being the largest
+    static constexpr std::size_t max_code_lengths{ 288 + 32 };
+
+    std::uint64_t bit_position{ 0 }; // Into the concatenated segments
+    std::uint64_t total_out{ 0 };
+    std::uint32_t adler{ 1 }; // Running Adler-32 of the output so far
+    std::uint32_t stored_remaining{ 0 };
+    std::uint32_t match_remaining{ 0 };
+    std::uint32_t match_distance{ 0 };
+    std::uint16_t literal_count{ 0 };
+    std::uint16_t distance_count{ 0 };
+    std::uint8_t  state{ 0 };
+    bool          final_block{ false };
+    bool          zlib_wrapped{ true };
+    std::array<std::uint8_t, max_code_lengths> code_lengths{};
+    // The last min( total_out, window_size ) bytes of output, oldest first
+    std::vector<std::byte> window{};
+};
+
+// Inflater: resumable zlib (RFC 1950) / raw deflate (RFC 1951) decoder.
+// Output is pulled in arbitrarily sized pieces through read(), so callers
+// can consume a stream one scanline at a time without buffering the whole
+// decompressed image. History for back-references is kept in an internal
+// 32 KiB window.
+class Inflater
+{
+    public:
+    static constexpr std::size_t window_size{ 32768 };
+
+    Inflater() noexcept = default;
+
+    // Starts decoding a new stream. The segments must outlive the inflater
+    // (or the next reset).
+    void reset( const std::span<const segment_t> segments,
+                const bool                       zlib_wrapped = true ) noexcept;
+
+    // Snapshot of the current state, see InflateCheckpoint.
+    [[nodiscard]] InflateCheckpoint checkpoint() const;
+
+    // Continues decoding `segments`, the same stream a checkpoint was taken
+    // from, at that checkpoint. Returns false, leaving the inflater failed,
+    // if the checkpoint is inconsistent or lies past the end of the input.
+    [[nodiscard]] bool
+    resume( const std::span<const segment_t> segments,
+            const InflateCheckpoint &        checkpoint ) noexcept;
+
+    // Decodes up to out.size() bytes, returning the number written. Fewer
+    // bytes are only returned at the end of the stream or on error, see
+    // status().
+    [[nodiscard]] std::size_t read( std::span<std::byte> out ) noexcept;
+
+    // Consumes the remainder of the stream (trailing empty blocks & the
+    // Adler-32 trailer) without producing output. Returns STREAM_END if the
+    // stream ended cleanly.
+    [[nodiscard]] inflate_status_t finish() noexcept;
+
+    [[nodiscard]] constexpr inflate_status_t status() const noexcept {
+        return m_status;
+    }
+    [[nodiscard]] constexpr bool failed() const noexcept {
+        return m_status != inflate_status_t::OK
+               && m_status != inflate_status_t::STREAM_END;
+    }
+    [[nodiscard]] constexpr bool finished() const noexcept {
+        return m_status == inflate_status_t::STREAM_END;
+    }
+    [[nodiscard]] constexpr std::uint64_t total_out() const noexcept {
+        return m_total_out;
+    }
+    // Bits of input consumed so far.
+    [[nodiscard]] constexpr std::uint64_t bit_position() const noexcept {
+        return m_reader.bit_position();
+    }
+    // True if the input ran out exactly between two blocks, on a byte
+    // boundary, as at a full flush point. The stream is still TRUNCATED,
+    // but the output so far is complete.
+    [[nodiscard]] constexpr bool ended_between_blocks() const noexcept {
+        return m_ended_between_blocks;
+    }
+
+    private:
+    enum class state_t : std::uint8_t {
+        ZLIB_HEADER,
+        BLOCK_HEADER,
+        STORED,
+        HUFFMAN,
+        TRAILER,
+        DONE
+    };
+
+    [[nodiscard]] bool read_zlib_header() noexcept;
+    [[nodiscard]] bool read_block_header() noexcept;
+    [[nodiscard]] bool read_dynamic_tables() noexcept;
+    [[nodiscard]] bool read_trailer() noexcept;
+    [[nodiscard]] std::size_t copy_stored( std::span<std::byte> out ) noexcept;
+    [[nodiscard]] std::size_t
+    inflate_block( std::span<std::byte> out ) noexcept;
+
+    void append_window( const std::span<const std::byte> bytes ) noexcept;
+    constexpr void set_error( const inflate_status_t status ) noexcept {
+        m_status = status;
+        m_state = state_t::DONE;
+    }
+
+    SegmentedBitReader                 m_reader{};
+    HuffmanTable                       m_literals{};
+    HuffmanTable                       m_distances{};
+    // Code lengths the current tables were built from, for checkpoints
+    std::array<std::uint8_t, InflateCheckpoint::max_code_lengths>
+                                       m_code_lengths{};
+    std::uint16_t                      m_literal_count{ 0 };
+    std::uint16_t                      m_distance_count{ 0 };
+    std::array<std::byte, window_size> m_window{};
+    std::uint64_t                      m_total_out{ 0 };
+    std::uint32_t                      m_stored_remaining{ 0 };
+    std::uint32_t                      m_match_remaining{ 0 };
+    std::uint32_t                      m_match_distance{ 0 };
+    Adler32                            m_adler{};
+    state_t                            m_state{ state_t::DONE };
+    inflate_status_t                   m_status{ inflate_status_t::OK };
+    bool                               m_final_block{ false };
+    bool                               m_zlib_wrapped{ true };
+    bool                               m_ended_between_blocks{ false };
+};
+
+} // namespace ZLIB
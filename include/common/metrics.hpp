@@ -0,0 +1,185 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string_view>
+
+namespace METRICS
+{
+
+// Pipeline stages timed. Stages may nest, CRC runs within the chunk walk,
+// so the time of an inner stage also counts towards its outer stage.
+enum class stage_t : std::uint8_t {
+    // clang-format off
+    READ       = 0, // Opening & mapping a file, by the path overloads
+    CHUNK_WALK = 1, // Reading & checking the chunk layout
+    CRC        = 2,
+    INFLATE    = 3,
+    UNFILTER   = 4,
+    CONVERT    = 5  // Output sample conversions
+    // clang-format on
+};
+
+constexpr inline std::size_t stage_count{ 6 };
+
+[[nodiscard]] constexpr std::string_view
+stage_name( const stage_t stage ) noexcept {
+    switch ( stage ) {
+    case stage_t::READ: return "read";
+    case stage_t::CHUNK_WALK: return "chunk_walk";
+    case stage_t::CRC: return "crc";
+    case stage_t::INFLATE: return "inflate";
+    case stage_t::UNFILTER: return "unfilter";
+    case stage_t::CONVERT: return "convert";
+    default: return "unknown";
+    }
+}
+
+struct StageTotals
+{
+    std::uint64_t calls{ 0 };
+    std::uint64_t nanoseconds{ 0 };
+    std::uint64_t bytes_in{ 0 };
+    std::uint64_t bytes_out{ 0 };
+};
+
+// StageMetrics: totals per stage, over one image or the whole process.
+struct StageMetrics
+{
+    std::uint64_t                        images{ 0 };
+    std::array<StageTotals, stage_count> stages{};
+
+    [[nodiscard]] constexpr const StageTotals &
+    operator[]( const stage_t stage ) const noexcept {
+        return stages[static_cast<std::size_t>( stage )];
+    }
+};
+
+// Metrics are off until enabled, & then cost a relaxed load & a branch per
+// timed stage.
+inline std::atomic<bool> metrics_enabled{ false };
+
+[[nodiscard]] inline bool
+enabled() noexcept {
+    return metrics_enabled.load( std::memory_order_relaxed );
+}
+
+inline void
+set_enabled( const bool enable ) noexcept {
+    metrics_enabled.store( enable, std::memory_order_relaxed );
+}
+
+// Totals of every stage timed in the process since the last reset.
+[[nodiscard]] StageMetrics process_metrics() noexcept;
+void                       reset_process_metrics() noexcept;
+
+// Counts an image towards `image` & the process totals, if enabled.
+void count_image( StageMetrics * image ) noexcept;
+
+// Adds `totals` of `stage` to `image`, if given, & to the process totals.
+void add_totals( StageMetrics * image, const stage_t stage,
+                 const StageTotals & totals ) noexcept;
+
+// steady_clock nanoseconds, the clock stages are timed by.
+[[nodiscard]] std::uint64_t now() noexcept;
+
+// StageTimer: times one call of a stage, from construction to destruction,
+// & adds it to `image`, if given, & to the process totals. Does nothing if
+// metrics were disabled at construction. Per image metrics aren't
+// synchronised, so a StageMetrics must only be timed from one thread.
+class StageTimer
+{
+    public:
+    StageTimer( StageMetrics * const image, const stage_t stage,
+                const std::uint64_t bytes_in = 0 ) noexcept :
+        m_image( image ),
+        m_bytes_in( bytes_in ),
+        m_stage( stage ),
+        m_active( enabled() ) {
+        if ( m_active ) {
+            m_start = now();
+        }
+    }
+    StageTimer( const StageTimer & ) = delete;
+    StageTimer & operator=( const StageTimer & ) = delete;
+    ~StageTimer() {
+        if ( m_active ) {
+            stop();
+        }
+    }
+
+    void set_bytes_in( const std::uint64_t bytes_in ) noexcept {
+        m_bytes_in = bytes_in;
+    }
+    void set_bytes_out( const std::uint64_t bytes_out ) noexcept {
+        m_bytes_out = bytes_out;
+    }
+
+    private:
+    void stop() noexcept;
+
+    StageMetrics * m_image;
+    std::uint64_t  m_bytes_in;
+    std::uint64_t  m_bytes_out{ 0 };
+    std::uint64_t  m_start{ 0 };
+    stage_t        m_stage;
+    bool           m_active;
+};
+
+// StageBatch: totals of stages run many times over, e.g. once per row,
+// kept locally & added to `image`, if given, & to the process totals once,
+// on destruction. Whether metrics are enabled is read once, at
+// construction. Calls are timed back to back off one clock: lap() ends
+// the call of a stage that began at the previous lap() or mark(), so a
+// row of several stages reads the clock once per stage.
+class StageBatch
+{
+    public:
+    explicit StageBatch( StageMetrics * const image ) noexcept :
+        m_image( image ),
+        m_active( enabled() ) {}
+    StageBatch( const StageBatch & ) = delete;
+    StageBatch & operator=( const StageBatch & ) = delete;
+    ~StageBatch();
+
+    [[nodiscard]] bool active() const noexcept { return m_active; }
+
+    // Starts the next call from now, for stages that don't follow another.
+    void mark() noexcept { m_last = now(); }
+    // Counts a call of `stage` ending now.
+    void lap( const stage_t stage, const std::uint64_t bytes_in,
+              const std::uint64_t bytes_out ) noexcept {
+        const auto time{ now() };
+        auto &     totals{ m_totals[static_cast<std::size_t>( stage )] };
+        ++totals.calls;
+        totals.nanoseconds += time - m_last;
+        totals.bytes_in += bytes_in;
+        totals.bytes_out += bytes_out;
+        m_last = time;
+    }
+
+    private:
+    StageMetrics *                       m_image;
+    std::array<StageTotals, stage_count> m_totals{};
+    std::uint64_t                        m_last{ 0 };
+    bool                                 m_active;
+};
+
+enum class metrics_format_t : std::uint8_t { JSON, PROMETHEUS };
+
+// JSON: {"images":N,"stages":{"read":{"calls":..,"nanoseconds":..,
+// "bytes_in":..,"bytes_out":..},...}}. Prometheus text: one counter family
+// per StageTotals field, labelled by stage, in seconds & bytes.
+void write_metrics( std::ostream & out_stream, const StageMetrics & metrics,
+                    const metrics_format_t format );
+
+// Writes the process totals to `path`, replacing it. Returns false if the
+// file couldn't be written.
+[[nodiscard]] bool save_process_metrics( const std::filesystem::path & path,
+                                         const metrics_format_t format );
+
+} // namespace METRICS
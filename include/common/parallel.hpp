@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace PARALLEL
+{
+
+// Workers to run `tasks` tasks on when `threads` were asked for, 0 meaning
+// one per core. Never more than there are tasks, never fewer than 1.
+[[nodiscard]] std::size_t worker_count( const std::uint32_t threads,
+                                        const std::size_t   tasks ) noexcept;
+
+// WorkerPool: threads kept waiting between runs, so callers running many
+// small batches start their threads once. The calling thread of run() is
+// worker 0 & works alongside the pool's own threads. A pool runs one batch
+// at a time.
+class WorkerPool
+{
+    public:
+    // A pool of `workers` workers, the calling thread included.
+    explicit WorkerPool( const std::size_t workers );
+    WorkerPool( const WorkerPool & ) = delete;
+    WorkerPool & operator=( const WorkerPool & ) = delete;
+    ~WorkerPool();
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return m_threads.size() + 1;
+    }
+
+    // Runs task( index ), or task( index, worker ) where it takes both, for
+    // every index in [0, count) & returns once all are done. Tasks start in
+    // index order. Once one throws no more are started, & the exception of
+    // the lowest index that threw is rethrown, the same one a sequential
+    // loop would throw.
+    template <typename Task>
+    void run( const std::size_t count, Task && task ) {
+        if constexpr ( std::invocable<Task &, std::size_t, std::size_t> ) {
+            run_tasks( count, task );
+        }
+        else {
+            run_tasks( count,
+                       [&]( const std::size_t index, const std::size_t ) {
+                           task( index );
+                       } );
+        }
+    }
+
+    private:
+    using task_t = std::function<void( std::size_t, std::size_t )>;
+
+    void run_tasks( const std::size_t count, const task_t & task );
+    // Takes tasks of the current batch until none are left.
+    void take_tasks( const std::size_t worker ) noexcept;
+    void work( const std::size_t worker ) noexcept;
+    // Wakes the threads to exit, they are joined as m_threads is destroyed.
+    void stop() noexcept;
+
+    std::mutex                m_mutex;
+    std::condition_variable   m_wake;
+    std::condition_variable   m_done;
+    const task_t *            m_task{ nullptr };
+    std::size_t               m_count{ 0 };
+    std::atomic<std::size_t>  m_next{ 0 };
+    std::atomic<bool>         m_failed{ false };
+    std::size_t               m_error_index{ 0 };
+    std::exception_ptr        m_error{};
+    // Batches started, workers wake for each new one
+    std::uint64_t             m_batch{ 0 };
+    std::size_t               m_busy{ 0 };
+    bool                      m_stopping{ false };
+    std::vector<std::jthread> m_threads;
+};
+
+// Runs `task` over [0, count) as WorkerPool::run does, on worker_count(
+// threads, count ) workers. Threads are started for this call only, runs
+// with one worker stay on the calling thread.
+template <typename Task>
+void
+parallel_for( const std::size_t count, const std::uint32_t threads,
+              Task && task ) {
+    WorkerPool pool{ worker_count( threads, count ) };
+    pool.run( count, std::forward<Task>( task ) );
+}
+
+} // namespace PARALLEL
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <string_view>
+
+namespace PERF
+{
+
+// Hardware events counted, all in user space only.
+enum class counter_t : std::uint8_t {
+    // clang-format off
+    CYCLES        = 0,
+    INSTRUCTIONS  = 1,
+    BRANCH_MISSES = 2,
+    LLC_MISSES    = 3  // Last level cache read misses
+    // clang-format on
+};
+
+constexpr inline std::size_t counter_count{ 4 };
+
+using CounterValues = std::array<std::uint64_t, counter_count>;
+
+// RegionTotals: counts over every call of one named region.
+struct RegionTotals
+{
+    std::string_view name;
+    std::uint64_t    calls{ 0 };
+    std::uint64_t    bytes{ 0 };
+    CounterValues    counters{};
+
+    [[nodiscard]] constexpr std::uint64_t
+    operator[]( const counter_t counter ) const noexcept {
+        return counters[static_cast<std::size_t>( counter )];
+    }
+
+    // Instructions per cycle, 0 if no cycles were counted.
+    [[nodiscard]] double ipc() const noexcept;
+    // Events of `counter` per byte processed, 0 if no bytes were given.
+    [[nodiscard]] double per_byte( const counter_t counter ) const noexcept;
+};
+
+// Profile: hardware performance counters of the thread that created it,
+// opened as one perf_event group so they are scheduled together, & the
+// totals of the regions run while it is active. Counters the kernel or
+// CPU don't offer read as 0, & without perf_event_open support (non-Linux,
+// no PMU, perf_event_paranoid above 2) only calls & bytes are counted.
+class Profile
+{
+    public:
+    // Regions beyond this many names are not recorded
+    static constexpr std::size_t max_regions{ 16 };
+
+    Profile() noexcept;
+    Profile( const Profile & ) = delete;
+    Profile & operator=( const Profile & ) = delete;
+    ~Profile();
+
+    // True if at least the cycle counter could be opened.
+    [[nodiscard]] bool available() const noexcept {
+        return m_fds[0] >= 0;
+    }
+
+    // Regions entered on the creating thread record to this profile
+    // between start() & stop().
+    void start() noexcept;
+    void stop() noexcept;
+
+    [[nodiscard]] std::span<const RegionTotals> regions() const noexcept {
+        return std::span{ m_regions }.first( m_region_count );
+    }
+
+    // One line per region: name, calls, bytes, the four counters, IPC, &
+    // branch & LLC misses per byte.
+    void report( std::ostream & out_stream ) const;
+
+    private:
+    friend class Region;
+
+    [[nodiscard]] CounterValues read() const noexcept;
+    void add( const std::string_view name, const std::uint64_t bytes,
+              const CounterValues & start ) noexcept;
+
+    // Descriptors in counter_t order, -1 where a counter isn't available
+    std::array<int, counter_count>        m_fds;
+    std::array<RegionTotals, max_regions> m_regions{};
+    std::size_t                           m_region_count{ 0 };
+};
+
+// Profile regions entered on this thread record to, nullptr if none.
+// Constant initialised, so accesses from other translation units need no
+// TLS init wrapper call.
+extern constinit thread_local Profile * active_profile;
+
+// Region: counts the hardware events of one named code region, from
+// construction to destruction, in the thread's active profile. With no
+// active profile it costs a thread local load & a branch. With one,
+// entering & leaving each read the counters with a system call, so regions
+// belong around whole stages, not per row steps. `name` must outlive the
+// profile, string literals are expected.
+class Region
+{
+    public:
+    explicit Region( const std::string_view name,
+                     const std::uint64_t    bytes = 0 ) noexcept :
+        m_profile( active_profile ), m_name( name ), m_bytes( bytes ) {
+        if ( m_profile != nullptr ) {
+            m_start = m_profile->read();
+        }
+    }
+    Region( const Region & ) = delete;
+    Region & operator=( const Region & ) = delete;
+    ~Region() {
+        if ( m_profile != nullptr ) {
+            m_profile->add( m_name, m_bytes, m_start );
+        }
+    }
+
+    // Bytes processed by the region, for the per byte rates.
+    void set_bytes( const std::uint64_t bytes ) noexcept { m_bytes = bytes; }
+
+    private:
+    Profile *        m_profile;
+    std::string_view m_name;
+    std::uint64_t    m_bytes;
+    CounterValues    m_start{};
+};
+
+} // namespace PERF
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// Highest level of trace event compiled in, set through the TRACE_LEVEL
+// cache variable. At 0 every TRACE::event call compiles to nothing.
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+
+namespace TRACE
+{
+
+enum class trace_level_t : std::uint8_t {
+    // clang-format off
+    NONE   = 0,
+    STAGE  = 1, // Once per image & pipeline stage
+    CHUNK  = 2, // Once per chunk
+    DETAIL = 3  // Once per row, block or other inner loop step
+    // clang-format on
+};
+
+constexpr inline auto compiled_level{ static_cast<trace_level_t>(
+    TRACE_LEVEL ) };
+
+// TraceEvent: a single trace record. `name` must point to a string
+// literal, so recording an event never copies or allocates.
+struct TraceEvent
+{
+    std::uint64_t timestamp; // steady_clock nanoseconds
+    const char *  name;
+    std::uint64_t first;  // Event specific values, e.g. a chunk's type &
+    std::uint64_t second; // length
+    trace_level_t level;
+};
+
+// TraceBuffer: ring of the most recent events of one thread. Only the
+// owning thread records to or reads its buffer, so recording is a store &
+// an increment, with no locks or atomics. Once full the oldest events are
+// overwritten.
+class TraceBuffer
+{
+    public:
+    static constexpr std::size_t capacity{ 4096 };
+
+    TraceBuffer() : m_events( capacity ) {}
+
+    void record( const TraceEvent & event ) noexcept {
+        m_events[m_recorded % capacity] = event;
+        ++m_recorded;
+    }
+
+    // Buffered events, oldest first.
+    [[nodiscard]] std::vector<TraceEvent> events() const;
+
+    // Events overwritten before they were read.
+    [[nodiscard]] std::uint64_t dropped() const noexcept {
+        return m_recorded > capacity ? m_recorded - capacity : 0;
+    }
+
+    void clear() noexcept { m_recorded = 0; }
+
+    private:
+    std::vector<TraceEvent> m_events;
+    std::uint64_t           m_recorded{ 0 };
+};
+
+// Buffer of the calling thread, created on its first event.
+[[nodiscard]] TraceBuffer & thread_buffer();
+
+[[nodiscard]] std::uint64_t timestamp() noexcept;
+
+// Records an event of `Level` to the calling thread's buffer, if that
+// level is compiled in. Otherwise the call, arguments included, compiles
+// to nothing.
+template <trace_level_t Level>
+inline void
+event( [[maybe_unused]] const char *        name,
+       [[maybe_unused]] const std::uint64_t first = 0,
+       [[maybe_unused]] const std::uint64_t second = 0 ) {
+    if constexpr ( Level != trace_level_t::NONE && Level <= compiled_level ) {
+        thread_buffer().record(
+            { timestamp(), name, first, second, Level } );
+    }
+}
+
+// One event per line: timestamp, level, name & values.
+std::ostream & operator<<( std::ostream &     out_stream,
+                           const TraceEvent & event );
+
+} // namespace TRACE
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "png/png_decoder.hpp"
+#include "png/png_types.hpp"
+
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace PNG
+{
+
+// What happens to a frame's region once it has been shown, before the
+// next frame is composited.
+enum class DisposeOp : std::uint8_t {
+    // clang-format off
+    NONE       = 0, // Left as composited
+    BACKGROUND = 1, // Cleared to transparent black
+    PREVIOUS   = 2  // Restored to what it was before the frame
+    // clang-format on
+};
+
+// How a frame's pixels are combined with the canvas under them.
+enum class BlendOp : std::uint8_t {
+    // clang-format off
+    SOURCE = 0, // Replace the region, alpha included
+    OVER   = 1  // Alpha composite the frame over the region
+    // clang-format on
+};
+
+// FrameControl: fcTL chunk payload, the placement & timing of one frame.
+struct FrameControl
+{
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t x_offset;
+    std::uint32_t y_offset;
+    // Delay before the next frame, in seconds: numerator / denominator, a
+    // denominator of 0 meaning 100.
+    std::uint16_t delay_numerator;
+    std::uint16_t delay_denominator;
+    DisposeOp     dispose_op;
+    BlendOp       blend_op;
+};
+
+struct ApngOptions
+{
+    // Frames decoded ahead of compositing. Frames are inflated, unfiltered
+    // & expanded to RGBA in batches of `decode_ahead`, in parallel, then
+    // composited in order as the iterator reaches them. Larger batches
+    // keep more threads busy & hold more decoded frames in memory. 0 for
+    // one frame per worker thread.
+    std::uint32_t decode_ahead{ 0 };
+
+    // Worker threads decoding each batch, 0 for one per core.
+    std::uint32_t threads{ 0 };
+};
+
+// AnimationFrame: the canvas once a frame has been composited onto it.
+struct AnimationFrame
+{
+    std::uint32_t index;
+    FrameControl  control;
+    // Canvas as 8 bit RGBA, rows tightly packed. Views into the decoder &
+    // is overwritten by the next frame.
+    std::span<const std::byte> canvas;
+};
+
+// ApngDecoder: decodes the frames of an animated PNG in display order,
+// composited onto a full size RGBA canvas. The pixel data of every frame
+// is a zlib stream of its own, so frames are inflated & unfiltered in
+// parallel; only compositing, which follows the dispose & blend ops of the
+// frames before, runs in order. Samples are converted to 8 bit RGBA, with
+// palette & tRNS transparency applied & 16 bit samples rounded. A PNG
+// without an acTL chunk decodes as a single frame of its image.
+class ApngDecoder
+{
+    public:
+    class FrameIterator;
+
+    ApngDecoder() = delete;
+    // Throws as PngDecoder does for an invalid PNG, & BAD_ANIMATION for
+    // animation chunks that are malformed, out of sequence, outside the
+    // canvas or disagree with acTL on the frame count.
+    explicit ApngDecoder( const std::span<const std::byte> raw_data,
+                          const ApngOptions &              options = {} );
+
+    [[nodiscard]] const IHDR::IhdrChunkPayload & header() const noexcept {
+        return m_decoder.header();
+    }
+    [[nodiscard]] std::span<const FrameControl> frames() const noexcept {
+        return m_frames;
+    }
+    // Times to play the animation, 0 for forever.
+    [[nodiscard]] std::uint32_t play_count() const noexcept {
+        return m_play_count;
+    }
+    // False if the IDAT image is a static fallback, not part of the
+    // animation.
+    [[nodiscard]] bool default_image_is_frame() const noexcept {
+        return m_default_image_is_frame;
+    }
+
+    // Composites the next frame & returns the canvas, or nothing once
+    // every frame has been shown. Throws BAD_IMAGE_DATA or BAD_FILTER_TYPE
+    // for corrupt frame data.
+    [[nodiscard]] std::optional<AnimationFrame> next_frame();
+    // Starts over from the first frame, on a cleared canvas.
+    void rewind() noexcept;
+
+    // Input iterator over the remaining frames, calling next_frame().
+    [[nodiscard]] FrameIterator begin();
+    [[nodiscard]] std::default_sentinel_t end() const noexcept {
+        return std::default_sentinel;
+    }
+
+    private:
+    // Decodes frames [first, first + count) to RGBA into m_decoded, which
+    // is left as it was if any of them fails.
+    void decode_batch( const std::size_t first, const std::size_t count );
+    // Decodes frame `index` to RGBA, frame width * height pixels.
+    [[nodiscard]] std::vector<std::byte>
+    decode_frame( const std::size_t index ) const;
+    // Applies the dispose op of the frame last shown to the canvas.
+    void dispose_previous() noexcept;
+
+    PngDecoder                m_decoder;
+    ApngOptions               m_options;
+    std::vector<FrameControl> m_frames;
+    // Frame data of each frame, fdAT sequence numbers skipped
+    std::vector<std::vector<ZLIB::segment_t>> m_frame_data;
+    std::uint32_t                             m_play_count{ 0 };
+    bool                                      m_default_image_is_frame{ true };
+    std::optional<CONVERT::PaletteLookup>     m_palette_lookup;
+
+    std::vector<std::byte> m_canvas;
+    // Region of the frame last shown, as it was before that frame, for
+    // DisposeOp::PREVIOUS
+    std::vector<std::byte> m_saved_region;
+    // Decoded frames of the current batch, emptied once composited
+    std::vector<std::vector<std::byte>> m_decoded;
+    std::size_t                         m_batch_begin{ 0 };
+    std::size_t                         m_next_frame{ 0 };
+};
+
+class ApngDecoder::FrameIterator
+{
+    public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = AnimationFrame;
+
+    FrameIterator() = default;
+    explicit FrameIterator( ApngDecoder & decoder ) :
+        m_decoder( &decoder ), m_frame( decoder.next_frame() ) {}
+
+    [[nodiscard]] const AnimationFrame & operator*() const noexcept {
+        return *m_frame;
+    }
+    [[nodiscard]] const AnimationFrame * operator->() const noexcept {
+        return &*m_frame;
+    }
+    FrameIterator & operator++() {
+        m_frame = m_decoder->next_frame();
+        return *this;
+    }
+    void operator++( int ) { ++*this; }
+
+    [[nodiscard]] bool
+    operator==( const std::default_sentinel_t ) const noexcept {
+        return !m_frame.has_value();
+    }
+
+    private:
+    ApngDecoder *                 m_decoder{ nullptr };
+    std::optional<AnimationFrame> m_frame{};
+};
+
+inline ApngDecoder::FrameIterator
+ApngDecoder::begin() {
+    return FrameIterator{ *this };
+}
+
+} // namespace PNG
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "png/png_types.hpp"
+
+#include <cstdint>
+
+namespace PNG
+{
+
+// Point reached in a PNG's chunk sequence, set by the critical chunks.
+enum class ChunkStage : std::uint8_t {
+    // clang-format off
+    START            = 0, // Nothing yet, IHDR must come first
+    HEADER           = 1, // After IHDR
+    PALETTE          = 2, // After PLTE
+    IMAGE_DATA       = 3, // Within the run of IDAT chunks
+    AFTER_IMAGE_DATA = 4, // After the IDAT run
+    END              = 5  // After IEND, nothing may follow
+    // clang-format on
+};
+
+// ChunkOrderValidator: the PNG chunk ordering & cardinality rules as a
+// table-driven state machine. Each known chunk type has a row giving the
+// stages it may appear in, whether it may repeat & the stage it moves the
+// sequence to, found by a hash of the chunk type, so every chunk is
+// checked with one lookup as soon as its type is read, before its CRC or
+// payload. Parsers feed it chunk by chunk, rejecting a malformed file
+// before any image data is decoded. Unknown chunk types may appear
+// anywhere between IHDR & IEND. Payloads are not looked at, beyond the
+// colour type the parser passes on from IHDR.
+class ChunkOrderValidator
+{
+    public:
+    // Checks that a chunk of `type` may come next & advances past it.
+    // Returns NONE, or the first error of the sequence, which sticks:
+    // MISSING_IHDR if the first chunk isn't IHDR, MISSING_PLTE for IDAT
+    // of an indexed image without PLTE, MISSING_IDAT for IEND before any
+    // IDAT, BAD_PLTE for PLTE in a greyscale image, else BAD_CHUNK_ORDER.
+    [[nodiscard]] png_error_t next( const PngChunkType type ) noexcept;
+
+    // Colour type of the IHDR just checked, which decides whether PLTE is
+    // required, allowed or forbidden.
+    void set_colour_type( const IHDR::ColourType colour_type ) noexcept {
+        m_colour_type = colour_type;
+    }
+
+    // Checks that the sequence is complete: NONE once IEND has been seen,
+    // else the sticky error or TRUNCATED_CHUNK.
+    [[nodiscard]] png_error_t finish() const noexcept;
+
+    [[nodiscard]] ChunkStage stage() const noexcept { return m_stage; }
+
+    private:
+    ChunkStage       m_stage{ ChunkStage::START };
+    IHDR::ColourType m_colour_type{ IHDR::ColourType::INVALID };
+    // Bit per row of the rule table, set once that chunk type is seen
+    std::uint32_t    m_seen{ 0 };
+    png_error_t      m_error{ png_error_t::NONE };
+};
+
+} // namespace PNG
@@ -3,6 +3,7 @@
 #include "png/png_types.hpp"
 
 #include <ranges>
+#include <span>
 #include <vector>
 
 namespace PNG
@@ -164,12 +165,11 @@ class IhdrChunkPayload final : protected PngChunkPayloadBase
 
     constexpr explicit IhdrChunkPayload( const IhdrChunkPayload & other ) =
         default;
-    constexpr explicit IhdrChunkPayload( IhdrChunkPayload && other ) noexcept;
+    explicit IhdrChunkPayload( IhdrChunkPayload && other ) noexcept;
 
     constexpr IhdrChunkPayload &
     operator=( const IhdrChunkPayload & other ) = default;
-    constexpr IhdrChunkPayload &
-    operator=( IhdrChunkPayload && other ) noexcept;
+    IhdrChunkPayload & operator=( IhdrChunkPayload && other ) noexcept;
 
     [[nodiscard]] constexpr operator bool() const noexcept override {
         return isValid();
@@ -210,6 +210,27 @@ class IhdrChunkPayload final : protected PngChunkPayloadBase
     }
 };
 
+// Bytes of filtered scanlines, filter type bytes included, that the image
+// data of `ihdr` inflates to.
+constexpr std::uint64_t
+image_data_bytes( const IhdrChunkPayload & ihdr ) noexcept {
+    const auto passes{ ihdr.getInterlaceMethod() == InterlaceMethod::ADAM_7 ?
+                           std::span{ adam7_passes } :
+                           std::span{ &full_image_pass, 1 } };
+    std::uint64_t bytes{ 0 };
+    for ( const auto & pass : passes ) {
+        const auto columns{ pass_width( pass, ihdr.getWidth() ) };
+        const auto rows{ pass_height( pass, ihdr.getHeight() ) };
+        if ( columns != 0 && rows != 0 ) {
+            bytes += std::uint64_t{ rows }
+                     * ( scanline_bytes( columns, ihdr.getColourType(),
+                                         ihdr.getBitDepth() )
+                         + 1 );
+        }
+    }
+    return bytes;
+}
+
 } // namespace IHDR
 
 namespace PLTE
@@ -217,8 +238,7 @@ namespace PLTE
 
 // TODO(chunk_size_type): decide whether the channel-split PLTE storage stays on
 // main or is replaced by the typed-size payload model from chunk_size_type.
-constexpr std::vector<Palette>
-bytes_to_palette( const std::span<const std::byte> & data );
+std::vector<Palette> bytes_to_palette( const std::span<const std::byte> & data );
 
 class PlteChunkPayload final : protected PngChunkPayloadBase
 {
@@ -230,19 +250,17 @@ class PlteChunkPayload final : protected PngChunkPayloadBase
     protected:
     public:
     PlteChunkPayload() = delete;
-    constexpr explicit PlteChunkPayload(
-        const std::vector<Palette> & palettes );
-    constexpr explicit PlteChunkPayload(
-        const std::span<const std::byte> & data );
+    explicit PlteChunkPayload( const std::vector<Palette> & palettes );
+    explicit PlteChunkPayload( const std::span<const std::byte> & data );
 
     constexpr ~PlteChunkPayload() = default;
 
     constexpr explicit PlteChunkPayload( const PlteChunkPayload & ) = default;
-    constexpr explicit PlteChunkPayload( PlteChunkPayload && ) noexcept;
+    explicit PlteChunkPayload( PlteChunkPayload && ) noexcept;
 
     constexpr PlteChunkPayload &
     operator=( const PlteChunkPayload & ) = default;
-    constexpr PlteChunkPayload & operator=( PlteChunkPayload && ) noexcept;
+    PlteChunkPayload & operator=( PlteChunkPayload && ) noexcept;
 
     [[nodiscard]] constexpr operator bool() const noexcept override {
         return isValid();
@@ -258,11 +276,14 @@ class PlteChunkPayload final : protected PngChunkPayloadBase
                         .blue = b_channel[idx] };
     }
 
-    constexpr auto rChannel() const noexcept { return r_channel; }
-    constexpr auto gChannel() const noexcept { return g_channel; }
-    constexpr auto bChannel() const noexcept { return b_channel; }
+    constexpr const auto & rChannel() const noexcept { return r_channel; }
+    constexpr const auto & gChannel() const noexcept { return g_channel; }
+    constexpr const auto & bChannel() const noexcept { return b_channel; }
+    constexpr std::size_t  getEntries() const noexcept {
+        return r_channel.size();
+    }
 
-    constexpr auto getPalettes() const noexcept;
+    std::vector<Palette> getPalettes() const noexcept;
 };
 } // namespace PLTE
 
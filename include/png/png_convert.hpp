@@ -0,0 +1,142 @@
+#pragma once
+
+#include "png/png_chunk_payload.hpp"
+#include "png/png_types.hpp"
+
+#include <array>
+#include <span>
+
+namespace PNG
+{
+
+namespace CONVERT
+{
+
+// Multiplier stretching a 1, 2 or 4 bit sample to the full 0-255 range,
+// e.g. 0b11 -> 0xFF for 2 bit samples.
+constexpr std::uint8_t
+full_range_scale( const IHDR::BitDepth bit_depth ) noexcept {
+    return static_cast<std::uint8_t>( 0xFF / ( ( 1U << bit_depth ) - 1 ) );
+}
+
+// Sample `index` of a scanline of `bit_depth` bit samples, 16 bit samples
+// big endian & smaller ones packed MSB first.
+constexpr std::uint16_t
+read_sample( const std::span<const std::byte> row, const std::size_t index,
+             const IHDR::BitDepth bit_depth ) noexcept {
+    if ( bit_depth == 16 ) {
+        return static_cast<std::uint16_t>(
+            std::to_integer<std::uint32_t>( row[2 * index] ) << byte_bits
+            | std::to_integer<std::uint32_t>( row[2 * index + 1] ) );
+    }
+    const auto bit{ index * bit_depth };
+    const auto shift{ byte_bits - bit_depth - bit % byte_bits };
+    return static_cast<std::uint16_t>(
+        ( std::to_integer<std::uint32_t>( row[bit / byte_bits] ) >> shift )
+        & ( ( 1U << bit_depth ) - 1 ) );
+}
+
+// Counterpart of read_sample. Samples below 8 bits are OR'ed in, so the
+// row must start zeroed.
+constexpr void
+write_sample( const std::span<std::byte> row, const std::size_t index,
+              const std::uint16_t value,
+              const IHDR::BitDepth bit_depth ) noexcept {
+    if ( bit_depth == 16 ) {
+        row[2 * index] = static_cast<std::byte>( value >> byte_bits );
+        row[2 * index + 1] = static_cast<std::byte>( value & 0xFF );
+        return;
+    }
+    const auto bit{ index * bit_depth };
+    const auto shift{ byte_bits - bit_depth - bit % byte_bits };
+    row[bit / byte_bits] |= static_cast<std::byte>( value << shift );
+}
+
+// Copies pixel `source_index` of `source` to pixel `target_index` of
+// `target`. Pixels below 8 bits are packed MSB first, as in PNG scanlines.
+void copy_pixel( const std::span<const std::byte> source,
+                 const std::size_t                source_index,
+                 const std::span<std::byte>       target,
+                 const std::size_t                target_index,
+                 const std::uint8_t               bits ) noexcept;
+
+// Expands `count` packed samples of `bit_depth` (1, 2 or 4) bits, MSB first
+// as in PNG scanlines, into one byte per sample. Samples keep their value
+// (palette indices) unless `scale` is set, in which case they are stretched
+// to the full 0-255 range (greyscale).
+void unpack_samples( const std::span<const std::byte> packed,
+                     const std::span<std::byte> out, const std::size_t count,
+                     const IHDR::BitDepth bit_depth,
+                     const bool           scale ) noexcept;
+
+// PaletteLookup: PLTE & tRNS entries spread over every possible 8 bit
+// index. Indices past the end of the palette, which the spec leaves to the
+// decoder, read as opaque black. Entries are kept channel split, for
+// in-register table lookups, and interleaved RGBA, for gathers.
+struct PaletteLookup
+{
+    static constexpr std::size_t max_entries{ 256 };
+
+    explicit PaletteLookup( const PLTE::PlteChunkPayload &   palette,
+                            const std::span<const std::byte> transparency = {} );
+
+    alignas( 64 ) std::array<std::uint8_t, max_entries> red{};
+    alignas( 64 ) std::array<std::uint8_t, max_entries> green{};
+    alignas( 64 ) std::array<std::uint8_t, max_entries> blue{};
+    alignas( 64 ) std::array<std::uint8_t, max_entries> alpha{};
+    alignas( 64 ) std::array<std::byte, 4 * max_entries> rgba{};
+    std::size_t entries{ 0 };
+};
+
+// Expands `count` 8 bit palette indices into RGB, or RGBA if `with_alpha`
+// is set, in which case tRNS alpha is merged in the same pass.
+void expand_palette( const std::span<const std::byte> indices,
+                     const std::span<std::byte> out, const std::size_t count,
+                     const PaletteLookup & lookup,
+                     const bool            with_alpha ) noexcept;
+
+// 16 bit samples are reduced to 8 bits as ( sample * 255 + offset ) >> 16,
+// with one offset per pixel column (mod 8) of the row.
+using pixel_offsets_t = std::array<std::uint16_t, 8>;
+
+// Offsets rounding every sample to the nearest 8 bit value.
+constexpr pixel_offsets_t rounding_offsets{ 32895, 32895, 32895, 32895,
+                                            32895, 32895, 32895, 32895 };
+
+// Offsets applying an 8 x 8 ordered (Bayer) dither to row `y`, for a row
+// whose pixels sit at columns x_offset + k * x_step (Adam7 passes).
+constexpr pixel_offsets_t
+dither_offsets( const std::uint32_t y, const std::uint32_t x_offset = 0,
+                const std::uint32_t x_step = 1 ) noexcept {
+    // Bit-reversed interleave of the row & column bits
+    const auto bayer = []( const std::uint32_t row, const std::uint32_t col ) {
+        const auto mixed{ row ^ col };
+        return ( ( mixed & 1 ) << 5 ) | ( ( row & 1 ) << 4 )
+               | ( ( mixed & 2 ) << 2 ) | ( ( row & 2 ) << 1 )
+               | ( ( mixed & 4 ) >> 1 ) | ( ( row & 4 ) >> 2 );
+    };
+
+    pixel_offsets_t offsets{};
+    for ( std::uint32_t k{ 0 }; k < offsets.size(); ++k ) {
+        // Thresholds spread evenly over ( 0, 65536 )
+        offsets[k] = static_cast<std::uint16_t>(
+            ( 2 * bayer( y % 8, ( x_offset + k * x_step ) % 8 ) + 1 ) * 512 );
+    }
+    return offsets;
+}
+
+// Converts `count` big endian 16 bit samples to native byte order.
+void swap_samples_16( const std::span<const std::byte> samples,
+                      const std::span<std::byte>       out,
+                      const std::size_t                count ) noexcept;
+
+// Reduces the big endian 16 bit samples of `pixels` pixels of `channels`
+// samples each to 8 bits. Pixel k of the row uses offsets[k % 8].
+void reduce_samples_16( const std::span<const std::byte> samples,
+                        const std::span<std::byte> out, const std::size_t pixels,
+                        const std::size_t       channels,
+                        const pixel_offsets_t & offsets ) noexcept;
+
+} // namespace CONVERT
+
+} // namespace PNG
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "common/crc.hpp"
+#include "common/inflate.hpp"
+#include "common/metrics.hpp"
+#include "common/parallel.hpp"
+#include "png/png_chunk_payload.hpp"
+#include "png/png_convert.hpp"
+#include "png/png_image.hpp"
+#include "png/png_index.hpp"
+#include "png/png_types.hpp"
+
+#include <expected>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace PNG
+{
+
+// PngChunkView: non-owning view of a single chunk within a raw PNG buffer.
+struct PngChunkView
+{
+    std::size_t                offset; // Offset of the chunk's length field
+    PngChunkType               type;
+    std::span<const std::byte> data;
+    std::uint32_t              crc;
+};
+
+// Called with the (partially decoded) output image once a pass completes.
+// Passes are numbered from 1, non-interlaced images complete as pass 1.
+using PassCallback =
+    std::function<void( const std::uint8_t               pass,
+                        const std::span<const std::byte> image,
+                        const ImageLayout &              layout )>;
+
+// Output of 16 bit samples, which PNG stores big endian.
+enum class SampleDepth16 : std::uint8_t {
+    // clang-format off
+    UNCHANGED     = 0, // 16 bit, big endian
+    NATIVE_ENDIAN = 1, // 16 bit, native byte order
+    ROUND_TO_8    = 2, // 8 bit, rounded to nearest
+    DITHER_TO_8   = 3  // 8 bit, 8 x 8 ordered dither
+    // clang-format on
+};
+
+struct DecodeOptions
+{
+    // Progressive mode. When set, each Adam7 pass pixel is replicated over
+    // the block it stands in for until later passes refine it, so the image
+    // handed to the callback is a full size approximation after every pass.
+    // The first preview only costs inflating pass 1 (1/64 of the pixels).
+    PassCallback on_pass_complete{};
+
+    // Expand 1, 2 & 4 bit samples to one byte per sample as each row is
+    // unfiltered. Greyscale samples are additionally stretched to the full
+    // 0-255 range if scale_greyscale is set, palette indices never are.
+    bool unpack_samples{ false };
+    bool scale_greyscale{ false };
+
+    // Expand palette indices to 8 bit RGB, or RGBA with the tRNS alpha
+    // merged in if the image has a tRNS chunk.
+    bool expand_palette{ false };
+
+    // 16 bit conversions, applied in the same per-row pass as the rest.
+    SampleDepth16 sixteen_bit{ SampleDepth16::UNCHANGED };
+
+    // Decode only image rows [first_row, end_row), clamped to the image
+    // height. The output holds just those rows. Rows above the range are
+    // unfiltered, as later rows depend on them, but never converted or
+    // written. Inflating stops once the last row of the range is produced,
+    // so the rest of the stream is neither read nor checked.
+    std::uint32_t first_row{ 0 };
+    std::uint32_t end_row{ std::numeric_limits<std::uint32_t>::max() };
+
+    // Index from build_index() for this image. Row ranges then start
+    // inflating at the nearest checkpoint above first_row. Throws BAD_INDEX
+    // if the index was built from different image data.
+    const DecodeIndex * index{ nullptr };
+
+    // Worker threads for images with full flush points (see
+    // PngDecoder::sync_points()), 0 for one per core. The IDAT stream is
+    // then inflated band by band in parallel, each band being unfiltered
+    // as soon as the one before it is, from that band's last row. Used
+    // for whole, non-interlaced images only, others decode on the calling
+    // thread.
+    std::uint32_t threads{ 1 };
+};
+
+// IndexedImage: an indexed-colour image kept in indexed form, one byte per
+// pixel. The palette & transparency view into the decoder that produced
+// the image, which must outlive it.
+struct IndexedImage
+{
+    std::vector<std::byte>         indices;
+    ImageLayout                    layout;
+    const PLTE::PlteChunkPayload & palette;
+    std::span<const std::byte>     transparency; // tRNS alpha, may be empty
+};
+
+// PngDecoder: parses the chunk layout of an in-memory PNG up front, then
+// decodes the image data on request. Scanlines are inflated, unfiltered &
+// written out one at a time, so decodes on one thread hold no intermediate
+// copy of the decompressed stream. Parallel decodes hold it in bands, one
+// per flush point. By default output samples keep the PNG's own
+// layout: packed for bit depths below 8, big endian for 16 bit depths.
+// DecodeOptions selects conversions, which are applied per row in the
+// same loop.
+class PngDecoder
+{
+    public:
+    PngDecoder() = delete;
+    explicit PngDecoder( const std::span<const std::byte> raw_data );
+
+    // Parses the chunk layout as the constructor does, but returns the
+    // error of a malformed PNG rather than throwing it, so a scan over many
+    // files pays a branch for each corrupt one instead of an unwind. Only
+    // allocation failure still throws.
+    [[nodiscard]] static std::expected<PngDecoder, png_error_t>
+    try_parse( const std::span<const std::byte> raw_data );
+
+    // Tag of the constructor that leaves the chunks unread. Only PngDecoder
+    // can make one, the constructor is public so std::expected can build a
+    // decoder in place.
+    class Unparsed
+    {
+        explicit Unparsed() = default;
+        friend class PngDecoder;
+    };
+    PngDecoder( const std::span<const std::byte> raw_data, Unparsed );
+
+    [[nodiscard]] const IHDR::IhdrChunkPayload & header() const noexcept {
+        return *m_ihdr;
+    }
+    [[nodiscard]] std::span<const PngChunkView> chunks() const noexcept {
+        return m_chunks;
+    }
+    [[nodiscard]] const std::optional<PLTE::PlteChunkPayload> &
+    palette() const noexcept {
+        return m_plte;
+    }
+    // Offsets into the concatenated IDAT data just past each empty stored
+    // block, which is what a full flush leaves behind. Inflating may
+    // restart at these, if the flush also reset the dictionary. Taken from
+    // the syNc chunk when the image has a valid one, else found by scanning
+    // the IDAT data on the first call. Scanned points may be sync flushes,
+    // which keep the dictionary, or marker bytes within the data, so
+    // parallel decodes check every band & fall back to inflating in order.
+    [[nodiscard]] std::span<const std::uint64_t> sync_points();
+    // tRNS payload, empty if the image has none
+    [[nodiscard]] std::span<const std::byte> transparency() const noexcept {
+        return m_transparency;
+    }
+    // Time & bytes of each stage run for this image while METRICS are
+    // enabled, the chunk walk & every decode so far. Parallel decodes time
+    // inflating & unfiltering their bands as a whole, as the inflate
+    // stage, on the calling thread.
+    [[nodiscard]] const METRICS::StageMetrics & metrics() const noexcept {
+        return m_metrics;
+    }
+
+    // Layout of the decoded image (or row range) with rows `stride` bytes
+    // apart. A stride of 0 packs rows tightly, as in the buffer returned by
+    // decode().
+    [[nodiscard]] ImageLayout
+    layout( const DecodeOptions & options = {},
+            const std::size_t     stride = 0 ) const noexcept;
+
+    [[nodiscard]] std::vector<std::byte>
+    decode( const DecodeOptions & options = {} );
+
+    // Decodes into a caller owned buffer, rows `stride` bytes apart (0 for
+    // tightly packed). Stride padding is left untouched. The buffer must
+    // hold layout( options, stride ).required_size() bytes, else BAD_OUTPUT
+    // is thrown before any data is inflated. Scratch buffers, the inflated
+    // bands & the worker threads of parallel decodes are kept by the
+    // decoder, so repeated decodes of the same image allocate nothing.
+    // Bands that fail their checks are freed, their decodes allocate anew.
+    void decode_into( const std::span<std::byte> image,
+                      const std::size_t          stride,
+                      const DecodeOptions &      options = {} );
+
+    // Decodes into a new Image with 64 byte aligned rows, allocated from
+    // `resource`.
+    [[nodiscard]] Image
+    decode_to_image( const DecodeOptions &       options = {},
+                     std::pmr::memory_resource * resource =
+                         std::pmr::get_default_resource() );
+
+    // Inflates & unfilters the whole image once, recording a checkpoint
+    // every `rows_per_checkpoint` rows. Adam7 images, whose rows depend on
+    // every pass, get an index without checkpoints.
+    [[nodiscard]] DecodeIndex
+    build_index( const std::uint32_t rows_per_checkpoint );
+
+    // Decodes an indexed-colour image to its 8 bit index plane, without
+    // palette expansion. Throws NOT_INDEXED for other colour types.
+    [[nodiscard]] IndexedImage
+    decode_indexed( const DecodeOptions & options = {} );
+
+    private:
+    // Reads & checks the chunk layout, returning the first error found.
+    [[nodiscard]] png_error_t read_chunks();
+    // Fills m_sync_points from the syNc chunk, on the first call, if its
+    // offsets all point just past a full flush marker. Returns true if
+    // they do.
+    [[nodiscard]] bool read_sync_index();
+
+    // Colour type & bit depth of decoded rows once `options` are applied.
+    [[nodiscard]] std::pair<IHDR::ColourType, IHDR::BitDepth>
+    output_format( const DecodeOptions & options ) const noexcept;
+
+    // Row range of `options`, clamped to the image.
+    [[nodiscard]] std::pair<std::uint32_t, std::uint32_t>
+    row_range( const DecodeOptions & options ) const noexcept;
+
+    // True if rows need converting, even if their format is unchanged.
+    [[nodiscard]] bool
+    converts_rows( const DecodeOptions & options ) const noexcept;
+
+    // Converts the `columns` unfiltered pixels of scanline `row` of `pass`
+    // to the output format.
+    void convert_scanline( const std::span<const std::byte> scanline,
+                           const std::uint32_t              row,
+                           const IHDR::Adam7Pass &          pass,
+                           const std::uint32_t              columns,
+                           const std::span<std::byte>       target,
+                           const DecodeOptions &            options ) noexcept;
+    // Inflates the IDAT bands between sync points on `threads` threads into
+    // m_bands, unfiltering the rows of the leading bands that hold whole
+    // scanlines of `scanline_size` bytes in place. Returns false, freeing
+    // the bands, if they don't chain into one valid stream no larger than
+    // the image, e.g. a sync point was a false match or the flush kept
+    // the dictionary.
+    [[nodiscard]] bool inflate_bands( const std::uint32_t threads,
+                                      const std::size_t   scanline_size,
+                                      const std::size_t   filter_bpp );
+
+    // Inflates the next scanline of the stream, or copies it from m_bands,
+    // filter type byte included, & unfilters it against `previous` unless
+    // it was unfiltered in its band. Both stages are timed into
+    // `row_stages`, if given.
+    void read_scanline( const std::span<std::byte>       scanline,
+                        const std::span<const std::byte> previous,
+                        const std::size_t                filter_bpp,
+                        METRICS::StageBatch * const      row_stages );
+    void decode_image( const std::span<std::byte> image,
+                       const ImageLayout &        layout,
+                       const DecodeOptions &      options );
+
+    std::span<const std::byte>            m_raw_data;
+    std::vector<PngChunkView>             m_chunks;
+    std::vector<ZLIB::segment_t>          m_idat_segments;
+    std::optional<IHDR::IhdrChunkPayload> m_ihdr;
+    std::optional<PLTE::PlteChunkPayload> m_plte;
+    std::span<const std::byte>            m_transparency;
+    // Adler-32 of the IHDR & IDAT chunk CRCs, identifies DecodeIndexes
+    std::uint32_t                         m_fingerprint{ 0 };
+    std::span<const std::byte>            m_sync_chunk;
+    // Found on first use, from the syNc chunk or else by scanning
+    std::vector<std::uint64_t>            m_sync_points;
+    std::optional<bool>                   m_sync_indexed;
+    bool                                  m_sync_scanned{ false };
+    CRC::CrcTable32                       m_crc_calculator;
+    ZLIB::Inflater                        m_inflater;
+    // Current & previous scanline, reused between decodes
+    std::vector<std::byte> m_scanlines;
+    // Converted pixels of an interlaced scanline, before placement
+    std::vector<std::byte> m_converted;
+    // Unpacked indices of a sub-byte scanline, before palette expansion
+    std::vector<std::byte>                m_indices;
+    std::optional<CONVERT::PaletteLookup> m_palette_lookup;
+    // Inflated bands of a parallel decode & the read position within them
+    std::vector<std::vector<std::byte>>       m_bands;
+    std::size_t                               m_band_index{ 0 };
+    std::size_t                               m_band_offset{ 0 };
+    // Leading bands whose rows are already unfiltered
+    std::size_t                               m_unfiltered_bands{ 0 };
+    bool                                      m_reading_bands{ false };
+    // Input & Adler-32 of each band, reused between decodes
+    std::vector<std::vector<ZLIB::segment_t>> m_band_inputs;
+    std::vector<std::uint32_t>                m_band_checksums;
+    // Workers of the last parallel decode, kept while their count holds
+    std::unique_ptr<PARALLEL::WorkerPool>     m_pool;
+    METRICS::StageMetrics                     m_metrics{};
+};
+
+} // namespace PNG
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "common/crc.hpp"
+#include "png/png_encoder.hpp"
+#include "png/png_types.hpp"
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace PNG
+{
+
+// PngEditor: metadata edits to a PNG that leave its image data alone.
+// Opening walks the chunk headers only, reading no chunk data & checking
+// no CRCs, so it costs the same whatever the size of the IDAT data.
+// Writing copies every chunk no edit touched byte for byte, CRC included,
+// in runs as long as the source allows, & serialises only the chunks
+// edits added. Critical chunks can't be edited, & anything after IEND is
+// dropped.
+class PngEditor
+{
+    public:
+    PngEditor() = delete;
+    // Edits the PNG in `source`, which must outlive the editor. Throws
+    // BAD_HEADER for a missing signature, TRUNCATED_CHUNK if a chunk runs
+    // past the data or there is no IEND, & MISSING_IHDR unless the first
+    // chunk is IHDR.
+    explicit PngEditor( const std::span<const std::byte> source );
+#if defined( __linux__ )
+    // Edits the PNG file at `path`, mapped read only. Writing to a file
+    // descriptor then copies untouched chunks within the kernel, with
+    // copy_file_range or sendfile, where the file systems allow. Throws
+    // READ_FAILED if the file can't be opened or mapped, & as above.
+    explicit PngEditor( const std::filesystem::path & path );
+#endif
+    ~PngEditor();
+
+    PngEditor( const PngEditor & ) = delete;
+    PngEditor & operator=( const PngEditor & ) = delete;
+    PngEditor( PngEditor && other ) noexcept;
+    PngEditor & operator=( PngEditor && other ) noexcept;
+
+    // Types of the chunks as they will be written, in order.
+    [[nodiscard]] std::vector<PngChunkType> chunk_types() const;
+
+    // Removes every chunk of `type`. Throws BAD_EDIT for a critical chunk.
+    void remove( const PngChunkType type );
+    // Removes the tEXt, zTXt & iTXt chunks with keyword `keyword`.
+    void remove_text( const std::string_view keyword );
+    // Removes every ancillary chunk but tRNS, which pixels depend on, &
+    // syNc, which indexes the image data.
+    void strip_metadata();
+    // Replaces the chunks of `type` by one holding `data`, or adds it where
+    // the PNG specification places that type: before PLTE for colour
+    // space chunks, after IDAT for text & tIME, else before IDAT. Throws
+    // BAD_EDIT for a critical chunk or text chunk (see set_text).
+    void set( const PngChunkType type, const std::span<const std::byte> data );
+    // Replaces the text chunks with keyword `keyword` by one tEXt chunk.
+    // Throws BAD_EDIT unless the keyword is 1 to 79 bytes without NULs, &
+    // for text holding a NUL.
+    void set_text( const std::string_view keyword,
+                   const std::string_view text );
+
+    // Re-splits the image data into IDAT chunks of `chunk_size` data bytes,
+    // the last holding the rest, without recompressing it: one huge chunk
+    // becomes several a streaming decoder can check as they arrive, many
+    // tiny ones fewer. Each chunk's CRC is computed as its data is copied,
+    // so no chunk is ever buffered whole. Throws BAD_EDIT for a size of 0
+    // or over 2^31 - 1.
+    void rechunk_idat( const std::uint32_t chunk_size );
+
+    // Writes the edited PNG to `sink`.
+    void write( const ByteSink & sink ) const;
+#if defined( __linux__ )
+    // Writes the edited PNG to the open file descriptor `fd`, from its
+    // current offset. Throws WRITE_FAILED if a write fails.
+    void write( const int fd ) const;
+#endif
+
+    private:
+    // One chunk of the output: a whole chunk of the source, or new bytes
+    struct Chunk
+    {
+        PngChunkType           type;
+        std::size_t            offset; // In the source, if `bytes` is empty
+        std::size_t            size;   // Length, type, data & CRC
+        std::vector<std::byte> bytes;
+    };
+
+    void read_chunks();
+    // Unmaps & closes the source file, if any.
+    void close_source() noexcept;
+    // Chunk data of a source chunk, or the new chunk's
+    [[nodiscard]] std::span<const std::byte>
+    chunk_data( const Chunk & chunk ) const noexcept;
+    // Index in m_chunks a new chunk of `type` goes before
+    [[nodiscard]] std::size_t
+    insert_position( const PngChunkType type ) const noexcept;
+    // Replaces the chunks `matches` picks by a new chunk of `type` holding
+    // `data`, at the first match's position or insert_position().
+    template <typename Matches>
+    void replace( const PngChunkType               type,
+                  const std::span<const std::byte> data,
+                  const Matches &                  matches );
+    // Data bytes of all the IDAT chunks of the source.
+    [[nodiscard]] std::uint64_t idat_data_bytes() const noexcept;
+    // Calls `copy( offset, size )` for each run of consecutive source
+    // chunks & `emit( bytes )` for each new chunk, in output order.
+    template <typename Copy, typename Emit>
+    void for_each_piece( const Copy & copy, const Emit & emit ) const;
+    // Writes the IDAT data as chunks of m_idat_size bytes, as
+    // for_each_piece does: the data is copied from the source, headers &
+    // CRCs are emitted.
+    template <typename Copy, typename Emit>
+    void write_rechunked_idat( const Copy & copy, const Emit & emit ) const;
+
+    std::span<const std::byte> m_source;
+    std::vector<Chunk>         m_chunks;
+    CRC::CrcTable32            m_crc_calculator;
+    // Data bytes per IDAT chunk written, 0 to keep the source's chunks
+    std::uint32_t              m_idat_size{ 0 };
+    // Mapped file, if editing one
+    int                        m_fd{ -1 };
+    bool                       m_mapped{ false };
+};
+
+} // namespace PNG
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "common/crc.hpp"
+#include "common/deflate.hpp"
+#include "common/parallel.hpp"
+#include "png/png_chunk_payload.hpp"
+#include "png/png_types.hpp"
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace PNG
+{
+
+// Receives the encoded file in order, in pieces of any size. Throwing
+// aborts the encode.
+using ByteSink = std::function<void( const std::span<const std::byte> bytes )>;
+
+// Sink appending to `buffer`, which must outlive it.
+[[nodiscard]] ByteSink buffer_sink( std::vector<std::byte> & buffer );
+
+#if defined( __linux__ )
+// Sink writing to the open file descriptor `fd`, which it doesn't close.
+// Throws WRITE_FAILED if a write fails.
+[[nodiscard]] ByteSink fd_sink( const int fd );
+#endif
+
+struct EncodeOptions
+{
+    // Largest IDAT chunk, in bytes of chunk data. Compressed data is held
+    // back until it fills a chunk, the last one excepted.
+    std::uint32_t idat_size{ 65536 };
+
+    ZLIB::CompressionLevel level{ ZLIB::CompressionLevel::DEFAULT };
+
+    // Filter applied to every scanline.
+    IDAT::FilterType filter{ IDAT::FilterType::NONE };
+
+    // Choose each scanline's filter by the minimum sum of absolute
+    // differences (see IDAT::choose_filter) rather than using `filter`.
+    // Indexed & sub-byte images, which rarely gain from it, keep `filter`.
+    // The choice depends only on the row & the one above, so threaded
+    // bands select the same filters as a single thread.
+    bool adaptive_filter{ false };
+
+    // Full flush the deflate stream every rows_per_segment rows, resetting
+    // its dictionary, & record where each segment starts in a syNc chunk
+    // (see SyncIndex) so decoders can inflate the segments in parallel.
+    // Non-interlaced images only, 0 for a single segment.
+    std::uint32_t rows_per_segment{ 0 };
+
+    // Worker threads, 0 for one per core. Non-interlaced images are then
+    // split into bands of rows (the segments, if rows_per_segment is set),
+    // each filtered & deflated on its own thread & stitched into one zlib
+    // stream. Outside of segments, each band's compressor is primed with
+    // the last 32 KiB of filtered data before it, so matches still reach
+    // across bands. Interlaced images encode on the calling thread.
+    std::uint32_t threads{ 1 };
+};
+
+// PngEncoder: writes a PNG to a ByteSink as rows are supplied. The
+// signature & IHDR are written on construction, PLTE & tRNS on request
+// before the first row, IDAT chunks whenever compressed data fills one &
+// IEND by finish(). At most one IDAT chunk of compressed data is held at a
+// time, and write buffers are allocated once up front. Adam7 images are
+// interlaced from a copy of the raw rows, compressed once the last row
+// arrives. With several threads, rows are instead held until there is a
+// band for each worker, and the batch of bands written once compressed.
+// The worker threads, their compressors & band buffers are likewise set
+// up once & reused by every batch.
+class PngEncoder
+{
+    public:
+    PngEncoder() = delete;
+    // Throws BAD_IHDR for an invalid header & BAD_ENCODE for an idat_size
+    // of 0.
+    PngEncoder( const IHDR::IhdrChunkPayload & header, ByteSink sink,
+                const EncodeOptions & options = {} );
+
+    // Writes a PLTE chunk. Throws BAD_PLTE for 0 or over 256 entries, more
+    // than 2^bit depth entries for an indexed image, or a greyscale image,
+    // & BAD_ENCODE once rows or a palette were written.
+    void write_palette( const std::span<const PLTE::Palette> palette );
+
+    // Writes a tRNS chunk, `transparency` being its data. Throws BAD_TRNS
+    // if the data doesn't fit the colour type or palette, MISSING_PLTE for
+    // an indexed image without a palette yet & BAD_ENCODE once rows were
+    // written.
+    void write_transparency( const std::span<const std::byte> transparency );
+
+    // Appends rows of pixel data in the PNG sample layout (packed below 8
+    // bits, big endian 16 bit samples), `stride` bytes apart (0 for tightly
+    // packed). The last row needn't be padded. Throws BAD_ENCODE if `rows`
+    // isn't a whole number of rows or runs past the image, & MISSING_PLTE
+    // for an indexed image without a palette.
+    void write_rows( const std::span<const std::byte> rows,
+                     const std::size_t                stride = 0 );
+
+    // Writes the remaining IDAT data, the syNc chunk if any & IEND. Throws
+    // BAD_ENCODE unless every row was written.
+    void finish();
+
+    [[nodiscard]] const IHDR::IhdrChunkPayload & header() const noexcept {
+        return m_ihdr;
+    }
+    [[nodiscard]] constexpr std::uint32_t rows_written() const noexcept {
+        return m_rows_written;
+    }
+    [[nodiscard]] constexpr bool finished() const noexcept {
+        return m_finished;
+    }
+
+    private:
+    // Writes a whole chunk, the CRC computed over the type & then the data.
+    void write_chunk( const PngChunkType               type,
+                      const std::span<const std::byte> data );
+    // Writes the filter type byte, then `row` filtered against `previous`,
+    // choosing the filter if m_adaptive_filter is set.
+    void filter_scanline( const std::span<const std::byte> row,
+                          const std::span<const std::byte> previous,
+                          const std::span<std::byte>       filtered ) const;
+    // Filters `row` against m_previous & compresses it, filter type first.
+    void encode_scanline( const std::span<const std::byte> row );
+    // Compresses the rows of m_batch after m_batch_start_row, one band per
+    // worker, & writes the bands in order.
+    void encode_batch();
+    // Filters & compresses rows [first_row, end_row) of m_batch into
+    // `output` with `deflater`, as a piece of the zlib stream of the whole
+    // image. Returns the Adler-32 of the band's filtered data.
+    [[nodiscard]] std::uint32_t
+    encode_band( const std::uint32_t first_row, const std::uint32_t end_row,
+                 ZLIB::Deflater &         deflater,
+                 std::vector<std::byte> & filtered,
+                 std::vector<std::byte> & output ) const;
+    void compress( const std::span<const std::byte> data,
+                   const ZLIB::deflate_flush_t      flush );
+    // Writes the full IDAT chunks of m_idat, or all of it if `all` is set.
+    void write_idat( const bool all );
+    // Compresses the Adam7 passes of m_interlace_rows.
+    void encode_interlaced();
+
+    IHDR::IhdrChunkPayload m_ihdr;
+    ByteSink               m_sink;
+    EncodeOptions          m_options;
+    CRC::CrcTable32        m_crc_calculator;
+    ZLIB::Deflater         m_deflater;
+    std::size_t            m_row_bytes;
+    std::size_t            m_filter_bpp;
+    bool                   m_adaptive_filter;
+    // Compressed data not yet written
+    std::vector<std::byte> m_idat;
+    // Previous unfiltered scanline of the pass, zero for the first
+    std::vector<std::byte> m_previous;
+    // Filter type byte & filtered scanline
+    std::vector<std::byte> m_filtered;
+    // Adam7: every raw row until the image is complete, & one pass row
+    std::vector<std::byte>     m_interlace_rows;
+    std::vector<std::byte>     m_pass_row;
+    std::vector<std::uint64_t> m_sync_points;
+    // Threaded encoding: rows per band, raw rows from m_batch_first_row
+    // (carried over from the last batch to filter & prime its successor)
+    // & per band compressors & scratch. 0 band rows when encoding on the
+    // calling thread.
+    std::uint32_t                         m_band_rows{ 0 };
+    std::uint32_t                         m_worker_count{ 1 };
+    std::uint32_t                         m_batch_first_row{ 0 };
+    std::uint32_t                         m_batch_start_row{ 0 };
+    std::vector<std::byte>                m_batch;
+    std::vector<ZLIB::Deflater>           m_band_deflaters;
+    std::vector<std::vector<std::byte>>   m_band_filtered;
+    std::vector<std::vector<std::byte>>   m_band_output;
+    std::unique_ptr<PARALLEL::WorkerPool> m_pool;
+    // Adler-32 of the filtered data & compressed bytes of the bands so far
+    std::uint32_t m_stream_adler{ ZLIB::Adler32{}.value() };
+    std::uint64_t m_stream_bytes{ 0 };
+    std::size_t                m_palette_entries{ 0 };
+    std::uint32_t              m_rows_written{ 0 };
+    bool                       m_finished{ false };
+};
+
+} // namespace PNG
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "png/png_types.hpp"
+
+#include <array>
+#include <span>
+
+namespace PNG
+{
+
+namespace IDAT
+{
+
+// Distance in bytes between a byte & the corresponding byte of the previous
+// pixel, as used by the Sub, Average & Paeth filters. Rounds up to 1 for
+// bit depths below 8.
+constexpr std::size_t
+filter_bytes_per_pixel( const IHDR::ColourType colour_type,
+                        const IHDR::BitDepth   bit_depth ) noexcept {
+    return std::max<std::size_t>(
+        1, IHDR::bits_per_pixel( colour_type, bit_depth ) / byte_bits );
+}
+
+constexpr std::uint8_t
+paeth_predictor( const std::uint8_t a, const std::uint8_t b,
+                 const std::uint8_t c ) noexcept {
+    const int p{ a + b - c };
+    const int pa{ p > a ? p - a : a - p };
+    const int pb{ p > b ? p - b : b - p };
+    const int pc{ p > c ? p - c : c - p };
+    if ( pa <= pb && pa <= pc ) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Reverses the filter applied to `row` (excluding the filter type byte) in
+// place. `previous_row` is the unfiltered preceding row of the same pass,
+// all zero for the first row. Returns false for an invalid filter type.
+[[nodiscard]] bool unfilter_row( const FilterType                 filter_type,
+                                 const std::span<std::byte>       row,
+                                 const std::span<const std::byte> previous_row,
+                                 const std::size_t bytes_per_pixel ) noexcept;
+
+// Applies `filter_type` to `row` (excluding the filter type byte), writing
+// the filtered bytes to `out`, which must be as long as `row`.
+// `previous_row` is the unfiltered preceding row of the same pass, all
+// zero for the first row. Returns false for an invalid filter type.
+[[nodiscard]] bool filter_row( const FilterType                 filter_type,
+                               const std::span<const std::byte> row,
+                               const std::span<const std::byte> previous_row,
+                               const std::span<std::byte>       out,
+                               const std::size_t bytes_per_pixel ) noexcept;
+
+inline constexpr std::size_t filter_type_count{ static_cast<std::size_t>(
+    FilterType::INVALID ) };
+
+// Minimum sum of absolute differences heuristic: for each filter type, in
+// order, the sum of the filtered bytes of `row` taken as signed values.
+// All five are evaluated in a single pass over the row.
+[[nodiscard]] std::array<std::uint64_t, filter_type_count>
+filter_costs( const std::span<const std::byte> row,
+              const std::span<const std::byte> previous_row,
+              const std::size_t                bytes_per_pixel ) noexcept;
+
+// Filter type with the lowest filter_costs, the lower type on ties.
+[[nodiscard]] FilterType
+choose_filter( const std::span<const std::byte> row,
+               const std::span<const std::byte> previous_row,
+               const std::size_t                bytes_per_pixel ) noexcept;
+
+} // namespace IDAT
+
+} // namespace PNG
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "png/png_types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+
+namespace PNG
+{
+
+// ImageLayout: memory layout of a decoded image buffer.
+struct ImageLayout
+{
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint8_t  bits_per_pixel;
+    std::size_t   stride; // Bytes between the starts of consecutive rows
+
+    [[nodiscard]] constexpr std::size_t size() const noexcept {
+        return stride * height;
+    }
+    // Bytes of pixel data per row, excluding any stride padding
+    [[nodiscard]] constexpr std::size_t row_bytes() const noexcept {
+        return ( std::size_t{ width } * bits_per_pixel + 7 ) / 8;
+    }
+    // Smallest buffer holding the image, the last row needs no padding
+    [[nodiscard]] constexpr std::size_t required_size() const noexcept {
+        return height == 0 ? 0 : ( height - 1 ) * stride + row_bytes();
+    }
+};
+
+// HugePageResource: memory resource backing large allocations with huge
+// pages. Explicit (hugetlbfs) pages are tried first, then transparent huge
+// pages via madvise. Allocations below `threshold` bytes, and every
+// allocation on platforms without huge page support, go to `upstream`.
+class HugePageResource : public std::pmr::memory_resource
+{
+    public:
+    static constexpr std::size_t huge_page_bytes{ std::size_t{ 2 } << 20 };
+
+    explicit HugePageResource(
+        std::pmr::memory_resource * upstream = std::pmr::get_default_resource(),
+        const std::size_t           threshold = huge_page_bytes ) noexcept :
+        m_upstream( upstream ), m_threshold( threshold ) {}
+
+    private:
+    void * do_allocate( const std::size_t bytes,
+                        const std::size_t alignment ) override;
+    void   do_deallocate( void * const p, const std::size_t bytes,
+                          const std::size_t alignment ) override;
+    [[nodiscard]] bool do_is_equal(
+        const std::pmr::memory_resource & other ) const noexcept override;
+
+    std::pmr::memory_resource * m_upstream;
+    std::size_t                 m_threshold;
+};
+
+// Image: owning pixel buffer in the layout PngDecoder produces. Samples
+// per pixel & bits per sample follow the PNG colour type & bit depth. Rows
+// start on row_alignment byte boundaries, the stride being padded up to a
+// multiple of it, so every row can be loaded with aligned vector loads.
+// Padding bytes are left uninitialised.
+class Image
+{
+    public:
+    static constexpr std::size_t row_alignment{ 64 };
+
+    Image() = delete;
+    // Throws BAD_IHDR for colour type & bit depth combinations PNG doesn't
+    // allow. Rows are at least `min_stride` bytes apart.
+    Image( const std::uint32_t width, const std::uint32_t height,
+           const IHDR::ColourType colour_type, const IHDR::BitDepth bit_depth,
+           const std::size_t           min_stride = 0,
+           std::pmr::memory_resource * resource =
+               std::pmr::get_default_resource() );
+    ~Image();
+
+    Image( const Image & ) = delete;
+    Image & operator=( const Image & ) = delete;
+    Image( Image && other ) noexcept;
+    Image & operator=( Image && other ) noexcept;
+
+    [[nodiscard]] constexpr std::uint32_t width() const noexcept {
+        return m_width;
+    }
+    [[nodiscard]] constexpr std::uint32_t height() const noexcept {
+        return m_height;
+    }
+    [[nodiscard]] constexpr IHDR::ColourType colour_type() const noexcept {
+        return m_colour_type;
+    }
+    [[nodiscard]] constexpr IHDR::BitDepth bit_depth() const noexcept {
+        return m_bit_depth;
+    }
+    [[nodiscard]] constexpr std::uint8_t channels() const noexcept {
+        return IHDR::channel_count( m_colour_type );
+    }
+    [[nodiscard]] constexpr std::uint8_t bits_per_pixel() const noexcept {
+        return IHDR::bits_per_pixel( m_colour_type, m_bit_depth );
+    }
+    [[nodiscard]] constexpr std::size_t stride() const noexcept {
+        return m_stride;
+    }
+    [[nodiscard]] constexpr ImageLayout layout() const noexcept {
+        return ImageLayout{ .width = m_width,
+                            .height = m_height,
+                            .bits_per_pixel = bits_per_pixel(),
+                            .stride = m_stride };
+    }
+    [[nodiscard]] std::pmr::memory_resource * resource() const noexcept {
+        return m_resource;
+    }
+
+    // Whole buffer, stride * height bytes
+    [[nodiscard]] std::span<std::byte> data() noexcept {
+        return { m_data, m_stride * m_height };
+    }
+    [[nodiscard]] std::span<const std::byte> data() const noexcept {
+        return { m_data, m_stride * m_height };
+    }
+    // Pixel bytes of row `y`, without padding
+    [[nodiscard]] std::span<std::byte> row( const std::uint32_t y ) noexcept {
+        return { m_data + y * m_stride, layout().row_bytes() };
+    }
+    [[nodiscard]] std::span<const std::byte>
+    row( const std::uint32_t y ) const noexcept {
+        return { m_data + y * m_stride, layout().row_bytes() };
+    }
+
+    private:
+    void release() noexcept;
+
+    std::uint32_t               m_width;
+    std::uint32_t               m_height;
+    IHDR::ColourType            m_colour_type;
+    IHDR::BitDepth              m_bit_depth;
+    std::size_t                 m_stride;
+    std::pmr::memory_resource * m_resource;
+    std::byte *                 m_data;
+};
+
+} // namespace PNG
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common/inflate.hpp"
+#include "png/png_types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace PNG
+{
+
+// RowCheckpoint: decoder state just before scanline `row` is inflated.
+struct RowCheckpoint
+{
+    std::uint32_t row;
+    // Unfiltered scanline row - 1, without its filter type byte, which the
+    // Up, Average & Paeth filters of `row` refer to
+    std::vector<std::byte>  previous_row;
+    ZLIB::InflateCheckpoint inflate;
+};
+
+// DecodeIndex: inflate checkpoints every rows_per_checkpoint rows of a
+// non-interlaced image, built by PngDecoder::build_index. Decodes of a row
+// range start from the nearest checkpoint above it instead of the start of
+// the IDAT stream. An index is tied to the IDAT data it was built from via
+// a fingerprint of the chunk CRCs, and can be kept in a sidecar file.
+class DecodeIndex
+{
+    public:
+    DecodeIndex() noexcept = default;
+    DecodeIndex( const std::uint32_t fingerprint,
+                 const std::uint32_t rows_per_checkpoint,
+                 std::vector<RowCheckpoint> checkpoints ) noexcept :
+        m_fingerprint( fingerprint ),
+        m_rows_per_checkpoint( rows_per_checkpoint ),
+        m_checkpoints( std::move( checkpoints ) ) {}
+
+    [[nodiscard]] constexpr std::uint32_t fingerprint() const noexcept {
+        return m_fingerprint;
+    }
+    [[nodiscard]] constexpr std::uint32_t rows_per_checkpoint() const noexcept {
+        return m_rows_per_checkpoint;
+    }
+    [[nodiscard]] std::span<const RowCheckpoint> checkpoints() const noexcept {
+        return m_checkpoints;
+    }
+
+    // Last checkpoint at or above `row`, nullptr if there is none.
+    [[nodiscard]] const RowCheckpoint *
+    nearest( const std::uint32_t row ) const noexcept;
+
+    // Sidecar format, all integers big endian:
+    //   "PNGX", version, fingerprint, rows per checkpoint, checkpoint count
+    //   per checkpoint: row, previous row, inflate state, window
+    // Byte strings are prefixed by their 32 bit length. Reading throws
+    // BAD_INDEX on malformed input.
+    [[nodiscard]] std::vector<std::byte> serialize() const;
+    [[nodiscard]] static DecodeIndex
+    deserialize( const std::span<const std::byte> bytes );
+
+    void save( const std::filesystem::path & path ) const;
+    [[nodiscard]] static DecodeIndex load( const std::filesystem::path & path );
+
+    private:
+    std::uint32_t              m_fingerprint{ 0 };
+    std::uint32_t              m_rows_per_checkpoint{ 0 };
+    std::vector<RowCheckpoint> m_checkpoints{};
+};
+
+// SyncIndex: data of the private syNc chunk. An encoder that full flushes
+// the deflate stream every rows_per_segment rows, resetting its dictionary,
+// records where each segment after the first starts, as offsets into the
+// concatenated IDAT data. Offsets don't depend on how that data is split
+// into IDAT chunks, so the chunk stays valid when IDATs are re-chunked.
+struct SyncIndex
+{
+    std::uint32_t              rows_per_segment{ 0 };
+    std::vector<std::uint64_t> offsets{};
+
+    // Chunk data, all integers big endian:
+    //   version (1 byte), rows per segment, 8 byte offset per segment
+    // Parsing throws BAD_INDEX on malformed data, try_parse returns it.
+    [[nodiscard]] std::vector<std::byte> serialize() const;
+    [[nodiscard]] static SyncIndex
+    parse( const std::span<const std::byte> data );
+    [[nodiscard]] static std::expected<SyncIndex, png_error_t>
+    try_parse( const std::span<const std::byte> data );
+};
+
+} // namespace PNG
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common/deflate.hpp"
+#include "png/png_chunk_payload.hpp"
+#include "png/png_types.hpp"
+
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace PNG
+{
+
+// ReducedImage: one exact representation of an image's pixels, in the
+// colour type & bit depth it would be encoded with. Rows are tightly
+// packed in the PNG sample layout, as PngEncoder::write_rows takes them.
+struct ReducedImage
+{
+    std::uint32_t                         width;
+    std::uint32_t                         height;
+    IHDR::ColourType                      colour_type;
+    IHDR::BitDepth                        bit_depth;
+    std::optional<PLTE::PlteChunkPayload> palette;      // Indexed only
+    std::vector<std::byte>                transparency; // tRNS data, or none
+    std::vector<std::byte>                pixels;
+};
+
+struct OptimizeOptions
+{
+    // Fixed filters tried with each reduction, plus the adaptive filter
+    // choice of EncodeOptions::adaptive_filter for reductions it applies
+    // to (8 & 16 bit, not indexed) if `adaptive_filter` is set.
+    std::vector<IDAT::FilterType> filters{
+        IDAT::FilterType::NONE, IDAT::FilterType::SUB, IDAT::FilterType::UP,
+        IDAT::FilterType::AVERAGE, IDAT::FilterType::PAETH
+    };
+    bool adaptive_filter{ true };
+
+    std::vector<ZLIB::CompressionLevel> levels{
+        ZLIB::CompressionLevel::DEFAULT, ZLIB::CompressionLevel::BEST
+    };
+
+    // Worker threads the trials are spread over, 0 for one per core.
+    std::uint32_t threads{ 0 };
+};
+
+struct OptimizeResult
+{
+    std::vector<std::byte> png;
+    // Encoding of `png`, unless the input was kept
+    IHDR::ColourType       colour_type;
+    IHDR::BitDepth         bit_depth;
+    IDAT::FilterType       filter;
+    bool                   adaptive_filter;
+    ZLIB::CompressionLevel level;
+    std::size_t            trials;
+    // False if no trial beat the input, which `png` is then a copy of
+    bool reduced;
+};
+
+// Lossless reductions of the PNG `png`: its pixels widened to RGBA, then
+//  - 16 bit samples reduced to 8 bits when every sample repeats its byte,
+//  - alpha dropped when opaque, or replaced by a tRNS colour key when
+//    only fully transparent pixels, all of one colour, use it,
+//  - colour dropped when every pixel is grey, the grey bit depth then
+//    lowered as far as the samples allow,
+//  - and, as an alternative, an indexed image when at most 256 colours are
+//    used, translucent palette entries first to keep tRNS short.
+// Throws as PngDecoder does for an invalid PNG.
+[[nodiscard]] std::vector<ReducedImage>
+lossless_reductions( const std::span<const std::byte> png );
+
+// Encodes every reduction of lossless_reductions() with every filter &
+// level of `options`, the trials running concurrently, & keeps the
+// smallest file, or the input if nothing beats it. Output images are not
+// interlaced & carry only IHDR, PLTE, tRNS, IDAT & IEND: other ancillary
+// chunks are dropped. Throws as PngDecoder does for an invalid PNG, &
+// BAD_ENCODE if `options` allows no trials.
+[[nodiscard]] OptimizeResult optimize( const std::span<const std::byte> png,
+                                       const OptimizeOptions & options = {} );
+
+} // namespace PNG
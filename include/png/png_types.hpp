@@ -8,11 +8,19 @@
 #include <expected>
 #include <iostream>
 // #include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace PNG
 {
 
+// The 8 byte signature every PNG datastream starts with.
+constexpr inline std::size_t   png_signature_bytes{ 8 };
+constexpr inline std::uint64_t png_signature{ 0x89'504E47'0D0A'1A'0A };
+
+// Length, type & CRC fields surrounding every chunk's data.
+constexpr inline std::size_t chunk_overhead_bytes{ 12 };
+
 // PngChunkType
 
 // Chunk types underlying values are set to their hex values.
@@ -99,17 +107,42 @@ enum class PngChunkType : std::uint32_t {
      * to be regarded as transparent.
      * */
     tRNS = 0x74'52'4e'53,
-    zTXt = 0x7a'54'58'74 // Contains compressed text (& compression method
-                         // marker). Same
-                         // limits
-                         // as tEXt
+    zTXt = 0x7a'54'58'74, // Contains compressed text (& compression method
+                          // marker). Same
+                          // limits
+                          // as tEXt
+
+    // PRIVATE CHUNKS:
+    /* syNc:
+     * Offsets of the full flush points of the IDAT stream, see SyncIndex.
+     * Ancillary, private & safe to copy, so other decoders ignore it &
+     * editors keep it.
+     * */
+    syNc = 0x73'79'4e'63,
+
+    // APNG CHUNKS:
+    /* acTL:
+     * Animation control, before the first IDAT: frame count (4 bytes) &
+     * play count (4 bytes, 0 to loop forever).
+     * */
+    acTL = 0x61'63'54'4c,
+    /* fcTL:
+     * Frame control, before each frame's data: sequence number, size,
+     * offset, delay, dispose & blend operations (26 bytes).
+     * */
+    fcTL = 0x66'63'54'4c,
+    /* fdAT:
+     * Frame data: a sequence number (4 bytes) followed by what an IDAT
+     * chunk would hold, for frames other than the default image.
+     * */
+    fdAT = 0x66'64'41'54
 
     /* Lower case first letter = non-critical
      * Lower case last letter = safe to copy,
      * even if application doesn't * understand it.*/
 };
 
-constexpr std::array<PngChunkType, 21> valid_png_chunk{
+constexpr std::array<PngChunkType, 25> valid_png_chunk{
     // clang-format off
     PngChunkType::IHDR,
     PngChunkType::PLTE,
@@ -131,7 +164,11 @@ constexpr std::array<PngChunkType, 21> valid_png_chunk{
     PngChunkType::tEXt,
     PngChunkType::tIME,
     PngChunkType::tRNS,
-    PngChunkType::zTXt
+    PngChunkType::zTXt,
+    PngChunkType::syNc,
+    PngChunkType::acTL,
+    PngChunkType::fcTL,
+    PngChunkType::fdAT
     // clang-format on
 };
 
@@ -172,6 +209,89 @@ is_valid( const PngPixelFormat png_pixel_format ) {
 std::ostream & operator<<( std::ostream &       out_stream,
                            const PngPixelFormat pixel_format );
 
+// png_error_t
+
+enum class png_error_t : std::uint8_t {
+    // clang-format off
+    NONE            = 0,
+    BAD_HEADER      = 1,  // PNG signature mismatch
+    TRUNCATED_CHUNK = 2,  // Chunk extends past the end of the data
+    BAD_CRC         = 3,
+    BAD_IHDR        = 4,
+    MISSING_IHDR    = 5,
+    MISSING_PLTE    = 6,
+    MISSING_IDAT    = 7,
+    BAD_FILTER_TYPE = 8,
+    BAD_IMAGE_DATA  = 9,  // Corrupt or short zlib stream in IDAT
+    BAD_PLTE        = 10, // Entry count not a multiple of 3 or above 256
+    BAD_TRNS        = 11, // More alpha entries than palette entries
+    NOT_INDEXED     = 12, // Indexed output requested for a non-indexed image
+    BAD_OUTPUT      = 13, // Output buffer too small or stride below a row
+    BAD_INDEX       = 14, // Decode index corrupt or from a different image
+    BAD_ENCODE      = 15, // Encoder calls out of order, or rows missing
+    WRITE_FAILED    = 16, // Output sink could not take the encoded bytes
+    BAD_EDIT        = 17, // Edit to a critical chunk or invalid chunk data
+    READ_FAILED     = 18, // Input file could not be opened or mapped
+    BAD_ANIMATION   = 19, // APNG chunks invalid, out of order or missing
+    BAD_CHUNK_ORDER = 20  // Chunk misplaced, repeated or after IEND
+    // clang-format on
+};
+
+[[nodiscard]] constexpr const char *
+error_message( const png_error_t error ) noexcept {
+    switch ( error ) {
+    case png_error_t::NONE: return "No error";
+    case png_error_t::BAD_HEADER: return "Invalid PNG signature";
+    case png_error_t::TRUNCATED_CHUNK: return "Truncated chunk";
+    case png_error_t::BAD_CRC: return "Chunk CRC mismatch";
+    case png_error_t::BAD_IHDR: return "Invalid IHDR chunk";
+    case png_error_t::MISSING_IHDR: return "Missing IHDR chunk";
+    case png_error_t::MISSING_PLTE: return "Missing PLTE chunk";
+    case png_error_t::MISSING_IDAT: return "Missing IDAT chunk";
+    case png_error_t::BAD_FILTER_TYPE: return "Invalid scanline filter type";
+    case png_error_t::BAD_IMAGE_DATA: return "Corrupt image data";
+    case png_error_t::BAD_PLTE: return "Invalid PLTE chunk";
+    case png_error_t::BAD_TRNS: return "Invalid tRNS chunk";
+    case png_error_t::NOT_INDEXED: return "Image is not indexed colour";
+    case png_error_t::BAD_OUTPUT:
+        return "Output buffer too small for the decoded image";
+    case png_error_t::BAD_INDEX:
+        return "Decode index is corrupt or belongs to another image";
+    case png_error_t::BAD_ENCODE:
+        return "Encoder used out of order or image incomplete";
+    case png_error_t::WRITE_FAILED: return "Failed to write encoded output";
+    case png_error_t::BAD_EDIT: return "Invalid chunk edit";
+    case png_error_t::READ_FAILED: return "Failed to read input file";
+    case png_error_t::BAD_ANIMATION: return "Invalid APNG animation";
+    case png_error_t::BAD_CHUNK_ORDER: return "Chunk out of order";
+        // clang-format off
+    COLD default: return "Unknown png_error_t";
+        // clang-format on
+    }
+}
+
+std::ostream & operator<<( std::ostream & out_stream, const png_error_t error );
+
+class png_error : public std::runtime_error
+{
+    public:
+    explicit png_error( const png_error_t error ) :
+        std::runtime_error( error_message( error ) ), m_error( error ) {}
+
+    [[nodiscard]] constexpr png_error_t error() const noexcept {
+        return m_error;
+    }
+
+    private:
+    png_error_t m_error;
+};
+
+class bad_png_header : public png_error
+{
+    public:
+    bad_png_header() : png_error( png_error_t::BAD_HEADER ) {}
+};
+
 
 // Types for the IHDR chunk
 namespace IHDR
@@ -247,6 +367,37 @@ is_valid( const ColourType colour_type, const BitDepth bit_depth ) {
 std::ostream & operator<<( std::ostream &   out_stream,
                            const ColourType colour_type );
 
+// Samples per pixel for each colour type.
+constexpr std::uint8_t
+channel_count( const ColourType colour_type ) noexcept {
+    switch ( colour_type ) {
+    case ColourType::GREYSCALE: [[fallthrough]];
+    case ColourType::INDEXED_COLOUR: return 1;
+    case ColourType::GREYSCALE_ALPHA: return 2;
+    case ColourType::TRUE_COLOUR: return 3;
+    case ColourType::TRUE_COLOUR_ALPHA: return 4;
+    case ColourType::INVALID: [[fallthrough]];
+    default: return 0;
+    }
+}
+
+constexpr std::uint8_t
+bits_per_pixel( const ColourType colour_type,
+                const BitDepth   bit_depth ) noexcept {
+    return static_cast<std::uint8_t>( channel_count( colour_type )
+                                      * bit_depth );
+}
+
+// Bytes in one scanline of `width` pixels, excluding the filter type byte.
+constexpr std::size_t
+scanline_bytes( const std::uint32_t width, const ColourType colour_type,
+                const BitDepth bit_depth ) noexcept {
+    return ( static_cast<std::size_t>( width )
+                 * bits_per_pixel( colour_type, bit_depth )
+             + byte_bits - 1 )
+           / byte_bits;
+}
+
 // CompressionMethod
 
 enum class CompressionMethod : std::uint8_t {
@@ -284,6 +435,48 @@ is_valid( const InterlaceMethod interlace_method ) {
            || interlace_method == InterlaceMethod::ADAM_7;
 }
 
+// Adam7 pass geometry. Each pass samples every x_step'th pixel of every
+// y_step'th row. The block size is the area a pass pixel stands in for
+// until later passes refine it, used for progressive display.
+struct Adam7Pass
+{
+    std::uint8_t x_offset;
+    std::uint8_t y_offset;
+    std::uint8_t x_step;
+    std::uint8_t y_step;
+    std::uint8_t block_width;
+    std::uint8_t block_height;
+};
+
+constexpr std::array<Adam7Pass, 7> adam7_passes{
+    // clang-format off
+    Adam7Pass{ 0, 0, 8, 8, 8, 8 },
+    Adam7Pass{ 4, 0, 8, 8, 4, 8 },
+    Adam7Pass{ 0, 4, 4, 8, 4, 4 },
+    Adam7Pass{ 2, 0, 4, 4, 2, 4 },
+    Adam7Pass{ 0, 2, 2, 4, 2, 2 },
+    Adam7Pass{ 1, 0, 2, 2, 1, 2 },
+    Adam7Pass{ 0, 1, 1, 2, 1, 1 }
+    // clang-format on
+};
+
+// Non-interlaced images are decoded as a single pass covering every pixel.
+constexpr Adam7Pass full_image_pass{ 0, 0, 1, 1, 1, 1 };
+
+constexpr std::uint32_t
+pass_width( const Adam7Pass & pass, const std::uint32_t width ) noexcept {
+    return width > pass.x_offset ?
+               ( width - pass.x_offset + pass.x_step - 1U ) / pass.x_step :
+               0;
+}
+
+constexpr std::uint32_t
+pass_height( const Adam7Pass & pass, const std::uint32_t height ) noexcept {
+    return height > pass.y_offset ?
+               ( height - pass.y_offset + pass.y_step - 1U ) / pass.y_step :
+               0;
+}
+
 } // namespace IHDR
 
 namespace PLTE
@@ -303,7 +496,29 @@ std::ostream & operator<<( std::ostream & out_stream, const Palette palette );
 } // namespace PLTE
 
 namespace IDAT
-{}
+{
+
+// FilterType: per-scanline filter selector for filter method 0.
+enum class FilterType : std::uint8_t {
+    // clang-format off
+    NONE    = 0,
+    SUB     = 1,
+    UP      = 2,
+    AVERAGE = 3,
+    PAETH   = 4,
+    INVALID = 5
+    // clang-format on
+};
+
+constexpr bool
+is_valid( const FilterType filter_type ) {
+    return filter_type < FilterType::INVALID;
+}
+
+std::ostream & operator<<( std::ostream &   out_stream,
+                           const FilterType filter_type );
+
+} // namespace IDAT
 
 namespace IEND
 {}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "png/png_types.hpp"
+
+#include <filesystem>
+#include <span>
+
+namespace PNG
+{
+
+struct VerifyResult
+{
+    png_error_t error{ png_error_t::NONE };
+    // Offset of the chunk at fault, the first IDAT chunk for errors in the
+    // image data stream
+    std::size_t offset{ 0 };
+};
+
+// Checks that the PNG `png` is intact without decoding it, as pngcheck
+// does: the signature, chunk layout & ordering (IHDR first, PLTE & tRNS
+// before the image data, IDAT chunks consecutive, nothing after IEND), the
+// IHDR, PLTE & tRNS payloads (tRNS sized for the colour type & absent with
+// alpha), every chunk CRC, & the zlib stream of the IDAT data down to its
+// Adler-32 trailer & the amount of data the image needs. The stream is
+// inflated into a small buffer that is overwritten & discarded, so no
+// image sized memory is ever allocated. Everything runs on the calling
+// thread, callers verifying many files run one call per thread. Returns
+// the first problem found, layout errors before CRC errors before stream
+// errors.
+[[nodiscard]] VerifyResult verify_png( const std::span<const std::byte> png );
+
+#if defined( __linux__ )
+// Verifies the PNG file at `path`, mapped read only for sequential access.
+// Fails with READ_FAILED if the file can't be opened or mapped.
+[[nodiscard]] VerifyResult verify_png( const std::filesystem::path & path );
+#endif
+
+} // namespace PNG
@@ -0,0 +1,28 @@
+#include "common/adler32.hpp"
+
+#include <algorithm>
+
+namespace ZLIB
+{
+
+void
+Adler32::update( const std::span<const std::byte> input_bytes ) noexcept {
+    // Largest n such that 255n(n+1)/2 + (n+1)(adler_modulus-1) fits in 32
+    // bits, allowing the modulo to be deferred for that many bytes.
+    constexpr std::size_t max_deferred_bytes{ 5552 };
+
+    auto remaining{ input_bytes };
+    while ( !remaining.empty() ) {
+        const auto block_size{ std::min( remaining.size(),
+                                         max_deferred_bytes ) };
+        for ( const auto byte : remaining.first( block_size ) ) {
+            m_a += std::to_integer<std::uint32_t>( byte );
+            m_b += m_a;
+        }
+        m_a %= adler_modulus;
+        m_b %= adler_modulus;
+        remaining = remaining.subspan( block_size );
+    }
+}
+
+} // namespace ZLIB
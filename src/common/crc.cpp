@@ -18,7 +18,13 @@ CrcTable32::calculate_table() noexcept {
                         0 );
         }
 
-        table[i] = c;
+        tables[0][i] = static_cast<std::uint32_t>( c.to_ulong() );
+    }
+    for ( std::size_t k{ 1 }; k < slice_count; ++k ) {
+        for ( std::size_t i{ 0 }; i < table_size; ++i ) {
+            const auto previous{ tables[k - 1][i] };
+            tables[k][i] = ( previous >> 8 ) ^ tables[0][previous & 0xFF];
+        }
     }
 
     is_table_computed = true;
@@ -27,29 +33,45 @@ CrcTable32::calculate_table() noexcept {
 crc_t
 CrcTable32::update_crc(
     const crc_t &                    initial_crc,
-    const std::span<const std::byte> input_bytes ) noexcept {
-    constexpr auto pad_byte = []( const std::byte b ) -> crc_t {
-        return std::to_integer<std::uint32_t>( b );
+    const std::span<const std::byte> input_bytes ) const noexcept {
+    // The constructor computed the tables, so this only reads them
+    const auto byte_at = [&]( const std::size_t i ) -> std::uint32_t {
+        return std::to_integer<std::uint32_t>( input_bytes[i] );
+    };
+    const auto word_at = [&]( const std::size_t i ) {
+        return byte_at( i ) | byte_at( i + 1 ) << 8 | byte_at( i + 2 ) << 16
+               | byte_at( i + 3 ) << 24;
     };
 
-    if ( !is_table_computed ) {
-        calculate_table();
+    // Slicing-by-8: each step folds 8 input bytes into the register with
+    // one lookup per byte, in independent tables
+    auto        crc{ static_cast<std::uint32_t>( initial_crc.to_ulong() ) };
+    std::size_t i{ 0 };
+    for ( ; i + slice_count <= input_bytes.size(); i += slice_count ) {
+        const auto low{ crc ^ word_at( i ) };
+        const auto high{ word_at( i + 4 ) };
+        crc = tables[7][low & 0xFF] ^ tables[6][( low >> 8 ) & 0xFF]
+              ^ tables[5][( low >> 16 ) & 0xFF] ^ tables[4][low >> 24]
+              ^ tables[3][high & 0xFF] ^ tables[2][( high >> 8 ) & 0xFF]
+              ^ tables[1][( high >> 16 ) & 0xFF] ^ tables[0][high >> 24];
     }
-
-    auto crc = initial_crc;
-    for ( const auto & [i, byte] : input_bytes | std::views::enumerate ) {
-        const auto idx{
-            ( ( crc ^ pad_byte( byte ) ) & crc_t{ 0xFF } ).to_ulong()
-        };
-        crc = ( crc >> 8 ) ^ table[idx];
+    for ( ; i < input_bytes.size(); ++i ) {
+        crc = ( crc >> 8 ) ^ tables[0][( crc ^ byte_at( i ) ) & 0xFF];
     }
 
-    return crc;
+    return crc_t{ crc };
 }
 
 crc_t
-CrcTable32::crc( const std::span<const std::byte> input_bytes ) {
+CrcTable32::crc( const std::span<const std::byte> input_bytes ) const {
     return update_crc( 0xffffffffL, input_bytes ) ^ crc_t { 0xffffffffL };
 }
 
+crc_t
+CrcTable32::crc( const std::span<const std::byte> input_bytes,
+                 const crc_t &                    previous_crc ) const {
+    return update_crc( previous_crc ^ crc_t{ 0xffffffffL }, input_bytes )
+           ^ crc_t{ 0xffffffffL };
+}
+
 } // namespace CRC
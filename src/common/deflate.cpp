@@ -0,0 +1,980 @@
+#include "common/deflate.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+namespace ZLIB
+{
+
+namespace
+{
+
+// CMF byte: deflate with a 32 KiB window
+constexpr std::uint8_t zlib_cmf{ 0x78 };
+
+// Block header bits: BFINAL, then BTYPE
+constexpr std::uint32_t block_header_bits{ 3 };
+constexpr std::uint32_t stored_block_type{ 0 };
+constexpr std::uint32_t fixed_block_type{ 1 };
+constexpr std::uint32_t dynamic_block_type{ 2 };
+
+constexpr std::size_t   window_mask{ Deflater::window_size - 1 };
+constexpr std::uint32_t hash_bits{ 15 };
+// Enough lookahead for a longest match & the hash of the byte after it
+constexpr std::size_t min_lookahead{ max_match + min_match + 1 };
+// Symbols buffered before a block is emitted
+constexpr std::size_t block_symbols{ 16384 };
+// Bytes parsed at a time by BEST, each emitted as one block
+constexpr std::size_t optimal_block{ 16384 };
+constexpr std::size_t optimal_passes{ 3 };
+// A 3 byte match further back than this costs more than 3 literals
+constexpr std::uint32_t too_far{ 4096 };
+
+constexpr std::uint32_t max_code_length{ 15 };
+constexpr std::uint32_t max_code_length_length{ 7 };
+// Code length alphabet: repeat previous, repeat zero 3-10 & 11-138 times
+constexpr std::uint8_t repeat_previous{ 16 };
+constexpr std::uint8_t repeat_zero{ 17 };
+constexpr std::uint8_t repeat_zero_long{ 18 };
+
+struct LevelConfig
+{
+    // Chain entries examined per match search
+    std::uint32_t max_chain;
+    // Stop searching at a match this long
+    std::uint32_t nice_length;
+    // FAST: longest match whose positions are all hashed. DEFAULT: longest
+    // match still checked against a lazy match at the next position.
+    std::uint32_t lazy_length;
+};
+
+constexpr std::array<LevelConfig, 4> level_configs{ {
+    { 0, 0, 0 },           // STORE
+    { 4, 32, 8 },          // FAST
+    { 128, 128, 16 },      // DEFAULT
+    { 1024, max_match, 0 } // BEST
+} };
+
+constexpr std::array<std::uint8_t, max_match + 1> length_codes{ [] {
+    std::array<std::uint8_t, max_match + 1> codes{};
+    for ( std::size_t code{ 0 }; code + 1 < length_base.size(); ++code ) {
+        const auto end{ length_base[code]
+                        + ( 1U << length_extra_bits[code] ) };
+        for ( auto length{ length_base[code] }; length < end; ++length ) {
+            codes[length] = static_cast<std::uint8_t>( code );
+        }
+    }
+    // 258 has a code of its own rather than 284 with all extra bits set
+    codes[max_match] = static_cast<std::uint8_t>( length_base.size() - 1 );
+    return codes;
+}() };
+
+constexpr std::uint32_t
+distance_code( const std::uint32_t distance ) noexcept {
+    if ( distance <= 4 ) {
+        return distance - 1;
+    }
+    // Two codes per power of two, split by the bit below the highest
+    const auto high_bit{ static_cast<std::uint32_t>(
+        std::bit_width( distance - 1 ) - 1 ) };
+    return 2 * high_bit + ( ( ( distance - 1 ) >> ( high_bit - 1 ) ) & 1 );
+}
+
+constexpr auto fixed_literals{ fixed_literal_lengths() };
+
+constexpr std::uint32_t
+hash( const std::byte * const bytes ) noexcept {
+    const auto value{ std::to_integer<std::uint32_t>( bytes[0] ) << 16
+                      | std::to_integer<std::uint32_t>( bytes[1] ) << 8
+                      | std::to_integer<std::uint32_t>( bytes[2] ) };
+    return ( value * 0x9E37'79B1U ) >> ( 32 - hash_bits );
+}
+
+// Bytes in common at `a` & `b`, at most `limit`.
+std::uint32_t
+common_length( const std::byte * const a, const std::byte * const b,
+               const std::uint32_t limit ) noexcept {
+    std::uint32_t length{ 0 };
+    if constexpr ( std::endian::native == std::endian::little ) {
+        while ( length + sizeof( std::uint64_t ) <= limit ) {
+            std::uint64_t x{ 0 };
+            std::uint64_t y{ 0 };
+            std::memcpy( &x, a + length, sizeof( x ) );
+            std::memcpy( &y, b + length, sizeof( y ) );
+            if ( x != y ) {
+                return length
+                       + static_cast<std::uint32_t>( std::countr_zero( x ^ y )
+                                                     / 8 );
+            }
+            length += sizeof( std::uint64_t );
+        }
+    }
+    while ( length < limit && a[length] == b[length] ) {
+        ++length;
+    }
+    return length;
+}
+
+// Huffman code lengths of at most `limit` bits for symbols occurring
+// `counts` times. Counts are halved until the plain Huffman code fits.
+void
+build_lengths( const std::span<const std::uint32_t> counts,
+               const std::span<std::uint8_t>        lengths,
+               const std::uint32_t                  limit ) {
+    std::ranges::fill( lengths, std::uint8_t{ 0 } );
+    std::vector<std::uint32_t> weights( counts.begin(), counts.end() );
+    std::vector<std::uint32_t> leaves;
+    for ( std::uint32_t symbol{ 0 }; symbol < counts.size(); ++symbol ) {
+        if ( counts[symbol] != 0 ) {
+            leaves.push_back( symbol );
+        }
+    }
+    if ( leaves.size() < 2 ) {
+        for ( const auto symbol : leaves ) {
+            lengths[symbol] = 1;
+        }
+        return;
+    }
+
+    const auto leaf_count{ leaves.size() };
+    std::vector<std::uint64_t> node_weights( 2 * leaf_count - 1 );
+    std::vector<std::uint32_t> parents( 2 * leaf_count - 1 );
+    std::vector<std::uint32_t> depths( 2 * leaf_count - 1 );
+    while ( true ) {
+        std::ranges::stable_sort( leaves, {}, [&]( const auto symbol ) {
+            return weights[symbol];
+        } );
+        for ( std::size_t i{ 0 }; i < leaf_count; ++i ) {
+            node_weights[i] = weights[leaves[i]];
+        }
+        // Two queues: sorted leaves & internal nodes, created in order of
+        // weight
+        std::size_t next_leaf{ 0 };
+        std::size_t next_node{ leaf_count };
+        const auto  take_lightest{ [&]( const std::size_t node_end ) {
+            if ( next_leaf < leaf_count
+                 && ( next_node == node_end
+                      || node_weights[next_leaf]
+                             <= node_weights[next_node] ) ) {
+                return next_leaf++;
+            }
+            return next_node++;
+        } };
+        for ( auto node{ leaf_count }; node < node_weights.size(); ++node ) {
+            const auto left{ take_lightest( node ) };
+            const auto right{ take_lightest( node ) };
+            node_weights[node] = node_weights[left] + node_weights[right];
+            parents[left] = static_cast<std::uint32_t>( node );
+            parents[right] = static_cast<std::uint32_t>( node );
+        }
+        // Parents follow their children, so depths fill in from the root
+        std::uint32_t max_depth{ 0 };
+        depths.back() = 0;
+        for ( auto node{ node_weights.size() - 1 }; node-- > 0; ) {
+            depths[node] = depths[parents[node]] + 1;
+            max_depth = std::max( max_depth, depths[node] );
+        }
+        if ( max_depth <= limit ) {
+            for ( std::size_t i{ 0 }; i < leaf_count; ++i ) {
+                lengths[leaves[i]] = static_cast<std::uint8_t>( depths[i] );
+            }
+            return;
+        }
+        for ( auto & weight : weights ) {
+            weight = weight == 0 ? 0 : ( weight + 1 ) / 2;
+        }
+    }
+}
+
+// Decoders reject incomplete codes other than a single 1 bit code, so a
+// lone code gets a partner.
+void
+complete_lengths( const std::span<std::uint8_t> lengths ) noexcept {
+    const auto used{ std::ranges::count_if(
+        lengths, []( const auto length ) { return length != 0; } ) };
+    if ( used == 0 ) {
+        lengths[0] = 1;
+        lengths[1] = 1;
+    }
+    else if ( used == 1 ) {
+        lengths[lengths[0] == 0 ? 0 : 1] = 1;
+    }
+}
+
+// Canonical codes for `lengths`, bit reversed for the LSB-first writer.
+template <std::size_t N>
+std::array<std::uint16_t, N>
+canonical_codes( const std::span<const std::uint8_t> lengths ) noexcept {
+    std::array<std::uint32_t, max_code_length + 1> counts{};
+    for ( const auto length : lengths ) {
+        ++counts[length];
+    }
+    counts[0] = 0;
+    std::array<std::uint32_t, max_code_length + 1> next{};
+    for ( std::uint32_t bits{ 1 }, code{ 0 }; bits <= max_code_length;
+          ++bits ) {
+        code = ( code + counts[bits - 1] ) << 1;
+        next[bits] = code;
+    }
+    std::array<std::uint16_t, N> codes{};
+    for ( std::size_t symbol{ 0 }; symbol < lengths.size(); ++symbol ) {
+        const auto length{ lengths[symbol] };
+        if ( length != 0 ) {
+            codes[symbol] = static_cast<std::uint16_t>(
+                reverse_bits( next[length]++, length ) );
+        }
+    }
+    return codes;
+}
+
+// Bits of the symbols counted, extra bits included, under the given
+// code lengths.
+std::uint64_t
+symbol_bits( const std::span<const std::uint32_t> literal_counts,
+             const std::span<const std::uint32_t> distance_counts,
+             const std::span<const std::uint8_t>  literal_lengths,
+             const std::span<const std::uint8_t>  distance_lengths ) noexcept {
+    std::uint64_t bits{ 0 };
+    for ( std::size_t symbol{ 0 }; symbol < literal_counts.size(); ++symbol ) {
+        auto symbol_length{ std::uint64_t{ literal_lengths[symbol] } };
+        if ( symbol > end_of_block ) {
+            symbol_length += length_extra_bits[symbol - end_of_block - 1];
+        }
+        bits += literal_counts[symbol] * symbol_length;
+    }
+    for ( std::size_t code{ 0 }; code < distance_counts.size(); ++code ) {
+        bits += distance_counts[code]
+                * ( std::uint64_t{ distance_lengths[code] }
+                    + distance_extra_bits[code] );
+    }
+    return bits;
+}
+
+// Dynamic Huffman block header: code lengths & their run length encoding.
+struct DynamicHeader
+{
+    std::array<std::uint8_t, max_literal_codes>         literal_lengths{};
+    std::array<std::uint8_t, max_distance_codes>        distance_lengths{};
+    std::array<std::uint8_t, code_length_order.size()> code_length_lengths{};
+    // Code length symbol in the low 5 bits, its repeat count above
+    std::vector<std::uint16_t> code_lengths{};
+    std::uint32_t              literal_count{ 0 };
+    std::uint32_t              distance_count{ 0 };
+    std::uint32_t              code_length_count{ 0 };
+    std::uint64_t              bits{ 0 };
+};
+
+DynamicHeader
+plan_dynamic( const std::span<const std::uint32_t> literal_counts,
+              const std::span<const std::uint32_t> distance_counts ) {
+    DynamicHeader header{};
+    build_lengths( literal_counts, header.literal_lengths, max_code_length );
+    build_lengths( distance_counts, header.distance_lengths, max_code_length );
+    complete_lengths( header.literal_lengths );
+    complete_lengths( header.distance_lengths );
+
+    header.literal_count = max_literal_codes;
+    while ( header.literal_count > end_of_block + 1
+            && header.literal_lengths[header.literal_count - 1] == 0 ) {
+        --header.literal_count;
+    }
+    header.distance_count = max_distance_codes;
+    while ( header.distance_count > 1
+            && header.distance_lengths[header.distance_count - 1] == 0 ) {
+        --header.distance_count;
+    }
+
+    // Both alphabets are run length encoded as one sequence
+    std::vector<std::uint8_t> lengths(
+        header.literal_lengths.begin(),
+        header.literal_lengths.begin() + header.literal_count );
+    lengths.insert( lengths.end(), header.distance_lengths.begin(),
+                    header.distance_lengths.begin() + header.distance_count );
+    std::array<std::uint32_t, code_length_order.size()> counts{};
+    const auto emit{ [&]( const std::uint8_t symbol,
+                          const std::size_t  repeat ) {
+        header.code_lengths.push_back(
+            static_cast<std::uint16_t>( symbol | repeat << 5 ) );
+        ++counts[symbol];
+    } };
+    for ( std::size_t i{ 0 }; i < lengths.size(); ) {
+        const auto length{ lengths[i] };
+        std::size_t run{ 1 };
+        while ( i + run < lengths.size() && lengths[i + run] == length ) {
+            ++run;
+        }
+        i += run;
+        if ( length == 0 ) {
+            for ( ; run >= 11; run -= std::min<std::size_t>( run, 138 ) ) {
+                emit( repeat_zero_long, std::min<std::size_t>( run, 138 ) );
+            }
+            if ( run >= 3 ) {
+                emit( repeat_zero, run );
+                run = 0;
+            }
+        }
+        else {
+            emit( length, 1 );
+            --run;
+            for ( ; run >= 3; run -= std::min<std::size_t>( run, 6 ) ) {
+                emit( repeat_previous, std::min<std::size_t>( run, 6 ) );
+            }
+        }
+        for ( ; run > 0; --run ) {
+            emit( length, 1 );
+        }
+    }
+
+    build_lengths( counts, header.code_length_lengths,
+                   max_code_length_length );
+    complete_lengths( header.code_length_lengths );
+    header.code_length_count = code_length_order.size();
+    while ( header.code_length_count > 4
+            && header.code_length_lengths
+                       [code_length_order[header.code_length_count - 1]]
+                   == 0 ) {
+        --header.code_length_count;
+    }
+
+    header.bits = 5 + 5 + 4 + 3 * std::uint64_t{ header.code_length_count };
+    for ( std::size_t symbol{ 0 }; symbol < counts.size(); ++symbol ) {
+        header.bits += counts[symbol] * std::uint64_t{
+            header.code_length_lengths[symbol] };
+    }
+    header.bits += 2 * counts[repeat_previous] + 3 * counts[repeat_zero]
+                   + 7 * counts[repeat_zero_long];
+    return header;
+}
+
+} // namespace
+
+Deflater::Deflater( const CompressionLevel level, const bool zlib_wrapped ) :
+    m_level( level ), m_zlib_wrapped( zlib_wrapped ) {
+    if ( m_level == CompressionLevel::STORE ) {
+        m_pending.reserve( max_stored_block );
+        return;
+    }
+    m_window.resize( 2 * window_size );
+    m_head.resize( std::size_t{ 1 } << hash_bits );
+    m_previous.resize( window_size );
+    m_symbols.reserve( block_symbols );
+    if ( m_level == CompressionLevel::BEST ) {
+        m_candidate_index.resize( optimal_block + 1 );
+        m_costs.resize( optimal_block + 1 );
+        m_steps.resize( optimal_block + 1 );
+    }
+}
+
+void
+Deflater::reset() {
+    m_writer.reset();
+    m_adler.reset();
+    m_pending.clear();
+    m_window_end = 0;
+    m_position = 0;
+    m_block_start = 0;
+    std::ranges::fill( m_head, 0U );
+    m_symbols.clear();
+    m_literal_counts.fill( 0 );
+    m_distance_counts.fill( 0 );
+    m_total_in = 0;
+    m_total_out = 0;
+    m_header_written = false;
+    m_finished = false;
+}
+
+void
+Deflater::reset( const bool zlib_wrapped ) {
+    m_zlib_wrapped = zlib_wrapped;
+    reset();
+}
+
+void
+Deflater::set_dictionary( const std::span<const std::byte> dictionary ) {
+    if ( m_level == CompressionLevel::STORE ) {
+        return;
+    }
+    const auto history{ dictionary.last(
+        std::min( dictionary.size(), window_size ) ) };
+    std::ranges::copy( history,
+                       m_window.begin()
+                           + static_cast<std::ptrdiff_t>( m_window_end ) );
+    m_window_end += history.size();
+    for ( ; m_position < m_window_end; ++m_position ) {
+        insert_hash( m_position );
+    }
+    m_block_start = m_position;
+}
+
+void
+Deflater::deflate( const std::span<const std::byte> input,
+                   const deflate_flush_t flush, std::vector<std::byte> & out ) {
+    const auto initial_size{ out.size() };
+    if ( !m_header_written ) {
+        write_zlib_header( out );
+        m_header_written = true;
+    }
+
+    m_adler.update( input );
+    m_total_in += input.size();
+
+    if ( m_level == CompressionLevel::STORE ) {
+        auto remaining{ input };
+        while ( !remaining.empty() ) {
+            const auto count{ std::min( remaining.size(),
+                                        max_stored_block - m_pending.size() ) };
+            m_pending.insert( m_pending.end(), remaining.begin(),
+                              remaining.begin()
+                                  + static_cast<std::ptrdiff_t>( count ) );
+            remaining = remaining.subspan( count );
+            if ( m_pending.size() == max_stored_block ) {
+                write_pending( false, out );
+            }
+        }
+    }
+    else {
+        compress( input, flush != deflate_flush_t::NONE, out );
+    }
+
+    switch ( flush ) {
+    case deflate_flush_t::NONE: break;
+    case deflate_flush_t::FULL:
+    case deflate_flush_t::SYNC: {
+        write_pending( false, out );
+        // The empty stored block is the marker decoders look for
+        write_stored( {}, false, out );
+        // Forget the history so later matches can't refer back past it
+        if ( flush == deflate_flush_t::FULL ) {
+            std::ranges::fill( m_head, 0U );
+        }
+    } break;
+    case deflate_flush_t::FINISH: {
+        write_pending( true, out );
+        m_writer.align_to_byte( out );
+        if ( m_zlib_wrapped ) {
+            const auto trailer{
+                to_bytes<std::uint32_t, std::endian::native, std::endian::big>(
+                    m_adler.value() )
+            };
+            out.insert( out.end(), trailer.begin(), trailer.end() );
+        }
+        m_finished = true;
+    } break;
+    }
+
+    m_total_out += out.size() - initial_size;
+}
+
+void
+Deflater::write_zlib_header( std::vector<std::byte> & out ) {
+    if ( !m_zlib_wrapped ) {
+        return;
+    }
+    // FLEVEL, then FCHECK making CMF * 256 + FLG a multiple of 31
+    const auto level_bits{ static_cast<std::uint32_t>( m_level ) << 6 };
+    const auto check{ 31 - ( zlib_cmf * 256U + level_bits ) % 31 };
+    out.push_back( std::byte{ zlib_cmf } );
+    out.push_back( static_cast<std::byte>( level_bits | ( check % 31 ) ) );
+}
+
+void
+Deflater::write_stored( const std::span<const std::byte> block,
+                        const bool is_final, std::vector<std::byte> & out ) {
+    m_writer.write_bits( ( is_final ? 1U : 0U ) | stored_block_type << 1,
+                         block_header_bits, out );
+    m_writer.align_to_byte( out );
+    const auto length{ static_cast<std::uint16_t>( block.size() ) };
+    // LEN & NLEN are the only little endian fields of the format
+    for ( const auto value :
+          { length, static_cast<std::uint16_t>( ~length ) } ) {
+        const auto bytes{ to_bytes<std::uint16_t, std::endian::native,
+                                   std::endian::little>( value ) };
+        out.insert( out.end(), bytes.begin(), bytes.end() );
+    }
+    out.insert( out.end(), block.begin(), block.end() );
+}
+
+void
+Deflater::write_pending( const bool is_final, std::vector<std::byte> & out ) {
+    if ( m_level != CompressionLevel::STORE ) {
+        write_block( is_final, out );
+        return;
+    }
+    // An empty pending buffer still closes the stream when final
+    if ( !m_pending.empty() || is_final ) {
+        write_stored( m_pending, is_final, out );
+        m_pending.clear();
+    }
+}
+
+void
+Deflater::compress( std::span<const std::byte> input, const bool drain,
+                    std::vector<std::byte> & out ) {
+    while ( true ) {
+        if ( m_window_end == m_window.size() ) {
+            slide_window( out );
+        }
+        const auto count{ std::min( input.size(),
+                                    m_window.size() - m_window_end ) };
+        std::ranges::copy( input.first( count ),
+                           m_window.begin()
+                               + static_cast<std::ptrdiff_t>( m_window_end ) );
+        m_window_end += count;
+        input = input.subspan( count );
+
+        const auto last{ drain && input.empty() };
+        switch ( m_level ) {
+        case CompressionLevel::FAST: match_greedy( last, out ); break;
+        case CompressionLevel::DEFAULT: match_lazy( last, out ); break;
+        default: match_optimal( last, out ); break;
+        }
+        if ( input.empty() ) {
+            return;
+        }
+    }
+}
+
+void
+Deflater::match_greedy( const bool drain, std::vector<std::byte> & out ) {
+    const auto & config{ level_configs[static_cast<std::size_t>( m_level )] };
+    while ( m_position < m_window_end
+            && ( drain || m_window_end - m_position >= min_lookahead ) ) {
+        const auto    position{ m_position };
+        const auto    limit{ static_cast<std::uint32_t>(
+            std::min<std::size_t>( max_match, m_window_end - position ) ) };
+        std::uint32_t distance{ 0 };
+        auto          length{ find_match( position, 0, limit, distance ) };
+        if ( length == min_match && distance > too_far ) {
+            length = 0;
+        }
+        insert_hash( position );
+
+        if ( length != 0 ) {
+            // Long matches are skipped over unhashed to save time
+            if ( length <= config.lazy_length ) {
+                for ( std::size_t i{ 1 }; i < length; ++i ) {
+                    insert_hash( position + i );
+                }
+            }
+            m_position += length;
+            push_match( length, distance );
+        }
+        else {
+            m_position += 1;
+            push_literal( m_window[position] );
+        }
+        if ( m_symbols.size() == block_symbols ) {
+            write_block( false, out );
+        }
+    }
+}
+
+void
+Deflater::match_lazy( const bool drain, std::vector<std::byte> & out ) {
+    const auto & config{ level_configs[static_cast<std::size_t>( m_level )] };
+    // A match found at the next position, carried to its iteration
+    std::uint32_t next_length{ 0 };
+    std::uint32_t next_distance{ 0 };
+    while ( m_position < m_window_end
+            && ( drain || m_window_end - m_position >= min_lookahead ) ) {
+        const auto position{ m_position };
+        const auto limit_at{ [&]( const std::size_t at ) {
+            return static_cast<std::uint32_t>(
+                std::min<std::size_t>( max_match, m_window_end - at ) );
+        } };
+        auto length{ next_length };
+        auto distance{ next_distance };
+        if ( next_length == 0 ) {
+            length = find_match( position, 0, limit_at( position ), distance );
+            if ( length == min_match && distance > too_far ) {
+                length = 0;
+            }
+        }
+        next_length = 0;
+        insert_hash( position );
+
+        // Defer to a longer match starting at the next byte
+        if ( length != 0 && length < config.lazy_length
+             && position + 1 < m_window_end ) {
+            next_length = find_match( position + 1, length,
+                                      limit_at( position + 1 ),
+                                      next_distance );
+        }
+
+        if ( length != 0 && next_length == 0 ) {
+            for ( std::size_t i{ 1 }; i < length; ++i ) {
+                insert_hash( position + i );
+            }
+            m_position += length;
+            push_match( length, distance );
+        }
+        else {
+            m_position += 1;
+            push_literal( m_window[position] );
+        }
+        if ( m_symbols.size() == block_symbols ) {
+            write_block( false, out );
+        }
+    }
+}
+
+void
+Deflater::match_optimal( const bool drain, std::vector<std::byte> & out ) {
+    while ( m_position < m_window_end ) {
+        const auto available{ m_window_end - m_position };
+        if ( !drain && available < optimal_block + min_lookahead ) {
+            return;
+        }
+        parse_optimal( std::min( available, optimal_block ), out );
+    }
+}
+
+void
+Deflater::parse_optimal( const std::size_t count,
+                         std::vector<std::byte> & out ) {
+    const auto & config{ level_configs[static_cast<std::size_t>( m_level )] };
+    const auto   start{ m_position };
+
+    // Every match worth considering: the closest one of each length, from
+    // the chain walk in order of distance
+    m_candidates.clear();
+    for ( std::size_t i{ 0 }; i < count; ++i ) {
+        m_candidate_index[i] =
+            static_cast<std::uint32_t>( m_candidates.size() );
+        const auto    position{ start + i };
+        const auto    limit{ static_cast<std::uint32_t>(
+            std::min<std::size_t>( max_match, count - i ) ) };
+        std::uint32_t chain{ config.max_chain };
+        auto          best{ min_match - 1 };
+        if ( limit >= min_match && position + min_match <= m_window_end ) {
+            for ( auto candidate{ m_head[hash( &m_window[position] )] };
+                  candidate != 0 && chain-- > 0 && best < limit;
+                  candidate = m_previous[( candidate - 1 ) & window_mask] ) {
+                const auto match{ candidate - std::size_t{ 1 } };
+                if ( position - match > window_size ) {
+                    break;
+                }
+                if ( m_window[match + best] != m_window[position + best] ) {
+                    continue;
+                }
+                const auto length{ common_length( &m_window[match],
+                                                  &m_window[position],
+                                                  limit ) };
+                if ( length > best ) {
+                    best = length;
+                    m_candidates.push_back(
+                        { static_cast<std::uint16_t>( length ),
+                          static_cast<std::uint16_t>( position - match ) } );
+                }
+            }
+        }
+        insert_hash( position );
+    }
+    m_candidate_index[count] =
+        static_cast<std::uint32_t>( m_candidates.size() );
+
+    // Shortest paths under a cost model refined from the previous pass's
+    // symbol counts, starting from the fixed Huffman code
+    std::array<std::uint8_t, max_literal_codes>  literal_lengths{};
+    std::array<std::uint8_t, max_distance_codes> distance_lengths{};
+    std::ranges::copy( std::span{ fixed_literals }.first( max_literal_codes ),
+                       literal_lengths.begin() );
+    distance_lengths.fill( fixed_distance_length );
+
+    std::vector<Symbol> best_path;
+    std::vector<Symbol> path;
+    auto best_bits{ std::numeric_limits<std::uint64_t>::max() };
+    for ( std::size_t pass{ 0 }; pass < optimal_passes; ++pass ) {
+        std::array<std::uint32_t, max_match + 1> length_costs{};
+        for ( auto length{ min_match }; length <= max_match; ++length ) {
+            const auto code{ length_codes[length] };
+            length_costs[length] =
+                literal_lengths[end_of_block + 1 + code]
+                + length_extra_bits[code];
+        }
+
+        std::ranges::fill( m_costs, std::numeric_limits<std::uint32_t>::max() );
+        m_costs[0] = 0;
+        for ( std::size_t i{ 0 }; i < count; ++i ) {
+            const auto base{ m_costs[i] };
+            const auto literal_cost{
+                base
+                + literal_lengths[std::to_integer<std::size_t>(
+                    m_window[start + i] )]
+            };
+            if ( literal_cost < m_costs[i + 1] ) {
+                m_costs[i + 1] = literal_cost;
+                m_steps[i + 1] = { 1, 0 };
+            }
+            auto shorter{ min_match };
+            for ( auto c{ m_candidate_index[i] };
+                  c < m_candidate_index[i + 1]; ++c ) {
+                const auto [longest, distance]{ m_candidates[c] };
+                const auto code{ distance_code( distance ) };
+                const auto distance_cost{ base + distance_lengths[code]
+                                          + distance_extra_bits[code] };
+                for ( auto length{ shorter }; length <= longest; ++length ) {
+                    const auto cost{ distance_cost + length_costs[length] };
+                    if ( cost < m_costs[i + length] ) {
+                        m_costs[i + length] = cost;
+                        m_steps[i + length] = {
+                            static_cast<std::uint16_t>( length ), distance
+                        };
+                    }
+                }
+                shorter = longest + 1U;
+            }
+        }
+
+        path.clear();
+        for ( auto i{ count }; i > 0; i -= m_steps[i].value ) {
+            path.push_back( m_steps[i] );
+        }
+        std::ranges::reverse( path );
+
+        m_literal_counts.fill( 0 );
+        m_distance_counts.fill( 0 );
+        for ( std::size_t i{ 0 }; const auto step : path ) {
+            if ( step.distance == 0 ) {
+                push_literal( m_window[start + i] );
+            }
+            else {
+                push_match( step.value, step.distance );
+            }
+            i += step.value;
+        }
+        m_symbols.clear();
+        m_literal_counts[end_of_block] = 1;
+        const auto header{ plan_dynamic( m_literal_counts,
+                                         m_distance_counts ) };
+        const auto bits{ header.bits
+                         + symbol_bits( m_literal_counts, m_distance_counts,
+                                        header.literal_lengths,
+                                        header.distance_lengths ) };
+        if ( bits < best_bits ) {
+            best_bits = bits;
+            best_path = path;
+        }
+
+        // Unused symbols stay affordable in the next pass's model
+        for ( auto & symbol_count : m_literal_counts ) {
+            ++symbol_count;
+        }
+        for ( auto & symbol_count : m_distance_counts ) {
+            ++symbol_count;
+        }
+        build_lengths( m_literal_counts, literal_lengths, max_code_length );
+        build_lengths( m_distance_counts, distance_lengths, max_code_length );
+    }
+
+    m_literal_counts.fill( 0 );
+    m_distance_counts.fill( 0 );
+    for ( std::size_t i{ 0 }; const auto step : best_path ) {
+        if ( step.distance == 0 ) {
+            push_literal( m_window[start + i] );
+        }
+        else {
+            push_match( step.value, step.distance );
+        }
+        i += step.value;
+    }
+    m_position += count;
+    write_block( false, out );
+}
+
+void
+Deflater::slide_window( std::vector<std::byte> & out ) {
+    if ( m_block_start < window_size ) {
+        write_block( false, out );
+    }
+    std::ranges::copy( m_window.begin() + window_size,
+                       m_window.begin()
+                           + static_cast<std::ptrdiff_t>( m_window_end ),
+                       m_window.begin() );
+    m_window_end -= window_size;
+    m_position -= window_size;
+    m_block_start -= window_size;
+    const auto slide{ [&]( auto & entry ) {
+        entry = entry > window_size ?
+                    static_cast<std::uint32_t>( entry - window_size ) :
+                    0;
+    } };
+    std::ranges::for_each( m_head, slide );
+    std::ranges::for_each( m_previous, slide );
+}
+
+void
+Deflater::insert_hash( const std::size_t position ) noexcept {
+    if ( position + min_match > m_window_end ) {
+        return;
+    }
+    auto & head{ m_head[hash( &m_window[position] )] };
+    m_previous[position & window_mask] = head;
+    head = static_cast<std::uint32_t>( position + 1 );
+}
+
+std::uint32_t
+Deflater::find_match( const std::size_t   position,
+                      const std::uint32_t best_length,
+                      const std::uint32_t limit,
+                      std::uint32_t &     distance ) const {
+    if ( limit < min_match || best_length >= limit ) {
+        return 0;
+    }
+    const auto & config{ level_configs[static_cast<std::size_t>( m_level )] };
+    auto         best{ std::max( best_length, min_match - 1 ) };
+    auto         found{ false };
+    auto         chain{ config.max_chain };
+    for ( auto candidate{ m_head[hash( &m_window[position] )] };
+          candidate != 0 && chain-- > 0;
+          candidate = m_previous[( candidate - 1 ) & window_mask] ) {
+        const auto match{ candidate - std::size_t{ 1 } };
+        if ( position - match > window_size ) {
+            break;
+        }
+        // Cheap rejection on the byte that would make the match longer
+        if ( m_window[match + best] != m_window[position + best] ) {
+            continue;
+        }
+        const auto length{ common_length( &m_window[match],
+                                          &m_window[position], limit ) };
+        if ( length > best ) {
+            best = length;
+            distance = static_cast<std::uint32_t>( position - match );
+            found = true;
+            if ( length >= config.nice_length || length == limit ) {
+                break;
+            }
+        }
+    }
+    return found ? best : 0;
+}
+
+void
+Deflater::push_literal( const std::byte value ) noexcept {
+    m_symbols.push_back( { std::to_integer<std::uint16_t>( value ), 0 } );
+    ++m_literal_counts[std::to_integer<std::size_t>( value )];
+}
+
+void
+Deflater::push_match( const std::uint32_t length,
+                      const std::uint32_t distance ) noexcept {
+    m_symbols.push_back( { static_cast<std::uint16_t>( length ),
+                           static_cast<std::uint16_t>( distance ) } );
+    ++m_literal_counts[end_of_block + 1 + length_codes[length]];
+    ++m_distance_counts[distance_code( distance )];
+}
+
+void
+Deflater::write_block( const bool is_final, std::vector<std::byte> & out ) {
+    if ( m_symbols.empty() && !is_final ) {
+        m_block_start = m_position;
+        return;
+    }
+    const std::span<const std::byte> raw{
+        m_window.data() + m_block_start, m_window.data() + m_position
+    };
+    m_literal_counts[end_of_block] = 1;
+
+    const auto header{ plan_dynamic( m_literal_counts, m_distance_counts ) };
+    const auto dynamic_bits{ block_header_bits + header.bits
+                             + symbol_bits( m_literal_counts,
+                                            m_distance_counts,
+                                            header.literal_lengths,
+                                            header.distance_lengths ) };
+    std::array<std::uint8_t, max_distance_codes> fixed_distances{};
+    fixed_distances.fill( fixed_distance_length );
+    const auto fixed_bits{ block_header_bits
+                           + symbol_bits( m_literal_counts, m_distance_counts,
+                                          fixed_literals, fixed_distances ) };
+    // Header, padding to a byte boundary & LEN/NLEN per stored block
+    const auto stored_blocks{ std::max<std::size_t>(
+        1, ( raw.size() + max_stored_block - 1 ) / max_stored_block ) };
+    const auto stored_bits{ stored_blocks * ( byte_bits + 32 )
+                            + 8 * std::uint64_t{ raw.size() } };
+
+    if ( stored_bits < std::min( dynamic_bits, fixed_bits ) ) {
+        auto rest{ raw };
+        do {
+            const auto block{ rest.first(
+                std::min( rest.size(), max_stored_block ) ) };
+            rest = rest.subspan( block.size() );
+            write_stored( block, is_final && rest.empty(), out );
+        } while ( !rest.empty() );
+    }
+    else if ( fixed_bits <= dynamic_bits ) {
+        m_writer.write_bits( ( is_final ? 1U : 0U ) | fixed_block_type << 1,
+                             block_header_bits, out );
+        write_symbols( fixed_literals, fixed_distances, out );
+    }
+    else {
+        m_writer.write_bits( ( is_final ? 1U : 0U ) | dynamic_block_type << 1,
+                             block_header_bits, out );
+        m_writer.write_bits( header.literal_count - ( end_of_block + 1 ), 5,
+                             out );
+        m_writer.write_bits( header.distance_count - 1, 5, out );
+        m_writer.write_bits( header.code_length_count - 4, 4, out );
+        for ( std::uint32_t i{ 0 }; i < header.code_length_count; ++i ) {
+            m_writer.write_bits(
+                header.code_length_lengths[code_length_order[i]], 3, out );
+        }
+        const auto codes{ canonical_codes<code_length_order.size()>(
+            header.code_length_lengths ) };
+        for ( const auto entry : header.code_lengths ) {
+            const auto symbol{ entry & 0x1FU };
+            const auto repeat{ static_cast<std::uint32_t>( entry >> 5 ) };
+            m_writer.write_bits( codes[symbol],
+                                 header.code_length_lengths[symbol], out );
+            switch ( symbol ) {
+            case repeat_previous:
+                m_writer.write_bits( repeat - 3, 2, out );
+                break;
+            case repeat_zero: m_writer.write_bits( repeat - 3, 3, out ); break;
+            case repeat_zero_long:
+                m_writer.write_bits( repeat - 11, 7, out );
+                break;
+            default: break;
+            }
+        }
+        write_symbols( header.literal_lengths, header.distance_lengths, out );
+    }
+
+    m_symbols.clear();
+    m_literal_counts.fill( 0 );
+    m_distance_counts.fill( 0 );
+    m_block_start = m_position;
+}
+
+void
+Deflater::write_symbols( const std::span<const std::uint8_t> literal_lengths,
+                         const std::span<const std::uint8_t> distance_lengths,
+                         std::vector<std::byte> &           out ) {
+    const auto literal_codes{ canonical_codes<fixed_literal_codes>(
+        literal_lengths ) };
+    const auto distance_codes{ canonical_codes<fixed_distance_codes>(
+        distance_lengths ) };
+    for ( const auto [value, distance] : m_symbols ) {
+        if ( distance == 0 ) {
+            m_writer.write_bits( literal_codes[value], literal_lengths[value],
+                                 out );
+            continue;
+        }
+        const auto length_code{ length_codes[value] };
+        const auto symbol{ end_of_block + 1 + length_code };
+        m_writer.write_bits( literal_codes[symbol], literal_lengths[symbol],
+                             out );
+        m_writer.write_bits( value - length_base[length_code],
+                             length_extra_bits[length_code], out );
+        const auto code{ distance_code( distance ) };
+        m_writer.write_bits( distance_codes[code], distance_lengths[code],
+                             out );
+        m_writer.write_bits( distance - distance_base[code],
+                             distance_extra_bits[code], out );
+    }
+    m_writer.write_bits( literal_codes[end_of_block],
+                         literal_lengths[end_of_block], out );
+}
+
+} // namespace ZLIB
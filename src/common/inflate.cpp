@@ -0,0 +1,726 @@
+#include "common/inflate.hpp"
+
+#include "common/deflate_format.hpp"
+#include "common/trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ZLIB
+{
+
+namespace
+{
+
+constexpr std::size_t window_mask{ Inflater::window_size - 1 };
+
+constexpr auto fixed_literals{ fixed_literal_lengths() };
+constexpr auto fixed_distances{ [] {
+    std::array<std::uint8_t, fixed_distance_codes> lengths{};
+    lengths.fill( fixed_distance_length );
+    return lengths;
+}() };
+
+} // namespace
+
+std::ostream &
+operator<<( std::ostream & out_stream, const inflate_status_t status ) {
+    switch ( status ) {
+    case inflate_status_t::OK: return out_stream << "OK";
+    case inflate_status_t::STREAM_END: return out_stream << "STREAM_END";
+    case inflate_status_t::TRUNCATED: return out_stream << "TRUNCATED";
+    case inflate_status_t::BAD_ZLIB_HEADER:
+        return out_stream << "BAD_ZLIB_HEADER";
+    case inflate_status_t::BAD_BLOCK_TYPE:
+        return out_stream << "BAD_BLOCK_TYPE";
+    case inflate_status_t::BAD_STORED_LENGTH:
+        return out_stream << "BAD_STORED_LENGTH";
+    case inflate_status_t::BAD_HUFFMAN_TABLE:
+        return out_stream << "BAD_HUFFMAN_TABLE";
+    case inflate_status_t::BAD_SYMBOL: return out_stream << "BAD_SYMBOL";
+    case inflate_status_t::BAD_DISTANCE: return out_stream << "BAD_DISTANCE";
+    case inflate_status_t::BAD_ADLER32: return out_stream << "BAD_ADLER32";
+        // clang-format off
+    COLD default:
+        return out_stream << "Unknown inflate_status_t ("
+                          << static_cast<std::uint32_t>( status ) << ")";
+        // clang-format on
+    }
+}
+
+// SegmentedBitReader
+
+void
+SegmentedBitReader::reset( const std::span<const segment_t> segments ) noexcept {
+    m_segments = segments;
+    m_segment_index = 0;
+    m_segment_offset = 0;
+    m_bytes_fetched = 0;
+    m_bit_buffer = 0;
+    m_bit_count = 0;
+}
+
+void
+SegmentedBitReader::refill() noexcept {
+    while ( m_bit_count <= 56 && m_segment_index < m_segments.size() ) {
+        const auto & segment{ m_segments[m_segment_index] };
+        while ( m_bit_count <= 56 && m_segment_offset < segment.size() ) {
+            m_bit_buffer |=
+                std::to_integer<std::uint64_t>( segment[m_segment_offset++] )
+                << m_bit_count;
+            m_bit_count += byte_bits;
+            ++m_bytes_fetched;
+        }
+        if ( m_segment_offset == segment.size() ) {
+            ++m_segment_index;
+            m_segment_offset = 0;
+        }
+    }
+}
+
+std::size_t
+SegmentedBitReader::copy_bytes( std::span<std::byte> out ) noexcept {
+    assert( m_bit_count % byte_bits == 0 );
+
+    std::size_t copied{ 0 };
+    // Drain whole bytes already held in the bit buffer
+    while ( copied < out.size() && m_bit_count >= byte_bits ) {
+        out[copied++] = static_cast<std::byte>( m_bit_buffer & 0xFF );
+        consume( byte_bits );
+    }
+
+    // Copy the remainder straight from the segments
+    while ( copied < out.size() && m_segment_index < m_segments.size() ) {
+        const auto & segment{ m_segments[m_segment_index] };
+        const auto   count{ std::min( out.size() - copied,
+                                      segment.size() - m_segment_offset ) };
+        std::memcpy( out.data() + copied, segment.data() + m_segment_offset,
+                     count );
+        copied += count;
+        m_segment_offset += count;
+        m_bytes_fetched += count;
+        if ( m_segment_offset == segment.size() ) {
+            ++m_segment_index;
+            m_segment_offset = 0;
+        }
+    }
+
+    return copied;
+}
+
+bool
+SegmentedBitReader::seek( const std::uint64_t bit_position ) noexcept {
+    reset( m_segments );
+
+    auto byte_offset{ bit_position / byte_bits };
+    while ( m_segment_index < m_segments.size()
+            && byte_offset >= m_segments[m_segment_index].size() ) {
+        byte_offset -= m_segments[m_segment_index].size();
+        m_bytes_fetched += m_segments[m_segment_index].size();
+        ++m_segment_index;
+    }
+    if ( m_segment_index == m_segments.size() && byte_offset != 0 ) {
+        return false;
+    }
+    m_segment_offset = static_cast<std::size_t>( byte_offset );
+    m_bytes_fetched += byte_offset;
+
+    const auto skip_bits{ static_cast<std::uint32_t>( bit_position
+                                                      % byte_bits ) };
+    if ( !fill( skip_bits ) ) {
+        return false;
+    }
+    consume( skip_bits );
+    return true;
+}
+
+// HuffmanTable
+
+bool
+HuffmanTable::build(
+    const std::span<const std::uint8_t> code_lengths ) noexcept {
+    assert( code_lengths.size() <= max_symbols );
+
+    m_counts.fill( 0 );
+    m_fast.fill( 0 );
+    for ( const auto length : code_lengths ) { ++m_counts[length]; }
+    m_counts[0] = 0;
+
+    // Reject over-subscribed code sets. Incomplete sets are accepted, an
+    // unassigned code is reported as bad_symbol when decoded.
+    std::int32_t codes_left{ 1 };
+    for ( std::uint32_t length{ 1 }; length <= max_code_length; ++length ) {
+        codes_left <<= 1;
+        codes_left -= m_counts[length];
+        if ( codes_left < 0 ) {
+            return false;
+        }
+    }
+
+    // Symbol offsets for each code length, & the first canonical code
+    std::array<std::uint16_t, max_code_length + 1> offsets{};
+    std::array<std::uint32_t, max_code_length + 1> next_code{};
+    std::uint32_t                                  code{ 0 };
+    for ( std::uint32_t length{ 1 }; length <= max_code_length; ++length ) {
+        offsets[length] =
+            static_cast<std::uint16_t>( offsets[length - 1]
+                                        + m_counts[length - 1] );
+        code = ( code + m_counts[length - 1] ) << 1;
+        next_code[length] = code;
+    }
+
+    for ( std::uint32_t symbol{ 0 }; symbol < code_lengths.size(); ++symbol ) {
+        const std::uint32_t length{ code_lengths[symbol] };
+        if ( length == 0 ) {
+            continue;
+        }
+        m_symbols[offsets[length]++] = static_cast<std::uint16_t>( symbol );
+
+        const auto symbol_code{ next_code[length]++ };
+        if ( length <= fast_bits ) {
+            // Deflate packs codes MSB first into an LSB first bit stream
+            const auto reversed{ reverse_bits( symbol_code, length ) };
+            const auto entry{ static_cast<std::uint16_t>(
+                ( length << symbol_bits ) | symbol ) };
+            for ( std::uint32_t i{ reversed }; i < m_fast.size();
+                  i += 1U << length ) {
+                m_fast[i] = entry;
+            }
+        }
+    }
+
+    return true;
+}
+
+int
+HuffmanTable::decode( SegmentedBitReader & reader ) const noexcept {
+    [[maybe_unused]] const bool filled{ reader.fill( max_code_length ) };
+    const auto                  available{ reader.bit_count() };
+
+    const auto entry{ m_fast[reader.peek( fast_bits )] };
+    if ( entry != 0 ) {
+        const std::uint32_t length{ static_cast<std::uint32_t>( entry )
+                                    >> symbol_bits };
+        if ( length > available ) {
+            return truncated;
+        }
+        reader.consume( length );
+        return entry & ( ( 1 << symbol_bits ) - 1 );
+    }
+
+    // Canonical decode, one code bit at a time
+    const auto   bits{ reader.peek( max_code_length ) };
+    std::int32_t code{ 0 };
+    std::int32_t first{ 0 };
+    std::int32_t index{ 0 };
+    for ( std::uint32_t length{ 1 }; length <= max_code_length; ++length ) {
+        if ( length > available ) {
+            return truncated;
+        }
+        code |= static_cast<std::int32_t>( ( bits >> ( length - 1 ) ) & 1 );
+        const std::int32_t count{ m_counts[length] };
+        if ( code - first < count ) {
+            reader.consume( length );
+            return m_symbols[static_cast<std::size_t>( index + code - first )];
+        }
+        index += count;
+        first = ( first + count ) << 1;
+        code <<= 1;
+    }
+
+    return bad_symbol;
+}
+
+// Inflater
+
+void
+Inflater::reset( const std::span<const segment_t> segments,
+                 const bool                       zlib_wrapped ) noexcept {
+    m_reader.reset( segments );
+    m_total_out = 0;
+    m_stored_remaining = 0;
+    m_match_remaining = 0;
+    m_match_distance = 0;
+    m_adler.reset();
+    m_state = zlib_wrapped ? state_t::ZLIB_HEADER : state_t::BLOCK_HEADER;
+    m_status = inflate_status_t::OK;
+    m_final_block = false;
+    m_zlib_wrapped = zlib_wrapped;
+    m_ended_between_blocks = false;
+}
+
+InflateCheckpoint
+Inflater::checkpoint() const {
+    InflateCheckpoint checkpoint{ .bit_position = m_reader.bit_position(),
+                                  .total_out = m_total_out,
+                                  .adler = m_adler.value(),
+                                  .stored_remaining = m_stored_remaining,
+                                  .match_remaining = m_match_remaining,
+                                  .match_distance = m_match_distance,
+                                  .literal_count = m_literal_count,
+                                  .distance_count = m_distance_count,
+                                  .state = static_cast<std::uint8_t>( m_state ),
+                                  .final_block = m_final_block,
+                                  .zlib_wrapped = m_zlib_wrapped,
+                                  .code_lengths = m_code_lengths,
+                                  .window = {} };
+
+    const auto history{ static_cast<std::size_t>(
+        std::min<std::uint64_t>( m_total_out, window_size ) ) };
+    checkpoint.window.resize( history );
+    for ( std::size_t i{ 0 }; i < history; ++i ) {
+        checkpoint.window[i] = m_window[static_cast<std::size_t>(
+            ( m_total_out - history + i ) & window_mask )];
+    }
+    return checkpoint;
+}
+
+bool
+Inflater::resume( const std::span<const segment_t> segments,
+                  const InflateCheckpoint &        checkpoint ) noexcept {
+    reset( segments, checkpoint.zlib_wrapped );
+
+    const auto history{ std::min<std::uint64_t>( checkpoint.total_out,
+                                                 window_size ) };
+    const auto lengths{ std::span{ checkpoint.code_lengths } };
+    if ( checkpoint.state >= static_cast<std::uint8_t>( state_t::DONE )
+         || checkpoint.window.size() != history
+         || checkpoint.match_distance > history
+         || checkpoint.literal_count > HuffmanTable::max_symbols
+         || checkpoint.literal_count + checkpoint.distance_count
+                > lengths.size()
+         || !m_reader.seek( checkpoint.bit_position ) ) {
+        set_error( inflate_status_t::TRUNCATED );
+        return false;
+    }
+
+    m_state = static_cast<state_t>( checkpoint.state );
+    if ( m_state == state_t::HUFFMAN
+         && ( !m_literals.build( lengths.first( checkpoint.literal_count ) )
+              || !m_distances.build(
+                  lengths.subspan( checkpoint.literal_count,
+                                   checkpoint.distance_count ) ) ) ) {
+        set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+        return false;
+    }
+
+    m_total_out = checkpoint.total_out;
+    m_stored_remaining = checkpoint.stored_remaining;
+    m_match_remaining = checkpoint.match_remaining;
+    m_match_distance = checkpoint.match_distance;
+    m_adler = Adler32{ checkpoint.adler };
+    m_final_block = checkpoint.final_block;
+    m_code_lengths = checkpoint.code_lengths;
+    m_literal_count = checkpoint.literal_count;
+    m_distance_count = checkpoint.distance_count;
+    // Bytes before the stream start are never referenced, so the window
+    // can be placed as if it had been appended
+    if ( history != 0 ) {
+        m_total_out -= history;
+        append_window( checkpoint.window );
+        m_total_out = checkpoint.total_out;
+    }
+    return true;
+}
+
+std::size_t
+Inflater::read( std::span<std::byte> out ) noexcept {
+    std::size_t produced{ 0 };
+    std::size_t checksummed{ 0 };
+
+    const auto update_checksum = [&]() {
+        if ( m_zlib_wrapped ) {
+            m_adler.update(
+                out.subspan( checksummed, produced - checksummed ) );
+        }
+        checksummed = produced;
+    };
+
+    while ( m_state != state_t::DONE ) {
+        // Headers & the trailer are processed eagerly, block data only
+        // while there is room for it.
+        if ( produced == out.size()
+             && ( m_state == state_t::HUFFMAN
+                  || ( m_state == state_t::STORED
+                       && m_stored_remaining > 0 ) ) ) {
+            break;
+        }
+
+        switch ( m_state ) {
+        case state_t::ZLIB_HEADER: {
+            if ( read_zlib_header() ) {
+                m_state = state_t::BLOCK_HEADER;
+            }
+        } break;
+        case state_t::BLOCK_HEADER: {
+            if ( m_final_block ) {
+                m_state = state_t::TRAILER;
+            }
+            else if ( !read_block_header() ) {
+                break;
+            }
+        } break;
+        case state_t::STORED: {
+            produced += copy_stored( out.subspan( produced ) );
+        } break;
+        case state_t::HUFFMAN: {
+            produced += inflate_block( out.subspan( produced ) );
+        } break;
+        case state_t::TRAILER: {
+            update_checksum();
+            if ( read_trailer() ) {
+                m_status = inflate_status_t::STREAM_END;
+                m_state = state_t::DONE;
+            }
+        } break;
+        case state_t::DONE: break;
+        }
+    }
+
+    update_checksum();
+    return produced;
+}
+
+inflate_status_t
+Inflater::finish() noexcept {
+    // Anything left should be the end of block code, empty blocks & the
+    // trailer. Surplus data is decoded & discarded so the trailer can
+    // still be verified.
+    std::array<std::byte, 64> scratch{};
+    while ( m_state != state_t::DONE ) {
+        [[maybe_unused]] const auto discarded{ read( scratch ) };
+    }
+    return m_status;
+}
+
+bool
+Inflater::read_zlib_header() noexcept {
+    std::uint32_t cmf{ 0 };
+    std::uint32_t flg{ 0 };
+    if ( !m_reader.read_bits( 8, cmf ) || !m_reader.read_bits( 8, flg ) ) {
+        set_error( inflate_status_t::TRUNCATED );
+        return false;
+    }
+
+    constexpr std::uint32_t deflate_method{ 8 };
+    constexpr std::uint32_t max_window_bits{ 7 };
+    constexpr std::uint32_t preset_dictionary_flag{ 0x20 };
+    if ( ( cmf & 0x0F ) != deflate_method || ( cmf >> 4 ) > max_window_bits
+         || ( ( cmf << 8 ) | flg ) % 31 != 0
+         || ( flg & preset_dictionary_flag ) != 0 ) {
+        set_error( inflate_status_t::BAD_ZLIB_HEADER );
+        return false;
+    }
+
+    return true;
+}
+
+bool
+Inflater::read_block_header() noexcept {
+    std::uint32_t header{ 0 };
+    if ( !m_reader.read_bits( 3, header ) ) {
+        m_ended_between_blocks = m_reader.bit_count() == 0;
+        set_error( inflate_status_t::TRUNCATED );
+        return false;
+    }
+    m_final_block = ( header & 1 ) != 0;
+
+    switch ( header >> 1 ) {
+    case 0: { // Stored
+        m_reader.align_to_byte();
+        std::uint32_t length{ 0 };
+        std::uint32_t length_complement{ 0 };
+        if ( !m_reader.read_bits( 16, length )
+             || !m_reader.read_bits( 16, length_complement ) ) {
+            set_error( inflate_status_t::TRUNCATED );
+            return false;
+        }
+        if ( ( length ^ 0xFFFF ) != length_complement ) {
+            set_error( inflate_status_t::BAD_STORED_LENGTH );
+            return false;
+        }
+        m_stored_remaining = length;
+        m_state = state_t::STORED;
+    } break;
+    case 1: { // Fixed Huffman codes
+        if ( !m_literals.build( fixed_literals )
+             || !m_distances.build( fixed_distances ) ) {
+            set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+            return false;
+        }
+        std::ranges::copy( fixed_literals, m_code_lengths.begin() );
+        std::ranges::copy( fixed_distances,
+                           m_code_lengths.begin() + fixed_literals.size() );
+        m_literal_count = static_cast<std::uint16_t>( fixed_literals.size() );
+        m_distance_count = static_cast<std::uint16_t>( fixed_distances.size() );
+        m_state = state_t::HUFFMAN;
+    } break;
+    case 2: { // Dynamic Huffman codes
+        if ( !read_dynamic_tables() ) {
+            return false;
+        }
+        m_state = state_t::HUFFMAN;
+    } break;
+    COLD default: {
+        set_error( inflate_status_t::BAD_BLOCK_TYPE );
+        return false;
+    }
+    }
+
+    TRACE::event<TRACE::trace_level_t::DETAIL>( "inflate_block", header >> 1,
+                                                m_final_block );
+    return true;
+}
+
+bool
+Inflater::read_dynamic_tables() noexcept {
+    std::uint32_t literal_count{ 0 };
+    std::uint32_t distance_count{ 0 };
+    std::uint32_t code_length_count{ 0 };
+    if ( !m_reader.read_bits( 5, literal_count )
+         || !m_reader.read_bits( 5, distance_count )
+         || !m_reader.read_bits( 4, code_length_count ) ) {
+        set_error( inflate_status_t::TRUNCATED );
+        return false;
+    }
+    literal_count += 257;
+    distance_count += 1;
+    code_length_count += 4;
+    if ( literal_count > max_literal_codes
+         || distance_count > max_distance_codes ) {
+        set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+        return false;
+    }
+
+    std::array<std::uint8_t, code_length_order.size()> code_length_lengths{};
+    for ( std::uint32_t i{ 0 }; i < code_length_count; ++i ) {
+        std::uint32_t length{ 0 };
+        if ( !m_reader.read_bits( 3, length ) ) {
+            set_error( inflate_status_t::TRUNCATED );
+            return false;
+        }
+        code_length_lengths[code_length_order[i]] =
+            static_cast<std::uint8_t>( length );
+    }
+
+    // The code length alphabet is decoded with the distance table, which
+    // is rebuilt below.
+    if ( !m_distances.build( code_length_lengths ) ) {
+        set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+        return false;
+    }
+
+    std::array<std::uint8_t, max_literal_codes + max_distance_codes> lengths{};
+    std::uint32_t index{ 0 };
+    while ( index < literal_count + distance_count ) {
+        const auto symbol{ m_distances.decode( m_reader ) };
+        if ( symbol < 0 ) {
+            set_error( symbol == HuffmanTable::truncated ?
+                           inflate_status_t::TRUNCATED :
+                           inflate_status_t::BAD_HUFFMAN_TABLE );
+            return false;
+        }
+
+        if ( symbol < 16 ) {
+            lengths[index++] = static_cast<std::uint8_t>( symbol );
+            continue;
+        }
+
+        std::uint8_t  repeat_value{ 0 };
+        std::uint32_t repeat_count{ 0 };
+        bool          read_ok{ false };
+        if ( symbol == 16 ) {
+            if ( index == 0 ) {
+                set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+                return false;
+            }
+            repeat_value = lengths[index - 1];
+            read_ok = m_reader.read_bits( 2, repeat_count );
+            repeat_count += 3;
+        }
+        else if ( symbol == 17 ) {
+            read_ok = m_reader.read_bits( 3, repeat_count );
+            repeat_count += 3;
+        }
+        else {
+            read_ok = m_reader.read_bits( 7, repeat_count );
+            repeat_count += 11;
+        }
+
+        if ( !read_ok ) {
+            set_error( inflate_status_t::TRUNCATED );
+            return false;
+        }
+        if ( index + repeat_count > literal_count + distance_count ) {
+            set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+            return false;
+        }
+        std::fill_n( lengths.begin() + index, repeat_count, repeat_value );
+        index += repeat_count;
+    }
+
+    if ( lengths[end_of_block] == 0 ) {
+        set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+        return false;
+    }
+
+    const std::span<const std::uint8_t> all_lengths{ lengths };
+    if ( !m_literals.build( all_lengths.first( literal_count ) )
+         || !m_distances.build(
+             all_lengths.subspan( literal_count, distance_count ) ) ) {
+        set_error( inflate_status_t::BAD_HUFFMAN_TABLE );
+        return false;
+    }
+    std::ranges::copy( all_lengths.first( literal_count + distance_count ),
+                       m_code_lengths.begin() );
+    m_literal_count = static_cast<std::uint16_t>( literal_count );
+    m_distance_count = static_cast<std::uint16_t>( distance_count );
+
+    return true;
+}
+
+bool
+Inflater::read_trailer() noexcept {
+    if ( !m_zlib_wrapped ) {
+        return true;
+    }
+
+    m_reader.align_to_byte();
+    std::uint32_t expected{ 0 };
+    for ( std::uint32_t i{ 0 }; i < 4; ++i ) {
+        std::uint32_t byte{ 0 };
+        if ( !m_reader.read_bits( 8, byte ) ) {
+            set_error( inflate_status_t::TRUNCATED );
+            return false;
+        }
+        expected = ( expected << 8 ) | byte;
+    }
+
+    if ( expected != m_adler.value() ) {
+        set_error( inflate_status_t::BAD_ADLER32 );
+        return false;
+    }
+
+    return true;
+}
+
+void
+Inflater::append_window( const std::span<const std::byte> bytes ) noexcept {
+    // Only the last window_size bytes can ever be referenced
+    const auto tail{ bytes.size() > window_size ?
+                         bytes.last( window_size ) :
+                         bytes };
+    const auto start{ static_cast<std::size_t>(
+        ( m_total_out + bytes.size() - tail.size() ) & window_mask ) };
+    const auto first_part{ std::min( tail.size(), window_size - start ) };
+    std::memcpy( m_window.data() + start, tail.data(), first_part );
+    std::memcpy( m_window.data(), tail.data() + first_part,
+                 tail.size() - first_part );
+}
+
+std::size_t
+Inflater::copy_stored( std::span<std::byte> out ) noexcept {
+    const auto wanted{ std::min<std::size_t>( out.size(),
+                                              m_stored_remaining ) };
+    const auto copied{ m_reader.copy_bytes( out.first( wanted ) ) };
+
+    append_window( out.first( copied ) );
+    m_total_out += copied;
+    m_stored_remaining -= static_cast<std::uint32_t>( copied );
+
+    if ( copied < wanted ) {
+        set_error( inflate_status_t::TRUNCATED );
+    }
+    else if ( m_stored_remaining == 0 ) {
+        m_state = state_t::BLOCK_HEADER;
+    }
+
+    return copied;
+}
+
+std::size_t
+Inflater::inflate_block( std::span<std::byte> out ) noexcept {
+    std::size_t produced{ 0 };
+
+    const auto emit = [&]( const std::byte value ) {
+        m_window[static_cast<std::size_t>( m_total_out & window_mask )] =
+            value;
+        out[produced++] = value;
+        ++m_total_out;
+    };
+
+    while ( produced < out.size() ) {
+        // Finish any match interrupted by a full output buffer
+        if ( m_match_remaining > 0 ) {
+            const auto count{ std::min<std::size_t>( m_match_remaining,
+                                                     out.size() - produced ) };
+            for ( std::size_t i{ 0 }; i < count; ++i ) {
+                emit( m_window[static_cast<std::size_t>(
+                    ( m_total_out - m_match_distance ) & window_mask )] );
+            }
+            m_match_remaining -= static_cast<std::uint32_t>( count );
+            continue;
+        }
+
+        const auto symbol{ m_literals.decode( m_reader ) };
+        if ( symbol < 0 ) {
+            set_error( symbol == HuffmanTable::truncated ?
+                           inflate_status_t::TRUNCATED :
+                           inflate_status_t::BAD_SYMBOL );
+            break;
+        }
+
+        const auto literal{ static_cast<std::uint32_t>( symbol ) };
+        if ( literal < end_of_block ) {
+            emit( static_cast<std::byte>( literal ) );
+            continue;
+        }
+        if ( literal == end_of_block ) {
+            m_state = state_t::BLOCK_HEADER;
+            break;
+        }
+
+        const auto length_code{ literal - end_of_block - 1 };
+        if ( length_code >= length_base.size() ) {
+            set_error( inflate_status_t::BAD_SYMBOL );
+            break;
+        }
+        std::uint32_t length_extra{ 0 };
+        if ( !m_reader.read_bits( length_extra_bits[length_code],
+                                  length_extra ) ) {
+            set_error( inflate_status_t::TRUNCATED );
+            break;
+        }
+
+        const auto distance_symbol{ m_distances.decode( m_reader ) };
+        if ( distance_symbol < 0 ) {
+            set_error( distance_symbol == HuffmanTable::truncated ?
+                           inflate_status_t::TRUNCATED :
+                           inflate_status_t::BAD_SYMBOL );
+            break;
+        }
+        const auto distance_code{ static_cast<std::uint32_t>(
+            distance_symbol ) };
+        if ( distance_code >= distance_base.size() ) {
+            set_error( inflate_status_t::BAD_DISTANCE );
+            break;
+        }
+        std::uint32_t distance_extra{ 0 };
+        if ( !m_reader.read_bits( distance_extra_bits[distance_code],
+                                  distance_extra ) ) {
+            set_error( inflate_status_t::TRUNCATED );
+            break;
+        }
+
+        m_match_distance = distance_base[distance_code] + distance_extra;
+        if ( m_match_distance > m_total_out ) {
+            set_error( inflate_status_t::BAD_DISTANCE );
+            break;
+        }
+        m_match_remaining = length_base[length_code] + length_extra;
+    }
+
+    return produced;
+}
+
+} // namespace ZLIB
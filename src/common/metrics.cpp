@@ -0,0 +1,196 @@
+#include "common/metrics.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+namespace METRICS
+{
+
+namespace
+{
+
+constexpr std::uint64_t nanoseconds_per_second{ 1'000'000'000 };
+
+struct AtomicTotals
+{
+    std::atomic<std::uint64_t> calls{ 0 };
+    std::atomic<std::uint64_t> nanoseconds{ 0 };
+    std::atomic<std::uint64_t> bytes_in{ 0 };
+    std::atomic<std::uint64_t> bytes_out{ 0 };
+};
+
+std::atomic<std::uint64_t>            process_images{ 0 };
+std::array<AtomicTotals, stage_count> process_stages{};
+
+// Exact decimal seconds, without going through floating point
+void
+write_seconds( std::ostream & out_stream, const std::uint64_t nanoseconds ) {
+    const auto fill{ out_stream.fill( '0' ) };
+    out_stream << nanoseconds / nanoseconds_per_second << '.'
+               << std::setw( 9 ) << nanoseconds % nanoseconds_per_second;
+    out_stream.fill( fill );
+}
+
+void
+write_json( std::ostream & out_stream, const StageMetrics & metrics ) {
+    out_stream << "{\"images\":" << metrics.images << ",\"stages\":{";
+    for ( std::size_t i{ 0 }; i < stage_count; ++i ) {
+        const auto & totals{ metrics.stages[i] };
+        out_stream << ( i == 0 ? "" : "," ) << '"'
+                   << stage_name( static_cast<stage_t>( i ) )
+                   << "\":{\"calls\":" << totals.calls
+                   << ",\"nanoseconds\":" << totals.nanoseconds
+                   << ",\"bytes_in\":" << totals.bytes_in
+                   << ",\"bytes_out\":" << totals.bytes_out << '}';
+    }
+    out_stream << "}}\n";
+}
+
+void
+write_prometheus( std::ostream & out_stream, const StageMetrics & metrics ) {
+    const auto write_family = [&]( const std::string_view name,
+                                   const std::string_view help,
+                                   auto                   write_value ) {
+        out_stream << "# HELP " << name << ' ' << help << '\n'
+                   << "# TYPE " << name << " counter\n";
+        for ( std::size_t i{ 0 }; i < stage_count; ++i ) {
+            out_stream << name << "{stage=\""
+                       << stage_name( static_cast<stage_t>( i ) ) << "\"} ";
+            write_value( metrics.stages[i] );
+            out_stream << '\n';
+        }
+    };
+
+    out_stream << "# HELP png_images_total Images parsed.\n"
+               << "# TYPE png_images_total counter\n"
+               << "png_images_total " << metrics.images << '\n';
+    write_family( "png_stage_calls_total", "Times each stage ran.",
+                  [&]( const StageTotals & totals ) {
+                      out_stream << totals.calls;
+                  } );
+    write_family( "png_stage_seconds_total", "Wall time spent in each stage.",
+                  [&]( const StageTotals & totals ) {
+                      write_seconds( out_stream, totals.nanoseconds );
+                  } );
+    write_family( "png_stage_bytes_in_total", "Bytes read by each stage.",
+                  [&]( const StageTotals & totals ) {
+                      out_stream << totals.bytes_in;
+                  } );
+    write_family( "png_stage_bytes_out_total", "Bytes written by each stage.",
+                  [&]( const StageTotals & totals ) {
+                      out_stream << totals.bytes_out;
+                  } );
+}
+
+} // namespace
+
+StageMetrics
+process_metrics() noexcept {
+    StageMetrics metrics{};
+    metrics.images = process_images.load( std::memory_order_relaxed );
+    for ( std::size_t i{ 0 }; i < stage_count; ++i ) {
+        const auto & totals{ process_stages[i] };
+        metrics.stages[i] = {
+            .calls = totals.calls.load( std::memory_order_relaxed ),
+            .nanoseconds = totals.nanoseconds.load( std::memory_order_relaxed ),
+            .bytes_in = totals.bytes_in.load( std::memory_order_relaxed ),
+            .bytes_out = totals.bytes_out.load( std::memory_order_relaxed )
+        };
+    }
+    return metrics;
+}
+
+void
+reset_process_metrics() noexcept {
+    process_images.store( 0, std::memory_order_relaxed );
+    for ( auto & totals : process_stages ) {
+        totals.calls.store( 0, std::memory_order_relaxed );
+        totals.nanoseconds.store( 0, std::memory_order_relaxed );
+        totals.bytes_in.store( 0, std::memory_order_relaxed );
+        totals.bytes_out.store( 0, std::memory_order_relaxed );
+    }
+}
+
+void
+count_image( StageMetrics * const image ) noexcept {
+    if ( !enabled() ) {
+        return;
+    }
+    if ( image != nullptr ) {
+        ++image->images;
+    }
+    process_images.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void
+add_totals( StageMetrics * const image, const stage_t stage,
+            const StageTotals & totals ) noexcept {
+    const auto index{ static_cast<std::size_t>( stage ) };
+    if ( image != nullptr ) {
+        auto & image_totals{ image->stages[index] };
+        image_totals.calls += totals.calls;
+        image_totals.nanoseconds += totals.nanoseconds;
+        image_totals.bytes_in += totals.bytes_in;
+        image_totals.bytes_out += totals.bytes_out;
+    }
+    auto & process_totals{ process_stages[index] };
+    process_totals.calls.fetch_add( totals.calls, std::memory_order_relaxed );
+    process_totals.nanoseconds.fetch_add( totals.nanoseconds,
+                                          std::memory_order_relaxed );
+    process_totals.bytes_in.fetch_add( totals.bytes_in,
+                                       std::memory_order_relaxed );
+    process_totals.bytes_out.fetch_add( totals.bytes_out,
+                                        std::memory_order_relaxed );
+}
+
+std::uint64_t
+now() noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() )
+            .count() );
+}
+
+void
+StageTimer::stop() noexcept {
+    add_totals( m_image, m_stage,
+                { .calls = 1,
+                  .nanoseconds = now() - m_start,
+                  .bytes_in = m_bytes_in,
+                  .bytes_out = m_bytes_out } );
+}
+
+StageBatch::~StageBatch() {
+    if ( !m_active ) {
+        return;
+    }
+    for ( std::size_t i{ 0 }; i < stage_count; ++i ) {
+        if ( m_totals[i].calls != 0 ) {
+            add_totals( m_image, static_cast<stage_t>( i ), m_totals[i] );
+        }
+    }
+}
+
+void
+write_metrics( std::ostream & out_stream, const StageMetrics & metrics,
+               const metrics_format_t format ) {
+    if ( format == metrics_format_t::JSON ) {
+        write_json( out_stream, metrics );
+    }
+    else {
+        write_prometheus( out_stream, metrics );
+    }
+}
+
+bool
+save_process_metrics( const std::filesystem::path & path,
+                      const metrics_format_t        format ) {
+    std::ofstream out_file{ path, std::ios::trunc };
+    write_metrics( out_file, process_metrics(), format );
+    out_file.flush();
+    return static_cast<bool>( out_file );
+}
+
+} // namespace METRICS
@@ -0,0 +1,116 @@
+#include "common/parallel.hpp"
+
+#include <algorithm>
+
+namespace PARALLEL
+{
+
+std::size_t
+worker_count( const std::uint32_t threads, const std::size_t tasks ) noexcept {
+    const std::size_t requested{
+        threads != 0 ? threads :
+                       std::max( 1U, std::thread::hardware_concurrency() )
+    };
+    return std::max<std::size_t>( 1, std::min( requested, tasks ) );
+}
+
+WorkerPool::WorkerPool( const std::size_t workers ) {
+    try {
+        for ( std::size_t worker{ 1 }; worker < workers; ++worker ) {
+            m_threads.emplace_back( [this, worker] { work( worker ); } );
+        }
+    }
+    catch ( ... ) {
+        stop();
+        throw;
+    }
+}
+
+WorkerPool::~WorkerPool() { stop(); }
+
+void
+WorkerPool::stop() noexcept {
+    {
+        const std::lock_guard lock{ m_mutex };
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+}
+
+void
+WorkerPool::run_tasks( const std::size_t count, const task_t & task ) {
+    if ( count == 0 ) {
+        return;
+    }
+
+    // A single task stays on the calling thread
+    const bool shared{ count > 1 && !m_threads.empty() };
+    {
+        const std::lock_guard lock{ m_mutex };
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_failed = false;
+        m_error = nullptr;
+        if ( shared ) {
+            m_busy = m_threads.size();
+            ++m_batch;
+        }
+    }
+    if ( shared ) {
+        m_wake.notify_all();
+    }
+    take_tasks( 0 );
+    if ( shared ) {
+        std::unique_lock lock{ m_mutex };
+        m_done.wait( lock, [this] { return m_busy == 0; } );
+    }
+
+    if ( m_error ) {
+        std::rethrow_exception( std::exchange( m_error, nullptr ) );
+    }
+}
+
+void
+WorkerPool::take_tasks( const std::size_t worker ) noexcept {
+    // Tasks are handed out in order, so every task before one that threw
+    // was already started & still runs to completion
+    for ( auto index{ m_next++ }; index < m_count && !m_failed;
+          index = m_next++ ) {
+        try {
+            ( *m_task )( index, worker );
+        }
+        catch ( ... ) {
+            const std::lock_guard lock{ m_mutex };
+            if ( !m_error || index < m_error_index ) {
+                m_error = std::current_exception();
+                m_error_index = index;
+            }
+            m_failed = true;
+        }
+    }
+}
+
+void
+WorkerPool::work( const std::size_t worker ) noexcept {
+    std::uint64_t batch{ 0 };
+    while ( true ) {
+        {
+            std::unique_lock lock{ m_mutex };
+            m_wake.wait( lock,
+                         [&] { return m_stopping || m_batch != batch; } );
+            if ( m_stopping ) {
+                return;
+            }
+            batch = m_batch;
+        }
+        take_tasks( worker );
+        {
+            const std::lock_guard lock{ m_mutex };
+            --m_busy;
+        }
+        m_done.notify_one();
+    }
+}
+
+} // namespace PARALLEL
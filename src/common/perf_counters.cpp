@@ -0,0 +1,179 @@
+#include "common/perf_counters.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+
+#if defined( __linux__ )
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PERF
+{
+
+constinit thread_local Profile * active_profile{ nullptr };
+
+namespace
+{
+
+#if defined( __linux__ )
+// perf_event type & config of each counter_t
+constexpr std::array<std::pair<std::uint32_t, std::uint64_t>, counter_count>
+    counter_events{ {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                                  | ( PERF_COUNT_HW_CACHE_OP_READ << 8 )
+                                  | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) },
+    } };
+
+// Opens `counter` for the calling thread, as the group leader if
+// `group_fd` is -1. Returns -1 on failure.
+int
+open_counter( const std::size_t counter, const int group_fd ) noexcept {
+    perf_event_attr attributes{};
+    attributes.size = sizeof( attributes );
+    attributes.type = counter_events[counter].first;
+    attributes.config = counter_events[counter].second;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    // The leader starts the whole group once it is complete
+    if ( group_fd < 0 ) {
+        attributes.disabled = 1;
+    }
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    return static_cast<int>( ::syscall( SYS_perf_event_open, &attributes, 0,
+                                        -1, group_fd,
+                                        PERF_FLAG_FD_CLOEXEC ) );
+}
+#endif
+
+} // namespace
+
+double
+RegionTotals::ipc() const noexcept {
+    const auto cycles{ ( *this )[counter_t::CYCLES] };
+    const auto instructions{ ( *this )[counter_t::INSTRUCTIONS] };
+    return cycles == 0 ? 0.0 :
+                         static_cast<double>( instructions )
+                             / static_cast<double>( cycles );
+}
+
+double
+RegionTotals::per_byte( const counter_t counter ) const noexcept {
+    return bytes == 0 ? 0.0 :
+                        static_cast<double>( ( *this )[counter] )
+                            / static_cast<double>( bytes );
+}
+
+Profile::Profile() noexcept : m_fds{ -1, -1, -1, -1 } {
+#if defined( __linux__ )
+    m_fds[0] = open_counter( 0, -1 );
+    if ( m_fds[0] < 0 ) {
+        return;
+    }
+    for ( std::size_t i{ 1 }; i < counter_count; ++i ) {
+        m_fds[i] = open_counter( i, m_fds[0] );
+    }
+    ::ioctl( m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+    ::ioctl( m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+#endif
+}
+
+Profile::~Profile() {
+    stop();
+#if defined( __linux__ )
+    for ( const auto fd : m_fds ) {
+        if ( fd >= 0 ) {
+            ::close( fd );
+        }
+    }
+#endif
+}
+
+void
+Profile::start() noexcept {
+    active_profile = this;
+}
+
+void
+Profile::stop() noexcept {
+    if ( active_profile == this ) {
+        active_profile = nullptr;
+    }
+}
+
+CounterValues
+Profile::read() const noexcept {
+    CounterValues values{};
+#if defined( __linux__ )
+    if ( !available() ) {
+        return values;
+    }
+    // Number of counters, then their values in the order they joined
+    std::array<std::uint64_t, counter_count + 1> group{};
+    if ( ::read( m_fds[0], group.data(), sizeof( group ) )
+         < static_cast<ssize_t>( sizeof( std::uint64_t ) ) ) {
+        return values;
+    }
+    std::size_t next{ 1 };
+    for ( std::size_t i{ 0 }; i < counter_count; ++i ) {
+        if ( m_fds[i] >= 0 && next <= group[0] ) {
+            values[i] = group[next++];
+        }
+    }
+#endif
+    return values;
+}
+
+void
+Profile::add( const std::string_view name, const std::uint64_t bytes,
+              const CounterValues & start ) noexcept {
+    const auto end{ read() };
+    const auto recorded{ regions() };
+    const auto index{ static_cast<std::size_t>(
+        std::ranges::find( recorded, name, &RegionTotals::name )
+        - recorded.begin() ) };
+    if ( index == m_region_count ) {
+        if ( m_region_count == max_regions ) {
+            return;
+        }
+        m_regions[m_region_count++] = { .name = name };
+    }
+
+    auto & totals{ m_regions[index] };
+    ++totals.calls;
+    totals.bytes += bytes;
+    for ( std::size_t i{ 0 }; i < counter_count; ++i ) {
+        totals.counters[i] += end[i] - start[i];
+    }
+}
+
+void
+Profile::report( std::ostream & out_stream ) const {
+    const auto flags{ out_stream.flags() };
+    const auto precision{ out_stream.precision() };
+    out_stream << std::dec << std::fixed << std::setprecision( 3 )
+               << "# region calls bytes cycles instructions branch_misses "
+                  "llc_misses ipc branch_misses_per_byte "
+                  "llc_misses_per_byte\n";
+    for ( const auto & region : regions() ) {
+        out_stream << region.name << ' ' << region.calls << ' '
+                   << region.bytes;
+        for ( const auto count : region.counters ) {
+            out_stream << ' ' << count;
+        }
+        out_stream << ' ' << region.ipc() << ' '
+                   << region.per_byte( counter_t::BRANCH_MISSES ) << ' '
+                   << region.per_byte( counter_t::LLC_MISSES ) << '\n';
+    }
+    out_stream.flags( flags );
+    out_stream.precision( precision );
+}
+
+} // namespace PERF
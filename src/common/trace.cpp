@@ -0,0 +1,47 @@
+#include "common/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+
+namespace TRACE
+{
+
+std::vector<TraceEvent>
+TraceBuffer::events() const {
+    const auto count{ static_cast<std::size_t>(
+        std::min<std::uint64_t>( m_recorded, capacity ) ) };
+    const auto first{ static_cast<std::size_t>( ( m_recorded - count )
+                                                % capacity ) };
+
+    std::vector<TraceEvent> ordered;
+    ordered.reserve( count );
+    for ( std::size_t i{ 0 }; i < count; ++i ) {
+        ordered.push_back( m_events[( first + i ) % capacity] );
+    }
+    return ordered;
+}
+
+TraceBuffer &
+thread_buffer() {
+    thread_local TraceBuffer buffer{};
+    return buffer;
+}
+
+std::uint64_t
+timestamp() noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() )
+            .count() );
+}
+
+std::ostream &
+operator<<( std::ostream & out_stream, const TraceEvent & event ) {
+    return out_stream << event.timestamp << ' '
+                      << static_cast<unsigned>( event.level ) << ' '
+                      << event.name << ' ' << event.first << ' '
+                      << event.second;
+}
+
+} // namespace TRACE
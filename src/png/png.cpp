@@ -1,11 +1,9 @@
 #include "png/png.hpp"
 
+#include "common/trace.hpp"
+
 #include <bit>
 #include <cassert>
-// #include <iomanip>
-#include <filesystem>
-#include <fstream>
-#include <iostream>
 #include <span>
 
 namespace PNG
@@ -36,8 +34,10 @@ PNG::PNG( const std::string_view raw_data ) :
     png_chunks.reserve( 10 );
     do {
         png_chunks.emplace_back( parse_chunk( raw_data, data_offset ) );
-        std::cout << png_chunks[png_chunks.size() - 1] << std::endl;
     } while ( data_offset < raw_data.size() );
+    TRACE::event<TRACE::trace_level_t::STAGE>( "png_chunks",
+                                               png_chunks.size(),
+                                               raw_data.size() );
 
     png_chunks.shrink_to_fit();
 }
@@ -60,20 +60,9 @@ PNG::parse_chunk( const std::string_view chunk_data,
     // Get start pointer for validating CRC
     const auto crc_start_ptr{ reinterpret_cast<const std::byte *>(
         chunk_data.data() + data_offset ) };
-    if ( potential_chunk_type == png_chunk_t::IEND ) {
-        const auto data_path{ std::filesystem::current_path() / ".." / "tests"
-                              / "data" / "iend_bytes.bin" };
-        std::ofstream out_file{ data_path,
-                                std::ios_base::out | std::ios_base::binary };
-        if ( !out_file.is_open() ) {
-            std::cerr << "Failed to open iend out file" << std::endl;
-            exit( 1 );
-        }
-
-        std::cout << std::string{ chunk_data.data() + data_offset, 4 }
-                  << std::endl;
-        out_file.write( chunk_data.data() + data_offset, 4 );
-    }
+    TRACE::event<TRACE::trace_level_t::CHUNK>(
+        "parse_chunk", static_cast<std::uint32_t>( potential_chunk_type ),
+        data_size );
     data_offset += 4;
 
     // Copy data
@@ -0,0 +1,543 @@
+#include "png/png_apng.hpp"
+
+#include "common/parallel.hpp"
+#include "png/png_convert.hpp"
+#include "png/png_filter.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::size_t actl_payload_bytes{ 8 };
+constexpr std::size_t fctl_payload_bytes{ 26 };
+// Sequence number leading fcTL & fdAT data
+constexpr std::size_t sequence_bytes{ 4 };
+constexpr std::size_t rgba_bytes{ 4 };
+
+constexpr std::uint8_t max_sample{ 255 };
+
+template <typename T>
+[[nodiscard]] T
+read_integer( const std::span<const std::byte> data,
+              const std::size_t                offset ) noexcept {
+    return span_to_integer<T, std::endian::big>(
+        data.subspan( offset, sizeof( T ) ) );
+}
+
+// Source samples & what they need to become 8 bit RGBA.
+struct PixelFormat
+{
+    IHDR::ColourType               colour_type;
+    IHDR::BitDepth                 bit_depth;
+    std::uint8_t                   channels;
+    const CONVERT::PaletteLookup * palette; // Indexed only
+    // tRNS colour key, in samples of the image's own bit depth
+    std::optional<std::array<std::uint16_t, 3>> key;
+};
+
+constexpr std::uint8_t
+to_8_bits( const std::uint16_t sample, const PixelFormat & format ) noexcept {
+    if ( format.bit_depth == 16 ) {
+        return static_cast<std::uint8_t>(
+            ( sample * std::uint32_t{ max_sample }
+              + CONVERT::rounding_offsets[0] )
+            >> 16 );
+    }
+    // Only greyscale has samples below 8 bits outside of palettes
+    return static_cast<std::uint8_t>(
+        format.bit_depth < 8 ?
+            sample * CONVERT::full_range_scale( format.bit_depth ) :
+            sample );
+}
+
+// Expands the `columns` unfiltered pixels of `pixels` to 8 bit RGBA.
+void
+expand_to_rgba( const std::span<const std::byte> pixels,
+                const std::uint32_t columns, const PixelFormat & format,
+                const std::span<std::byte> rgba ) noexcept {
+    if ( format.palette != nullptr ) {
+        for ( std::uint32_t x{ 0 }; x < columns; ++x ) {
+            const auto index{ CONVERT::read_sample( pixels, x,
+                                                    format.bit_depth ) };
+            std::memcpy( rgba.data() + x * rgba_bytes,
+                         format.palette->rgba.data() + index * rgba_bytes,
+                         rgba_bytes );
+        }
+        return;
+    }
+    if ( format.colour_type == IHDR::ColourType::TRUE_COLOUR_ALPHA
+         && format.bit_depth == 8 ) {
+        std::memcpy( rgba.data(), pixels.data(), columns * rgba_bytes );
+        return;
+    }
+
+    const auto has_colour{ format.channels >= 3 };
+    const auto has_alpha{ format.channels % 2 == 0 };
+    for ( std::uint32_t x{ 0 }; x < columns; ++x ) {
+        std::array<std::uint16_t, 4> samples{};
+        for ( std::uint8_t channel{ 0 }; channel < format.channels;
+              ++channel ) {
+            samples[channel] = CONVERT::read_sample(
+                pixels, std::size_t{ x } * format.channels + channel,
+                format.bit_depth );
+        }
+        const auto keyed{ format.key
+                          && std::ranges::equal(
+                              std::span{ samples }.first( format.channels ),
+                              std::span{ *format.key }.first(
+                                  format.channels ) ) };
+
+        const auto pixel{ rgba.subspan( x * rgba_bytes, rgba_bytes ) };
+        const auto colour_channels{ has_colour ? 3 : 1 };
+        for ( int channel{ 0 }; channel < 3; ++channel ) {
+            pixel[channel] = static_cast<std::byte>( to_8_bits(
+                samples[has_colour ? channel : 0], format ) );
+        }
+        auto alpha{ has_alpha ? to_8_bits( samples[colour_channels], format ) :
+                                max_sample };
+        if ( keyed ) {
+            alpha = 0;
+        }
+        pixel[3] = static_cast<std::byte>( alpha );
+    }
+}
+
+// Composites `pixels` RGBA pixels of `source` over `target`, as the APNG
+// specification defines for non-premultiplied 8 bit samples:
+//   u = sa * 255, v = ( 255 - sa ) * ta, a = u + v
+//   colour = ( sc * u + tc * v ) / a, alpha = a / 255
+// both divisions truncating.
+void
+blend_over( const std::span<const std::byte> source,
+            const std::span<std::byte> target, const std::size_t first,
+            const std::size_t pixels ) noexcept {
+    for ( auto pixel{ first }; pixel < pixels; ++pixel ) {
+        const auto s{ source.subspan( pixel * rgba_bytes, rgba_bytes ) };
+        const auto t{ target.subspan( pixel * rgba_bytes, rgba_bytes ) };
+        const auto source_alpha{ std::to_integer<std::uint32_t>( s[3] ) };
+        if ( source_alpha == 0 ) {
+            continue;
+        }
+        if ( source_alpha == max_sample ) {
+            std::ranges::copy( s, t.begin() );
+            continue;
+        }
+        const auto u{ source_alpha * max_sample };
+        const auto v{ ( max_sample - source_alpha )
+                      * std::to_integer<std::uint32_t>( t[3] ) };
+        const auto alpha{ u + v };
+        for ( std::size_t channel{ 0 }; channel < 3; ++channel ) {
+            t[channel] = static_cast<std::byte>(
+                ( std::to_integer<std::uint32_t>( s[channel] ) * u
+                  + std::to_integer<std::uint32_t>( t[channel] ) * v )
+                / alpha );
+        }
+        t[3] = static_cast<std::byte>( alpha / max_sample );
+    }
+}
+
+#if defined( __AVX2__ )
+// Sample at bit `Shift` of each RGBA pixel, as a float.
+template <int Shift>
+__m256
+channel_ps( const __m256i pixels ) noexcept {
+    return _mm256_cvtepi32_ps( _mm256_and_si256(
+        _mm256_srli_epi32( pixels, Shift ), _mm256_set1_epi32( 0xFF ) ) );
+}
+
+// blend_over, 8 pixels at a time in single precision. Every product & sum
+// is an integer below 2^24, so exact, & no quotient comes close enough to
+// the integer above it to round up to it: truncating matches the integer
+// division of the scalar code. Returns the pixels blended.
+std::size_t
+blend_over_avx2( const std::span<const std::byte> source,
+                 const std::span<std::byte>       target,
+                 const std::size_t                pixels ) noexcept {
+    const auto  full{ _mm256_set1_ps( max_sample ) };
+    const auto  zero{ _mm256_setzero_si256() };
+    std::size_t pixel{ 0 };
+    for ( ; pixel + 8 <= pixels; pixel += 8 ) {
+        const auto s{ _mm256_loadu_si256( reinterpret_cast<const __m256i *>(
+            source.data() + pixel * rgba_bytes ) ) };
+        const auto t{ _mm256_loadu_si256( reinterpret_cast<const __m256i *>(
+            target.data() + pixel * rgba_bytes ) ) };
+
+        const auto source_alpha{ channel_ps<24>( s ) };
+        const auto u{ _mm256_mul_ps( source_alpha, full ) };
+        const auto v{ _mm256_mul_ps( _mm256_sub_ps( full, source_alpha ),
+                                     channel_ps<24>( t ) ) };
+        const auto alpha{ _mm256_add_ps( u, v ) };
+        const auto colour = [&]( const __m256 s_channel,
+                                 const __m256 t_channel ) {
+            return _mm256_cvttps_epi32( _mm256_div_ps(
+                _mm256_add_ps( _mm256_mul_ps( s_channel, u ),
+                               _mm256_mul_ps( t_channel, v ) ),
+                alpha ) );
+        };
+
+        auto blended{ _mm256_slli_epi32(
+            _mm256_cvttps_epi32( _mm256_div_ps( alpha, full ) ), 24 ) };
+        blended = _mm256_or_si256(
+            blended, colour( channel_ps<0>( s ), channel_ps<0>( t ) ) );
+        blended = _mm256_or_si256(
+            blended,
+            _mm256_slli_epi32(
+                colour( channel_ps<8>( s ), channel_ps<8>( t ) ), 8 ) );
+        blended = _mm256_or_si256(
+            blended,
+            _mm256_slli_epi32(
+                colour( channel_ps<16>( s ), channel_ps<16>( t ) ), 16 ) );
+
+        // Fully transparent source pixels leave the target as it was, which
+        // also discards the 0 / 0 of transparent over transparent
+        const auto transparent{ _mm256_cmpeq_epi32(
+            _mm256_srli_epi32( s, 24 ), zero ) };
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>( target.data()
+                                         + pixel * rgba_bytes ),
+            _mm256_blendv_epi8( blended, t, transparent ) );
+    }
+    return pixel;
+}
+#endif
+
+} // namespace
+
+ApngDecoder::ApngDecoder( const std::span<const std::byte> raw_data,
+                          const ApngOptions &              options ) :
+    m_decoder( raw_data ), m_options( options ) {
+    const auto & ihdr{ header() };
+    const auto   canvas_width{ std::uint64_t{ ihdr.getWidth() } };
+    const auto   canvas_height{ std::uint64_t{ ihdr.getHeight() } };
+
+    bool          animated{ false };
+    bool          seen_idat{ false };
+    bool          seen_fdat{ false };
+    std::uint32_t frame_count{ 0 };
+    std::uint32_t sequence{ 0 };
+    const auto check_sequence = [&]( const std::span<const std::byte> data ) {
+        if ( read_integer<std::uint32_t>( data, 0 ) != sequence++ ) {
+            throw png_error( png_error_t::BAD_ANIMATION );
+        }
+    };
+
+    std::vector<ZLIB::segment_t> idat_data;
+    for ( const auto & chunk : m_decoder.chunks() ) {
+        const auto data{ chunk.data };
+        if ( chunk.type == PngChunkType::IDAT ) {
+            seen_idat = true;
+            idat_data.emplace_back( data );
+            // Only a frame announced before the image data can own it
+            if ( animated && !m_frames.empty() ) {
+                if ( !m_default_image_is_frame || m_frames.size() != 1
+                     || seen_fdat ) {
+                    throw png_error( png_error_t::BAD_ANIMATION );
+                }
+                m_frame_data.back().emplace_back( data );
+            }
+        }
+        else if ( chunk.type == PngChunkType::acTL ) {
+            if ( animated || seen_idat || data.size() != actl_payload_bytes ) {
+                throw png_error( png_error_t::BAD_ANIMATION );
+            }
+            animated = true;
+            frame_count = read_integer<std::uint32_t>( data, 0 );
+            m_play_count = read_integer<std::uint32_t>( data, 4 );
+            if ( frame_count == 0 ) {
+                throw png_error( png_error_t::BAD_ANIMATION );
+            }
+        }
+        // Frame chunks without acTL are ignored, as the image isn't animated
+        else if ( chunk.type == PngChunkType::fcTL && animated ) {
+            if ( data.size() != fctl_payload_bytes
+                 || ( !m_frame_data.empty() && m_frame_data.back().empty() ) ) {
+                throw png_error( png_error_t::BAD_ANIMATION );
+            }
+            check_sequence( data );
+            const FrameControl frame{
+                .width = read_integer<std::uint32_t>( data, 4 ),
+                .height = read_integer<std::uint32_t>( data, 8 ),
+                .x_offset = read_integer<std::uint32_t>( data, 12 ),
+                .y_offset = read_integer<std::uint32_t>( data, 16 ),
+                .delay_numerator = read_integer<std::uint16_t>( data, 20 ),
+                .delay_denominator = read_integer<std::uint16_t>( data, 22 ),
+                .dispose_op = static_cast<DisposeOp>( data[24] ),
+                .blend_op = static_cast<BlendOp>( data[25] )
+            };
+            // The default image, when it is a frame, fills the canvas
+            const auto covers_canvas{ frame.x_offset == 0 && frame.y_offset == 0
+                                      && frame.width == canvas_width
+                                      && frame.height == canvas_height };
+            if ( frame.width == 0 || frame.height == 0
+                 || frame.x_offset + std::uint64_t{ frame.width }
+                        > canvas_width
+                 || frame.y_offset + std::uint64_t{ frame.height }
+                        > canvas_height
+                 || frame.dispose_op > DisposeOp::PREVIOUS
+                 || frame.blend_op > BlendOp::OVER
+                 || ( !seen_idat && !covers_canvas ) ) {
+                throw png_error( png_error_t::BAD_ANIMATION );
+            }
+            m_frames.push_back( frame );
+            m_frame_data.emplace_back();
+        }
+        else if ( chunk.type == PngChunkType::fdAT && animated ) {
+            if ( data.size() < sequence_bytes || !seen_idat
+                 || m_frames.empty()
+                 || ( m_default_image_is_frame && m_frames.size() == 1 ) ) {
+                throw png_error( png_error_t::BAD_ANIMATION );
+            }
+            check_sequence( data );
+            seen_fdat = true;
+            m_frame_data.back().emplace_back( data.subspan( sequence_bytes ) );
+        }
+
+        // Whether frame 0 came before the image data
+        if ( animated && !seen_idat ) {
+            m_default_image_is_frame = !m_frames.empty();
+        }
+    }
+
+    if ( !animated ) {
+        m_frames.push_back( FrameControl{
+            .width = ihdr.getWidth(),
+            .height = ihdr.getHeight(),
+            .x_offset = 0,
+            .y_offset = 0,
+            .delay_numerator = 0,
+            .delay_denominator = 0,
+            .dispose_op = DisposeOp::NONE,
+            .blend_op = BlendOp::SOURCE } );
+        m_frame_data.push_back( std::move( idat_data ) );
+        m_default_image_is_frame = true;
+    }
+    else if ( m_frames.size() != frame_count || m_frame_data.back().empty() ) {
+        throw png_error( png_error_t::BAD_ANIMATION );
+    }
+
+    // A first frame can't restore what was there before it
+    if ( m_frames.front().dispose_op == DisposeOp::PREVIOUS ) {
+        m_frames.front().dispose_op = DisposeOp::BACKGROUND;
+    }
+
+    if ( ihdr.getColourType() == IHDR::ColourType::INDEXED_COLOUR ) {
+        m_palette_lookup.emplace( *m_decoder.palette(),
+                                  m_decoder.transparency() );
+    }
+    m_canvas.resize( canvas_width * canvas_height * rgba_bytes );
+}
+
+std::optional<AnimationFrame>
+ApngDecoder::next_frame() {
+    if ( m_next_frame == m_frames.size() ) {
+        return std::nullopt;
+    }
+    // Decoded before the canvas is touched, so a bad frame leaves the
+    // decoder as it was
+    if ( m_next_frame - m_batch_begin >= m_decoded.size() ) {
+        std::size_t batch_size{ m_options.decode_ahead };
+        if ( batch_size == 0 ) {
+            batch_size = PARALLEL::worker_count(
+                m_options.threads, std::numeric_limits<std::size_t>::max() );
+        }
+        decode_batch( m_next_frame,
+                      std::min<std::size_t>( batch_size,
+                                             m_frames.size() - m_next_frame ) );
+    }
+    if ( m_next_frame != 0 ) {
+        dispose_previous();
+    }
+    const auto pixels{ std::move( m_decoded[m_next_frame - m_batch_begin] ) };
+    const auto & frame{ m_frames[m_next_frame] };
+
+    const auto canvas_stride{ std::size_t{ header().getWidth() } * rgba_bytes };
+    const auto frame_stride{ std::size_t{ frame.width } * rgba_bytes };
+    const auto region_row = [&]( const std::uint32_t y ) {
+        return std::span{ m_canvas }.subspan(
+            ( frame.y_offset + y ) * canvas_stride
+                + std::size_t{ frame.x_offset } * rgba_bytes,
+            frame_stride );
+    };
+
+    if ( frame.dispose_op == DisposeOp::PREVIOUS ) {
+        m_saved_region.resize( frame_stride * frame.height );
+        for ( std::uint32_t y{ 0 }; y < frame.height; ++y ) {
+            std::ranges::copy( region_row( y ),
+                               m_saved_region.begin() + y * frame_stride );
+        }
+    }
+
+    for ( std::uint32_t y{ 0 }; y < frame.height; ++y ) {
+        const auto source{ std::span{ pixels }.subspan( y * frame_stride,
+                                                        frame_stride ) };
+        const auto target{ region_row( y ) };
+        if ( frame.blend_op == BlendOp::SOURCE ) {
+            std::ranges::copy( source, target.begin() );
+            continue;
+        }
+        std::size_t blended{ 0 };
+#if defined( __AVX2__ )
+        blended = blend_over_avx2( source, target, frame.width );
+#endif
+        blend_over( source, target, blended, frame.width );
+    }
+
+    return AnimationFrame{ .index =
+                               static_cast<std::uint32_t>( m_next_frame++ ),
+                           .control = frame,
+                           .canvas = m_canvas };
+}
+
+void
+ApngDecoder::rewind() noexcept {
+    std::ranges::fill( m_canvas, std::byte{ 0 } );
+    m_decoded.clear();
+    m_batch_begin = 0;
+    m_next_frame = 0;
+}
+
+void
+ApngDecoder::decode_batch( const std::size_t first, const std::size_t count ) {
+    std::vector<std::vector<std::byte>> decoded( count );
+
+    // The earliest bad frame is reported, however the work was shared out
+    PARALLEL::parallel_for( count, m_options.threads,
+                            [&]( const std::size_t frame ) {
+                                decoded[frame] = decode_frame( first
+                                                               + frame );
+                            } );
+
+    // Only a whole batch replaces the last one
+    m_decoded.swap( decoded );
+    m_batch_begin = first;
+}
+
+std::vector<std::byte>
+ApngDecoder::decode_frame( const std::size_t index ) const {
+    const auto & ihdr{ header() };
+    const auto & frame{ m_frames[index] };
+    const auto   colour_type{ ihdr.getColourType() };
+    const auto   bit_depth{ ihdr.getBitDepth() };
+    const auto   filter_bpp{ IDAT::filter_bytes_per_pixel( colour_type,
+                                                           bit_depth ) };
+    const auto   channels{ IHDR::channel_count( colour_type ) };
+
+    PixelFormat format{ .colour_type = colour_type,
+                        .bit_depth = bit_depth,
+                        .channels = channels,
+                        .palette = m_palette_lookup ? &*m_palette_lookup :
+                                                      nullptr,
+                        .key = std::nullopt };
+    const auto  transparency{ m_decoder.transparency() };
+    if ( format.palette == nullptr && channels % 2 == 1
+         && transparency.size() == 2 * std::size_t{ channels } ) {
+        format.key.emplace();
+        for ( std::uint8_t channel{ 0 }; channel < channels; ++channel ) {
+            ( *format.key )[channel] = CONVERT::read_sample( transparency,
+                                                             channel, 16 );
+        }
+    }
+
+    const bool interlaced{ ihdr.getInterlaceMethod()
+                           == IHDR::InterlaceMethod::ADAM_7 };
+    const auto passes{ interlaced ? std::span{ IHDR::adam7_passes } :
+                                    std::span{ &IHDR::full_image_pass, 1 } };
+
+    const auto frame_stride{ std::size_t{ frame.width } * rgba_bytes };
+    std::vector<std::byte> rgba( frame_stride * frame.height );
+    const auto             max_scanline{
+        IHDR::scanline_bytes( frame.width, colour_type, bit_depth ) + 1
+    };
+    std::vector<std::byte> scanlines( 2 * max_scanline );
+    // Expanded pixels of an interlaced scanline, before placement
+    std::vector<std::byte> expanded( interlaced ? frame_stride : 0 );
+
+    ZLIB::Inflater inflater{};
+    inflater.reset( m_frame_data[index] );
+    for ( const auto & pass : passes ) {
+        const auto columns{ IHDR::pass_width( pass, frame.width ) };
+        const auto rows{ IHDR::pass_height( pass, frame.height ) };
+        if ( columns == 0 || rows == 0 ) {
+            continue;
+        }
+        const auto scanline_size{
+            IHDR::scanline_bytes( columns, colour_type, bit_depth ) + 1
+        };
+        auto current{ std::span{ scanlines }.first( scanline_size ) };
+        auto previous{ std::span{ scanlines }.subspan( max_scanline,
+                                                       scanline_size ) };
+        std::ranges::fill( previous, std::byte{ 0 } );
+
+        for ( std::uint32_t row{ 0 }; row < rows; ++row ) {
+            if ( inflater.read( current ) != scanline_size ) {
+                throw png_error( png_error_t::BAD_IMAGE_DATA );
+            }
+            if ( !IDAT::unfilter_row(
+                     static_cast<IDAT::FilterType>( current[0] ),
+                     current.subspan( 1 ), previous.subspan( 1 ),
+                     filter_bpp ) ) {
+                throw png_error( png_error_t::BAD_FILTER_TYPE );
+            }
+            std::swap( current, previous );
+
+            const std::uint32_t y{ pass.y_offset + row * pass.y_step };
+            const auto target{ std::span{ rgba }.subspan( y * frame_stride,
+                                                          frame_stride ) };
+            if ( !interlaced ) {
+                expand_to_rgba( previous.subspan( 1 ), columns, format,
+                                target );
+                continue;
+            }
+            expand_to_rgba( previous.subspan( 1 ), columns, format,
+                            expanded );
+            for ( std::uint32_t column{ 0 }; column < columns; ++column ) {
+                const std::size_t x{ pass.x_offset
+                                     + column * std::size_t{ pass.x_step } };
+                std::memcpy( target.data() + x * rgba_bytes,
+                             expanded.data() + column * rgba_bytes,
+                             rgba_bytes );
+            }
+        }
+    }
+    if ( inflater.finish() != ZLIB::inflate_status_t::STREAM_END ) {
+        throw png_error( png_error_t::BAD_IMAGE_DATA );
+    }
+    return rgba;
+}
+
+void
+ApngDecoder::dispose_previous() noexcept {
+    const auto & frame{ m_frames[m_next_frame - 1] };
+    if ( frame.dispose_op == DisposeOp::NONE ) {
+        return;
+    }
+    const auto canvas_stride{ std::size_t{ header().getWidth() } * rgba_bytes };
+    const auto frame_stride{ std::size_t{ frame.width } * rgba_bytes };
+    for ( std::uint32_t y{ 0 }; y < frame.height; ++y ) {
+        const auto row{ std::span{ m_canvas }.subspan(
+            ( frame.y_offset + y ) * canvas_stride
+                + std::size_t{ frame.x_offset } * rgba_bytes,
+            frame_stride ) };
+        if ( frame.dispose_op == DisposeOp::BACKGROUND ) {
+            std::ranges::fill( row, std::byte{ 0 } );
+        }
+        else {
+            std::ranges::copy(
+                std::span{ m_saved_region }.subspan( y * frame_stride,
+                                                     frame_stride ),
+                row.begin() );
+        }
+    }
+}
+
+} // namespace PNG
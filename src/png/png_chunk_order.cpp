@@ -0,0 +1,214 @@
+#include "png/png_chunk_order.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace PNG
+{
+
+namespace
+{
+
+using stage_mask_t = std::uint8_t;
+
+constexpr stage_mask_t
+stage_bit( const ChunkStage stage ) noexcept {
+    return static_cast<stage_mask_t>( 1U << static_cast<unsigned>( stage ) );
+}
+
+constexpr stage_mask_t before_palette{ stage_bit( ChunkStage::HEADER ) };
+constexpr stage_mask_t before_image_data{
+    stage_bit( ChunkStage::HEADER ) | stage_bit( ChunkStage::PALETTE )
+};
+// Non-IDAT chunks never see IMAGE_DATA, it ends as they arrive
+constexpr stage_mask_t after_header{ before_image_data
+                                     | stage_bit(
+                                         ChunkStage::AFTER_IMAGE_DATA ) };
+constexpr stage_mask_t after_image_data{ stage_bit(
+    ChunkStage::AFTER_IMAGE_DATA ) };
+
+// Where one chunk type may appear.
+struct ChunkRule
+{
+    PngChunkType type;
+    stage_mask_t stages;
+    bool         repeats;
+    // Must follow PLTE: always when the image has one, & in images that
+    // require one (indexed colour) even when it is missing
+    bool                      follows_palette;
+    // Stage the chunk moves the sequence to, if any
+    std::optional<ChunkStage> next_stage;
+};
+
+constexpr std::array chunk_rules{
+    // clang-format off
+    ChunkRule{ PngChunkType::IHDR, stage_bit( ChunkStage::START ), false,
+               false, ChunkStage::HEADER },
+    ChunkRule{ PngChunkType::PLTE, before_palette, false, false,
+               ChunkStage::PALETTE },
+    ChunkRule{ PngChunkType::IDAT,
+               before_image_data | stage_bit( ChunkStage::IMAGE_DATA ), true,
+               true, ChunkStage::IMAGE_DATA },
+    ChunkRule{ PngChunkType::IEND, after_image_data, false, false,
+               ChunkStage::END },
+    ChunkRule{ PngChunkType::cHRM, before_palette, false, false, {} },
+    ChunkRule{ PngChunkType::gAMA, before_palette, false, false, {} },
+    ChunkRule{ PngChunkType::iCCP, before_palette, false, false, {} },
+    ChunkRule{ PngChunkType::sBIT, before_palette, false, false, {} },
+    ChunkRule{ PngChunkType::sRGB, before_palette, false, false, {} },
+    ChunkRule{ PngChunkType::bKGD, before_image_data, false, true, {} },
+    ChunkRule{ PngChunkType::hIST, stage_bit( ChunkStage::PALETTE ), false,
+               false, {} },
+    ChunkRule{ PngChunkType::tRNS, before_image_data, false, true, {} },
+    ChunkRule{ PngChunkType::pHYs, before_image_data, false, false, {} },
+    ChunkRule{ PngChunkType::sTER, before_image_data, false, false, {} },
+    ChunkRule{ PngChunkType::eXIF, before_image_data, false, false, {} },
+    ChunkRule{ PngChunkType::acTL, before_image_data, false, false, {} },
+    ChunkRule{ PngChunkType::sPLT, before_image_data, true, false, {} },
+    ChunkRule{ PngChunkType::tIME, after_header, false, false, {} },
+    ChunkRule{ PngChunkType::tEXt, after_header, true, false, {} },
+    ChunkRule{ PngChunkType::zTXt, after_header, true, false, {} },
+    ChunkRule{ PngChunkType::iTXt, after_header, true, false, {} },
+    ChunkRule{ PngChunkType::dSIG, after_header, true, false, {} },
+    ChunkRule{ PngChunkType::syNc, after_header, false, false, {} },
+    ChunkRule{ PngChunkType::fcTL, after_header, true, false, {} },
+    ChunkRule{ PngChunkType::fdAT, after_image_data, true, false, {} }
+    // clang-format on
+};
+static_assert( chunk_rules.size() <= 32, "m_seen holds a bit per rule" );
+
+// Rules seen before PLTE that must follow it, which a later PLTE rejects
+constexpr std::uint32_t follows_palette_rules{ [] {
+    std::uint32_t mask{ 0 };
+    for ( std::uint32_t index{ 0 }; index < chunk_rules.size(); ++index ) {
+        if ( chunk_rules[index].follows_palette ) {
+            mask |= 1U << index;
+        }
+    }
+    return mask;
+}() };
+
+// Rules are found by a multiplicative hash of the chunk type into a table
+// of slots, the multiplier being searched for at compile time so that no
+// two known types share a slot.
+constexpr unsigned rule_slot_bits{ 6 };
+constexpr std::size_t rule_slot_count{ std::size_t{ 1 } << rule_slot_bits };
+static_assert( chunk_rules.size() < rule_slot_count );
+
+constexpr std::size_t
+rule_slot( const PngChunkType type, const std::uint32_t multiplier ) noexcept {
+    return ( static_cast<std::uint32_t>( type ) * multiplier )
+           >> ( 32 - rule_slot_bits );
+}
+
+consteval std::uint32_t
+find_rule_multiplier() {
+    for ( std::uint32_t multiplier{ 1 };; multiplier += 2 ) {
+        std::array<bool, rule_slot_count> used{};
+        const bool collides{ std::ranges::any_of(
+            chunk_rules, [&]( const ChunkRule & rule ) {
+                return std::exchange(
+                    used[rule_slot( rule.type, multiplier )], true );
+            } ) };
+        if ( !collides ) {
+            return multiplier;
+        }
+    }
+}
+
+constexpr std::uint32_t rule_multiplier{ find_rule_multiplier() };
+
+// Index into chunk_rules + 1 per slot, 0 for an empty slot
+constexpr std::array<std::uint8_t, rule_slot_count> rule_slots{ [] {
+    std::array<std::uint8_t, rule_slot_count> slots{};
+    for ( std::size_t index{ 0 }; index < chunk_rules.size(); ++index ) {
+        slots[rule_slot( chunk_rules[index].type, rule_multiplier )]
+            = static_cast<std::uint8_t>( index + 1 );
+    }
+    return slots;
+}() };
+
+const ChunkRule *
+find_rule( const PngChunkType type ) noexcept {
+    const auto slot{ rule_slots[rule_slot( type, rule_multiplier )] };
+    if ( slot == 0 || chunk_rules[slot - 1].type != type ) {
+        return nullptr;
+    }
+    return &chunk_rules[slot - 1];
+}
+
+} // namespace
+
+png_error_t
+ChunkOrderValidator::next( const PngChunkType type ) noexcept {
+    if ( m_error != png_error_t::NONE ) {
+        return m_error;
+    }
+    const auto fail = [&]( const png_error_t error ) {
+        m_error = error;
+        return error;
+    };
+
+    if ( m_stage == ChunkStage::START && type != PngChunkType::IHDR ) {
+        return fail( png_error_t::MISSING_IHDR );
+    }
+    if ( m_stage == ChunkStage::END ) {
+        return fail( png_error_t::BAD_CHUNK_ORDER );
+    }
+    if ( m_stage == ChunkStage::IMAGE_DATA && type != PngChunkType::IDAT ) {
+        m_stage = ChunkStage::AFTER_IMAGE_DATA;
+    }
+
+    const auto * const rule{ find_rule( type ) };
+    if ( rule == nullptr ) {
+        return png_error_t::NONE;
+    }
+
+    const bool greyscale{ m_colour_type == IHDR::ColourType::GREYSCALE
+                          || m_colour_type
+                                 == IHDR::ColourType::GREYSCALE_ALPHA };
+    const bool palette_missing{ rule->follows_palette
+                                && m_colour_type
+                                       == IHDR::ColourType::INDEXED_COLOUR
+                                && m_stage == ChunkStage::HEADER };
+    if ( type == PngChunkType::PLTE && greyscale ) {
+        return fail( png_error_t::BAD_PLTE );
+    }
+    if ( type == PngChunkType::IDAT && palette_missing ) {
+        return fail( png_error_t::MISSING_PLTE );
+    }
+    if ( type == PngChunkType::IEND
+         && m_stage != ChunkStage::AFTER_IMAGE_DATA ) {
+        return fail( png_error_t::MISSING_IDAT );
+    }
+
+    const auto index{ static_cast<std::uint32_t>( rule
+                                                  - chunk_rules.data() ) };
+    const auto seen{ ( m_seen >> index & 1U ) != 0 };
+    const bool palette_late{ type == PngChunkType::PLTE
+                             && ( m_seen & follows_palette_rules ) != 0 };
+    if ( ( rule->stages & stage_bit( m_stage ) ) == 0 || palette_missing
+         || palette_late || ( seen && !rule->repeats ) ) {
+        return fail( png_error_t::BAD_CHUNK_ORDER );
+    }
+
+    m_seen |= 1U << index;
+    if ( rule->next_stage.has_value() ) {
+        m_stage = *rule->next_stage;
+    }
+    return png_error_t::NONE;
+}
+
+png_error_t
+ChunkOrderValidator::finish() const noexcept {
+    if ( m_error != png_error_t::NONE ) {
+        return m_error;
+    }
+    return m_stage == ChunkStage::END ? png_error_t::NONE :
+                                        png_error_t::TRUNCATED_CHUNK;
+}
+
+} // namespace PNG
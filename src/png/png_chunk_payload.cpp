@@ -65,8 +65,7 @@ IhdrChunkPayload::IhdrChunkPayload(
                               sizeof( interlace_method ) ) ) );
 }
 
-constexpr IhdrChunkPayload::IhdrChunkPayload(
-    IhdrChunkPayload && other ) noexcept :
+IhdrChunkPayload::IhdrChunkPayload( IhdrChunkPayload && other ) noexcept :
     PngChunkPayloadBase( other.getSize(), other.getChunkType() ),
     width( other.getWidth() ),
     height( other.getHeight() ),
@@ -78,7 +77,7 @@ constexpr IhdrChunkPayload::IhdrChunkPayload(
     other.setInvalid();
 }
 
-constexpr IhdrChunkPayload &
+IhdrChunkPayload &
 IhdrChunkPayload::operator=( IhdrChunkPayload && other ) noexcept {
     if ( this != &other ) {
         PngChunkPayloadBase::operator=( std::move( other ) );
@@ -102,12 +101,12 @@ IhdrChunkPayload::operator=( IhdrChunkPayload && other ) noexcept {
 namespace PLTE
 {
 
-constexpr std::vector<Palette>
+std::vector<Palette>
 bytes_to_palette( const std::span<const std::byte> & data ) {
     std::vector<Palette> result;
     result.reserve( data.size() / 3 );
 
-    for ( const auto palette_values :
+    for ( const auto & palette_values :
           data | std::views::chunk( sizeof( Palette ) /* = 3 */ ) ) {
         result.emplace_back(
             Palette{ std::to_integer<colour_t>( palette_values[0] ),
@@ -118,8 +117,7 @@ bytes_to_palette( const std::span<const std::byte> & data ) {
     return result;
 }
 
-constexpr PlteChunkPayload::PlteChunkPayload(
-    const std::vector<Palette> & palettes ) :
+PlteChunkPayload::PlteChunkPayload( const std::vector<Palette> & palettes ) :
     PngChunkPayloadBase( sizeof( Palette )
                              * static_cast<std::uint32_t>( palettes.size() ),
                          PngChunkType::PLTE ) {
@@ -137,8 +135,7 @@ constexpr PlteChunkPayload::PlteChunkPayload(
                 | std::ranges::to<std::vector<colour_t>>();
 }
 
-constexpr PlteChunkPayload::PlteChunkPayload(
-    const std::span<const std::byte> & data ) :
+PlteChunkPayload::PlteChunkPayload( const std::span<const std::byte> & data ) :
     PngChunkPayloadBase( static_cast<std::uint32_t>( data.size() ),
                          PngChunkType::PLTE ) {
     // TODO(chunk_size_type): add direct PLTE tests on main before expanding
@@ -150,8 +147,7 @@ constexpr PlteChunkPayload::PlteChunkPayload(
     *this = PlteChunkPayload( bytes_to_palette( data ) );
 }
 
-constexpr PlteChunkPayload::PlteChunkPayload(
-    PlteChunkPayload && other ) noexcept :
+PlteChunkPayload::PlteChunkPayload( PlteChunkPayload && other ) noexcept :
     PngChunkPayloadBase( other.getSize(), other.getChunkType() ),
     r_channel( other.rChannel() ),
     g_channel( other.gChannel() ),
@@ -161,7 +157,7 @@ constexpr PlteChunkPayload::PlteChunkPayload(
     other.setInvalid();
 }
 
-constexpr PlteChunkPayload &
+PlteChunkPayload &
 PlteChunkPayload::operator=( PlteChunkPayload && other ) noexcept {
     assert( other.getChunkType() == PngChunkType::PLTE );
     assert( other.getSize() % 3 == 0 );
@@ -174,7 +170,7 @@ PlteChunkPayload::operator=( PlteChunkPayload && other ) noexcept {
     return *this;
 }
 
-constexpr auto
+std::vector<Palette>
 PlteChunkPayload::getPalettes() const noexcept {
     return std::ranges::views::zip( r_channel, g_channel, b_channel )
            | std::views::transform( []( const auto & iter ) {
@@ -0,0 +1,621 @@
+#include "png/png_convert.hpp"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+#if defined( __SSSE3__ )
+#include <immintrin.h>
+#endif
+
+namespace PNG
+{
+
+namespace CONVERT
+{
+
+namespace
+{
+
+void
+unpack_samples_scalar( const std::span<const std::byte> packed,
+                       const std::span<std::byte> out, const std::size_t first,
+                       const std::size_t count, const IHDR::BitDepth bit_depth,
+                       const std::uint8_t multiplier ) noexcept {
+    const auto samples_per_byte{ static_cast<std::size_t>( byte_bits
+                                                           / bit_depth ) };
+    const auto mask{ static_cast<std::uint32_t>( ( 1U << bit_depth ) - 1 ) };
+
+    for ( auto i{ first }; i < count; ++i ) {
+        const auto shift{ static_cast<std::uint32_t>(
+            byte_bits - bit_depth * ( i % samples_per_byte + 1 ) ) };
+        const auto sample{
+            ( std::to_integer<std::uint32_t>( packed[i / samples_per_byte] )
+              >> shift )
+            & mask
+        };
+        out[i] = static_cast<std::byte>( sample * multiplier );
+    }
+}
+
+void
+expand_palette_scalar( const std::span<const std::byte> indices,
+                       const std::span<std::byte> out, const std::size_t first,
+                       const std::size_t count, const PaletteLookup & lookup,
+                       const bool with_alpha ) noexcept {
+    const std::size_t channels{ with_alpha ? 4U : 3U };
+    for ( auto i{ first }; i < count; ++i ) {
+        const auto index{ std::to_integer<std::size_t>( indices[i] ) };
+        std::memcpy( out.data() + i * channels, lookup.rgba.data() + 4 * index,
+                     channels );
+    }
+}
+
+void
+swap_samples_16_scalar( const std::span<const std::byte> samples,
+                        const std::span<std::byte> out, const std::size_t first,
+                        const std::size_t count ) noexcept {
+    for ( auto i{ first }; i < count; ++i ) {
+        out[2 * i] = samples[2 * i + 1];
+        out[2 * i + 1] = samples[2 * i];
+    }
+}
+
+constexpr std::uint32_t reduce_multiplier{ 255 };
+
+void
+reduce_samples_16_scalar( const std::span<const std::byte> samples,
+                          const std::span<std::byte>       out,
+                          const std::size_t first, const std::size_t count,
+                          const std::size_t       channels,
+                          const pixel_offsets_t & offsets ) noexcept {
+    for ( auto i{ first }; i < count; ++i ) {
+        const auto sample{
+            ( std::to_integer<std::uint32_t>( samples[2 * i] ) << byte_bits )
+            | std::to_integer<std::uint32_t>( samples[2 * i + 1] )
+        };
+        const auto offset{ offsets[( i / channels ) % offsets.size()] };
+        out[i] = static_cast<std::byte>(
+            ( sample * reduce_multiplier + offset ) >> 16 );
+    }
+}
+
+#if defined( __SSSE3__ )
+
+// Swaps the bytes of each 16 bit lane.
+std::size_t
+swap_samples_16_ssse3( const std::span<const std::byte> samples,
+                       const std::span<std::byte>       out,
+                       const std::size_t                count ) noexcept {
+    constexpr std::size_t lanes{ 8 };
+    const auto            swap{ _mm_setr_epi8( 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11,
+                                               10, 13, 12, 15, 14 ) };
+
+    std::size_t i{ 0 };
+    for ( ; i + lanes <= count; i += lanes ) {
+        const auto input{ _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>( samples.data() + 2 * i ) ) };
+        _mm_storeu_si128( reinterpret_cast<__m128i *>( out.data() + 2 * i ),
+                          _mm_shuffle_epi8( input, swap ) );
+    }
+    return i;
+}
+
+#endif
+
+#if defined( __AVX2__ )
+
+// 16 samples per iteration: byte swap (vpshufb), widen to 32 bits, then
+// ( sample * 255 + offset ) >> 16 & pack back down to bytes. Per sample
+// offsets come from a table repeating the pixel offsets, indexed by the
+// sample's phase within the 8 pixel period.
+std::size_t
+reduce_samples_16_avx2( const std::span<const std::byte> samples,
+                        const std::span<std::byte> out, const std::size_t count,
+                        const std::size_t       channels,
+                        const pixel_offsets_t & offsets ) noexcept {
+    constexpr std::size_t lanes{ 16 };
+    constexpr std::size_t max_channels{ 4 };
+    const std::size_t     period{ offsets.size() * channels };
+
+    std::array<std::uint32_t, max_channels * 8 + lanes> sample_offsets{};
+    for ( std::size_t k{ 0 }; k < period + lanes; ++k ) {
+        sample_offsets[k] = offsets[( k / channels ) % offsets.size()];
+    }
+
+    const auto swap{ _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4,
+        7, 6, 9, 8, 11, 10, 13, 12, 15, 14 ) };
+    const auto multiplier{ _mm256_set1_epi32( reduce_multiplier ) };
+    // Dword order after the packs, see below
+    const auto gather_bytes{ _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 ) };
+
+    std::size_t i{ 0 };
+    for ( ; i + lanes <= count; i += lanes ) {
+        const auto input{ _mm256_shuffle_epi8(
+            _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>( samples.data() + 2 * i ) ),
+            swap ) };
+        const auto * const phase{ sample_offsets.data() + i % period };
+
+        const auto reduce = [&multiplier]( const __m128i      half,
+                                           const auto * const half_offsets ) {
+            const auto wide{ _mm256_cvtepu16_epi32( half ) };
+            return _mm256_srli_epi32(
+                _mm256_add_epi32(
+                    _mm256_mullo_epi32( wide, multiplier ),
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>( half_offsets ) ) ),
+                16 );
+        };
+        const auto low{ reduce( _mm256_castsi256_si128( input ), phase ) };
+        const auto high{ reduce( _mm256_extracti128_si256( input, 1 ),
+                                 phase + 8 ) };
+
+        // Packs work within 128 bit lanes, leaving the dwords ordered
+        // low 0-3, high 0-3, 0, 0 | low 4-7, high 4-7, 0, 0
+        const auto bytes{ _mm256_packus_epi16(
+            _mm256_packus_epi32( low, high ), _mm256_setzero_si256() ) };
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i *>( out.data() + i ),
+            _mm256_castsi256_si128(
+                _mm256_permutevar8x32_epi32( bytes, gather_bytes ) ) );
+    }
+    return i;
+}
+
+#endif
+
+#if defined( __SSSE3__ )
+
+// RGB output is written 16 bytes at a time, of which 12 are valid, so the
+// vector loops stop this many pixels short of the end to stay in bounds.
+constexpr std::size_t rgb_store_slack{ 2 };
+
+// Stores 4 RGBA pixels, or their RGB bytes if `with_alpha` is not set.
+inline void
+store_pixels( std::byte * const out, const __m128i pixels,
+              const bool with_alpha ) noexcept {
+    if ( with_alpha ) {
+        _mm_storeu_si128( reinterpret_cast<__m128i *>( out ), pixels );
+        return;
+    }
+    const auto drop_alpha{ _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13,
+                                          14, -1, -1, -1, -1 ) };
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( out ),
+                      _mm_shuffle_epi8( pixels, drop_alpha ) );
+}
+
+// Palettes of up to 16 entries fit a register per channel, so each channel
+// is a single pshufb. Blocks holding an index past the table take the
+// scalar path.
+std::size_t
+expand_palette_ssse3( const std::span<const std::byte> indices,
+                      const std::span<std::byte> out, const std::size_t count,
+                      const PaletteLookup & lookup,
+                      const bool            with_alpha ) noexcept {
+    constexpr std::size_t lanes{ 16 };
+    const std::size_t     channels{ with_alpha ? 4U : 3U };
+
+    const auto load = []( const auto & table ) {
+        return _mm_load_si128(
+            reinterpret_cast<const __m128i *>( table.data() ) );
+    };
+    const auto red{ load( lookup.red ) };
+    const auto green{ load( lookup.green ) };
+    const auto blue{ load( lookup.blue ) };
+    const auto alpha{ load( lookup.alpha ) };
+    const auto max_index{ _mm_set1_epi8( lanes - 1 ) };
+
+    std::size_t i{ 0 };
+    for ( ; i + lanes + rgb_store_slack <= count; i += lanes ) {
+        const auto index{ _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>( indices.data() + i ) ) };
+        if ( _mm_movemask_epi8( _mm_cmpeq_epi8(
+                 _mm_min_epu8( index, max_index ), index ) )
+             != 0xFFFF ) {
+            expand_palette_scalar( indices, out, i, i + lanes, lookup,
+                                   with_alpha );
+            continue;
+        }
+
+        const auto r{ _mm_shuffle_epi8( red, index ) };
+        const auto g{ _mm_shuffle_epi8( green, index ) };
+        const auto b{ _mm_shuffle_epi8( blue, index ) };
+        const auto a{ _mm_shuffle_epi8( alpha, index ) };
+        const auto rg_low{ _mm_unpacklo_epi8( r, g ) };
+        const auto rg_high{ _mm_unpackhi_epi8( r, g ) };
+        const auto ba_low{ _mm_unpacklo_epi8( b, a ) };
+        const auto ba_high{ _mm_unpackhi_epi8( b, a ) };
+
+        auto * const target{ out.data() + i * channels };
+        store_pixels( target, _mm_unpacklo_epi16( rg_low, ba_low ),
+                      with_alpha );
+        store_pixels( target + 4 * channels,
+                      _mm_unpackhi_epi16( rg_low, ba_low ), with_alpha );
+        store_pixels( target + 8 * channels,
+                      _mm_unpacklo_epi16( rg_high, ba_high ), with_alpha );
+        store_pixels( target + 12 * channels,
+                      _mm_unpackhi_epi16( rg_high, ba_high ), with_alpha );
+    }
+    return i;
+}
+
+#endif
+
+#if defined( __AVX512VBMI__ ) && defined( __AVX512BW__ )
+
+// Byte permute patterns interleaving two 64 byte registers, constexpr so
+// the loops load them straight from .rodata.
+template <std::size_t N>
+using permute_pattern_t = std::array<std::uint8_t, N>;
+
+// Pairs { x[base + k], y[base + k] } for k in [0, 32).
+constexpr permute_pattern_t<64>
+pair_pattern( const std::size_t base ) {
+    permute_pattern_t<64> pattern{};
+    for ( std::size_t k{ 0 }; k < 32; ++k ) {
+        pattern[2 * k] = static_cast<std::uint8_t>( base + k );
+        pattern[2 * k + 1] = static_cast<std::uint8_t>( 64 + base + k );
+    }
+    return pattern;
+}
+
+// 16 bit pairs { x[base + k], y[base + k] } for k in [0, 16).
+constexpr std::array<std::uint16_t, 32>
+pair_pattern_16( const std::size_t base ) {
+    std::array<std::uint16_t, 32> pattern{};
+    for ( std::size_t k{ 0 }; k < 16; ++k ) {
+        pattern[2 * k] = static_cast<std::uint16_t>( base + k );
+        pattern[2 * k + 1] = static_cast<std::uint16_t>( 32 + base + k );
+    }
+    return pattern;
+}
+
+// RGB bytes [64 * block, 64 * block + 64) of 64 pixels, from RG pairs of
+// pixels [16 * block, 16 * block + 32) & the blue plane.
+constexpr permute_pattern_t<64>
+rgb_pattern( const std::size_t block ) {
+    permute_pattern_t<64> pattern{};
+    for ( std::size_t j{ 0 }; j < 64; ++j ) {
+        const auto position{ 64 * block + j };
+        const auto pixel{ position / 3 };
+        const auto channel{ position % 3 };
+        pattern[j] = static_cast<std::uint8_t>(
+            channel < 2 ? 2 * ( pixel - 16 * block ) + channel : 64 + pixel );
+    }
+    return pattern;
+}
+
+// Full 256 entry palettes: each channel is 4 registers of 64 entries, two
+// vpermt2b lookups (index bits 0-6) blended on index bit 7. The channel
+// planes are then interleaved with further permutes.
+std::size_t
+expand_palette_avx512( const std::span<const std::byte> indices,
+                       const std::span<std::byte> out, const std::size_t count,
+                       const PaletteLookup & lookup,
+                       const bool            with_alpha ) noexcept {
+    constexpr std::size_t lanes{ 64 };
+
+    static constexpr std::array pairs{ pair_pattern( 0 ), pair_pattern( 16 ),
+                                       pair_pattern( 32 ) };
+    static constexpr std::array pairs_16{ pair_pattern_16( 0 ),
+                                          pair_pattern_16( 16 ) };
+    static constexpr std::array rgb{ rgb_pattern( 0 ), rgb_pattern( 1 ),
+                                     rgb_pattern( 2 ) };
+
+    const auto load = []( const auto & table, const std::size_t offset = 0 ) {
+        return _mm512_loadu_si512( table.data() + offset );
+    };
+
+    struct Plane
+    {
+        __m512i quarters[4];
+    };
+    const auto load_plane = [&load]( const auto & table ) {
+        return Plane{ { load( table, 0 ), load( table, 64 ), load( table, 128 ),
+                        load( table, 192 ) } };
+    };
+    const auto red{ load_plane( lookup.red ) };
+    const auto green{ load_plane( lookup.green ) };
+    const auto blue{ load_plane( lookup.blue ) };
+    const auto alpha{ load_plane( lookup.alpha ) };
+
+    std::size_t i{ 0 };
+    for ( ; i + lanes <= count; i += lanes ) {
+        const auto index{ _mm512_loadu_si512( indices.data() + i ) };
+        const auto high{ _mm512_movepi8_mask( index ) };
+        const auto lookup_plane = [&index, high]( const Plane & plane ) {
+            return _mm512_mask_blend_epi8(
+                high,
+                _mm512_permutex2var_epi8( plane.quarters[0], index,
+                                          plane.quarters[1] ),
+                _mm512_permutex2var_epi8( plane.quarters[2], index,
+                                          plane.quarters[3] ) );
+        };
+        const auto r{ lookup_plane( red ) };
+        const auto g{ lookup_plane( green ) };
+        const auto b{ lookup_plane( blue ) };
+
+        auto * const target{ out.data() + i * ( with_alpha ? 4 : 3 ) };
+        if ( with_alpha ) {
+            const auto a{ lookup_plane( alpha ) };
+            for ( std::size_t half{ 0 }; half < 2; ++half ) {
+                const auto pair{ load( pairs[2 * half] ) };
+                const auto rg{ _mm512_permutex2var_epi8( r, pair, g ) };
+                const auto ba{ _mm512_permutex2var_epi8( b, pair, a ) };
+                for ( std::size_t quarter{ 0 }; quarter < 2; ++quarter ) {
+                    const auto pair_16{ load( pairs_16[quarter] ) };
+                    _mm512_storeu_si512(
+                        target + 128 * half + 64 * quarter,
+                        _mm512_permutex2var_epi16( rg, pair_16, ba ) );
+                }
+            }
+        }
+        else {
+            for ( std::size_t block{ 0 }; block < 3; ++block ) {
+                const auto rg{ _mm512_permutex2var_epi8(
+                    r, load( pairs[block] ), g ) };
+                _mm512_storeu_si512(
+                    target + 64 * block,
+                    _mm512_permutex2var_epi8( rg, load( rgb[block] ), b ) );
+            }
+        }
+    }
+    return i;
+}
+
+#elif defined( __AVX2__ )
+
+// Full 256 entry palettes: 8 interleaved RGBA entries per vpgatherdd.
+std::size_t
+expand_palette_avx2( const std::span<const std::byte> indices,
+                     const std::span<std::byte> out, const std::size_t count,
+                     const PaletteLookup & lookup,
+                     const bool            with_alpha ) noexcept {
+    constexpr std::size_t lanes{ 8 };
+    const std::size_t     channels{ with_alpha ? 4U : 3U };
+    const auto * const    table{ reinterpret_cast<const int *>(
+        lookup.rgba.data() ) };
+
+    std::size_t i{ 0 };
+    for ( ; i + lanes + rgb_store_slack <= count; i += lanes ) {
+        const auto index{ _mm256_cvtepu8_epi32( _mm_loadl_epi64(
+            reinterpret_cast<const __m128i *>( indices.data() + i ) ) ) };
+        const auto pixels{ _mm256_i32gather_epi32( table, index, 4 ) };
+
+        auto * const target{ out.data() + i * channels };
+        store_pixels( target, _mm256_castsi256_si128( pixels ), with_alpha );
+        store_pixels( target + 4 * channels,
+                      _mm256_extracti128_si256( pixels, 1 ), with_alpha );
+    }
+    return i;
+}
+
+#endif
+
+#if defined( __SSSE3__ )
+
+// Unpacks 16 samples per iteration. The 2, 4 or 8 input bytes are first
+// spread so each lane holds the byte its sample lives in (pshufb), then
+// each lane's sample is shifted down & masked. Shifts act on 16 bit lanes,
+// but bits pulled in from the neighbouring byte are always masked away.
+// Scaling is a final 16 entry pshufb lookup.
+std::size_t
+unpack_samples_ssse3( const std::span<const std::byte> packed,
+                      const std::span<std::byte> out, const std::size_t count,
+                      const IHDR::BitDepth bit_depth,
+                      const std::uint8_t   multiplier ) noexcept {
+    constexpr std::size_t lanes{ 16 };
+    const std::size_t     input_bytes{ lanes * bit_depth / byte_bits };
+
+    __m128i spread{};
+    switch ( bit_depth ) {
+    case 1:
+        spread = _mm_setr_epi8( 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1 );
+        break;
+    case 2:
+        spread = _mm_setr_epi8( 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 );
+        break;
+    default:
+        spread = _mm_setr_epi8( 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7 );
+        break;
+    }
+
+    // Scaled value of every possible sample, for pshufb
+    alignas( lanes ) std::array<std::uint8_t, lanes> scale_table{};
+    for ( std::size_t value{ 0 }; value < scale_table.size(); ++value ) {
+        scale_table[value] = static_cast<std::uint8_t>( value * multiplier );
+    }
+    const auto scale_lut{ _mm_load_si128(
+        reinterpret_cast<const __m128i *>( scale_table.data() ) ) };
+
+    const auto bit_masks{ _mm_setr_epi8(
+        static_cast<char>( 0x80 ), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        static_cast<char>( 0x80 ), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 ) };
+    // Lanes whose 2 bit sample sits at bit offset 6, 4, 2 & 0
+    const auto crumb_6{ _mm_set1_epi32( 0x00'00'00'03 ) };
+    const auto crumb_4{ _mm_set1_epi32( 0x00'00'03'00 ) };
+    const auto crumb_2{ _mm_set1_epi32( 0x00'03'00'00 ) };
+    const auto crumb_0{ _mm_set1_epi32( 0x03'00'00'00 ) };
+    // Lanes whose 4 bit sample sits at bit offset 4 & 0
+    const auto nibble_4{ _mm_set1_epi16( 0x00'0F ) };
+    const auto nibble_0{ _mm_set1_epi16( 0x0F'00 ) };
+
+    std::size_t i{ 0 };
+    for ( ; i + lanes <= count; i += lanes ) {
+        std::uint64_t input{ 0 };
+        std::memcpy( &input, packed.data() + i * bit_depth / byte_bits,
+                     input_bytes );
+        const auto bytes{ _mm_shuffle_epi8(
+            _mm_cvtsi64_si128( static_cast<long long>( input ) ), spread ) };
+
+        __m128i samples{};
+        switch ( bit_depth ) {
+        case 1:
+            samples = _mm_cmpeq_epi8( _mm_and_si128( bytes, bit_masks ),
+                                      bit_masks );
+            samples = _mm_and_si128( samples, _mm_set1_epi8( 1 ) );
+            break;
+        case 2:
+            samples = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128( _mm_srli_epi16( bytes, 6 ), crumb_6 ),
+                    _mm_and_si128( _mm_srli_epi16( bytes, 4 ), crumb_4 ) ),
+                _mm_or_si128(
+                    _mm_and_si128( _mm_srli_epi16( bytes, 2 ), crumb_2 ),
+                    _mm_and_si128( bytes, crumb_0 ) ) );
+            break;
+        default:
+            samples = _mm_or_si128(
+                _mm_and_si128( _mm_srli_epi16( bytes, 4 ), nibble_4 ),
+                _mm_and_si128( bytes, nibble_0 ) );
+            break;
+        }
+
+        if ( multiplier != 1 ) {
+            samples = _mm_shuffle_epi8( scale_lut, samples );
+        }
+        _mm_storeu_si128( reinterpret_cast<__m128i *>( out.data() + i ),
+                          samples );
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+PaletteLookup::PaletteLookup( const PLTE::PlteChunkPayload &   palette,
+                              const std::span<const std::byte> transparency ) :
+    entries( std::min( palette.getEntries(), max_entries ) ) {
+    alpha.fill( 0xFF );
+    for ( std::size_t i{ 0 }; i < entries; ++i ) {
+        red[i] = palette.rChannel()[i];
+        green[i] = palette.gChannel()[i];
+        blue[i] = palette.bChannel()[i];
+    }
+    for ( std::size_t i{ 0 }; i < std::min( transparency.size(), entries );
+          ++i ) {
+        alpha[i] = std::to_integer<std::uint8_t>( transparency[i] );
+    }
+
+    for ( std::size_t i{ 0 }; i < max_entries; ++i ) {
+        rgba[4 * i] = static_cast<std::byte>( red[i] );
+        rgba[4 * i + 1] = static_cast<std::byte>( green[i] );
+        rgba[4 * i + 2] = static_cast<std::byte>( blue[i] );
+        rgba[4 * i + 3] = static_cast<std::byte>( alpha[i] );
+    }
+}
+
+void
+copy_pixel( const std::span<const std::byte> source,
+            const std::size_t source_index, const std::span<std::byte> target,
+            const std::size_t target_index, const std::uint8_t bits ) noexcept {
+    if ( bits >= byte_bits ) {
+        const auto bytes{ static_cast<std::size_t>( bits / byte_bits ) };
+        std::memcpy( target.data() + target_index * bytes,
+                     source.data() + source_index * bytes, bytes );
+        return;
+    }
+
+    const auto mask{ static_cast<std::uint32_t>( ( 1U << bits ) - 1 ) };
+    const auto source_bit{ source_index * bits };
+    const auto target_bit{ target_index * bits };
+    const auto source_shift{ static_cast<std::uint32_t>(
+        byte_bits - bits - source_bit % byte_bits ) };
+    const auto target_shift{ static_cast<std::uint32_t>(
+        byte_bits - bits - target_bit % byte_bits ) };
+
+    const auto value{ ( std::to_integer<std::uint32_t>(
+                            source[source_bit / byte_bits] )
+                        >> source_shift )
+                      & mask };
+    auto & target_byte{ target[target_bit / byte_bits] };
+    target_byte = static_cast<std::byte>(
+        ( std::to_integer<std::uint32_t>( target_byte )
+          & ~( mask << target_shift ) )
+        | ( value << target_shift ) );
+}
+
+void
+unpack_samples( const std::span<const std::byte> packed,
+                const std::span<std::byte> out, const std::size_t count,
+                const IHDR::BitDepth bit_depth, const bool scale ) noexcept {
+    assert( bit_depth == 1 || bit_depth == 2 || bit_depth == 4 );
+    assert( out.size() >= count );
+    assert( packed.size() * byte_bits >= count * bit_depth );
+
+    const auto multiplier{ scale ? full_range_scale( bit_depth ) :
+                                   std::uint8_t{ 1 } };
+
+    std::size_t done{ 0 };
+#if defined( __SSSE3__ )
+    done = unpack_samples_ssse3( packed, out, count, bit_depth, multiplier );
+#endif
+    unpack_samples_scalar( packed, out, done, count, bit_depth, multiplier );
+}
+
+void
+swap_samples_16( const std::span<const std::byte> samples,
+                 const std::span<std::byte>       out,
+                 const std::size_t                count ) noexcept {
+    assert( samples.size() >= 2 * count && out.size() >= 2 * count );
+
+    if constexpr ( std::endian::native == std::endian::big ) {
+        std::memcpy( out.data(), samples.data(), 2 * count );
+        return;
+    }
+
+    std::size_t done{ 0 };
+#if defined( __SSSE3__ )
+    done = swap_samples_16_ssse3( samples, out, count );
+#endif
+    swap_samples_16_scalar( samples, out, done, count );
+}
+
+void
+reduce_samples_16( const std::span<const std::byte> samples,
+                   const std::span<std::byte> out, const std::size_t pixels,
+                   const std::size_t       channels,
+                   const pixel_offsets_t & offsets ) noexcept {
+    assert( channels >= 1 && channels <= 4 );
+    const auto count{ pixels * channels };
+    assert( samples.size() >= 2 * count && out.size() >= count );
+
+    std::size_t done{ 0 };
+#if defined( __AVX2__ )
+    done = reduce_samples_16_avx2( samples, out, count, channels, offsets );
+#endif
+    reduce_samples_16_scalar( samples, out, done, count, channels, offsets );
+}
+
+void
+expand_palette( const std::span<const std::byte> indices,
+                const std::span<std::byte> out, const std::size_t count,
+                const PaletteLookup & lookup, const bool with_alpha ) noexcept {
+    assert( indices.size() >= count );
+    assert( out.size() >= count * ( with_alpha ? 4 : 3 ) );
+
+    std::size_t done{ 0 };
+#if defined( __SSSE3__ )
+    if ( lookup.entries <= 16 ) {
+        done = expand_palette_ssse3( indices, out, count, lookup, with_alpha );
+    }
+#endif
+#if defined( __AVX512VBMI__ ) && defined( __AVX512BW__ )
+    if ( done == 0 ) {
+        done = expand_palette_avx512( indices, out, count, lookup, with_alpha );
+    }
+#elif defined( __AVX2__ )
+    if ( done == 0 ) {
+        done = expand_palette_avx2( indices, out, count, lookup, with_alpha );
+    }
+#endif
+    expand_palette_scalar( indices, out, done, count, lookup, with_alpha );
+}
+
+} // namespace CONVERT
+
+} // namespace PNG
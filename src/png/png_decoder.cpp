@@ -0,0 +1,910 @@
+#include "png/png_decoder.hpp"
+
+#include "common/perf_counters.hpp"
+#include "common/trace.hpp"
+#include "png/png_chunk_order.hpp"
+#include "png/png_filter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ranges>
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::size_t ihdr_payload_bytes{ 13 };
+
+// Writes one unfiltered scanline of `pass` into the output image, whose
+// first row is image row `first_row`. In progressive mode each pixel is
+// replicated over its pass block, clipped to the output rows.
+void
+place_scanline( const std::span<const std::byte> scanline,
+                const std::uint32_t row, const IHDR::Adam7Pass & pass,
+                const std::uint32_t columns, const std::span<std::byte> image,
+                const ImageLayout & layout, const std::uint32_t first_row,
+                const bool progressive ) noexcept {
+    const std::uint32_t y{ pass.y_offset + row * pass.y_step };
+    const auto          block_width{ progressive ? pass.block_width : 1U };
+    const auto          block_height{ progressive ? pass.block_height : 1U };
+
+    // Non-interlaced scanlines already match the output row layout
+    if ( pass.x_step == 1 && block_height == 1 ) {
+        std::memcpy( image.data() + ( y - first_row ) * layout.stride,
+                     scanline.data(), scanline.size() );
+        return;
+    }
+
+    const auto y_begin{ std::max( y, first_row ) };
+    const auto y_end{ std::min( y + block_height,
+                                first_row + layout.height ) };
+    for ( std::uint32_t column{ 0 }; column < columns; ++column ) {
+        const std::uint32_t x{ pass.x_offset + column * pass.x_step };
+        const auto          x_end{ std::min( x + block_width, layout.width ) };
+        for ( auto target_y{ y_begin }; target_y < y_end; ++target_y ) {
+            const auto target_row{ image.subspan(
+                ( target_y - first_row ) * layout.stride,
+                layout.row_bytes() ) };
+            for ( auto target_x{ x }; target_x < x_end; ++target_x ) {
+                CONVERT::copy_pixel( scanline, column, target_row,
+                                     target_x, layout.bits_per_pixel );
+            }
+        }
+    }
+}
+
+constexpr std::size_t max_palette_entries{ 256 };
+
+// LEN & NLEN of an empty stored block, the marker a full flush leaves
+constexpr std::uint32_t empty_stored_block{ 0x0000FFFF };
+// zlib header, block header & the marker itself
+constexpr std::uint64_t min_sync_point{ 7 };
+
+// Sets `slice` to byte range [begin, end) of the concatenation of
+// `segments`.
+void
+slice_segments( const std::span<const ZLIB::segment_t> segments,
+                const std::uint64_t begin, const std::uint64_t end,
+                std::vector<ZLIB::segment_t> & slice ) {
+    slice.clear();
+    std::uint64_t offset{ 0 };
+    for ( const auto & segment : segments ) {
+        const auto segment_end{ offset + segment.size() };
+        if ( segment_end > begin && offset < end ) {
+            const auto first{ std::max( begin, offset ) - offset };
+            const auto last{ std::min( end, segment_end ) - offset };
+            slice.emplace_back( segment.subspan( first, last - first ) );
+        }
+        offset = segment_end;
+    }
+}
+
+bool
+expands_palette( const IHDR::IhdrChunkPayload & ihdr,
+                 const DecodeOptions &          options ) noexcept {
+    return options.expand_palette
+           && ihdr.getColourType() == IHDR::ColourType::INDEXED_COLOUR;
+}
+
+} // namespace
+
+PngDecoder::PngDecoder( const std::span<const std::byte> raw_data,
+                        Unparsed ) :
+    m_raw_data( raw_data ),
+    m_crc_calculator( CRC::PNG::png_polynomial<std::endian::big>() ) {}
+
+PngDecoder::PngDecoder( const std::span<const std::byte> raw_data ) :
+    PngDecoder( raw_data, Unparsed{} ) {
+    const auto error{ read_chunks() };
+    if ( error == png_error_t::BAD_HEADER ) {
+        throw bad_png_header();
+    }
+    if ( error != png_error_t::NONE ) {
+        throw png_error( error );
+    }
+}
+
+std::expected<PngDecoder, png_error_t>
+PngDecoder::try_parse( const std::span<const std::byte> raw_data ) {
+    std::expected<PngDecoder, png_error_t> result{ std::in_place, raw_data,
+                                                   Unparsed{} };
+    // One return of `result` so it is built in the caller's storage, the
+    // decoder is never moved
+    if ( const auto error{ result->read_chunks() };
+         error != png_error_t::NONE ) {
+        result = std::unexpected( error );
+    }
+    return result;
+}
+
+png_error_t
+PngDecoder::read_chunks() {
+    {
+        PERF::Region header_region{ "header_check", png_signature_bytes };
+        if ( m_raw_data.size() < png_signature_bytes
+             || span_to_integer<std::uint64_t, std::endian::big>(
+                    m_raw_data.first( png_signature_bytes ) )
+                    != png_signature ) {
+            return png_error_t::BAD_HEADER;
+        }
+    }
+
+    METRICS::StageTimer walk_timer{ &m_metrics, METRICS::stage_t::CHUNK_WALK,
+                                    m_raw_data.size() };
+    PERF::Region        walk_region{ "chunk_walk", m_raw_data.size() };
+
+    ZLIB::Adler32              fingerprint{};
+    ChunkOrderValidator        order{};
+    std::size_t                offset{ png_signature_bytes };
+    while ( offset < m_raw_data.size() ) {
+        if ( m_raw_data.size() - offset < chunk_overhead_bytes ) {
+            return png_error_t::TRUNCATED_CHUNK;
+        }
+
+        const auto length{ span_to_integer<std::uint32_t, std::endian::big>(
+            m_raw_data.subspan( offset, 4 ) ) };
+        if ( length > m_raw_data.size() - offset - chunk_overhead_bytes ) {
+            return png_error_t::TRUNCATED_CHUNK;
+        }
+
+        const auto type{ static_cast<PngChunkType>(
+            span_to_integer<std::uint32_t, std::endian::big>(
+                m_raw_data.subspan( offset + 4, 4 ) ) ) };
+        TRACE::event<TRACE::trace_level_t::CHUNK>(
+            "read_chunk", static_cast<std::uint32_t>( type ), length );
+        // Ordering is checked first, so a malformed file fails before any
+        // CRC is computed
+        if ( const auto error{ order.next( type ) };
+             error != png_error_t::NONE ) {
+            return error;
+        }
+        const auto data{ m_raw_data.subspan( offset + 8, length ) };
+        const auto crc{ span_to_integer<std::uint32_t, std::endian::big>(
+            m_raw_data.subspan( offset + 8 + length, 4 ) ) };
+
+        // CRC covers the chunk type & data
+        bool crc_matches{ false };
+        {
+            const auto          checked{ m_raw_data.subspan( offset + 4,
+                                                             length + 4 ) };
+            METRICS::StageTimer crc_timer{ &m_metrics, METRICS::stage_t::CRC,
+                                           checked.size() };
+            PERF::Region        crc_region{ "crc", checked.size() };
+            crc_matches = m_crc_calculator.crc( checked ).to_ulong() == crc;
+        }
+        if ( !crc_matches ) {
+            return png_error_t::BAD_CRC;
+        }
+
+        m_chunks.emplace_back( PngChunkView{
+            .offset = offset, .type = type, .data = data, .crc = crc } );
+        if ( type == PngChunkType::IHDR || type == PngChunkType::IDAT ) {
+            fingerprint.update(
+                to_bytes<std::uint32_t, std::endian::native,
+                         std::endian::big>( crc ) );
+        }
+        offset += chunk_overhead_bytes + length;
+
+        if ( type == PngChunkType::IHDR ) {
+            if ( data.size() != ihdr_payload_bytes ) {
+                return png_error_t::BAD_IHDR;
+            }
+            m_ihdr.emplace( data );
+            if ( !m_ihdr->isValid() ) {
+                return png_error_t::BAD_IHDR;
+            }
+            order.set_colour_type( m_ihdr->getColourType() );
+        }
+        else if ( type == PngChunkType::PLTE ) {
+            const auto entries{ data.size() / sizeof( PLTE::Palette ) };
+            if ( data.size() % sizeof( PLTE::Palette ) != 0 || entries == 0
+                 || entries > max_palette_entries ) {
+                return png_error_t::BAD_PLTE;
+            }
+            m_plte.emplace( data );
+        }
+        else if ( type == PngChunkType::tRNS ) {
+            m_transparency = data;
+        }
+        else if ( type == PngChunkType::IDAT ) {
+            m_idat_segments.emplace_back( data );
+        }
+        else if ( type == PngChunkType::syNc ) {
+            m_sync_chunk = data;
+        }
+        else if ( type == PngChunkType::IEND ) {
+            break;
+        }
+    }
+
+    m_fingerprint = fingerprint.value();
+
+    // IHDR, IDAT & PLTE, where required, are known to be present once
+    // IEND has been seen
+    if ( const auto error{ order.finish() }; error != png_error_t::NONE ) {
+        return error;
+    }
+    if ( m_ihdr->getColourType() == IHDR::ColourType::INDEXED_COLOUR
+         && m_transparency.size() > m_plte->getEntries() ) {
+        return png_error_t::BAD_TRNS;
+    }
+
+    METRICS::count_image( &m_metrics );
+    return png_error_t::NONE;
+}
+
+std::span<const std::uint64_t>
+PngDecoder::sync_points() {
+    if ( read_sync_index() || m_sync_scanned ) {
+        return m_sync_points;
+    }
+
+    std::uint64_t idat_offset{ 0 };
+    std::uint32_t recent_idat_bytes{ 0xFFFFFFFF };
+    for ( const auto & segment : m_idat_segments ) {
+        for ( const auto byte : segment ) {
+            recent_idat_bytes = ( recent_idat_bytes << 8 )
+                                | std::to_integer<std::uint32_t>( byte );
+            ++idat_offset;
+            if ( recent_idat_bytes == empty_stored_block
+                 && idat_offset >= min_sync_point ) {
+                m_sync_points.push_back( idat_offset );
+            }
+        }
+    }
+    m_sync_scanned = true;
+    return m_sync_points;
+}
+
+bool
+PngDecoder::read_sync_index() {
+    if ( m_sync_indexed.has_value() ) {
+        return *m_sync_indexed;
+    }
+    m_sync_indexed = false;
+
+    std::uint64_t idat_bytes{ 0 };
+    for ( const auto & segment : m_idat_segments ) {
+        idat_bytes += segment.size();
+    }
+
+    // The syNc chunk is ancillary, a stale or malformed one is ignored
+    if ( !m_sync_chunk.empty() ) {
+        const auto index{ SyncIndex::try_parse( m_sync_chunk ) };
+        // Offsets increase & markers can't overlap, so every marker is
+        // read in one walk over the segments
+        std::uint64_t marker_end{ 0 };
+        std::size_t   segment{ 0 };
+        std::uint64_t segment_start{ 0 };
+        const bool    valid{
+            index.has_value()
+            && std::ranges::all_of(
+                index->offsets, [&]( const std::uint64_t sync_point ) {
+                    if ( sync_point < min_sync_point || sync_point > idat_bytes
+                         || sync_point - 4 < marker_end ) {
+                        return false;
+                    }
+                    marker_end = sync_point;
+                    std::uint32_t marker{ 0 };
+                    for ( auto position{ sync_point - 4 };
+                          position < sync_point; ++position ) {
+                        while ( position - segment_start
+                                >= m_idat_segments[segment].size() ) {
+                            segment_start += m_idat_segments[segment].size();
+                            ++segment;
+                        }
+                        const auto offset{ position - segment_start };
+                        marker = ( marker << 8 )
+                                 | std::to_integer<std::uint32_t>(
+                                     m_idat_segments[segment][offset] );
+                    }
+                    return marker == empty_stored_block;
+                } )
+        };
+        if ( valid ) {
+            m_sync_points = index->offsets;
+            m_sync_indexed = true;
+        }
+    }
+    return *m_sync_indexed;
+}
+
+std::pair<IHDR::ColourType, IHDR::BitDepth>
+PngDecoder::output_format( const DecodeOptions & options ) const noexcept {
+    const auto & ihdr{ header() };
+    auto         colour_type{ ihdr.getColourType() };
+    auto         bit_depth{ ihdr.getBitDepth() };
+
+    if ( expands_palette( ihdr, options ) ) {
+        colour_type = m_transparency.empty() ?
+                          IHDR::ColourType::TRUE_COLOUR :
+                          IHDR::ColourType::TRUE_COLOUR_ALPHA;
+        bit_depth = byte_bits;
+    }
+    else if ( options.unpack_samples && bit_depth < byte_bits ) {
+        bit_depth = byte_bits;
+    }
+    else if ( bit_depth == 16
+              && ( options.sixteen_bit == SampleDepth16::ROUND_TO_8
+                   || options.sixteen_bit == SampleDepth16::DITHER_TO_8 ) ) {
+        bit_depth = byte_bits;
+    }
+
+    return { colour_type, bit_depth };
+}
+
+std::pair<std::uint32_t, std::uint32_t>
+PngDecoder::row_range( const DecodeOptions & options ) const noexcept {
+    const auto end_row{ std::min( options.end_row, header().getHeight() ) };
+    return { std::min( options.first_row, end_row ), end_row };
+}
+
+bool
+PngDecoder::converts_rows( const DecodeOptions & options ) const noexcept {
+    const auto & ihdr{ header() };
+    // Byte swapping keeps the format, but still rewrites every sample
+    const bool swapping{ ihdr.getBitDepth() == 16
+                         && options.sixteen_bit == SampleDepth16::NATIVE_ENDIAN
+                         && std::endian::native != std::endian::big };
+    return swapping
+           || output_format( options )
+                  != std::pair{ ihdr.getColourType(), ihdr.getBitDepth() };
+}
+
+void
+PngDecoder::convert_scanline( const std::span<const std::byte> scanline,
+                              const std::uint32_t              row,
+                              const IHDR::Adam7Pass &          pass,
+                              const std::uint32_t              columns,
+                              const std::span<std::byte>       target,
+                              const DecodeOptions & options ) noexcept {
+    const auto & ihdr{ header() };
+    const auto   bit_depth{ ihdr.getBitDepth() };
+    const bool   expanding{ expands_palette( ihdr, options ) };
+
+    if ( bit_depth == 16 ) {
+        const std::size_t channels{ IHDR::channel_count(
+            ihdr.getColourType() ) };
+        switch ( options.sixteen_bit ) {
+        case SampleDepth16::NATIVE_ENDIAN: {
+            CONVERT::swap_samples_16( scanline, target, columns * channels );
+        } break;
+        case SampleDepth16::ROUND_TO_8: {
+            CONVERT::reduce_samples_16( scanline, target, columns, channels,
+                                        CONVERT::rounding_offsets );
+        } break;
+        case SampleDepth16::DITHER_TO_8: {
+            // The dither pattern follows image, not pass, coordinates
+            CONVERT::reduce_samples_16(
+                scanline, target, columns, channels,
+                CONVERT::dither_offsets( pass.y_offset + row * pass.y_step,
+                                         pass.x_offset, pass.x_step ) );
+        } break;
+        case SampleDepth16::UNCHANGED: break;
+        }
+        return;
+    }
+
+    auto samples{ scanline };
+    if ( bit_depth < byte_bits ) {
+        // Palette expansion reads one index per byte
+        const auto unpacked{ expanding ?
+                                 std::span{ m_indices }.first( columns ) :
+                                 target.first( columns ) };
+        CONVERT::unpack_samples(
+            samples, unpacked, columns, bit_depth,
+            options.scale_greyscale
+                && ihdr.getColourType() == IHDR::ColourType::GREYSCALE );
+        samples = unpacked;
+    }
+    if ( expanding ) {
+        CONVERT::expand_palette( samples, target, columns, *m_palette_lookup,
+                                 !m_transparency.empty() );
+    }
+}
+
+ImageLayout
+PngDecoder::layout( const DecodeOptions & options,
+                    const std::size_t     stride ) const noexcept {
+    const auto & ihdr{ header() };
+    const auto [colour_type, bit_depth]{ output_format( options ) };
+    const auto row_bytes{ IHDR::scanline_bytes( ihdr.getWidth(), colour_type,
+                                                bit_depth ) };
+    const auto [first_row, end_row]{ row_range( options ) };
+
+    return ImageLayout{ .width = ihdr.getWidth(),
+                        .height = end_row - first_row,
+                        .bits_per_pixel =
+                            IHDR::bits_per_pixel( colour_type, bit_depth ),
+                        .stride = stride == 0 ? row_bytes : stride };
+}
+
+std::vector<std::byte>
+PngDecoder::decode( const DecodeOptions & options ) {
+    const auto             image_layout{ layout( options ) };
+    std::vector<std::byte> image( image_layout.size() );
+    decode_image( image, image_layout, options );
+    return image;
+}
+
+void
+PngDecoder::decode_into( const std::span<std::byte> image,
+                         const std::size_t          stride,
+                         const DecodeOptions &      options ) {
+    const auto image_layout{ layout( options, stride ) };
+    if ( image_layout.stride < image_layout.row_bytes()
+         || image.size() < image_layout.required_size() ) {
+        throw png_error( png_error_t::BAD_OUTPUT );
+    }
+    decode_image( image.first( image_layout.required_size() ), image_layout,
+                  options );
+}
+
+DecodeIndex
+PngDecoder::build_index( const std::uint32_t rows_per_checkpoint ) {
+    const auto & ihdr{ header() };
+    if ( ihdr.getInterlaceMethod() == IHDR::InterlaceMethod::ADAM_7
+         || rows_per_checkpoint == 0 ) {
+        return DecodeIndex{ m_fingerprint, rows_per_checkpoint, {} };
+    }
+
+    const auto scanline_size{ IHDR::scanline_bytes( ihdr.getWidth(),
+                                                    ihdr.getColourType(),
+                                                    ihdr.getBitDepth() )
+                              + 1 };
+    m_scanlines.resize( 2 * scanline_size );
+    auto current{ std::span{ m_scanlines }.first( scanline_size ) };
+    auto previous{ std::span{ m_scanlines }.last( scanline_size ) };
+    std::ranges::fill( previous, std::byte{ 0 } );
+    m_reading_bands = false;
+    m_inflater.reset( m_idat_segments );
+
+    METRICS::StageBatch        row_stages{ &m_metrics };
+    std::vector<RowCheckpoint> checkpoints;
+    for ( std::uint32_t row{ 1 }; row <= ihdr.getHeight(); ++row ) {
+        read_scanline( current, previous,
+                       IDAT::filter_bytes_per_pixel( ihdr.getColourType(),
+                                                     ihdr.getBitDepth() ),
+                       row_stages.active() ? &row_stages : nullptr );
+        std::swap( current, previous );
+
+        if ( row % rows_per_checkpoint == 0 && row < ihdr.getHeight() ) {
+            const auto unfiltered{ previous.subspan( 1 ) };
+            checkpoints.emplace_back( RowCheckpoint{
+                .row = row,
+                .previous_row = { unfiltered.begin(), unfiltered.end() },
+                .inflate = m_inflater.checkpoint() } );
+        }
+    }
+
+    if ( m_inflater.finish() != ZLIB::inflate_status_t::STREAM_END ) {
+        throw png_error( png_error_t::BAD_IMAGE_DATA );
+    }
+    return DecodeIndex{ m_fingerprint, rows_per_checkpoint,
+                        std::move( checkpoints ) };
+}
+
+Image
+PngDecoder::decode_to_image( const DecodeOptions &       options,
+                             std::pmr::memory_resource * resource ) {
+    const auto & ihdr{ header() };
+    const auto [colour_type, bit_depth]{ output_format( options ) };
+
+    Image image{ ihdr.getWidth(), layout( options ).height,
+                 colour_type,     bit_depth,
+                 0,               resource };
+    decode_into( image.data(), image.stride(), options );
+    return image;
+}
+
+IndexedImage
+PngDecoder::decode_indexed( const DecodeOptions & options ) {
+    if ( header().getColourType() != IHDR::ColourType::INDEXED_COLOUR ) {
+        throw png_error( png_error_t::NOT_INDEXED );
+    }
+
+    auto index_options{ options };
+    index_options.unpack_samples = true;
+    index_options.expand_palette = false;
+
+    auto indices{ decode( index_options ) };
+    return IndexedImage{ .indices = std::move( indices ),
+                         .layout = layout( index_options ),
+                         .palette = *m_plte,
+                         .transparency = m_transparency };
+}
+
+bool
+PngDecoder::inflate_bands( const std::uint32_t threads,
+                           const std::size_t   scanline_size,
+                           const std::size_t   filter_bpp ) {
+    const auto    band_count{ m_sync_points.size() + 1 };
+    std::uint64_t stream_bytes{ 0 };
+    for ( const auto & segment : m_idat_segments ) {
+        stream_bytes += segment.size();
+    }
+    METRICS::StageTimer inflate_timer{ &m_metrics, METRICS::stage_t::INFLATE,
+                                       stream_bytes };
+    // Counts the calling thread only, the other workers aren't profiled
+    PERF::Region        inflate_region{ "inflate", stream_bytes };
+
+    // The bands together can't hold more than the image's scanlines, so a
+    // small image with a large, highly compressed stream stops as soon as
+    // the bands overflow it
+    const auto                 max_output{ IHDR::image_data_bytes( header() ) };
+    std::atomic<std::uint64_t> output_bytes{ 0 };
+
+    m_bands.resize( band_count );
+    m_band_inputs.resize( band_count );
+    m_band_checksums.resize( band_count );
+    std::uint32_t     expected_checksum{ 0 };
+    std::atomic<bool> valid{ true };
+
+    // Every band but the first is raw deflate, the last one ends with the
+    // final block & is followed by the zlib trailer
+    const auto inflate_band = [&]( const std::size_t band ) {
+        const bool last{ band + 1 == band_count };
+        auto &     input{ m_band_inputs[band] };
+        slice_segments( m_idat_segments,
+                        band == 0 ? 0 : m_sync_points[band - 1],
+                        last ? stream_bytes : m_sync_points[band], input );
+
+        ZLIB::Inflater inflater{};
+        inflater.reset( input, band == 0 );
+
+        const auto  read_size{ static_cast<std::size_t>(
+            std::min<std::uint64_t>( std::size_t{ 1 } << 16,
+                                     max_output + 1 ) ) };
+        auto &      output{ m_bands[band] };
+        std::size_t produced{ 0 };
+        output.clear();
+        do {
+            output.resize( output.size() + read_size );
+            produced = inflater.read( std::span{ output }.last( read_size ) );
+            output.resize( output.size() - read_size + produced );
+            if ( ( output_bytes += produced ) > max_output ) {
+                return false;
+            }
+        } while ( produced == read_size && valid );
+
+        ZLIB::Adler32 checksum{};
+        checksum.update( output );
+        m_band_checksums[band] = checksum.value();
+
+        if ( !last ) {
+            return inflater.status() == ZLIB::inflate_status_t::TRUNCATED
+                   && inflater.ended_between_blocks();
+        }
+
+        ZLIB::SegmentedBitReader trailer{ input };
+        if ( !inflater.finished()
+             || !trailer.seek( ( inflater.bit_position() + byte_bits - 1 )
+                               / byte_bits * byte_bits ) ) {
+            return false;
+        }
+        for ( int i{ 0 }; i < 4; ++i ) {
+            std::uint32_t byte{ 0 };
+            if ( !trailer.read_bits( byte_bits, byte ) ) {
+                return false;
+            }
+            expected_checksum = ( expected_checksum << byte_bits ) | byte;
+        }
+        return true;
+    };
+
+    // Bands are unfiltered in order, each as its turn comes, the first row
+    // of a band against the last row of the band before. A row straddling
+    // two bands ends this, read_scanline() unfilters the rest.
+    std::atomic<std::size_t> turn{ 0 };
+    std::uint64_t            band_start{ 0 };
+    const auto zero_row{ std::span{ m_scanlines }.last( scanline_size - 1 ) };
+    std::ranges::fill( zero_row, std::byte{ 0 } );
+    std::span<const std::byte> previous_row{ zero_row };
+    m_unfiltered_bands = 0;
+
+    const auto unfilter_band = [&]( const std::size_t band ) {
+        auto &     output{ m_bands[band] };
+        const bool whole_rows{ band_start % scanline_size == 0
+                               && output.size() % scanline_size == 0 };
+        band_start += output.size();
+        if ( !valid || m_unfiltered_bands != band || !whole_rows ) {
+            return;
+        }
+        for ( std::size_t offset{ 0 }; offset < output.size();
+              offset += scanline_size ) {
+            const auto row{ std::span{ output }.subspan( offset,
+                                                         scanline_size ) };
+            if ( !IDAT::unfilter_row( static_cast<IDAT::FilterType>( row[0] ),
+                                      row.subspan( 1 ), previous_row,
+                                      filter_bpp ) ) {
+                valid = false;
+                return;
+            }
+            previous_row = row.subspan( 1 );
+        }
+        m_unfiltered_bands = band + 1;
+    };
+
+    const auto workers{ PARALLEL::worker_count( threads, band_count ) };
+    if ( m_pool == nullptr || m_pool->size() != workers ) {
+        m_pool = std::make_unique<PARALLEL::WorkerPool>( workers );
+    }
+    m_pool->run( band_count, [&]( const std::size_t band ) {
+        try {
+            if ( valid && !inflate_band( band ) ) {
+                valid = false;
+            }
+        }
+        catch ( ... ) {
+            valid = false;
+        }
+        // Every band takes its turn, failed or not, so none waits forever.
+        // Bands start in order, the ones before are already running.
+        for ( auto current{ turn.load() }; current != band;
+              current = turn.load() ) {
+            turn.wait( current );
+        }
+        unfilter_band( band );
+        turn = band + 1;
+        turn.notify_all();
+    } );
+
+    // Each band's checksum only covers its own output
+    std::uint32_t checksum{ ZLIB::Adler32{}.value() };
+    std::uint64_t inflated{ 0 };
+    for ( const auto & [band_checksum, output] :
+          std::views::zip( m_band_checksums, m_bands ) ) {
+        checksum = ZLIB::adler32_combine( checksum, band_checksum,
+                                          output.size() );
+        inflated += output.size();
+    }
+    inflate_timer.set_bytes_out( inflated );
+    if ( !valid || checksum != expected_checksum ) {
+        m_bands = {};
+        return false;
+    }
+    return true;
+}
+
+void
+PngDecoder::read_scanline( const std::span<std::byte>       scanline,
+                           const std::span<const std::byte> previous,
+                           const std::size_t                filter_bpp,
+                           METRICS::StageBatch * const      row_stages ) {
+    std::size_t read{ 0 };
+    // Band holding the end of the scanline
+    std::size_t last_band{ m_band_index };
+    if ( !m_reading_bands ) {
+        if ( row_stages == nullptr ) {
+            read = m_inflater.read( scanline );
+        }
+        else {
+            const auto bit_position{ m_inflater.bit_position() };
+            row_stages->mark();
+            read = m_inflater.read( scanline );
+            row_stages->lap(
+                METRICS::stage_t::INFLATE,
+                ( m_inflater.bit_position() - bit_position ) / byte_bits,
+                read );
+        }
+    }
+    // Scanlines may straddle bands
+    while ( m_reading_bands && read < scanline.size()
+            && m_band_index < m_bands.size() ) {
+        const auto band{ std::span{ m_bands[m_band_index] }.subspan(
+            m_band_offset ) };
+        const auto count{ std::min( band.size(), scanline.size() - read ) };
+        std::memcpy( scanline.data() + read, band.data(), count );
+        read += count;
+        last_band = m_band_index;
+        m_band_offset += count;
+        if ( m_band_offset == m_bands[m_band_index].size() ) {
+            ++m_band_index;
+            m_band_offset = 0;
+        }
+    }
+    if ( read != scanline.size() ) {
+        throw png_error( png_error_t::BAD_IMAGE_DATA );
+    }
+    TRACE::event<TRACE::trace_level_t::DETAIL>(
+        "read_scanline", std::to_integer<std::uint8_t>( scanline[0] ),
+        scanline.size() );
+    // Band copies are part of the inflate stage, timed as a whole
+    if ( row_stages != nullptr && m_reading_bands ) {
+        row_stages->mark();
+    }
+    // Rows of the leading bands were unfiltered as they were inflated, &
+    // those bands hold whole rows
+    if ( m_reading_bands && last_band < m_unfiltered_bands ) {
+        return;
+    }
+    if ( !IDAT::unfilter_row( static_cast<IDAT::FilterType>( scanline[0] ),
+                              scanline.subspan( 1 ), previous.subspan( 1 ),
+                              filter_bpp ) ) {
+        throw png_error( png_error_t::BAD_FILTER_TYPE );
+    }
+    if ( row_stages != nullptr ) {
+        row_stages->lap( METRICS::stage_t::UNFILTER, scanline.size(),
+                         scanline.size() - 1 );
+    }
+}
+
+void
+PngDecoder::decode_image( const std::span<std::byte> image,
+                          const ImageLayout &        layout,
+                          const DecodeOptions &      options ) {
+    const auto & ihdr{ header() };
+    const auto   colour_type{ ihdr.getColourType() };
+    const auto   bit_depth{ ihdr.getBitDepth() };
+    const auto   filter_bpp{ IDAT::filter_bytes_per_pixel( colour_type,
+                                                           bit_depth ) };
+    const bool   progressive{ static_cast<bool>( options.on_pass_complete ) };
+    const bool   converting{ converts_rows( options ) };
+    const bool   interlaced{ ihdr.getInterlaceMethod()
+                           == IHDR::InterlaceMethod::ADAM_7 };
+
+    const auto passes{ interlaced ? std::span{ IHDR::adam7_passes } :
+                                    std::span{ &IHDR::full_image_pass, 1 } };
+    const auto image_height{ ihdr.getHeight() };
+    const auto [first_row, end_row]{ row_range( options ) };
+    TRACE::event<TRACE::trace_level_t::STAGE>( "decode_image", first_row,
+                                               end_row );
+    // Row stages are totalled here & added to the metrics once, at the end
+    METRICS::StageBatch row_batch{ &m_metrics };
+    auto * const row_stages{ row_batch.active() ? &row_batch : nullptr };
+
+    // The stream ends with the last pass holding any scanlines, decoding
+    // can stop as soon as that pass reaches end_row
+    std::size_t last_pass{ 0 };
+    for ( std::size_t i{ 0 }; i < passes.size(); ++i ) {
+        if ( IHDR::pass_width( passes[i], layout.width ) != 0
+             && IHDR::pass_height( passes[i], image_height ) != 0 ) {
+            last_pass = i;
+        }
+    }
+
+    // Scanlines include the leading filter type byte
+    const auto max_scanline{
+        IHDR::scanline_bytes( layout.width, colour_type, bit_depth ) + 1
+    };
+    m_scanlines.resize( 2 * max_scanline );
+    if ( converting && interlaced ) {
+        m_converted.resize( layout.stride );
+    }
+    if ( expands_palette( ihdr, options ) ) {
+        m_palette_lookup.emplace( *m_plte, m_transparency );
+        m_indices.resize( layout.width );
+    }
+
+    // Resume from the nearest checkpoint above the range, if indexed
+    const RowCheckpoint * checkpoint{ nullptr };
+    if ( options.index != nullptr ) {
+        if ( options.index->fingerprint() != m_fingerprint ) {
+            throw png_error( png_error_t::BAD_INDEX );
+        }
+        checkpoint = interlaced ? nullptr : options.index->nearest( first_row );
+    }
+
+    // Streams with full flush points, listed by a syNc chunk or else
+    // scanned for, inflate in parallel, falling back to inflating in order
+    // if the bands turn out not to be independent
+    m_reading_bands = options.threads != 1 && !interlaced
+                      && checkpoint == nullptr && first_row == 0
+                      && end_row == image_height && !sync_points().empty()
+                      && inflate_bands( options.threads, max_scanline,
+                                        filter_bpp );
+    m_band_index = 0;
+    m_band_offset = 0;
+
+    if ( checkpoint == nullptr ) {
+        m_inflater.reset( m_idat_segments );
+    }
+    else if ( checkpoint->previous_row.size() != max_scanline - 1
+              || !m_inflater.resume( m_idat_segments, checkpoint->inflate ) ) {
+        throw png_error( png_error_t::BAD_INDEX );
+    }
+
+    // Adam7 places packed pixels bit by bit, clear caller owned rows so
+    // bits past the last pixel don't keep stale data
+    if ( interlaced && layout.bits_per_pixel < byte_bits ) {
+        for ( std::uint32_t y{ 0 }; y < layout.height; ++y ) {
+            std::ranges::fill(
+                image.subspan( y * layout.stride, layout.row_bytes() ),
+                std::byte{ 0 } );
+        }
+    }
+
+    // Rows interleave inflating, unfiltering & converting too finely to
+    // read the counters around each, so they are profiled as one region
+    PERF::Region rows_region{ "decode_rows", image.size() };
+    for ( const auto & [pass_index, pass] : std::views::enumerate( passes ) ) {
+        const auto columns{ IHDR::pass_width( pass, layout.width ) };
+        const auto rows{ IHDR::pass_height( pass, image_height ) };
+        // Rows from end_row on only feed later rows of the same pass
+        const auto needed_rows{ IHDR::pass_height( pass, end_row ) };
+        const auto block_height{ progressive ? pass.block_height : 1U };
+
+        // Empty passes contribute no scanlines to the stream
+        if ( columns != 0 && rows != 0 ) {
+            const auto scanline_size{
+                IHDR::scanline_bytes( columns, colour_type, bit_depth ) + 1
+            };
+            auto current{ std::span{ m_scanlines }.first( scanline_size ) };
+            auto previous{ std::span{ m_scanlines }.subspan( max_scanline,
+                                                             scanline_size ) };
+            std::ranges::fill( previous, std::byte{ 0 } );
+            std::uint32_t start_row{ 0 };
+            if ( checkpoint != nullptr ) {
+                std::ranges::copy( checkpoint->previous_row,
+                                   previous.begin() + 1 );
+                start_row = checkpoint->row;
+            }
+
+            for ( auto row{ start_row }; row < needed_rows; ++row ) {
+                read_scanline( current, previous, filter_bpp, row_stages );
+                std::swap( current, previous );
+
+                // Rows (or blocks) above the range are only unfiltered
+                const std::uint32_t y{ pass.y_offset + row * pass.y_step };
+                if ( y + block_height <= first_row ) {
+                    continue;
+                }
+
+                // The unfiltered scanline must stay intact, it is the next
+                // row's previous row. Non-interlaced rows convert straight
+                // into the image.
+                std::span<const std::byte> pixels{ previous.subspan( 1 ) };
+                if ( converting ) {
+                    const auto row_bytes{ ( columns * layout.bits_per_pixel
+                                            + byte_bits - 1 )
+                                          / byte_bits };
+                    const auto target{
+                        interlaced ?
+                            std::span{ m_converted }.first( row_bytes ) :
+                            image.subspan( ( y - first_row ) * layout.stride,
+                                           row_bytes )
+                    };
+                    convert_scanline( pixels, row, pass, columns, target,
+                                      options );
+                    // Conversion follows straight on from unfiltering
+                    if ( row_stages != nullptr ) {
+                        row_stages->lap( METRICS::stage_t::CONVERT,
+                                         pixels.size(), target.size() );
+                    }
+                    pixels = target;
+                }
+                if ( interlaced || !converting ) {
+                    place_scanline( pixels, row, pass, columns, image, layout,
+                                    first_row, progressive );
+                }
+            }
+
+            // Later passes follow in the stream, skip over the rest of
+            // this one without unfiltering it
+            if ( static_cast<std::size_t>( pass_index ) != last_pass ) {
+                for ( auto row{ needed_rows }; row < rows; ++row ) {
+                    if ( m_inflater.read( current ) != scanline_size ) {
+                        throw png_error( png_error_t::BAD_IMAGE_DATA );
+                    }
+                }
+            }
+        }
+
+        if ( progressive ) {
+            options.on_pass_complete( static_cast<std::uint8_t>( pass_index + 1 ),
+                                      image, layout );
+        }
+    }
+
+    // The end of the stream is only checked if it was decoded up to, bands
+    // are checked as they are inflated
+    if ( end_row == image_height && !m_reading_bands
+         && m_inflater.finish() != ZLIB::inflate_status_t::STREAM_END ) {
+        throw png_error( png_error_t::BAD_IMAGE_DATA );
+    }
+}
+
+} // namespace PNG
@@ -0,0 +1,483 @@
+#include "png/png_editor.hpp"
+
+#include "common/metrics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#if defined( __linux__ )
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::size_t   max_keyword_bytes{ 79 };
+constexpr std::uint32_t max_chunk_length{ 0x7FFF'FFFF };
+
+template <IntOrEnum T>
+constexpr auto
+big_endian_bytes( const T value ) {
+    return to_bytes<T, std::endian::native, std::endian::big>( value );
+}
+
+// Critical chunk types start with an upper case letter
+constexpr bool
+is_critical( const PngChunkType type ) noexcept {
+    return ( static_cast<std::uint32_t>( type ) & 0x2000'0000 ) == 0;
+}
+
+constexpr bool
+is_text( const PngChunkType type ) noexcept {
+    return type == PngChunkType::tEXt || type == PngChunkType::zTXt
+           || type == PngChunkType::iTXt;
+}
+
+// Chunks the PNG specification places before PLTE
+constexpr bool
+precedes_palette( const PngChunkType type ) noexcept {
+    return type == PngChunkType::cHRM || type == PngChunkType::gAMA
+           || type == PngChunkType::iCCP || type == PngChunkType::sBIT
+           || type == PngChunkType::sRGB;
+}
+
+// Keyword of text chunk data, the bytes before the first NUL
+std::string_view
+text_keyword( const std::span<const std::byte> data ) noexcept {
+    const auto end{ std::ranges::find( data, std::byte{ 0 } ) };
+    return { reinterpret_cast<const char *>( data.data() ),
+             static_cast<std::size_t>( end - data.begin() ) };
+}
+
+#if defined( __linux__ )
+// Copies `size` bytes at `offset` of the file `source_fd`, mapped at
+// `source`, to `fd`: within the kernel by copy_file_range, else sendfile,
+// else by writing from the mapping. Each gives way to the next once it
+// fails, as they do across file systems or into pipes & sockets.
+void
+copy_file_bytes( const int source_fd, const std::span<const std::byte> source,
+                 std::size_t offset, std::size_t size, const int fd ) {
+    const auto kernel_copy = [&]( const auto & copy ) {
+        while ( size != 0 ) {
+            auto       in_offset{ static_cast<off_t>( offset ) };
+            const auto copied{ copy( &in_offset ) };
+            if ( copied < 0 && errno == EINTR ) {
+                continue;
+            }
+            if ( copied <= 0 ) {
+                return;
+            }
+            offset += static_cast<std::size_t>( copied );
+            size -= static_cast<std::size_t>( copied );
+        }
+    };
+    kernel_copy( [&]( off_t * const in_offset ) {
+        return ::copy_file_range( source_fd, in_offset, fd, nullptr, size, 0 );
+    } );
+    kernel_copy( [&]( off_t * const in_offset ) {
+        return ::sendfile( fd, source_fd, in_offset, size );
+    } );
+    if ( size != 0 ) {
+        fd_sink( fd )( source.subspan( offset, size ) );
+    }
+}
+#endif
+
+} // namespace
+
+PngEditor::PngEditor( const std::span<const std::byte> source ) :
+    m_source( source ),
+    m_crc_calculator( CRC::PNG::png_polynomial<std::endian::big>() ) {
+    read_chunks();
+}
+
+#if defined( __linux__ )
+PngEditor::PngEditor( const std::filesystem::path & path ) :
+    m_crc_calculator( CRC::PNG::png_polynomial<std::endian::big>() ) {
+    try {
+        {
+            METRICS::StageTimer read_timer{ nullptr, METRICS::stage_t::READ };
+            m_fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+            struct stat status
+            {};
+            if ( m_fd < 0 || ::fstat( m_fd, &status ) != 0 ) {
+                throw png_error( png_error_t::READ_FAILED );
+            }
+            // An empty file can't be mapped, & fails as too short for a PNG
+            const auto size{ static_cast<std::size_t>( status.st_size ) };
+            if ( size != 0 ) {
+                auto * const p{ ::mmap( nullptr, size, PROT_READ,
+                                        MAP_PRIVATE, m_fd, 0 ) };
+                if ( p == MAP_FAILED ) {
+                    throw png_error( png_error_t::READ_FAILED );
+                }
+                m_source = { static_cast<const std::byte *>( p ), size };
+                m_mapped = true;
+            }
+            read_timer.set_bytes_out( size );
+        }
+        read_chunks();
+    }
+    catch ( ... ) {
+        close_source();
+        throw;
+    }
+}
+#endif
+
+PngEditor::~PngEditor() { close_source(); }
+
+PngEditor::PngEditor( PngEditor && other ) noexcept :
+    m_source( std::exchange( other.m_source, {} ) ),
+    m_chunks( std::move( other.m_chunks ) ),
+    m_crc_calculator( other.m_crc_calculator ),
+    m_idat_size( other.m_idat_size ),
+    m_fd( std::exchange( other.m_fd, -1 ) ),
+    m_mapped( std::exchange( other.m_mapped, false ) ) {}
+
+PngEditor &
+PngEditor::operator=( PngEditor && other ) noexcept {
+    if ( this != &other ) {
+        close_source();
+        m_source = std::exchange( other.m_source, {} );
+        m_chunks = std::move( other.m_chunks );
+        m_idat_size = other.m_idat_size;
+        m_fd = std::exchange( other.m_fd, -1 );
+        m_mapped = std::exchange( other.m_mapped, false );
+    }
+    return *this;
+}
+
+void
+PngEditor::close_source() noexcept {
+#if defined( __linux__ )
+    if ( m_mapped ) {
+        ::munmap( const_cast<std::byte *>( m_source.data() ),
+                  m_source.size() );
+    }
+    if ( m_fd >= 0 ) {
+        ::close( m_fd );
+    }
+#endif
+    m_source = {};
+    m_fd = -1;
+    m_mapped = false;
+}
+
+void
+PngEditor::read_chunks() {
+    if ( m_source.size() < png_signature_bytes
+         || span_to_integer<std::uint64_t, std::endian::big>(
+                m_source.first( png_signature_bytes ) )
+                != png_signature ) {
+        throw bad_png_header();
+    }
+
+    std::size_t offset{ png_signature_bytes };
+    while ( m_chunks.empty() || m_chunks.back().type != PngChunkType::IEND ) {
+        if ( m_source.size() - offset < chunk_overhead_bytes ) {
+            throw png_error( png_error_t::TRUNCATED_CHUNK );
+        }
+        const auto length{ span_to_integer<std::uint32_t, std::endian::big>(
+            m_source.subspan( offset, 4 ) ) };
+        if ( length > m_source.size() - offset - chunk_overhead_bytes ) {
+            throw png_error( png_error_t::TRUNCATED_CHUNK );
+        }
+        const auto type{ static_cast<PngChunkType>(
+            span_to_integer<std::uint32_t, std::endian::big>(
+                m_source.subspan( offset + 4, 4 ) ) ) };
+        if ( m_chunks.empty() && type != PngChunkType::IHDR ) {
+            throw png_error( png_error_t::MISSING_IHDR );
+        }
+
+        m_chunks.push_back(
+            Chunk{ type, offset, chunk_overhead_bytes + length, {} } );
+        offset += chunk_overhead_bytes + length;
+    }
+}
+
+std::span<const std::byte>
+PngEditor::chunk_data( const Chunk & chunk ) const noexcept {
+    const auto whole{ chunk.bytes.empty() ?
+                          m_source.subspan( chunk.offset, chunk.size ) :
+                          std::span<const std::byte>{ chunk.bytes } };
+    return whole.subspan( 8, chunk.size - chunk_overhead_bytes );
+}
+
+std::size_t
+PngEditor::insert_position( const PngChunkType type ) const noexcept {
+    // IEND is always last, & image data always ends before it
+    const auto first_of = [&]( const PngChunkType target ) {
+        return static_cast<std::size_t>(
+            std::ranges::find_if( m_chunks,
+                                  [&]( const Chunk & chunk ) {
+                                      return chunk.type == target
+                                             || chunk.type
+                                                    == PngChunkType::IEND;
+                                  } )
+            - m_chunks.begin() );
+    };
+    if ( is_text( type ) || type == PngChunkType::tIME ) {
+        return m_chunks.size() - 1;
+    }
+    const auto image_data{ first_of( PngChunkType::IDAT ) };
+    return precedes_palette( type ) ?
+               std::min( image_data, first_of( PngChunkType::PLTE ) ) :
+               image_data;
+}
+
+template <typename Matches>
+void
+PngEditor::replace( const PngChunkType               type,
+                    const std::span<const std::byte> data,
+                    const Matches &                  matches ) {
+    if ( data.size() > max_chunk_length ) {
+        throw png_error( png_error_t::BAD_EDIT );
+    }
+
+    Chunk      chunk{ type, 0, chunk_overhead_bytes + data.size(), {} };
+    const auto length{ big_endian_bytes(
+        static_cast<std::uint32_t>( data.size() ) ) };
+    const auto type_bytes{ big_endian_bytes( type ) };
+    const auto crc{ big_endian_bytes( static_cast<std::uint32_t>(
+        m_crc_calculator.crc( data, m_crc_calculator.crc( type_bytes ) )
+            .to_ulong() ) ) };
+    chunk.bytes.reserve( chunk.size );
+    chunk.bytes.insert( chunk.bytes.end(), length.begin(), length.end() );
+    chunk.bytes.insert( chunk.bytes.end(), type_bytes.begin(),
+                        type_bytes.end() );
+    chunk.bytes.insert( chunk.bytes.end(), data.begin(), data.end() );
+    chunk.bytes.insert( chunk.bytes.end(), crc.begin(), crc.end() );
+
+    // Only matches from the first on are erased, so its index holds
+    const auto first_match{ std::ranges::find_if( m_chunks, matches ) };
+    const auto position{ first_match != m_chunks.end() ?
+                             static_cast<std::size_t>( first_match
+                                                       - m_chunks.begin() ) :
+                             insert_position( type ) };
+    std::erase_if( m_chunks, matches );
+    m_chunks.insert( m_chunks.begin() + static_cast<std::ptrdiff_t>( position ),
+                     std::move( chunk ) );
+}
+
+std::uint64_t
+PngEditor::idat_data_bytes() const noexcept {
+    std::uint64_t bytes{ 0 };
+    for ( const auto & chunk : m_chunks ) {
+        if ( chunk.type == PngChunkType::IDAT ) {
+            bytes += chunk.size - chunk_overhead_bytes;
+        }
+    }
+    return bytes;
+}
+
+std::vector<PngChunkType>
+PngEditor::chunk_types() const {
+    // Rechunked IDAT data takes at least one chunk
+    const auto idat_chunks{ m_idat_size == 0 ?
+                                std::uint64_t{ 0 } :
+                                std::max<std::uint64_t>(
+                                    1, ( idat_data_bytes() + m_idat_size - 1 )
+                                           / m_idat_size ) };
+    std::vector<PngChunkType> types;
+    auto                      idat_written{ false };
+    for ( const auto & chunk : m_chunks ) {
+        if ( m_idat_size == 0 || chunk.type != PngChunkType::IDAT ) {
+            types.push_back( chunk.type );
+        }
+        else if ( !idat_written ) {
+            types.insert( types.end(), idat_chunks, PngChunkType::IDAT );
+            idat_written = true;
+        }
+    }
+    return types;
+}
+
+void
+PngEditor::remove( const PngChunkType type ) {
+    if ( is_critical( type ) ) {
+        throw png_error( png_error_t::BAD_EDIT );
+    }
+    std::erase_if( m_chunks, [type]( const Chunk & chunk ) {
+        return chunk.type == type;
+    } );
+}
+
+void
+PngEditor::remove_text( const std::string_view keyword ) {
+    std::erase_if( m_chunks, [&]( const Chunk & chunk ) {
+        return is_text( chunk.type )
+               && text_keyword( chunk_data( chunk ) ) == keyword;
+    } );
+}
+
+void
+PngEditor::strip_metadata() {
+    std::erase_if( m_chunks, []( const Chunk & chunk ) {
+        return !is_critical( chunk.type ) && chunk.type != PngChunkType::tRNS
+               && chunk.type != PngChunkType::syNc;
+    } );
+}
+
+void
+PngEditor::set( const PngChunkType               type,
+                const std::span<const std::byte> data ) {
+    if ( is_critical( type ) || is_text( type ) ) {
+        throw png_error( png_error_t::BAD_EDIT );
+    }
+    replace( type, data,
+             [type]( const Chunk & chunk ) { return chunk.type == type; } );
+}
+
+void
+PngEditor::set_text( const std::string_view keyword,
+                     const std::string_view text ) {
+    if ( keyword.empty() || keyword.size() > max_keyword_bytes
+         || keyword.contains( '\0' ) || text.contains( '\0' ) ) {
+        throw png_error( png_error_t::BAD_EDIT );
+    }
+
+    std::vector<std::byte> data;
+    data.reserve( keyword.size() + 1 + text.size() );
+    for ( const auto c : keyword ) {
+        data.push_back( static_cast<std::byte>( c ) );
+    }
+    data.push_back( std::byte{ 0 } );
+    for ( const auto c : text ) {
+        data.push_back( static_cast<std::byte>( c ) );
+    }
+    replace( PngChunkType::tEXt, data, [&]( const Chunk & chunk ) {
+        return is_text( chunk.type )
+               && text_keyword( chunk_data( chunk ) ) == keyword;
+    } );
+}
+
+void
+PngEditor::rechunk_idat( const std::uint32_t chunk_size ) {
+    if ( chunk_size == 0 || chunk_size > max_chunk_length ) {
+        throw png_error( png_error_t::BAD_EDIT );
+    }
+    m_idat_size = chunk_size;
+}
+
+template <typename Copy, typename Emit>
+void
+PngEditor::for_each_piece( const Copy & copy, const Emit & emit ) const {
+    // The signature starts the first run
+    std::size_t run_offset{ 0 };
+    std::size_t run_size{ png_signature_bytes };
+    auto        idat_written{ false };
+    for ( const auto & chunk : m_chunks ) {
+        const auto rechunked{ m_idat_size != 0
+                              && chunk.type == PngChunkType::IDAT };
+        if ( !chunk.bytes.empty() || rechunked ) {
+            if ( run_size != 0 ) {
+                copy( run_offset, run_size );
+                run_size = 0;
+            }
+            if ( !rechunked ) {
+                emit( std::span<const std::byte>{ chunk.bytes } );
+            }
+            else if ( !idat_written ) {
+                write_rechunked_idat( copy, emit );
+                idat_written = true;
+            }
+        }
+        else if ( run_size != 0 && run_offset + run_size == chunk.offset ) {
+            run_size += chunk.size;
+        }
+        else {
+            if ( run_size != 0 ) {
+                copy( run_offset, run_size );
+            }
+            run_offset = chunk.offset;
+            run_size = chunk.size;
+        }
+    }
+    if ( run_size != 0 ) {
+        copy( run_offset, run_size );
+    }
+}
+
+template <typename Copy, typename Emit>
+void
+PngEditor::write_rechunked_idat( const Copy & copy, const Emit & emit ) const {
+    const auto type_bytes{ big_endian_bytes( PngChunkType::IDAT ) };
+    const auto type_crc{ m_crc_calculator.crc( type_bytes ) };
+
+    // Read position: a source chunk & the data bytes of it already copied
+    auto        source{ m_chunks.begin() };
+    std::size_t consumed{ 0 };
+    const auto  source_data_bytes = [&] {
+        return source->type == PngChunkType::IDAT ?
+                   source->size - chunk_overhead_bytes :
+                   0;
+    };
+
+    auto remaining{ idat_data_bytes() };
+    do {
+        const auto length{ static_cast<std::uint32_t>(
+            std::min<std::uint64_t>( remaining, m_idat_size ) ) };
+        const auto length_bytes{ big_endian_bytes( length ) };
+        std::array<std::byte, 8> header{};
+        std::ranges::copy( length_bytes, header.begin() );
+        std::ranges::copy( type_bytes, header.begin() + length_bytes.size() );
+        emit( std::span<const std::byte>{ header } );
+
+        auto crc{ type_crc };
+        for ( std::size_t left{ length }; left != 0; ) {
+            while ( consumed == source_data_bytes() ) {
+                ++source;
+                consumed = 0;
+            }
+            const auto piece{ std::min( left,
+                                        source_data_bytes() - consumed ) };
+            const auto offset{ source->offset + 8 + consumed };
+            crc = m_crc_calculator.crc( m_source.subspan( offset, piece ),
+                                        crc );
+            copy( offset, piece );
+            consumed += piece;
+            left -= piece;
+        }
+        emit( std::span<const std::byte>{ big_endian_bytes(
+            static_cast<std::uint32_t>( crc.to_ulong() ) ) } );
+        remaining -= length;
+    } while ( remaining != 0 );
+}
+
+void
+PngEditor::write( const ByteSink & sink ) const {
+    for_each_piece(
+        [&]( const std::size_t offset, const std::size_t size ) {
+            sink( m_source.subspan( offset, size ) );
+        },
+        [&]( const std::span<const std::byte> bytes ) { sink( bytes ); } );
+}
+
+#if defined( __linux__ )
+void
+PngEditor::write( const int fd ) const {
+    const auto sink{ fd_sink( fd ) };
+    for_each_piece(
+        [&]( const std::size_t offset, const std::size_t size ) {
+            if ( m_fd >= 0 ) {
+                copy_file_bytes( m_fd, m_source, offset, size, fd );
+            }
+            else {
+                sink( m_source.subspan( offset, size ) );
+            }
+        },
+        [&]( const std::span<const std::byte> bytes ) { sink( bytes ); } );
+}
+#endif
+
+} // namespace PNG
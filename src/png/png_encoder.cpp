@@ -0,0 +1,512 @@
+#include "png/png_encoder.hpp"
+
+#include "png/png_convert.hpp"
+#include "png/png_filter.hpp"
+#include "png/png_index.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+
+#if defined( __linux__ )
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::size_t max_palette_entries{ 256 };
+
+// Filtered bytes per band when encoding on several threads
+constexpr std::size_t band_bytes{ std::size_t{ 1 } << 20 };
+
+// Rows whose filtered data fills the deflate window, primed from
+constexpr std::uint32_t
+window_rows( const std::size_t row_bytes ) noexcept {
+    return static_cast<std::uint32_t>(
+        ( ZLIB::Deflater::window_size + row_bytes ) / ( row_bytes + 1 ) );
+}
+
+// Output reserved for `bytes` of input: stored blocks, which is the most a
+// Deflater emits, a zlib header, a flush marker & the trailer
+constexpr std::size_t
+deflated_bytes( const std::size_t bytes ) noexcept {
+    constexpr std::size_t stored_block_header{ 5 };
+    return bytes
+           + ( bytes / ZLIB::Deflater::max_stored_block + 1 )
+                 * stored_block_header
+           + 16;
+}
+
+template <IntOrEnum T>
+constexpr auto
+big_endian_bytes( const T value ) {
+    return to_bytes<T, std::endian::native, std::endian::big>( value );
+}
+
+// IHDR chunk data: width, height, then one byte per remaining field
+std::vector<std::byte>
+ihdr_bytes( const IHDR::IhdrChunkPayload & ihdr ) {
+    std::vector<std::byte> data;
+    for ( const auto dimension : { ihdr.getWidth(), ihdr.getHeight() } ) {
+        const auto bytes{ big_endian_bytes( dimension ) };
+        data.insert( data.end(), bytes.begin(), bytes.end() );
+    }
+    data.push_back( static_cast<std::byte>( ihdr.getBitDepth() ) );
+    data.push_back( static_cast<std::byte>( ihdr.getColourType() ) );
+    data.push_back( static_cast<std::byte>( ihdr.getCompressionMethod() ) );
+    data.push_back( static_cast<std::byte>( ihdr.getFilterMethod() ) );
+    data.push_back( static_cast<std::byte>( ihdr.getInterlaceMethod() ) );
+    return data;
+}
+
+// tRNS data length for colour types that take a single transparent colour
+constexpr std::size_t
+transparency_bytes( const IHDR::ColourType colour_type ) noexcept {
+    switch ( colour_type ) {
+    case IHDR::ColourType::GREYSCALE: return 2;
+    case IHDR::ColourType::TRUE_COLOUR: return 6;
+    default: return 0;
+    }
+}
+
+} // namespace
+
+ByteSink
+buffer_sink( std::vector<std::byte> & buffer ) {
+    return [&buffer]( const std::span<const std::byte> bytes ) {
+        buffer.insert( buffer.end(), bytes.begin(), bytes.end() );
+    };
+}
+
+#if defined( __linux__ )
+ByteSink
+fd_sink( const int fd ) {
+    return [fd]( std::span<const std::byte> bytes ) {
+        while ( !bytes.empty() ) {
+            const auto written{ ::write( fd, bytes.data(), bytes.size() ) };
+            if ( written < 0 ) {
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                throw png_error( png_error_t::WRITE_FAILED );
+            }
+            bytes = bytes.subspan( static_cast<std::size_t>( written ) );
+        }
+    };
+}
+#endif
+
+PngEncoder::PngEncoder( const IHDR::IhdrChunkPayload & header, ByteSink sink,
+                        const EncodeOptions & options ) :
+    m_ihdr( header ),
+    m_sink( std::move( sink ) ),
+    m_options( options ),
+    m_crc_calculator( CRC::PNG::png_polynomial<std::endian::big>() ),
+    m_deflater( options.level ),
+    m_row_bytes( IHDR::scanline_bytes( header.getWidth(),
+                                       header.getColourType(),
+                                       header.getBitDepth() ) ),
+    m_filter_bpp( IDAT::filter_bytes_per_pixel( header.getColourType(),
+                                                header.getBitDepth() ) ),
+    m_adaptive_filter( options.adaptive_filter
+                       && header.getColourType()
+                              != IHDR::ColourType::INDEXED_COLOUR
+                       && header.getBitDepth() >= 8 ) {
+    if ( !m_ihdr.isValid() ) {
+        throw png_error( png_error_t::BAD_IHDR );
+    }
+    if ( m_options.idat_size == 0 || !IDAT::is_valid( m_options.filter ) ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+
+    // A stored block is the most a single deflate call appends past a
+    // chunk's worth of data
+    m_idat.reserve( m_options.idat_size + ZLIB::Deflater::max_stored_block
+                    + 16 );
+    m_previous.resize( m_row_bytes );
+    m_filtered.resize( m_row_bytes + 1 );
+    if ( m_ihdr.getInterlaceMethod() == IHDR::InterlaceMethod::ADAM_7 ) {
+        m_interlace_rows.resize( m_row_bytes * m_ihdr.getHeight() );
+        m_pass_row.resize( m_row_bytes );
+    }
+    else if ( m_options.threads != 1 ) {
+        m_worker_count = static_cast<std::uint32_t>( PARALLEL::worker_count(
+            m_options.threads, std::numeric_limits<std::uint32_t>::max() ) );
+    }
+    if ( m_worker_count > 1 ) {
+        m_band_rows = m_options.rows_per_segment != 0 ?
+                          m_options.rows_per_segment :
+                          static_cast<std::uint32_t>( std::max<std::size_t>(
+                              1, band_bytes / ( m_row_bytes + 1 ) ) );
+        const auto batch_rows{ std::min<std::uint64_t>(
+            m_ihdr.getHeight(),
+            std::uint64_t{ m_worker_count } * m_band_rows
+                + window_rows( m_row_bytes ) + 1 ) };
+        const auto band_input{ std::size_t{ m_band_rows }
+                               * ( m_row_bytes + 1 ) };
+        m_batch.reserve( batch_rows * m_row_bytes );
+        // Bands are appended whole, then written out a chunk at a time
+        m_idat.reserve( m_options.idat_size + deflated_bytes( band_input ) );
+        m_band_deflaters.reserve( m_worker_count );
+        m_band_filtered.resize( m_worker_count );
+        m_band_output.resize( m_worker_count );
+        for ( std::uint32_t band{ 0 }; band < m_worker_count; ++band ) {
+            m_band_deflaters.emplace_back( m_options.level, false );
+            m_band_filtered[band].reserve(
+                band_input
+                + std::size_t{ window_rows( m_row_bytes ) }
+                      * ( m_row_bytes + 1 ) );
+            m_band_output[band].reserve( deflated_bytes( band_input ) );
+        }
+        m_pool = std::make_unique<PARALLEL::WorkerPool>( m_worker_count );
+    }
+
+    m_sink( big_endian_bytes( png_signature ) );
+    write_chunk( PngChunkType::IHDR, ihdr_bytes( m_ihdr ) );
+}
+
+void
+PngEncoder::write_palette( const std::span<const PLTE::Palette> palette ) {
+    if ( m_rows_written != 0 || m_palette_entries != 0 || m_finished ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+    const auto colour_type{ m_ihdr.getColourType() };
+    // Indexed images can't have more entries than their indices can reach
+    const auto max_entries{ colour_type == IHDR::ColourType::INDEXED_COLOUR ?
+                                std::size_t{ 1 } << m_ihdr.getBitDepth() :
+                                max_palette_entries };
+    if ( palette.empty() || palette.size() > max_entries
+         || colour_type == IHDR::ColourType::GREYSCALE
+         || colour_type == IHDR::ColourType::GREYSCALE_ALPHA ) {
+        throw png_error( png_error_t::BAD_PLTE );
+    }
+
+    std::array<std::byte, max_palette_entries * sizeof( PLTE::Palette )>
+                data{};
+    std::size_t size{ 0 };
+    for ( const auto & [red, green, blue] : palette ) {
+        data[size++] = std::byte{ red };
+        data[size++] = std::byte{ green };
+        data[size++] = std::byte{ blue };
+    }
+    write_chunk( PngChunkType::PLTE, std::span{ data }.first( size ) );
+    m_palette_entries = palette.size();
+}
+
+void
+PngEncoder::write_transparency(
+    const std::span<const std::byte> transparency ) {
+    if ( m_rows_written != 0 || m_finished ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+    const auto colour_type{ m_ihdr.getColourType() };
+    if ( colour_type == IHDR::ColourType::INDEXED_COLOUR ) {
+        if ( m_palette_entries == 0 ) {
+            throw png_error( png_error_t::MISSING_PLTE );
+        }
+        if ( transparency.empty()
+             || transparency.size() > m_palette_entries ) {
+            throw png_error( png_error_t::BAD_TRNS );
+        }
+    }
+    else if ( transparency.size() != transparency_bytes( colour_type )
+              || transparency.empty() ) {
+        throw png_error( png_error_t::BAD_TRNS );
+    }
+    write_chunk( PngChunkType::tRNS, transparency );
+}
+
+void
+PngEncoder::write_rows( const std::span<const std::byte> rows,
+                        std::size_t                      stride ) {
+    if ( stride == 0 ) {
+        stride = m_row_bytes;
+    }
+    if ( m_finished || stride < m_row_bytes ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+    if ( m_ihdr.getColourType() == IHDR::ColourType::INDEXED_COLOUR
+         && m_palette_entries == 0 ) {
+        throw png_error( png_error_t::MISSING_PLTE );
+    }
+    if ( rows.empty() ) {
+        return;
+    }
+
+    // Either every row is padded to the stride, or all but the last
+    const auto count{ ( rows.size() + stride - m_row_bytes ) / stride };
+    if ( rows.size() < m_row_bytes
+         || ( rows.size() != count * stride
+              && rows.size() != ( count - 1 ) * stride + m_row_bytes )
+         || count > m_ihdr.getHeight() - m_rows_written ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+
+    const bool interlaced{ m_ihdr.getInterlaceMethod()
+                           == IHDR::InterlaceMethod::ADAM_7 };
+    const auto segment_rows{ interlaced || m_band_rows != 0 ?
+                                 0U :
+                                 m_options.rows_per_segment };
+    for ( std::size_t i{ 0 }; i < count; ++i ) {
+        const auto row{ rows.subspan( i * stride, m_row_bytes ) };
+        if ( interlaced ) {
+            std::ranges::copy( row, m_interlace_rows.begin()
+                                        + static_cast<std::ptrdiff_t>(
+                                            m_rows_written * m_row_bytes ) );
+        }
+        else if ( m_band_rows != 0 ) {
+            m_batch.insert( m_batch.end(), row.begin(), row.end() );
+        }
+        else {
+            encode_scanline( row );
+        }
+        ++m_rows_written;
+
+        if ( m_band_rows != 0
+             && ( m_rows_written - m_batch_start_row
+                      == std::uint64_t{ m_worker_count } * m_band_rows
+                  || m_rows_written == m_ihdr.getHeight() ) ) {
+            encode_batch();
+        }
+
+        if ( segment_rows != 0 && m_rows_written % segment_rows == 0
+             && m_rows_written < m_ihdr.getHeight() ) {
+            compress( {}, ZLIB::deflate_flush_t::FULL );
+            m_sync_points.push_back( m_deflater.total_out() );
+        }
+    }
+
+    if ( interlaced && m_rows_written == m_ihdr.getHeight() ) {
+        encode_interlaced();
+        // The raw rows are no longer needed
+        m_interlace_rows = {};
+    }
+}
+
+void
+PngEncoder::finish() {
+    if ( m_finished || m_rows_written != m_ihdr.getHeight() ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+
+    // Bands complete the stream with the last row
+    if ( m_band_rows == 0 ) {
+        compress( {}, ZLIB::deflate_flush_t::FINISH );
+    }
+    write_idat( true );
+    if ( !m_sync_points.empty() ) {
+        const SyncIndex index{ .rows_per_segment = m_options.rows_per_segment,
+                               .offsets = std::move( m_sync_points ) };
+        write_chunk( PngChunkType::syNc, index.serialize() );
+    }
+    write_chunk( PngChunkType::IEND, {} );
+    m_finished = true;
+}
+
+void
+PngEncoder::write_chunk( const PngChunkType               type,
+                         const std::span<const std::byte> data ) {
+    const auto length{ big_endian_bytes(
+        static_cast<std::uint32_t>( data.size() ) ) };
+    const auto type_bytes{ big_endian_bytes( type ) };
+    const auto crc{ m_crc_calculator.crc(
+        data, m_crc_calculator.crc( type_bytes ) ) };
+
+    std::array<std::byte, 8> chunk_header{};
+    std::ranges::copy( length, chunk_header.begin() );
+    std::ranges::copy( type_bytes, chunk_header.begin() + length.size() );
+    m_sink( chunk_header );
+    if ( !data.empty() ) {
+        m_sink( data );
+    }
+    m_sink( big_endian_bytes( static_cast<std::uint32_t>( crc.to_ulong() ) ) );
+}
+
+void
+PngEncoder::filter_scanline( const std::span<const std::byte> row,
+                             const std::span<const std::byte> previous,
+                             const std::span<std::byte>       filtered ) const {
+    const auto filter{ m_adaptive_filter ?
+                           IDAT::choose_filter( row,
+                                                previous.first( row.size() ),
+                                                m_filter_bpp ) :
+                           m_options.filter };
+    filtered[0] = static_cast<std::byte>( filter );
+    static_cast<void>( IDAT::filter_row( filter, row, previous,
+                                         filtered.subspan( 1 ),
+                                         m_filter_bpp ) );
+}
+
+void
+PngEncoder::encode_scanline( const std::span<const std::byte> row ) {
+    const auto filtered{ std::span{ m_filtered }.first( row.size() + 1 ) };
+    filter_scanline( row, m_previous, filtered );
+    std::ranges::copy( row, m_previous.begin() );
+    compress( filtered, ZLIB::deflate_flush_t::NONE );
+}
+
+void
+PngEncoder::encode_batch() {
+    const auto first_row{ m_batch_start_row };
+    const auto end_row{ m_rows_written };
+    const auto band_count{ ( end_row - first_row + m_band_rows - 1 )
+                           / m_band_rows };
+    const auto band_rows = [&]( const std::uint32_t band ) {
+        const auto start{ first_row + band * m_band_rows };
+        return std::pair{ start, std::min( end_row, start + m_band_rows ) };
+    };
+
+    std::vector<std::uint32_t> checksums( band_count );
+    m_pool->run( band_count, [&]( const std::size_t band ) {
+        const auto [start, end]{ band_rows(
+            static_cast<std::uint32_t>( band ) ) };
+        checksums[band] = encode_band( start, end, m_band_deflaters[band],
+                                       m_band_filtered[band],
+                                       m_band_output[band] );
+    } );
+
+    for ( std::uint32_t band{ 0 }; band < band_count; ++band ) {
+        const auto [start, end]{ band_rows( band ) };
+        if ( m_options.rows_per_segment != 0 && start != 0 ) {
+            m_sync_points.push_back( m_stream_bytes );
+        }
+        const auto & output{ m_band_output[band] };
+        m_idat.insert( m_idat.end(), output.begin(), output.end() );
+        m_stream_bytes += output.size();
+        m_stream_adler = ZLIB::adler32_combine(
+            m_stream_adler, checksums[band],
+            std::uint64_t{ end - start } * ( m_row_bytes + 1 ) );
+        write_idat( false );
+    }
+
+    // The first band carries the zlib header, & the trailer too if it was
+    // the only one
+    if ( end_row == m_ihdr.getHeight()
+         && band_rows( band_count - 1 ).first != 0 ) {
+        const auto trailer{ big_endian_bytes( m_stream_adler ) };
+        m_idat.insert( m_idat.end(), trailer.begin(), trailer.end() );
+        m_stream_bytes += trailer.size();
+    }
+
+    // Keep the rows the next batch filters against & primes from
+    const auto carry_rows{ std::min(
+        end_row - m_batch_first_row,
+        ( m_options.rows_per_segment == 0 ? window_rows( m_row_bytes ) : 0 )
+            + 1 ) };
+    m_batch.erase( m_batch.begin(),
+                   m_batch.end()
+                       - static_cast<std::ptrdiff_t>( carry_rows
+                                                      * m_row_bytes ) );
+    m_batch_first_row = end_row - carry_rows;
+    m_batch_start_row = end_row;
+}
+
+std::uint32_t
+PngEncoder::encode_band( const std::uint32_t      first_row,
+                         const std::uint32_t      end_row,
+                         ZLIB::Deflater &         deflater,
+                         std::vector<std::byte> & filtered,
+                         std::vector<std::byte> & output ) const {
+    // Segments start afresh, other bands re-filter enough rows before
+    // them to prime the window
+    const bool primed{ m_options.rows_per_segment == 0 };
+    const auto prime_rows{ primed ? window_rows( m_row_bytes ) : 0 };
+    const auto prime_row{ first_row - std::min( first_row, prime_rows ) };
+    const auto scanline_bytes{ m_row_bytes + 1 };
+    const auto raw_row = [&]( const std::uint32_t row ) {
+        return std::span{ m_batch }.subspan(
+            std::size_t{ row - m_batch_first_row } * m_row_bytes,
+            m_row_bytes );
+    };
+
+    filtered.resize( std::size_t{ end_row - prime_row } * scanline_bytes );
+    for ( auto row{ prime_row }; row < end_row; ++row ) {
+        filter_scanline( raw_row( row ),
+                         row == 0 ? std::span<const std::byte>{ m_previous } :
+                                    raw_row( row - 1 ),
+                         std::span{ filtered }.subspan(
+                             std::size_t{ row - prime_row } * scanline_bytes,
+                             scanline_bytes ) );
+    }
+    const auto dictionary{ std::span{ filtered }.first(
+        std::size_t{ first_row - prime_row } * scanline_bytes ) };
+
+    // Only the first band has the zlib header, only the last one ends
+    // with the final block
+    deflater.reset( first_row == 0 );
+    deflater.set_dictionary( dictionary );
+    output.clear();
+    deflater.deflate( std::span{ filtered }.subspan( dictionary.size() ),
+                      end_row == m_ihdr.getHeight() ?
+                          ZLIB::deflate_flush_t::FINISH :
+                          ( primed ? ZLIB::deflate_flush_t::SYNC :
+                                     ZLIB::deflate_flush_t::FULL ),
+                      output );
+    return deflater.adler();
+}
+
+void
+PngEncoder::compress( const std::span<const std::byte> data,
+                      const ZLIB::deflate_flush_t      flush ) {
+    m_deflater.deflate( data, flush, m_idat );
+    write_idat( false );
+}
+
+void
+PngEncoder::write_idat( const bool all ) {
+    std::size_t written{ 0 };
+    while ( m_idat.size() - written >= m_options.idat_size
+            || ( all && written < m_idat.size() ) ) {
+        const auto size{ std::min<std::size_t>( m_options.idat_size,
+                                                m_idat.size() - written ) };
+        write_chunk( PngChunkType::IDAT,
+                     std::span{ m_idat }.subspan( written, size ) );
+        written += size;
+    }
+    m_idat.erase( m_idat.begin(),
+                  m_idat.begin() + static_cast<std::ptrdiff_t>( written ) );
+}
+
+void
+PngEncoder::encode_interlaced() {
+    const auto width{ m_ihdr.getWidth() };
+    const auto height{ m_ihdr.getHeight() };
+    const auto bits{ IHDR::bits_per_pixel( m_ihdr.getColourType(),
+                                           m_ihdr.getBitDepth() ) };
+    const auto image{ std::span{ m_interlace_rows } };
+
+    for ( const auto & pass : IHDR::adam7_passes ) {
+        const auto columns{ IHDR::pass_width( pass, width ) };
+        const auto pass_rows{ IHDR::pass_height( pass, height ) };
+        if ( columns == 0 || pass_rows == 0 ) {
+            continue;
+        }
+
+        const auto row_bytes{ IHDR::scanline_bytes(
+            columns, m_ihdr.getColourType(), m_ihdr.getBitDepth() ) };
+        const auto pass_row{ std::span{ m_pass_row }.first( row_bytes ) };
+        std::ranges::fill( m_previous, std::byte{ 0 } );
+        for ( std::uint32_t row{ 0 }; row < pass_rows; ++row ) {
+            const auto source{ image.subspan(
+                ( pass.y_offset + std::size_t{ row } * pass.y_step )
+                    * m_row_bytes,
+                m_row_bytes ) };
+            // Keeps the padding bits after the last sub-byte pixel zero
+            std::ranges::fill( pass_row, std::byte{ 0 } );
+            for ( std::uint32_t column{ 0 }; column < columns; ++column ) {
+                CONVERT::copy_pixel( source,
+                                     pass.x_offset + column * pass.x_step,
+                                     pass_row, column, bits );
+            }
+            encode_scanline( pass_row );
+        }
+    }
+}
+
+} // namespace PNG
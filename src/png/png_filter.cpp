@@ -0,0 +1,306 @@
+#include "png/png_filter.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+namespace PNG
+{
+
+namespace IDAT
+{
+
+namespace
+{
+
+constexpr std::uint8_t
+to_u8( const std::byte value ) noexcept {
+    return std::to_integer<std::uint8_t>( value );
+}
+
+constexpr std::byte
+add_bytes( const std::byte value, const std::uint32_t predictor ) noexcept {
+    return static_cast<std::byte>( to_u8( value ) + predictor );
+}
+
+constexpr std::byte
+subtract_bytes( const std::byte     value,
+                const std::uint32_t predictor ) noexcept {
+    return static_cast<std::byte>( to_u8( value ) - predictor );
+}
+
+// |value| of a filtered byte taken as signed.
+constexpr std::uint32_t
+signed_magnitude( const std::uint32_t value ) noexcept {
+    const auto byte{ value & 0xFFU };
+    return byte < 0x80 ? byte : 0x100 - byte;
+}
+
+using filter_costs_t = std::array<std::uint64_t, filter_type_count>;
+
+void
+filter_costs_scalar( const std::byte * const current,
+                     const std::byte * const above, const std::size_t first,
+                     const std::size_t size, const std::size_t bpp,
+                     filter_costs_t & costs ) noexcept {
+    for ( auto i{ first }; i < size; ++i ) {
+        const std::uint32_t x{ to_u8( current[i] ) };
+        const std::uint32_t a{ i >= bpp ? to_u8( current[i - bpp] ) : 0U };
+        const std::uint32_t b{ to_u8( above[i] ) };
+        const std::uint32_t c{ i >= bpp ? to_u8( above[i - bpp] ) : 0U };
+        costs[0] += signed_magnitude( x );
+        costs[1] += signed_magnitude( x - a );
+        costs[2] += signed_magnitude( x - b );
+        costs[3] += signed_magnitude( x - ( a + b ) / 2 );
+        costs[4] += signed_magnitude(
+            x
+            - paeth_predictor( static_cast<std::uint8_t>( a ),
+                               static_cast<std::uint8_t>( b ),
+                               static_cast<std::uint8_t>( c ) ) );
+    }
+}
+
+#if defined( __AVX2__ )
+
+// Paeth predictor of 16 bit lanes: a where |p - a| is smallest, then b,
+// then c, with |p - a| = |b - c|, |p - b| = |a - c| & |p - c| the
+// magnitude of their signed sum.
+__m256i
+paeth_predictor_avx2( const __m256i a, const __m256i b,
+                      const __m256i c ) noexcept {
+    const auto pa_signed{ _mm256_sub_epi16( b, c ) };
+    const auto pb_signed{ _mm256_sub_epi16( a, c ) };
+    const auto pa{ _mm256_abs_epi16( pa_signed ) };
+    const auto pb{ _mm256_abs_epi16( pb_signed ) };
+    const auto pc{ _mm256_abs_epi16( _mm256_add_epi16( pa_signed,
+                                                       pb_signed ) ) };
+    const auto not_a{ _mm256_or_si256( _mm256_cmpgt_epi16( pa, pb ),
+                                       _mm256_cmpgt_epi16( pa, pc ) ) };
+    const auto b_or_c{ _mm256_blendv_epi8( b, c,
+                                           _mm256_cmpgt_epi16( pb, pc ) ) };
+    return _mm256_blendv_epi8( a, b_or_c, not_a );
+}
+
+// 32 bytes per iteration: the five filtered vectors are formed from one
+// load each of the current & previous rows at i & i - bpp, and their
+// signed magnitudes (vpabsb) summed into 64 bit lanes by vpsadbw. Returns
+// the index reached, bytes from `first` on as the scalar path would.
+std::size_t
+filter_costs_avx2( const std::byte * const current,
+                   const std::byte * const above, const std::size_t first,
+                   const std::size_t size, const std::size_t bpp,
+                   filter_costs_t & costs ) noexcept {
+    constexpr std::size_t lanes{ 32 };
+    const auto            zero{ _mm256_setzero_si256() };
+    const auto            one{ _mm256_set1_epi8( 1 ) };
+    const auto            load = []( const std::byte * const p ) {
+        return _mm256_loadu_si256( reinterpret_cast<const __m256i *>( p ) );
+    };
+
+    // Sum of the signed magnitudes of `v`'s bytes added to `sum`
+    const auto accumulate = [zero]( const __m256i sum, const __m256i v ) {
+        return _mm256_add_epi64(
+            sum, _mm256_sad_epu8( _mm256_abs_epi8( v ), zero ) );
+    };
+
+    auto none_sum{ zero };
+    auto sub_sum{ zero };
+    auto up_sum{ zero };
+    auto average_sum{ zero };
+    auto paeth_sum{ zero };
+    auto i{ first };
+    for ( ; i + lanes <= size; i += lanes ) {
+        const auto x{ load( current + i ) };
+        const auto a{ load( current + i - bpp ) };
+        const auto b{ load( above + i ) };
+        const auto c{ load( above + i - bpp ) };
+
+        // vpavgb rounds up, the Average filter rounds down
+        const auto average{ _mm256_sub_epi8(
+            _mm256_avg_epu8( a, b ),
+            _mm256_and_si256( _mm256_xor_si256( a, b ), one ) ) };
+        const auto paeth{ _mm256_packus_epi16(
+            paeth_predictor_avx2( _mm256_unpacklo_epi8( a, zero ),
+                                  _mm256_unpacklo_epi8( b, zero ),
+                                  _mm256_unpacklo_epi8( c, zero ) ),
+            paeth_predictor_avx2( _mm256_unpackhi_epi8( a, zero ),
+                                  _mm256_unpackhi_epi8( b, zero ),
+                                  _mm256_unpackhi_epi8( c, zero ) ) ) };
+
+        none_sum = accumulate( none_sum, x );
+        sub_sum = accumulate( sub_sum, _mm256_sub_epi8( x, a ) );
+        up_sum = accumulate( up_sum, _mm256_sub_epi8( x, b ) );
+        average_sum = accumulate( average_sum, _mm256_sub_epi8( x, average ) );
+        paeth_sum = accumulate( paeth_sum, _mm256_sub_epi8( x, paeth ) );
+    }
+
+    const auto add_lanes = []( std::uint64_t & cost, const __m256i sum ) {
+        std::array<std::uint64_t, 4> lane_sums{};
+        _mm256_storeu_si256( reinterpret_cast<__m256i *>( lane_sums.data() ),
+                             sum );
+        for ( const auto lane_sum : lane_sums ) {
+            cost += lane_sum;
+        }
+    };
+    add_lanes( costs[0], none_sum );
+    add_lanes( costs[1], sub_sum );
+    add_lanes( costs[2], up_sum );
+    add_lanes( costs[3], average_sum );
+    add_lanes( costs[4], paeth_sum );
+    return i;
+}
+
+#endif
+
+} // namespace
+
+bool
+unfilter_row( const FilterType filter_type, const std::span<std::byte> row,
+              const std::span<const std::byte> previous_row,
+              const std::size_t                bytes_per_pixel ) noexcept {
+    assert( previous_row.size() >= row.size() );
+
+    const auto   size{ row.size() };
+    const auto   bpp{ std::min( bytes_per_pixel, size ) };
+    std::byte *  current{ row.data() };
+    const auto * above{ previous_row.data() };
+
+    switch ( filter_type ) {
+    case FilterType::NONE: break;
+    case FilterType::SUB: {
+        for ( std::size_t i{ bpp }; i < size; ++i ) {
+            current[i] = add_bytes( current[i], to_u8( current[i - bpp] ) );
+        }
+    } break;
+    case FilterType::UP: {
+        for ( std::size_t i{ 0 }; i < size; ++i ) {
+            current[i] = add_bytes( current[i], to_u8( above[i] ) );
+        }
+    } break;
+    case FilterType::AVERAGE: {
+        for ( std::size_t i{ 0 }; i < bpp; ++i ) {
+            current[i] = add_bytes( current[i], to_u8( above[i] ) / 2U );
+        }
+        for ( std::size_t i{ bpp }; i < size; ++i ) {
+            current[i] = add_bytes(
+                current[i],
+                ( std::uint32_t{ to_u8( current[i - bpp] ) } + to_u8( above[i] ) )
+                    / 2U );
+        }
+    } break;
+    case FilterType::PAETH: {
+        // With no left neighbour the predictor reduces to the byte above
+        for ( std::size_t i{ 0 }; i < bpp; ++i ) {
+            current[i] = add_bytes( current[i], to_u8( above[i] ) );
+        }
+        for ( std::size_t i{ bpp }; i < size; ++i ) {
+            current[i] = add_bytes(
+                current[i], paeth_predictor( to_u8( current[i - bpp] ),
+                                             to_u8( above[i] ),
+                                             to_u8( above[i - bpp] ) ) );
+        }
+    } break;
+        // clang-format off
+    COLD default: return false;
+        // clang-format on
+    }
+
+    return true;
+}
+
+bool
+filter_row( const FilterType filter_type, const std::span<const std::byte> row,
+            const std::span<const std::byte> previous_row,
+            const std::span<std::byte>       out,
+            const std::size_t                bytes_per_pixel ) noexcept {
+    assert( previous_row.size() >= row.size() && out.size() >= row.size() );
+
+    const auto   size{ row.size() };
+    const auto   bpp{ std::min( bytes_per_pixel, size ) };
+    const auto * current{ row.data() };
+    const auto * above{ previous_row.data() };
+    std::byte *  filtered{ out.data() };
+
+    switch ( filter_type ) {
+    case FilterType::NONE: {
+        std::copy_n( current, size, filtered );
+    } break;
+    case FilterType::SUB: {
+        std::copy_n( current, bpp, filtered );
+        for ( std::size_t i{ bpp }; i < size; ++i ) {
+            filtered[i] = subtract_bytes( current[i],
+                                          to_u8( current[i - bpp] ) );
+        }
+    } break;
+    case FilterType::UP: {
+        for ( std::size_t i{ 0 }; i < size; ++i ) {
+            filtered[i] = subtract_bytes( current[i], to_u8( above[i] ) );
+        }
+    } break;
+    case FilterType::AVERAGE: {
+        for ( std::size_t i{ 0 }; i < bpp; ++i ) {
+            filtered[i] = subtract_bytes( current[i], to_u8( above[i] ) / 2U );
+        }
+        for ( std::size_t i{ bpp }; i < size; ++i ) {
+            filtered[i] = subtract_bytes(
+                current[i],
+                ( std::uint32_t{ to_u8( current[i - bpp] ) } + to_u8( above[i] ) )
+                    / 2U );
+        }
+    } break;
+    case FilterType::PAETH: {
+        for ( std::size_t i{ 0 }; i < bpp; ++i ) {
+            filtered[i] = subtract_bytes( current[i], to_u8( above[i] ) );
+        }
+        for ( std::size_t i{ bpp }; i < size; ++i ) {
+            filtered[i] = subtract_bytes(
+                current[i], paeth_predictor( to_u8( current[i - bpp] ),
+                                             to_u8( above[i] ),
+                                             to_u8( above[i - bpp] ) ) );
+        }
+    } break;
+        // clang-format off
+    COLD default: return false;
+        // clang-format on
+    }
+
+    return true;
+}
+
+std::array<std::uint64_t, filter_type_count>
+filter_costs( const std::span<const std::byte> row,
+              const std::span<const std::byte> previous_row,
+              const std::size_t                bytes_per_pixel ) noexcept {
+    assert( previous_row.size() >= row.size() );
+
+    const auto     size{ row.size() };
+    const auto     bpp{ std::min( bytes_per_pixel, size ) };
+    filter_costs_t costs{};
+    // The first pixel has no left neighbour
+    filter_costs_scalar( row.data(), previous_row.data(), 0, bpp,
+                         bytes_per_pixel, costs );
+    auto i{ bpp };
+#if defined( __AVX2__ )
+    i = filter_costs_avx2( row.data(), previous_row.data(), i, size,
+                           bytes_per_pixel, costs );
+#endif
+    filter_costs_scalar( row.data(), previous_row.data(), i, size,
+                         bytes_per_pixel, costs );
+    return costs;
+}
+
+FilterType
+choose_filter( const std::span<const std::byte> row,
+               const std::span<const std::byte> previous_row,
+               const std::size_t                bytes_per_pixel ) noexcept {
+    const auto costs{ filter_costs( row, previous_row, bytes_per_pixel ) };
+    return static_cast<FilterType>(
+        std::ranges::min_element( costs ) - costs.begin() );
+}
+
+} // namespace IDAT
+
+} // namespace PNG
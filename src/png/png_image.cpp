@@ -0,0 +1,143 @@
+#include "png/png_image.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#if defined( __linux__ )
+#include <sys/mman.h>
+#endif
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::size_t
+round_up( const std::size_t value, const std::size_t multiple ) noexcept {
+    return ( value + multiple - 1 ) / multiple * multiple;
+}
+
+} // namespace
+
+void *
+HugePageResource::do_allocate( const std::size_t bytes,
+                               const std::size_t alignment ) {
+#if defined( __linux__ )
+    if ( bytes >= m_threshold && alignment <= huge_page_bytes ) {
+        const auto mapped_bytes{ round_up( bytes, huge_page_bytes ) };
+        auto *     p{ mmap( nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1,
+                            0 ) };
+        // No hugetlbfs pages reserved, fall back to transparent huge pages.
+        // Plain mappings are only page aligned, so map a huge page extra &
+        // trim to a huge page boundary, which both meets `alignment` &
+        // lets every page of the range be backed by a huge page.
+        if ( p == MAP_FAILED ) {
+            const auto padded_bytes{ mapped_bytes + huge_page_bytes };
+            auto *     padded{ mmap( nullptr, padded_bytes,
+                                     PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) };
+            if ( padded == MAP_FAILED ) {
+                throw std::bad_alloc();
+            }
+            const auto address{ reinterpret_cast<std::uintptr_t>( padded ) };
+            const auto head{ round_up( address, huge_page_bytes ) - address };
+            p = static_cast<std::byte *>( padded ) + head;
+            if ( head != 0 ) {
+                munmap( padded, head );
+            }
+            munmap( static_cast<std::byte *>( p ) + mapped_bytes,
+                    huge_page_bytes - head );
+            madvise( p, mapped_bytes, MADV_HUGEPAGE );
+        }
+        return p;
+    }
+#endif
+    return m_upstream->allocate( bytes, alignment );
+}
+
+void
+HugePageResource::do_deallocate( void * const p, const std::size_t bytes,
+                                 const std::size_t alignment ) {
+#if defined( __linux__ )
+    if ( bytes >= m_threshold && alignment <= huge_page_bytes ) {
+        munmap( p, round_up( bytes, huge_page_bytes ) );
+        return;
+    }
+#endif
+    m_upstream->deallocate( p, bytes, alignment );
+}
+
+bool
+HugePageResource::do_is_equal(
+    const std::pmr::memory_resource & other ) const noexcept {
+    const auto * huge{ dynamic_cast<const HugePageResource *>( &other ) };
+    return huge != nullptr && huge->m_threshold == m_threshold
+           && huge->m_upstream->is_equal( *m_upstream );
+}
+
+Image::Image( const std::uint32_t width, const std::uint32_t height,
+              const IHDR::ColourType      colour_type,
+              const IHDR::BitDepth        bit_depth,
+              const std::size_t           min_stride,
+              std::pmr::memory_resource * resource ) :
+    m_width( width ),
+    m_height( height ),
+    m_colour_type( colour_type ),
+    m_bit_depth( bit_depth ),
+    m_stride( 0 ),
+    m_resource( resource ),
+    m_data( nullptr ) {
+    if ( !IHDR::is_valid( colour_type, bit_depth ) ) {
+        throw png_error( png_error_t::BAD_IHDR );
+    }
+
+    m_stride = round_up( std::max( min_stride, layout().row_bytes() ),
+                         row_alignment );
+    if ( m_stride * m_height != 0 ) {
+        m_data = static_cast<std::byte *>(
+            m_resource->allocate( m_stride * m_height, row_alignment ) );
+    }
+}
+
+Image::~Image() { release(); }
+
+Image::Image( Image && other ) noexcept :
+    m_width( other.m_width ),
+    m_height( other.m_height ),
+    m_colour_type( other.m_colour_type ),
+    m_bit_depth( other.m_bit_depth ),
+    m_stride( other.m_stride ),
+    m_resource( other.m_resource ),
+    m_data( std::exchange( other.m_data, nullptr ) ) {
+    other.m_width = 0;
+    other.m_height = 0;
+}
+
+Image &
+Image::operator=( Image && other ) noexcept {
+    if ( this != &other ) {
+        release();
+        m_width = std::exchange( other.m_width, 0 );
+        m_height = std::exchange( other.m_height, 0 );
+        m_colour_type = other.m_colour_type;
+        m_bit_depth = other.m_bit_depth;
+        m_stride = other.m_stride;
+        m_resource = other.m_resource;
+        m_data = std::exchange( other.m_data, nullptr );
+    }
+    return *this;
+}
+
+void
+Image::release() noexcept {
+    if ( m_data != nullptr ) {
+        m_resource->deallocate( m_data, m_stride * m_height, row_alignment );
+        m_data = nullptr;
+    }
+}
+
+} // namespace PNG
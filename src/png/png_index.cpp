@@ -0,0 +1,230 @@
+#include "png/png_index.hpp"
+
+#include "common/common.hpp"
+#include "png/png_types.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::uint32_t index_magic{ 0x504E4758 }; // "PNGX"
+constexpr std::uint32_t index_version{ 1 };
+constexpr std::uint8_t  sync_index_version{ 1 };
+
+template <typename T>
+void
+append_integer( std::vector<std::byte> & out, const T value ) {
+    const auto bytes{ to_bytes<T, std::endian::native, std::endian::big>(
+        value ) };
+    out.insert( out.end(), bytes.begin(), bytes.end() );
+}
+
+void
+append_bytes( std::vector<std::byte> &         out,
+              const std::span<const std::byte> bytes ) {
+    append_integer( out, static_cast<std::uint32_t>( bytes.size() ) );
+    out.insert( out.end(), bytes.begin(), bytes.end() );
+}
+
+// IndexReader: bounds checked reads from a serialized index.
+class IndexReader
+{
+    public:
+    explicit IndexReader( const std::span<const std::byte> bytes ) noexcept :
+        m_bytes( bytes ) {}
+
+    template <typename T>
+    [[nodiscard]] T integer() {
+        return span_to_integer<T, std::endian::big>( take( sizeof( T ) ) );
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() {
+        return take( integer<std::uint32_t>() );
+    }
+
+    [[nodiscard]] std::span<const std::byte> take( const std::size_t count ) {
+        if ( count > m_bytes.size() ) {
+            throw png_error( png_error_t::BAD_INDEX );
+        }
+        const auto taken{ m_bytes.first( count ) };
+        m_bytes = m_bytes.subspan( count );
+        return taken;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return m_bytes.empty(); }
+
+    private:
+    std::span<const std::byte> m_bytes;
+};
+
+} // namespace
+
+const RowCheckpoint *
+DecodeIndex::nearest( const std::uint32_t row ) const noexcept {
+    // Checkpoints are ordered by row
+    const auto after{ std::ranges::upper_bound( m_checkpoints, row, {},
+                                                &RowCheckpoint::row ) };
+    return after == m_checkpoints.begin() ? nullptr : &*std::prev( after );
+}
+
+std::vector<std::byte>
+DecodeIndex::serialize() const {
+    std::vector<std::byte> out;
+    append_integer( out, index_magic );
+    append_integer( out, index_version );
+    append_integer( out, m_fingerprint );
+    append_integer( out, m_rows_per_checkpoint );
+    append_integer( out, static_cast<std::uint32_t>( m_checkpoints.size() ) );
+
+    for ( const auto & [row, previous_row, inflate] : m_checkpoints ) {
+        append_integer( out, row );
+        append_bytes( out, previous_row );
+        append_integer( out, inflate.bit_position );
+        append_integer( out, inflate.total_out );
+        append_integer( out, inflate.adler );
+        append_integer( out, inflate.stored_remaining );
+        append_integer( out, inflate.match_remaining );
+        append_integer( out, inflate.match_distance );
+        append_integer( out, inflate.literal_count );
+        append_integer( out, inflate.distance_count );
+        append_integer( out, inflate.state );
+        append_integer( out, static_cast<std::uint8_t>( inflate.final_block ) );
+        append_integer( out,
+                        static_cast<std::uint8_t>( inflate.zlib_wrapped ) );
+        for ( const auto length : inflate.code_lengths ) {
+            append_integer( out, length );
+        }
+        append_bytes( out, inflate.window );
+    }
+
+    return out;
+}
+
+DecodeIndex
+DecodeIndex::deserialize( const std::span<const std::byte> bytes ) {
+    IndexReader reader{ bytes };
+    if ( reader.integer<std::uint32_t>() != index_magic
+         || reader.integer<std::uint32_t>() != index_version ) {
+        throw png_error( png_error_t::BAD_INDEX );
+    }
+
+    const auto fingerprint{ reader.integer<std::uint32_t>() };
+    const auto rows_per_checkpoint{ reader.integer<std::uint32_t>() };
+    const auto count{ reader.integer<std::uint32_t>() };
+
+    std::vector<RowCheckpoint> checkpoints;
+    for ( std::uint32_t i{ 0 }; i < count; ++i ) {
+        RowCheckpoint checkpoint{};
+        checkpoint.row = reader.integer<std::uint32_t>();
+        const auto previous_row{ reader.bytes() };
+        checkpoint.previous_row.assign( previous_row.begin(),
+                                        previous_row.end() );
+
+        auto & inflate{ checkpoint.inflate };
+        inflate.bit_position = reader.integer<std::uint64_t>();
+        inflate.total_out = reader.integer<std::uint64_t>();
+        inflate.adler = reader.integer<std::uint32_t>();
+        inflate.stored_remaining = reader.integer<std::uint32_t>();
+        inflate.match_remaining = reader.integer<std::uint32_t>();
+        inflate.match_distance = reader.integer<std::uint32_t>();
+        inflate.literal_count = reader.integer<std::uint16_t>();
+        inflate.distance_count = reader.integer<std::uint16_t>();
+        inflate.state = reader.integer<std::uint8_t>();
+        inflate.final_block = reader.integer<std::uint8_t>() != 0;
+        inflate.zlib_wrapped = reader.integer<std::uint8_t>() != 0;
+        for ( auto & length : inflate.code_lengths ) {
+            length = reader.integer<std::uint8_t>();
+        }
+        const auto window{ reader.bytes() };
+        inflate.window.assign( window.begin(), window.end() );
+
+        if ( !checkpoints.empty()
+             && checkpoint.row <= checkpoints.back().row ) {
+            throw png_error( png_error_t::BAD_INDEX );
+        }
+        checkpoints.push_back( std::move( checkpoint ) );
+    }
+
+    if ( !reader.empty() ) {
+        throw png_error( png_error_t::BAD_INDEX );
+    }
+    return DecodeIndex{ fingerprint, rows_per_checkpoint,
+                        std::move( checkpoints ) };
+}
+
+void
+DecodeIndex::save( const std::filesystem::path & path ) const {
+    const auto    bytes{ serialize() };
+    std::ofstream out_file{ path, std::ios::binary | std::ios::trunc };
+    out_file.write( reinterpret_cast<const char *>( bytes.data() ),
+                    static_cast<std::streamsize>( bytes.size() ) );
+    if ( !out_file ) {
+        throw png_error( png_error_t::BAD_INDEX );
+    }
+}
+
+DecodeIndex
+DecodeIndex::load( const std::filesystem::path & path ) {
+    std::ifstream in_file{ path, std::ios::binary };
+    if ( !in_file ) {
+        throw png_error( png_error_t::BAD_INDEX );
+    }
+    const std::vector<char> chars{ std::istreambuf_iterator<char>( in_file ),
+                                   std::istreambuf_iterator<char>() };
+    return deserialize( std::as_bytes( std::span{ chars } ) );
+}
+
+std::vector<std::byte>
+SyncIndex::serialize() const {
+    std::vector<std::byte> out;
+    append_integer( out, sync_index_version );
+    append_integer( out, rows_per_segment );
+    for ( const auto offset : offsets ) {
+        append_integer( out, offset );
+    }
+    return out;
+}
+
+SyncIndex
+SyncIndex::parse( const std::span<const std::byte> data ) {
+    auto index{ try_parse( data ) };
+    if ( !index.has_value() ) {
+        throw png_error( index.error() );
+    }
+    return std::move( *index );
+}
+
+std::expected<SyncIndex, png_error_t>
+SyncIndex::try_parse( const std::span<const std::byte> data ) {
+    constexpr std::size_t fixed_bytes{ sizeof( sync_index_version )
+                                       + sizeof( rows_per_segment ) };
+    constexpr std::size_t offset_bytes{ sizeof( std::uint64_t ) };
+    if ( data.size() < fixed_bytes
+         || ( data.size() - fixed_bytes ) % offset_bytes != 0
+         || std::to_integer<std::uint8_t>( data[0] ) != sync_index_version ) {
+        return std::unexpected( png_error_t::BAD_INDEX );
+    }
+
+    SyncIndex index{};
+    index.rows_per_segment = span_to_integer<std::uint32_t, std::endian::big>(
+        data.subspan( 1, sizeof( rows_per_segment ) ) );
+    index.offsets.reserve( ( data.size() - fixed_bytes ) / offset_bytes );
+    for ( std::size_t position{ fixed_bytes }; position < data.size();
+          position += offset_bytes ) {
+        const auto offset{ span_to_integer<std::uint64_t, std::endian::big>(
+            data.subspan( position, offset_bytes ) ) };
+        if ( !index.offsets.empty() && offset <= index.offsets.back() ) {
+            return std::unexpected( png_error_t::BAD_INDEX );
+        }
+        index.offsets.push_back( offset );
+    }
+    return index;
+}
+
+} // namespace PNG
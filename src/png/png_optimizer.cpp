@@ -0,0 +1,465 @@
+#include "png/png_optimizer.hpp"
+
+#include "common/parallel.hpp"
+#include "png/png_convert.hpp"
+#include "png/png_decoder.hpp"
+#include "png/png_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace PNG
+{
+
+namespace
+{
+
+using rgba_t = std::array<std::uint16_t, 4>;
+
+// Pixels widened to RGBA samples of `bit_depth` (8 or 16) bits, colour key
+// transparency folded into alpha.
+struct RgbaImage
+{
+    std::uint32_t       width;
+    std::uint32_t       height;
+    IHDR::BitDepth      bit_depth;
+    std::vector<rgba_t> pixels;
+};
+
+// Factor between greyscale samples of `bit_depth` bits & 8 bit ones, 1 for
+// 8 & 16 bits.
+constexpr std::uint16_t
+grey_scale( const IHDR::BitDepth bit_depth ) noexcept {
+    return bit_depth < 8 ? CONVERT::full_range_scale( bit_depth ) : 1;
+}
+
+// Colour key of a greyscale or truecolour tRNS chunk, in samples of the
+// image's own bit depth.
+std::optional<rgba_t>
+colour_key( const std::span<const std::byte> transparency,
+            const std::uint8_t               channels ) {
+    if ( transparency.size() != 2 * std::size_t{ channels } ) {
+        return std::nullopt;
+    }
+    rgba_t key{};
+    for ( std::size_t channel{ 0 }; channel < channels; ++channel ) {
+        key[channel] = CONVERT::read_sample( transparency, channel, 16 );
+    }
+    return key;
+}
+
+RgbaImage
+to_rgba( PngDecoder & decoder ) {
+    const auto & header{ decoder.header() };
+    const auto   colour_type{ header.getColourType() };
+    const auto   bit_depth{ header.getBitDepth() };
+    RgbaImage    image{ header.getWidth(), header.getHeight(),
+                     static_cast<IHDR::BitDepth>( bit_depth == 16 ? 16 : 8 ),
+                     {} };
+    image.pixels.resize( std::size_t{ image.width } * image.height );
+
+    if ( colour_type == IHDR::ColourType::INDEXED_COLOUR ) {
+        const auto                   indexed{ decoder.decode_indexed() };
+        const CONVERT::PaletteLookup lookup{ indexed.palette,
+                                             indexed.transparency };
+        std::ranges::transform(
+            indexed.indices, image.pixels.begin(), [&]( const std::byte i ) {
+                const auto index{ std::to_integer<std::size_t>( i ) };
+                return rgba_t{ lookup.red[index], lookup.green[index],
+                               lookup.blue[index], lookup.alpha[index] };
+            } );
+        return image;
+    }
+
+    const auto data{ decoder.decode() };
+    const auto channels{ IHDR::channel_count( colour_type ) };
+    const auto has_colour{ channels >= 3 };
+    const auto has_alpha{ channels % 2 == 0 };
+    const auto key{ has_alpha ?
+                        std::nullopt :
+                        colour_key( decoder.transparency(), channels ) };
+    const auto row_bytes{ IHDR::scanline_bytes( image.width, colour_type,
+                                                bit_depth ) };
+    // Sub-byte greyscale is stretched to 8 bits
+    const auto scale{ grey_scale( bit_depth ) };
+    const auto opaque{ static_cast<std::uint16_t>(
+        ( 1U << image.bit_depth ) - 1 ) };
+
+    auto pixel{ image.pixels.begin() };
+    for ( std::uint32_t y{ 0 }; y < image.height; ++y ) {
+        const auto row{ std::span{ data }.subspan( y * row_bytes,
+                                                   row_bytes ) };
+        for ( std::uint32_t x{ 0 }; x < image.width; ++x, ++pixel ) {
+            rgba_t samples{};
+            for ( std::size_t channel{ 0 }; channel < channels; ++channel ) {
+                samples[channel] = CONVERT::read_sample(
+                    row, std::size_t{ x } * channels + channel, bit_depth );
+            }
+            const auto keyed{ key
+                              && std::ranges::equal(
+                                  std::span{ samples }.first( channels ),
+                                  std::span{ *key }.first( channels ) ) };
+            const auto grey{ static_cast<std::uint16_t>( samples[0]
+                                                         * scale ) };
+            *pixel = has_colour ? rgba_t{ samples[0], samples[1], samples[2],
+                                          has_alpha ? samples[3] : opaque } :
+                                  rgba_t{ grey, grey, grey,
+                                          has_alpha ? samples[1] : opaque };
+            if ( keyed ) {
+                ( *pixel )[3] = 0;
+            }
+        }
+    }
+    return image;
+}
+
+// Lowers 16 bit samples to 8 bits if each is one byte repeated.
+void
+reduce_depth( RgbaImage & image ) {
+    if ( image.bit_depth != 16
+         || !std::ranges::all_of( image.pixels, []( const rgba_t & pixel ) {
+                return std::ranges::all_of( pixel, []( const auto sample ) {
+                    return sample >> byte_bits == ( sample & 0xFF );
+                } );
+            } ) ) {
+        return;
+    }
+    for ( auto & pixel : image.pixels ) {
+        for ( auto & sample : pixel ) {
+            sample = static_cast<std::uint16_t>( sample >> byte_bits );
+        }
+    }
+    image.bit_depth = 8;
+}
+
+// What the pixels of an RgbaImage need to be represented exactly.
+struct PixelUse
+{
+    bool opaque{ true };
+    bool grey{ true };
+    // Lowest bit depth holding every grey sample, 8 bit images only
+    IHDR::BitDepth grey_depth{ 8 };
+    // RGB of the transparent pixels, if tRNS can stand in for alpha
+    std::optional<rgba_t> key;
+    // Distinct pixels in order of appearance, 8 bit images with at most
+    // 256 only
+    std::vector<rgba_t> colours;
+};
+
+constexpr std::uint64_t
+pack_rgba( const rgba_t & pixel ) noexcept {
+    return std::uint64_t{ pixel[0] } << 48 | std::uint64_t{ pixel[1] } << 32
+           | std::uint64_t{ pixel[2] } << 16 | pixel[3];
+}
+
+PixelUse
+pixel_use( const RgbaImage & image ) {
+    constexpr std::size_t max_colours{ 256 };
+    constexpr std::array<IHDR::BitDepth, 3> grey_depths{ 1, 2, 4 };
+
+    const auto max_sample{ static_cast<std::uint16_t>(
+        ( 1U << image.bit_depth ) - 1 ) };
+    PixelUse use{};
+    use.grey_depth = image.bit_depth;
+    std::array<bool, grey_depths.size()> fits_depth{ true, true, true };
+    // Alpha is only ever 0 or opaque, & transparent pixels share a colour
+    auto keyable{ true };
+    auto count_colours{ image.bit_depth == 8 };
+    std::unordered_set<std::uint64_t> seen;
+    // Runs of one colour are only looked up once
+    std::optional<rgba_t> last_pixel;
+
+    for ( const auto & pixel : image.pixels ) {
+        const auto [red, green, blue, alpha]{ pixel };
+        use.opaque = use.opaque && alpha == max_sample;
+        use.grey = use.grey && red == green && green == blue;
+        for ( std::size_t i{ 0 }; i < grey_depths.size(); ++i ) {
+            fits_depth[i] = fits_depth[i]
+                            && red % CONVERT::full_range_scale(
+                                         grey_depths[i] )
+                                   == 0;
+        }
+        if ( alpha == 0 ) {
+            if ( !use.key ) {
+                use.key = rgba_t{ red, green, blue, 0 };
+            }
+            keyable = keyable && *use.key == pixel;
+        }
+        else {
+            keyable = keyable && alpha == max_sample;
+        }
+        if ( count_colours && pixel != last_pixel
+             && seen.insert( pack_rgba( pixel ) ).second ) {
+            use.colours.push_back( pixel );
+            count_colours = use.colours.size() <= max_colours;
+        }
+        last_pixel = pixel;
+    }
+
+    // The key colour mustn't also be used by opaque pixels
+    if ( keyable && use.key ) {
+        const rgba_t shown{ ( *use.key )[0], ( *use.key )[1], ( *use.key )[2],
+                            max_sample };
+        keyable = std::ranges::find( image.pixels, shown )
+                  == image.pixels.end();
+    }
+    if ( !keyable || use.opaque ) {
+        use.key.reset();
+    }
+    if ( use.grey && image.bit_depth == 8 ) {
+        const auto fit{ std::ranges::find( fits_depth, true ) };
+        if ( fit != fits_depth.end() ) {
+            use.grey_depth = grey_depths[static_cast<std::size_t>(
+                fit - fits_depth.begin() )];
+        }
+    }
+    if ( !count_colours ) {
+        use.colours.clear();
+    }
+    return use;
+}
+
+// Packs the samples `samples` gives for each pixel, the first channel_count
+// of them, into rows of the reduction's colour type & bit depth.
+template <typename Samples>
+void
+pack_pixels( const RgbaImage & image, ReducedImage & reduction,
+             const Samples & samples ) {
+    const auto channels{ IHDR::channel_count( reduction.colour_type ) };
+    const auto row_bytes{ IHDR::scanline_bytes(
+        image.width, reduction.colour_type, reduction.bit_depth ) };
+    reduction.pixels.assign( row_bytes * image.height, std::byte{ 0 } );
+
+    auto pixel{ image.pixels.begin() };
+    for ( std::uint32_t y{ 0 }; y < image.height; ++y ) {
+        const auto row{ std::span{ reduction.pixels }.subspan( y * row_bytes,
+                                                               row_bytes ) };
+        for ( std::uint32_t x{ 0 }; x < image.width; ++x, ++pixel ) {
+            const rgba_t values{ samples( *pixel ) };
+            for ( std::size_t channel{ 0 }; channel < channels; ++channel ) {
+                CONVERT::write_sample( row,
+                                       std::size_t{ x } * channels + channel,
+                                       values[channel], reduction.bit_depth );
+            }
+        }
+    }
+}
+
+// Greyscale or truecolour, with alpha only if it can't be dropped or keyed.
+ReducedImage
+direct_reduction( const RgbaImage & image, const PixelUse & use ) {
+    const auto   alpha{ !use.opaque && !use.key };
+    ReducedImage reduction{
+        image.width,
+        image.height,
+        use.grey ? ( alpha ? IHDR::ColourType::GREYSCALE_ALPHA :
+                             IHDR::ColourType::GREYSCALE ) :
+                   ( alpha ? IHDR::ColourType::TRUE_COLOUR_ALPHA :
+                             IHDR::ColourType::TRUE_COLOUR ),
+        use.grey && !alpha ? use.grey_depth : image.bit_depth,
+        std::nullopt,
+        {},
+        {}
+    };
+    const auto scale{ grey_scale( reduction.bit_depth ) };
+
+    if ( use.key ) {
+        const auto key_channels{ use.grey ? 1U : 3U };
+        reduction.transparency.resize( 2 * key_channels );
+        for ( std::size_t channel{ 0 }; channel < key_channels; ++channel ) {
+            CONVERT::write_sample(
+                reduction.transparency, channel,
+                static_cast<std::uint16_t>( ( *use.key )[channel] / scale ),
+                16 );
+        }
+    }
+    pack_pixels( image, reduction, [&]( const rgba_t & pixel ) {
+        return use.grey ? rgba_t{ static_cast<std::uint16_t>( pixel[0]
+                                                              / scale ),
+                                  pixel[3], 0, 0 } :
+                          pixel;
+    } );
+    return reduction;
+}
+
+// Indexed colour, translucent entries first so tRNS can stop at the last.
+ReducedImage
+indexed_reduction( const RgbaImage & image, const PixelUse & use ) {
+    auto colours{ use.colours };
+    std::ranges::stable_partition( colours, []( const rgba_t & colour ) {
+        return colour[3] != 0xFF;
+    } );
+    const auto entries{ colours.size() };
+    const auto bit_depth{ static_cast<IHDR::BitDepth>(
+        entries <= 2 ? 1 : ( entries <= 4 ? 2 : ( entries <= 16 ? 4 : 8 ) ) ) };
+
+    std::vector<PLTE::Palette>                       palette;
+    std::unordered_map<std::uint64_t, std::uint16_t> indices;
+    std::vector<std::byte>                           transparency;
+    for ( const auto & colour : colours ) {
+        indices.emplace( pack_rgba( colour ),
+                         static_cast<std::uint16_t>( palette.size() ) );
+        palette.push_back(
+            PLTE::Palette{ .red = static_cast<PLTE::colour_t>( colour[0] ),
+                           .green = static_cast<PLTE::colour_t>( colour[1] ),
+                           .blue = static_cast<PLTE::colour_t>( colour[2] ) } );
+        if ( colour[3] != 0xFF ) {
+            transparency.push_back( static_cast<std::byte>( colour[3] ) );
+        }
+    }
+
+    ReducedImage reduction{ image.width,
+                            image.height,
+                            IHDR::ColourType::INDEXED_COLOUR,
+                            bit_depth,
+                            std::optional<PLTE::PlteChunkPayload>{
+                                std::in_place, palette },
+                            std::move( transparency ),
+                            {} };
+    pack_pixels( image, reduction, [&]( const rgba_t & pixel ) {
+        return rgba_t{ indices.at( pack_rgba( pixel ) ), 0, 0, 0 };
+    } );
+    return reduction;
+}
+
+// One encoding tried by optimize()
+struct Trial
+{
+    std::size_t            reduction;
+    IDAT::FilterType       filter;
+    bool                   adaptive_filter;
+    ZLIB::CompressionLevel level;
+};
+
+std::vector<std::byte>
+encode_trial( const ReducedImage & reduction, const Trial & trial ) {
+    const IHDR::IhdrChunkPayload header{
+        reduction.width,
+        reduction.height,
+        reduction.bit_depth,
+        reduction.colour_type,
+        IHDR::CompressionMethod::COMPRESSION_METHOD_0,
+        IHDR::FilterMethod::FILTER_METHOD_0,
+        IHDR::InterlaceMethod::NO_INTERLACE
+    };
+    EncodeOptions options{};
+    options.level = trial.level;
+    options.filter = trial.filter;
+    options.adaptive_filter = trial.adaptive_filter;
+
+    std::vector<std::byte> png;
+    PngEncoder             encoder{ header, buffer_sink( png ), options };
+    if ( reduction.palette ) {
+        std::vector<PLTE::Palette> palette;
+        for ( std::size_t i{ 0 }; i < reduction.palette->getEntries(); ++i ) {
+            palette.push_back( ( *reduction.palette )[i] );
+        }
+        encoder.write_palette( palette );
+    }
+    if ( !reduction.transparency.empty() ) {
+        encoder.write_transparency( reduction.transparency );
+    }
+    encoder.write_rows( reduction.pixels );
+    encoder.finish();
+    return png;
+}
+
+} // namespace
+
+std::vector<ReducedImage>
+lossless_reductions( const std::span<const std::byte> png ) {
+    PngDecoder decoder{ png };
+    auto       image{ to_rgba( decoder ) };
+    reduce_depth( image );
+    const auto use{ pixel_use( image ) };
+
+    std::vector<ReducedImage> reductions;
+    reductions.push_back( direct_reduction( image, use ) );
+    if ( !use.colours.empty() ) {
+        reductions.push_back( indexed_reduction( image, use ) );
+    }
+    return reductions;
+}
+
+OptimizeResult
+optimize( const std::span<const std::byte> png,
+          const OptimizeOptions &          options ) {
+    const auto reductions{ lossless_reductions( png ) };
+
+    std::vector<Trial> trials;
+    for ( std::size_t r{ 0 }; r < reductions.size(); ++r ) {
+        // As EncodeOptions::adaptive_filter, which ignores these
+        const auto adaptive{ options.adaptive_filter
+                             && reductions[r].colour_type
+                                    != IHDR::ColourType::INDEXED_COLOUR
+                             && reductions[r].bit_depth >= 8 };
+        for ( const auto level : options.levels ) {
+            for ( const auto filter : options.filters ) {
+                trials.push_back( Trial{ r, filter, false, level } );
+            }
+            if ( adaptive ) {
+                trials.push_back(
+                    Trial{ r, IDAT::FilterType::NONE, true, level } );
+            }
+        }
+    }
+    if ( trials.empty() ) {
+        throw png_error( png_error_t::BAD_ENCODE );
+    }
+
+    PARALLEL::WorkerPool pool{ PARALLEL::worker_count( options.threads,
+                                                       trials.size() ) };
+
+    // Each worker keeps its smallest encoding, the earliest trial on ties,
+    // so the result doesn't depend on how trials were shared out
+    constexpr auto no_trial{ std::numeric_limits<std::size_t>::max() };
+    std::vector<std::size_t>            best_trial( pool.size(), no_trial );
+    std::vector<std::vector<std::byte>> best_png( pool.size() );
+    pool.run( trials.size(), [&]( const std::size_t trial,
+                                  const std::size_t worker ) {
+        auto encoded{ encode_trial( reductions[trials[trial].reduction],
+                                    trials[trial] ) };
+        if ( best_trial[worker] == no_trial
+             || encoded.size() < best_png[worker].size() ) {
+            best_trial[worker] = trial;
+            best_png[worker] = std::move( encoded );
+        }
+    } );
+
+    std::size_t best{ 0 };
+    for ( std::size_t worker{ 1 }; worker < pool.size(); ++worker ) {
+        const auto size{ best_png[worker].size() };
+        if ( best_trial[worker] == no_trial ) {
+            continue;
+        }
+        if ( best_trial[best] == no_trial || size < best_png[best].size()
+             || ( size == best_png[best].size()
+                  && best_trial[worker] < best_trial[best] ) ) {
+            best = worker;
+        }
+    }
+
+    const auto & trial{ trials[best_trial[best]] };
+    const auto & reduction{ reductions[trial.reduction] };
+    OptimizeResult result{ std::move( best_png[best] ),
+                           reduction.colour_type,
+                           reduction.bit_depth,
+                           trial.filter,
+                           trial.adaptive_filter,
+                           trial.level,
+                           trials.size(),
+                           true };
+    if ( result.png.size() >= png.size() ) {
+        const PngDecoder decoder{ png };
+        result.png.assign( png.begin(), png.end() );
+        result.colour_type = decoder.header().getColourType();
+        result.bit_depth = decoder.header().getBitDepth();
+        result.reduced = false;
+    }
+    return result;
+}
+
+} // namespace PNG
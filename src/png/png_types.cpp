@@ -45,8 +45,14 @@ operator<<( std::ostream & out_stream, const PngChunkType chunk_type ) {
     case PngChunkType::tEXt: [[fallthrough]];
     case PngChunkType::tIME: [[fallthrough]];
     case PngChunkType::tRNS: [[fallthrough]];
-    case PngChunkType::zTXt: {
+    case PngChunkType::zTXt: [[fallthrough]];
+    case PngChunkType::acTL: [[fallthrough]];
+    case PngChunkType::fcTL: [[fallthrough]];
+    case PngChunkType::fdAT: {
         out_stream << " (ancillary)";
+    } break;
+    case PngChunkType::syNc: {
+        out_stream << " (ancillary, private)";
     } break;
         // clang-format off
     COLD default : {
@@ -87,6 +93,12 @@ operator<<( std::ostream & out_stream, const PngPixelFormat pixel_format ) {
     return out_stream;
 }
 
+std::ostream &
+operator<<( std::ostream & out_stream, const png_error_t error ) {
+    return out_stream << std::format( "{} ({})", error_message( error ),
+                                      static_cast<std::uint32_t>( error ) );
+}
+
 namespace IHDR
 {
 
@@ -229,4 +241,37 @@ operator<<( std::ostream & out_stream, const Palette palette ) {
 
 } // namespace PLTE
 
+namespace IDAT
+{
+
+std::ostream &
+operator<<( std::ostream & out_stream, const FilterType filter_type ) {
+    switch ( filter_type ) {
+    case FilterType::NONE: {
+        return out_stream << "NONE (0)";
+    } break;
+    case FilterType::SUB: {
+        return out_stream << "SUB (1)";
+    } break;
+    case FilterType::UP: {
+        return out_stream << "UP (2)";
+    } break;
+    case FilterType::AVERAGE: {
+        return out_stream << "AVERAGE (3)";
+    } break;
+    case FilterType::PAETH: {
+        return out_stream << "PAETH (4)";
+    } break;
+        // clang-format off
+    COLD default: {
+        return out_stream << std::format(
+                   "INVALID FilterType ({})",
+                   static_cast<std::uint32_t>( filter_type ) );
+    }
+        // clang-format on
+    }
+}
+
+} // namespace IDAT
+
 } // namespace PNG
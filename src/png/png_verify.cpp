@@ -0,0 +1,248 @@
+#include "png/png_verify.hpp"
+
+#include "common/crc.hpp"
+#include "common/inflate.hpp"
+#include "common/metrics.hpp"
+#include "png/png_chunk_order.hpp"
+#include "png/png_chunk_payload.hpp"
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#if defined( __linux__ )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PNG
+{
+
+namespace
+{
+
+constexpr std::size_t   ihdr_payload_bytes{ 13 };
+constexpr std::size_t   max_palette_entries{ 256 };
+constexpr std::uint32_t max_chunk_length{ 0x7FFF'FFFF };
+// Inflated image data is written here & dropped
+constexpr std::size_t discard_bytes{ std::size_t{ 1 } << 15 };
+
+// tRNS data length for colour types that take a single transparent colour,
+// 0 for those with an alpha channel, which can't have a tRNS chunk
+constexpr std::size_t
+transparency_bytes( const IHDR::ColourType colour_type ) noexcept {
+    switch ( colour_type ) {
+    case IHDR::ColourType::GREYSCALE: return 2;
+    case IHDR::ColourType::TRUE_COLOUR: return 6;
+    default: return 0;
+    }
+}
+
+// What the chunk headers & critical chunks say about the image.
+struct Layout
+{
+    VerifyResult                          result;
+    std::optional<IHDR::IhdrChunkPayload> ihdr;
+    std::vector<ZLIB::segment_t>          idat;
+    std::size_t                           first_idat{ 0 };
+    // Offset just past IEND
+    std::size_t end{ 0 };
+};
+
+// Walks the chunk headers of `png`, checking the chunk layout, ordering &
+// the critical chunk payloads, but no CRCs. Trailing data after IEND is
+// caught here, the validator only sees whole chunks.
+Layout
+read_layout( const std::span<const std::byte> png ) {
+    Layout layout{};
+    const auto fail = [&]( const png_error_t error,
+                           const std::size_t offset ) {
+        layout.result = { error, offset };
+        return std::move( layout );
+    };
+
+    ChunkOrderValidator order{};
+    std::size_t         palette_entries{ 0 };
+    std::size_t         offset{ png_signature_bytes };
+    while ( layout.end == 0 ) {
+        if ( png.size() - offset < chunk_overhead_bytes ) {
+            return fail( png_error_t::TRUNCATED_CHUNK, offset );
+        }
+        const auto length{ span_to_integer<std::uint32_t, std::endian::big>(
+            png.subspan( offset, 4 ) ) };
+        if ( length > max_chunk_length
+             || length > png.size() - offset - chunk_overhead_bytes ) {
+            return fail( png_error_t::TRUNCATED_CHUNK, offset );
+        }
+        const auto type{ static_cast<PngChunkType>(
+            span_to_integer<std::uint32_t, std::endian::big>(
+                png.subspan( offset + 4, 4 ) ) ) };
+        const auto data{ png.subspan( offset + 8, length ) };
+        if ( const auto error{ order.next( type ) };
+             error != png_error_t::NONE ) {
+            return fail( error, offset );
+        }
+
+        if ( type == PngChunkType::IHDR ) {
+            if ( data.size() != ihdr_payload_bytes ) {
+                return fail( png_error_t::BAD_IHDR, offset );
+            }
+            layout.ihdr.emplace( data );
+            if ( !layout.ihdr->isValid() ) {
+                return fail( png_error_t::BAD_IHDR, offset );
+            }
+            order.set_colour_type( layout.ihdr->getColourType() );
+        }
+        else if ( type == PngChunkType::PLTE ) {
+            palette_entries = data.size() / sizeof( PLTE::Palette );
+            if ( data.size() % sizeof( PLTE::Palette ) != 0
+                 || palette_entries == 0
+                 || palette_entries > max_palette_entries ) {
+                return fail( png_error_t::BAD_PLTE, offset );
+            }
+        }
+        else if ( type == PngChunkType::tRNS ) {
+            const auto colour_type{ layout.ihdr->getColourType() };
+            const auto expected{ transparency_bytes( colour_type ) };
+            if ( colour_type == IHDR::ColourType::INDEXED_COLOUR ?
+                     data.size() > palette_entries :
+                     expected == 0 || data.size() != expected ) {
+                return fail( png_error_t::BAD_TRNS, offset );
+            }
+        }
+        else if ( type == PngChunkType::IDAT ) {
+            if ( layout.idat.empty() ) {
+                layout.first_idat = offset;
+            }
+            layout.idat.emplace_back( data );
+        }
+
+        offset += chunk_overhead_bytes + length;
+        if ( type == PngChunkType::IEND ) {
+            layout.end = offset;
+        }
+    }
+
+    if ( layout.end != png.size() ) {
+        return fail( png_error_t::BAD_CHUNK_ORDER, layout.end );
+    }
+    return layout;
+}
+
+// Offset of the first chunk in [signature, end) whose CRC doesn't match,
+// or `end` if all do. The chunk headers must already have been checked.
+std::size_t
+first_bad_crc( const std::span<const std::byte> png, const std::size_t end ) {
+    CRC::CrcTable32 crc_calculator(
+        CRC::PNG::png_polynomial<std::endian::big>() );
+    for ( std::size_t offset{ png_signature_bytes }; offset < end; ) {
+        const auto length{ span_to_integer<std::uint32_t, std::endian::big>(
+            png.subspan( offset, 4 ) ) };
+        const auto crc{ span_to_integer<std::uint32_t, std::endian::big>(
+            png.subspan( offset + 8 + length, 4 ) ) };
+        // CRC covers the chunk type & data
+        if ( crc_calculator.crc( png.subspan( offset + 4, length + 4 ) )
+                 .to_ulong()
+             != crc ) {
+            return offset;
+        }
+        offset += chunk_overhead_bytes + length;
+    }
+    return end;
+}
+
+// True if the zlib stream of `idat` is valid, Adler-32 included, & holds
+// exactly `expected` bytes.
+bool
+inflates_to( const std::span<const ZLIB::segment_t> idat,
+             const std::uint64_t                    expected ) noexcept {
+    ZLIB::Inflater inflater{};
+    inflater.reset( idat );
+    std::array<std::byte, discard_bytes> discard;
+    std::uint64_t                        produced{ 0 };
+    std::size_t                          count{ 0 };
+    do {
+        count = inflater.read( discard );
+        produced += count;
+    } while ( count == discard.size() && produced <= expected );
+
+    return produced == expected
+           && inflater.finish() == ZLIB::inflate_status_t::STREAM_END;
+}
+
+} // namespace
+
+VerifyResult
+verify_png( const std::span<const std::byte> png ) {
+    if ( png.size() < png_signature_bytes
+         || span_to_integer<std::uint64_t, std::endian::big>(
+                png.first( png_signature_bytes ) )
+                != png_signature ) {
+        return { png_error_t::BAD_HEADER, 0 };
+    }
+
+    const auto layout{ read_layout( png ) };
+    if ( layout.result.error != png_error_t::NONE ) {
+        return layout.result;
+    }
+
+    const auto bad_crc{ first_bad_crc( png, layout.end ) };
+    if ( bad_crc != layout.end ) {
+        return { png_error_t::BAD_CRC, bad_crc };
+    }
+    if ( !inflates_to( layout.idat,
+                       IHDR::image_data_bytes( *layout.ihdr ) ) ) {
+        return { png_error_t::BAD_IMAGE_DATA, layout.first_idat };
+    }
+    return {};
+}
+
+#if defined( __linux__ )
+VerifyResult
+verify_png( const std::filesystem::path & path ) {
+    void *      p{ nullptr };
+    std::size_t size{ 0 };
+    {
+        METRICS::StageTimer read_timer{ nullptr, METRICS::stage_t::READ };
+        const auto fd{ ::open( path.c_str(), O_RDONLY | O_CLOEXEC ) };
+        if ( fd < 0 ) {
+            return { png_error_t::READ_FAILED, 0 };
+        }
+        struct stat status
+        {};
+        if ( ::fstat( fd, &status ) != 0 ) {
+            ::close( fd );
+            return { png_error_t::READ_FAILED, 0 };
+        }
+        // An empty file can't be mapped, & fails as too short for a PNG
+        size = static_cast<std::size_t>( status.st_size );
+        if ( size == 0 ) {
+            ::close( fd );
+            return verify_png( std::span<const std::byte>{} );
+        }
+        p = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+        if ( p == MAP_FAILED ) {
+            return { png_error_t::READ_FAILED, 0 };
+        }
+        ::madvise( p, size, MADV_SEQUENTIAL );
+        read_timer.set_bytes_out( size );
+    }
+
+    VerifyResult result{};
+    try {
+        result = verify_png(
+            std::span{ static_cast<const std::byte *>( p ), size } );
+    }
+    catch ( ... ) {
+        ::munmap( p, size );
+        throw;
+    }
+    ::munmap( p, size );
+    return result;
+}
+#endif
+
+} // namespace PNG
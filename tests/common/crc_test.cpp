@@ -59,8 +59,29 @@ test_ihdr_bytes() {
         crc_from_bytes, ihdr_crc, std::span<const std::byte>{ ihdr_bytes } );
 }
 
-const auto crc_test_functions =
-    std::vector{ test_empty, test_ascii_digits, test_ihdr_bytes };
+bool
+test_incremental() {
+    constexpr std::bitset<CRC::crc_bits> digits_crc{ 0xCBF43926 };
+    constexpr auto crc_in_pieces = []( const std::string_view data,
+                                       const std::size_t      split ) {
+        const auto      bytes{ std::as_bytes(
+            std::span{ data.data(), data.size() } ) };
+        CRC::CrcTable32 crc_calculator(
+            CRC::PNG::png_polynomial<std::endian::big>() );
+        return crc_calculator.crc( bytes.subspan( split ),
+                                   crc_calculator.crc( bytes.first( split ) ) );
+    };
+    return TEST_INTERFACE::test_function( crc_in_pieces, digits_crc,
+                                          std::string_view{ "123456789" },
+                                          std::size_t{ 4 } )
+           && TEST_INTERFACE::test_function( crc_in_pieces, digits_crc,
+                                             std::string_view{ "123456789" },
+                                             std::size_t{ 0 } );
+}
+
+const auto crc_test_functions = std::vector{
+    test_empty, test_ascii_digits, test_ihdr_bytes, test_incremental
+};
 
 } // namespace CRC_TEST
 
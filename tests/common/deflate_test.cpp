@@ -0,0 +1,270 @@
+#include "common/deflate_test.hpp"
+
+#include "common/test_interface.hpp"
+
+#include <algorithm>
+
+namespace ZLIB_TEST
+{
+
+bool
+test_deflate_round_trip() {
+    const auto round_trip = []( const ZLIB::CompressionLevel level,
+                                const std::size_t            size,
+                                const std::size_t            piece_size ) {
+        const auto     data{ pattern_bytes( size ) };
+        ZLIB::Deflater deflater{ level };
+        const auto     stream{ deflate_in_pieces( deflater, data,
+                                                  piece_size ) };
+        const auto [output, status]{ inflate_stream( stream, size ) };
+        return status == ZLIB::inflate_status_t::STREAM_END
+               && std::ranges::equal( output, data )
+               && deflater.finished() && deflater.total_in() == size
+               && deflater.total_out() == stream.size();
+    };
+
+    // Stored streams start with the FLEVEL 0 zlib header
+    ZLIB::Deflater store{ ZLIB::CompressionLevel::STORE };
+    const auto     empty{ deflate_in_pieces( store, {}, 1 ) };
+
+    // Reset streams compress the same as new ones
+    const auto data{ pattern_bytes( 1000 ) };
+    store.reset();
+    const auto first{ deflate_in_pieces( store, data, 7 ) };
+    store.reset();
+    const auto second{ deflate_in_pieces( store, data, 7 ) };
+
+    constexpr auto stored{ ZLIB::CompressionLevel::STORE };
+    const auto     test_results = std::vector<bool>{
+        round_trip( stored, 0, 1 ),
+        round_trip( stored, 1, 1 ),
+        round_trip( stored, 1000, 1000 ),
+        round_trip( stored, 200000, 333 ),
+        // Stored blocks are at most 65535 bytes
+        round_trip( stored, 3 * ZLIB::Deflater::max_stored_block, 65536 ),
+        empty.size() == 11 && empty[0] == std::byte{ 0x78 }
+            && empty[1] == std::byte{ 0x01 },
+        first == second
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_deflate_levels() {
+    const auto round_trip = []( const ZLIB::CompressionLevel   level,
+                                const std::span<const std::byte> data,
+                                const std::size_t piece_size ) {
+        ZLIB::Deflater deflater{ level };
+        const auto     stream{ deflate_in_pieces( deflater, data,
+                                                  piece_size ) };
+        const auto [output, status]{ inflate_stream( stream, data.size() ) };
+        return status == ZLIB::inflate_status_t::STREAM_END
+               && std::ranges::equal( output, data )
+               && deflater.total_out() == stream.size();
+    };
+    const auto compressed_size = []( const ZLIB::CompressionLevel   level,
+                                     const std::span<const std::byte> data ) {
+        ZLIB::Deflater deflater{ level };
+        return deflate_in_pieces( deflater, data, data.size() + 1 ).size();
+    };
+
+    // Past twice the window, so the window slides
+    const auto text{ text_bytes( 150000 ) };
+    const auto random{ random_bytes( 70000 ) };
+    const auto pattern{ pattern_bytes( 100000 ) };
+    const auto zeros{ std::vector<std::byte>( 200000 ) };
+
+    std::vector<bool> test_results;
+    for ( const auto level : compressing_levels ) {
+        test_results.push_back( round_trip( level, {}, 1 ) );
+        test_results.push_back( round_trip( level, text, 1000 ) );
+        test_results.push_back( round_trip( level, text, 1 << 20 ) );
+        test_results.push_back( round_trip( level, random, 4093 ) );
+        test_results.push_back( round_trip( level, pattern, 777 ) );
+        test_results.push_back( round_trip( level, zeros, 65536 ) );
+        test_results.push_back(
+            round_trip( level, std::span{ text }.first( 3 ), 1 ) );
+        test_results.push_back(
+            round_trip( level, std::span{ text }.first( 300 ), 1 ) );
+
+        // FLEVEL records the level
+        ZLIB::Deflater deflater{ level };
+        const auto     stream{ deflate_in_pieces( deflater, text, 4096 ) };
+        test_results.push_back(
+            std::to_integer<std::uint32_t>( stream[1] ) >> 6
+            == static_cast<std::uint32_t>( level ) );
+
+        // Incompressible data falls back to stored blocks
+        test_results.push_back( compressed_size( level, random )
+                                <= random.size() + random.size() / 1000 );
+        test_results.push_back( compressed_size( level, text )
+                                < text.size() / 4 );
+        test_results.push_back( compressed_size( level, zeros ) < 1000 );
+    }
+
+    // More effort never does worse on text
+    const auto fast{ compressed_size( ZLIB::CompressionLevel::FAST, text ) };
+    const auto normal{ compressed_size( ZLIB::CompressionLevel::DEFAULT,
+                                        text ) };
+    const auto best{ compressed_size( ZLIB::CompressionLevel::BEST, text ) };
+    test_results.push_back( normal <= fast );
+    test_results.push_back( best <= normal );
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+namespace
+{
+
+// Round trip & sync point checks of a stream full flushed 3 times.
+std::vector<bool>
+full_flush_results( const ZLIB::CompressionLevel level ) {
+    const auto data{ text_bytes( 5000 ) };
+    const auto flush_at = std::vector<std::size_t>{ 1000, 1001, 4096 };
+
+    ZLIB::Deflater             deflater{ level };
+    std::vector<std::byte>     stream;
+    std::vector<std::uint64_t> sync_points;
+    std::size_t                offset{ 0 };
+    for ( const auto end : flush_at ) {
+        deflater.deflate( std::span{ data }.subspan( offset, end - offset ),
+                          ZLIB::deflate_flush_t::FULL, stream );
+        sync_points.push_back( deflater.total_out() );
+        offset = end;
+    }
+    deflater.deflate( std::span{ data }.subspan( offset ),
+                      ZLIB::deflate_flush_t::FINISH, stream );
+
+    // Each flush ends on an empty stored block, after which the stream
+    // inflates on its own as raw deflate
+    const auto marker_before = [&]( const std::uint64_t sync_point ) {
+        return std::ranges::equal(
+            std::span{ stream }.subspan( sync_point - 4, 4 ),
+            std::array{ std::byte{ 0x00 }, std::byte{ 0x00 },
+                        std::byte{ 0xFF }, std::byte{ 0xFF } } );
+    };
+    const auto inflates_from = [&]( const std::size_t index ) {
+        const auto [output, status]{ inflate_stream(
+            std::span{ stream }.subspan( sync_points[index] ),
+            data.size() - flush_at[index], false ) };
+        return status == ZLIB::inflate_status_t::STREAM_END
+               && std::ranges::equal(
+                   output, std::span{ data }.subspan( flush_at[index] ) );
+    };
+
+    const auto [output, status]{ inflate_stream( stream, data.size() ) };
+    return std::vector<bool>{ status == ZLIB::inflate_status_t::STREAM_END
+                                  && std::ranges::equal( output, data ),
+                              std::ranges::all_of( sync_points, marker_before ),
+                              inflates_from( 0 ),
+                              inflates_from( 1 ),
+                              inflates_from( 2 ) };
+}
+
+} // namespace
+
+bool
+test_deflate_full_flush() {
+    std::vector<bool> test_results;
+    for ( const auto level : { ZLIB::CompressionLevel::STORE,
+                               ZLIB::CompressionLevel::FAST,
+                               ZLIB::CompressionLevel::DEFAULT,
+                               ZLIB::CompressionLevel::BEST } ) {
+        const auto results{ full_flush_results( level ) };
+        test_results.insert( test_results.end(), results.begin(),
+                             results.end() );
+    }
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_deflate_dictionary() {
+    // Compresses `data` as pieces split at `split`, the second primed with
+    // the first & stitched on as raw deflate with a combined trailer
+    const auto stitched = []( const ZLIB::CompressionLevel   level,
+                              const std::span<const std::byte> data,
+                              const std::size_t                split ) {
+        const auto     head{ data.first( split ) };
+        const auto     tail{ data.subspan( split ) };
+        ZLIB::Deflater first{ level };
+        ZLIB::Deflater second{ level, false };
+        std::vector<std::byte> stream;
+        first.deflate( head, ZLIB::deflate_flush_t::SYNC, stream );
+        second.set_dictionary( head );
+        second.deflate( tail, ZLIB::deflate_flush_t::FINISH, stream );
+        const auto trailer{
+            to_bytes<std::uint32_t, std::endian::native, std::endian::big>(
+                ZLIB::adler32_combine( first.adler(), second.adler(),
+                                       tail.size() ) )
+        };
+        stream.insert( stream.end(), trailer.begin(), trailer.end() );
+        return std::pair{ stream, second.total_in() == tail.size() };
+    };
+
+    const auto text{ text_bytes( 100000 ) };
+    std::vector<bool> test_results;
+    for ( const auto level : compressing_levels ) {
+        for ( const auto split : { std::size_t{ 1 }, std::size_t{ 40000 },
+                                   std::size_t{ 99999 } } ) {
+            const auto [stream, counted]{ stitched( level, text, split ) };
+            const auto [output, status]{ inflate_stream( stream,
+                                                         text.size() ) };
+            test_results.push_back( counted
+                                    && status
+                                           == ZLIB::inflate_status_t::STREAM_END
+                                    && std::ranges::equal( output, text ) );
+        }
+
+        // Matches reach back into the dictionary
+        ZLIB::Deflater primed{ level, false };
+        ZLIB::Deflater unprimed{ level, false };
+        std::vector<std::byte> primed_stream;
+        std::vector<std::byte> unprimed_stream;
+        const auto             tail{ std::span{ text }.subspan( 60000, 2000 ) };
+        primed.set_dictionary( std::span{ text }.first( 60000 ) );
+        primed.deflate( tail, ZLIB::deflate_flush_t::FINISH, primed_stream );
+        unprimed.deflate( tail, ZLIB::deflate_flush_t::FINISH,
+                          unprimed_stream );
+        test_results.push_back( primed_stream.size()
+                                < unprimed_stream.size() );
+    }
+
+    // A sync flush keeps the history, later input still matches into it
+    ZLIB::Deflater         deflater{ ZLIB::CompressionLevel::DEFAULT };
+    std::vector<std::byte> stream;
+    deflater.deflate( std::span{ text }.first( 50000 ),
+                      ZLIB::deflate_flush_t::SYNC, stream );
+    const auto flushed{ stream.size() };
+    deflater.deflate( std::span{ text }.subspan( 50000, 100 ),
+                      ZLIB::deflate_flush_t::FINISH, stream );
+    const auto [output, status]{ inflate_stream( stream, 50100 ) };
+    test_results.push_back( status == ZLIB::inflate_status_t::STREAM_END
+                            && std::ranges::equal(
+                                output, std::span{ text }.first( 50100 ) ) );
+    test_results.push_back( stream.size() - flushed < 60 );
+
+    // Resetting may switch the zlib wrapper, the stream then matches a new
+    // deflater's
+    const auto             piece{ std::span{ text }.first( 20000 ) };
+    ZLIB::Deflater         reused{ ZLIB::CompressionLevel::BEST, false };
+    ZLIB::Deflater         fresh{ ZLIB::CompressionLevel::BEST };
+    std::vector<std::byte> raw_stream;
+    std::vector<std::byte> reused_stream;
+    std::vector<std::byte> fresh_stream;
+    reused.deflate( std::span{ text }.subspan( 50000, 3000 ),
+                    ZLIB::deflate_flush_t::FINISH, raw_stream );
+    reused.reset( true );
+    reused.deflate( piece, ZLIB::deflate_flush_t::FINISH, reused_stream );
+    fresh.deflate( piece, ZLIB::deflate_flush_t::FINISH, fresh_stream );
+    test_results.push_back( reused_stream == fresh_stream );
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace ZLIB_TEST
+
+int
+deflate_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "Deflate", ZLIB_TEST::test_functions );
+}
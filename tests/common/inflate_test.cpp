@@ -0,0 +1,257 @@
+#include "common/inflate_test.hpp"
+
+#include "common/test_interface.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+namespace ZLIB_TEST
+{
+
+namespace
+{
+
+std::vector<std::byte>
+string_bytes( const std::string_view str ) {
+    const auto bytes{ std::as_bytes( std::span{ str.data(), str.size() } ) };
+    return { bytes.begin(), bytes.end() };
+}
+
+// zlib.compress( b"hello hello hello hello", 9 )
+constexpr auto fixed_stream{ make_bytes( 0x78, 0xDA, 0xCB, 0x48, 0xCD, 0xC9,
+                                         0xC9, 0x57, 0xC8, 0x40, 0x27, 0x01,
+                                         0x68, 0x03, 0x08, 0xB1 ) };
+
+// Huffman only compression of 200 'a', 100 'b', 50 'c', 20 'd', 5 'e' &
+// "fghij", which zlib emits as a single dynamic block.
+constexpr auto dynamic_stream{ make_bytes(
+    0x78, 0x01, 0x05, 0xC1, 0x09, 0x81, 0x03, 0x40, 0x10, 0x04, 0x21, 0xAD,
+    0x54, 0xCF, 0xDE, 0x13, 0xFF, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0xDB, 0xB6, 0x6D,
+    0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D,
+    0xDB, 0xB6, 0x6D, 0xDB, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD,
+    0xDD, 0xDD, 0x7B, 0xEF, 0xBD, 0x9F, 0xDF, 0xBF, 0xFF, 0xCF, 0x17, 0x7B,
+    0x3C, 0x91, 0x38 ) };
+
+std::vector<std::byte>
+dynamic_stream_output() {
+    std::string expected;
+    expected.append( 200, 'a' );
+    expected.append( 100, 'b' );
+    expected.append( 50, 'c' );
+    expected.append( 20, 'd' );
+    expected.append( 5, 'e' );
+    expected.append( "fghij" );
+    return string_bytes( expected );
+}
+
+} // namespace
+
+bool
+test_adler32() {
+    constexpr auto adler_of = []( const std::string_view str ) {
+        ZLIB::Adler32 adler{};
+        adler.update( std::as_bytes( std::span{ str.data(), str.size() } ) );
+        return adler.value();
+    };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( adler_of, std::uint32_t{ 1 },
+                                       std::string_view{} ),
+        TEST_INTERFACE::test_function( adler_of, std::uint32_t{ 0x11E60398 },
+                                       std::string_view{ "Wikipedia" } ),
+        // Checksums of parts combine into that of the whole
+        ZLIB::adler32_combine( adler_of( "Wiki" ), adler_of( "pedia" ), 5 )
+            == adler_of( "Wikipedia" ),
+        ZLIB::adler32_combine( adler_of( "" ), adler_of( "Wikipedia" ), 9 )
+            == adler_of( "Wikipedia" ),
+        ZLIB::adler32_combine( adler_of( "Wikipedia" ), adler_of( "" ), 0 )
+            == adler_of( "Wikipedia" )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_stored_block() {
+    // Two stored blocks, the second final, holding "abc" & "de"
+    constexpr auto stream{ make_bytes( 0x78, 0x01, 0x00, 0x03, 0x00, 0xFC,
+                                       0xFF, 'a', 'b', 'c', 0x01, 0x02, 0x00,
+                                       0xFD, 0xFF, 'd', 'e', 0x05, 0xC8, 0x01,
+                                       0xF0 ) };
+    const auto     expected{ string_bytes( "abcde" ) };
+
+    const auto inflate_with = [&stream]( const std::size_t segment_size,
+                                         const std::size_t read_size ) {
+        const auto segments{ split_segments( stream, segment_size ) };
+        const auto [output, status] = inflate_all( segments, read_size );
+        return status == ZLIB::inflate_status_t::STREAM_END ? output :
+                                                              std::vector<std::byte>{};
+    };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       stream.size(), std::size_t{ 64 } ),
+        // Stored data split across segments & small reads
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       std::size_t{ 1 }, std::size_t{ 1 } ),
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       std::size_t{ 8 }, std::size_t{ 2 } )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_fixed_huffman() {
+    const auto expected{ string_bytes( "hello hello hello hello" ) };
+
+    const auto inflate_with = []( const std::size_t segment_size,
+                                  const std::size_t read_size ) {
+        const auto segments{ split_segments( fixed_stream, segment_size ) };
+        const auto [output, status] = inflate_all( segments, read_size );
+        return status == ZLIB::inflate_status_t::STREAM_END ? output :
+                                                              std::vector<std::byte>{};
+    };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       fixed_stream.size(),
+                                       std::size_t{ 64 } ),
+        // Matches interrupted by a full output buffer
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       std::size_t{ 3 }, std::size_t{ 1 } ),
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       std::size_t{ 1 }, std::size_t{ 5 } )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_dynamic_huffman() {
+    const auto expected{ dynamic_stream_output() };
+
+    const auto inflate_with = []( const std::size_t segment_size,
+                                  const std::size_t read_size ) {
+        const auto segments{ split_segments( dynamic_stream, segment_size ) };
+        const auto [output, status] = inflate_all( segments, read_size );
+        return status == ZLIB::inflate_status_t::STREAM_END ? output :
+                                                              std::vector<std::byte>{};
+    };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       dynamic_stream.size(),
+                                       std::size_t{ 1024 } ),
+        TEST_INTERFACE::test_function( inflate_with, expected,
+                                       std::size_t{ 7 }, std::size_t{ 13 } )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_corrupt_streams() {
+    const auto status_of = []( const std::vector<std::byte> & stream ) {
+        const auto segment{ ZLIB::segment_t{ stream } };
+        return inflate_all( std::span{ &segment, 1 }, 64 ).second;
+    };
+
+    auto bad_adler{ std::vector<std::byte>( fixed_stream.begin(),
+                                            fixed_stream.end() ) };
+    bad_adler.back() ^= std::byte{ 0x01 };
+
+    auto truncated{ std::vector<std::byte>( fixed_stream.begin(),
+                                            fixed_stream.end() ) };
+    truncated.resize( truncated.size() / 2 );
+
+    auto bad_header{ std::vector<std::byte>( fixed_stream.begin(),
+                                             fixed_stream.end() ) };
+    bad_header[1] ^= std::byte{ 0x01 };
+
+    // Block type 3 is reserved
+    const auto bad_block{ std::vector<std::byte>{
+        std::byte{ 0x78 }, std::byte{ 0x01 }, std::byte{ 0x07 } } };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( status_of,
+                                       ZLIB::inflate_status_t::BAD_ADLER32,
+                                       bad_adler ),
+        TEST_INTERFACE::test_function(
+            status_of, ZLIB::inflate_status_t::TRUNCATED, truncated ),
+        TEST_INTERFACE::test_function( status_of,
+                                       ZLIB::inflate_status_t::BAD_ZLIB_HEADER,
+                                       bad_header ),
+        TEST_INTERFACE::test_function(
+            status_of, ZLIB::inflate_status_t::BAD_BLOCK_TYPE, bad_block )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_checkpoints() {
+    // Inflates `split` bytes, then resumes a fresh inflater from a
+    // checkpoint. The rest of the output & the trailer must still check out.
+    const auto resumes_at = []( const std::span<const std::byte> stream,
+                                const std::size_t                segment_size,
+                                const std::size_t                split ) {
+        const auto segments{ split_segments( stream, segment_size ) };
+        const auto [expected, status] = inflate_all( segments, 1024 );
+
+        ZLIB::Inflater first{};
+        first.reset( segments );
+        std::vector<std::byte> head( split );
+        if ( first.read( head ) != split ) {
+            return false;
+        }
+        const auto checkpoint{ first.checkpoint() };
+
+        ZLIB::Inflater second{};
+        if ( !second.resume( segments, checkpoint ) ) {
+            return false;
+        }
+        std::vector<std::byte> tail( expected.size() - split );
+        return second.read( tail ) == tail.size()
+               && std::ranges::equal( tail,
+                                      std::span{ expected }.subspan( split ) )
+               && second.finish() == ZLIB::inflate_status_t::STREAM_END;
+    };
+
+    bool fixed_matches{ true };
+    for ( std::size_t split{ 0 }; split <= 23; ++split ) {
+        fixed_matches &= resumes_at( fixed_stream, 3, split );
+    }
+    bool dynamic_matches{ true };
+    const auto dynamic_size{ dynamic_stream_output().size() };
+    for ( std::size_t split{ 0 }; split <= dynamic_size; split += 7 ) {
+        dynamic_matches &= resumes_at( dynamic_stream, 5, split );
+    }
+
+    // A window that doesn't match the output position is rejected
+    const auto segments{ split_segments( fixed_stream, fixed_stream.size() ) };
+    ZLIB::Inflater inflater{};
+    inflater.reset( segments );
+    std::array<std::byte, 10> head{};
+    static_cast<void>( inflater.read( head ) );
+    auto bad_checkpoint{ inflater.checkpoint() };
+    bad_checkpoint.window.pop_back();
+
+    const auto test_results = std::vector<bool>{
+        fixed_matches, dynamic_matches,
+        !inflater.resume( segments, bad_checkpoint ) && inflater.failed()
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace ZLIB_TEST
+
+int
+inflate_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "Inflate", ZLIB_TEST::test_functions );
+}
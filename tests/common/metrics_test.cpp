@@ -0,0 +1,168 @@
+#include "common/metrics_test.hpp"
+
+#include "common/test_interface.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace METRICS_TEST
+{
+
+namespace
+{
+
+using METRICS::stage_t;
+
+// Metrics of a chunk walk, a CRC within it & one disabled inflate.
+METRICS::StageMetrics
+timed_stages() {
+    METRICS::StageMetrics image{};
+    METRICS::set_enabled( true );
+    METRICS::count_image( &image );
+    {
+        METRICS::StageTimer walk{ &image, stage_t::CHUNK_WALK, 100 };
+        METRICS::StageTimer crc{ &image, stage_t::CRC, 40 };
+        walk.set_bytes_out( 60 );
+    }
+    // Process totals only
+    METRICS::StageTimer{ nullptr, stage_t::CRC, 8 };
+    METRICS::set_enabled( false );
+    METRICS::StageTimer{ &image, stage_t::INFLATE, 60 };
+    return image;
+}
+
+} // namespace
+
+bool
+test_stage_timer() {
+    METRICS::reset_process_metrics();
+    const auto image{ timed_stages() };
+    const auto process{ METRICS::process_metrics() };
+    METRICS::reset_process_metrics();
+
+    const auto & walk{ image[stage_t::CHUNK_WALK] };
+    const auto & crc{ image[stage_t::CRC] };
+    const auto test_results = std::vector<bool>{
+        !METRICS::enabled(),
+        image.images == 1 && process.images == 1,
+        walk.calls == 1 && walk.bytes_in == 100 && walk.bytes_out == 60,
+        crc.calls == 1 && crc.bytes_in == 40 && crc.bytes_out == 0,
+        // The CRC ran within the walk
+        walk.nanoseconds >= crc.nanoseconds,
+        image[stage_t::INFLATE].calls == 0,
+        process[stage_t::CRC].calls == 2
+            && process[stage_t::CRC].bytes_in == 48,
+        process[stage_t::INFLATE].calls == 0,
+        METRICS::process_metrics().images == 0
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_stage_batch() {
+    METRICS::reset_process_metrics();
+    METRICS::StageMetrics image{};
+    bool                  deferred{ false };
+    METRICS::set_enabled( true );
+    {
+        METRICS::StageBatch rows{ &image };
+        for ( std::uint64_t row{ 0 }; row < 3; ++row ) {
+            rows.mark();
+            rows.lap( stage_t::INFLATE, 10, 20 );
+            rows.lap( stage_t::UNFILTER, 20, 19 );
+        }
+        // Nothing reaches the totals until the batch ends
+        deferred = image[stage_t::INFLATE].calls == 0
+                   && METRICS::process_metrics()[stage_t::INFLATE].calls == 0;
+    }
+    METRICS::set_enabled( false );
+    const auto process{ METRICS::process_metrics() };
+    // Enabled later than the batch started, so it stays off
+    METRICS::StageBatch disabled{ &image };
+    METRICS::set_enabled( true );
+    const bool disabled_inactive{ !disabled.active() };
+    METRICS::set_enabled( false );
+    METRICS::reset_process_metrics();
+
+    const auto & inflate{ image[stage_t::INFLATE] };
+    const auto & unfilter{ image[stage_t::UNFILTER] };
+    const auto test_results = std::vector<bool>{
+        deferred,
+        inflate.calls == 3 && inflate.bytes_in == 30
+            && inflate.bytes_out == 60,
+        unfilter.calls == 3 && unfilter.bytes_in == 60
+            && unfilter.bytes_out == 57,
+        process[stage_t::INFLATE].calls == 3
+            && process[stage_t::UNFILTER].bytes_out == 57,
+        process[stage_t::CONVERT].calls == 0,
+        disabled_inactive
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_metrics_export() {
+    METRICS::StageMetrics metrics{};
+    metrics.images = 2;
+    metrics.stages[static_cast<std::size_t>( stage_t::INFLATE )] = {
+        .calls = 3, .nanoseconds = 1'500'000'123, .bytes_in = 10,
+        .bytes_out = 40
+    };
+
+    std::ostringstream json;
+    METRICS::write_metrics( json, metrics, METRICS::metrics_format_t::JSON );
+    std::ostringstream prometheus;
+    METRICS::write_metrics( prometheus, metrics,
+                            METRICS::metrics_format_t::PROMETHEUS );
+    const auto contains = [&]( const std::string_view line ) {
+        return prometheus.str().find( line ) != std::string::npos;
+    };
+
+    const std::string empty_stage{
+        "{\"calls\":0,\"nanoseconds\":0,\"bytes_in\":0,\"bytes_out\":0}"
+    };
+    const std::string expected_json{
+        "{\"images\":2,\"stages\":{\"read\":" + empty_stage
+        + ",\"chunk_walk\":" + empty_stage + ",\"crc\":" + empty_stage
+        + ",\"inflate\":{\"calls\":3,\"nanoseconds\":1500000123,"
+          "\"bytes_in\":10,\"bytes_out\":40},\"unfilter\":"
+        + empty_stage + ",\"convert\":" + empty_stage + "}}\n"
+    };
+
+    // Written to file from the process totals, which are empty
+    METRICS::reset_process_metrics();
+    const auto path{ std::filesystem::temp_directory_path()
+                     / "metrics_test.prom" };
+    const bool saved{ METRICS::save_process_metrics(
+        path, METRICS::metrics_format_t::PROMETHEUS ) };
+    std::ifstream      saved_file{ path };
+    std::ostringstream saved_text;
+    saved_text << saved_file.rdbuf();
+    std::filesystem::remove( path );
+
+    const auto test_results = std::vector<bool>{
+        json.str() == expected_json,
+        contains( "# TYPE png_stage_seconds_total counter\n" ),
+        contains( "png_images_total 2\n" ),
+        contains( "png_stage_calls_total{stage=\"inflate\"} 3\n" ),
+        contains( "png_stage_seconds_total{stage=\"inflate\"} 1.500000123\n" ),
+        contains( "png_stage_seconds_total{stage=\"read\"} 0.000000000\n" ),
+        contains( "png_stage_bytes_out_total{stage=\"inflate\"} 40\n" ),
+        saved,
+        saved_text.str().find( "png_images_total 0\n" ) != std::string::npos,
+        !METRICS::save_process_metrics( path / "missing" / "metrics.json",
+                                        METRICS::metrics_format_t::JSON )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace METRICS_TEST
+
+int
+metrics_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "Metrics", METRICS_TEST::test_functions );
+}
@@ -0,0 +1,123 @@
+#include "common/parallel_test.hpp"
+
+#include "common/test_interface.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace PARALLEL_TEST
+{
+
+bool
+test_worker_count() {
+    const auto cores{ PARALLEL::worker_count(
+        0, std::numeric_limits<std::size_t>::max() ) };
+    const auto test_results = std::vector<bool>{
+        cores >= 1,
+        PARALLEL::worker_count( 4, 10 ) == 4,
+        PARALLEL::worker_count( 4, 3 ) == 3,
+        PARALLEL::worker_count( 0, 1 ) == 1,
+        // Nothing to run still takes the calling thread
+        PARALLEL::worker_count( 4, 0 ) == 1
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_worker_pool() {
+    PARALLEL::WorkerPool pool{ 4 };
+
+    // Batches reuse the same threads, each index runs exactly once
+    bool every_index_once{ true };
+    bool workers_in_range{ true };
+    for ( std::size_t count : { 1, 3, 100, 0, 57 } ) {
+        std::vector<std::atomic<int>> runs( count );
+        std::vector<std::size_t>      workers( count );
+        pool.run( count,
+                  [&]( const std::size_t index, const std::size_t worker ) {
+                      ++runs[index];
+                      workers[index] = worker;
+                  } );
+        every_index_once &= std::ranges::all_of(
+            runs, []( const auto & run ) { return run == 1; } );
+        workers_in_range &= std::ranges::all_of(
+            workers,
+            [&]( const auto worker ) { return worker < pool.size(); } );
+    }
+
+    // One worker runs in order, on the calling thread
+    std::vector<std::size_t> order;
+    const auto               caller{ std::this_thread::get_id() };
+    bool                     on_caller{ true };
+    PARALLEL::parallel_for( 5, 1, [&]( const std::size_t index ) {
+        order.push_back( index );
+        on_caller &= std::this_thread::get_id() == caller;
+    } );
+
+    const auto test_results = std::vector<bool>{
+        pool.size() == 4,
+        every_index_once,
+        workers_in_range,
+        order == std::vector<std::size_t>{ 0, 1, 2, 3, 4 },
+        on_caller
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_task_errors() {
+    PARALLEL::WorkerPool pool{ 3 };
+
+    // Tasks 7 & 20 throw, every task before 7 runs & 7's error is reported
+    std::vector<std::atomic<int>> runs( 40 );
+    std::size_t                   thrown{ 0 };
+    try {
+        pool.run( runs.size(), [&]( const std::size_t index ) {
+            ++runs[index];
+            if ( index == 7 || index == 20 ) {
+                throw std::runtime_error( std::to_string( index ) );
+            }
+        } );
+    }
+    catch ( const std::runtime_error & error ) {
+        thrown = std::stoul( error.what() );
+    }
+    const bool earlier_ran{ std::all_of( runs.begin(), runs.begin() + 7,
+                                         []( const auto & run ) {
+                                             return run == 1;
+                                         } ) };
+
+    // The pool is still usable afterwards
+    std::atomic<std::size_t> total{ 0 };
+    pool.run( 10, [&]( const std::size_t index ) { total += index; } );
+
+    std::size_t sequential_thrown{ 0 };
+    try {
+        PARALLEL::parallel_for( 10, 1, []( const std::size_t index ) {
+            if ( index >= 4 ) {
+                throw std::runtime_error( std::to_string( index ) );
+            }
+        } );
+    }
+    catch ( const std::runtime_error & error ) {
+        sequential_thrown = std::stoul( error.what() );
+    }
+
+    const auto test_results = std::vector<bool>{ thrown == 7, earlier_ran,
+                                                 total == 45,
+                                                 sequential_thrown == 4 };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PARALLEL_TEST
+
+int
+parallel_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "Parallel",
+                                      PARALLEL_TEST::test_functions );
+}
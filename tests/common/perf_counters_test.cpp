@@ -0,0 +1,136 @@
+#include "common/perf_counters_test.hpp"
+
+#include "common/test_interface.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <sstream>
+#include <string>
+
+namespace PERF_TEST
+{
+
+namespace
+{
+
+using PERF::counter_t;
+
+// Enough work for the counters to see, if they are available.
+std::uint64_t
+busy_work( const std::uint64_t count ) {
+    std::vector<std::uint64_t> values( count );
+    std::iota( values.begin(), values.end(), std::uint64_t{ 1 } );
+    return std::accumulate( values.begin(), values.end(), std::uint64_t{ 0 } );
+}
+
+} // namespace
+
+bool
+test_regions() {
+    PERF::Profile profile{};
+    // Not started, so nothing is recorded
+    { PERF::Region ignored{ "ignored", 10 }; }
+
+    profile.start();
+    std::uint64_t sum{ 0 };
+    for ( std::uint64_t i{ 0 }; i < 3; ++i ) {
+        PERF::Region work{ "work" };
+        sum += busy_work( 1000 );
+        work.set_bytes( 1000 );
+    }
+    {
+        PERF::Region outer{ "outer", 5 };
+        PERF::Region inner{ "inner", 7 };
+    }
+    profile.stop();
+    { PERF::Region stopped{ "work", 10 }; }
+
+    const auto regions{ profile.regions() };
+    const auto & work{ regions[0] };
+    // Without counters every count reads 0
+    const bool counted{ !profile.available()
+                        || ( work[counter_t::CYCLES] > 0
+                             && work[counter_t::INSTRUCTIONS] > 0 ) };
+    const auto test_results = std::vector<bool>{
+        PERF::active_profile == nullptr,
+        sum == 3 * 500'500,
+        regions.size() == 3,
+        work.name == "work" && work.calls == 3 && work.bytes == 3000,
+        // Recorded as they end, so the inner region first
+        regions[1].name == "inner" && regions[1].bytes == 7,
+        regions[2].name == "outer" && regions[2].calls == 1,
+        counted,
+        profile.available()
+            || work.counters == PERF::CounterValues{}
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_region_rates() {
+    const PERF::RegionTotals empty{ .name = "empty" };
+    const PERF::RegionTotals totals{ .name = "totals",
+                                     .calls = 2,
+                                     .bytes = 100,
+                                     .counters = { 400, 1000, 50, 20 } };
+
+    // Regions past max_regions are dropped
+    PERF::Profile profile{};
+    profile.start();
+    const std::array<std::string, PERF::Profile::max_regions + 1> names{
+        "r0", "r1", "r2",  "r3",  "r4",  "r5",  "r6",  "r7",  "r8",
+        "r9", "r10", "r11", "r12", "r13", "r14", "r15", "r16"
+    };
+    for ( const auto & name : names ) {
+        PERF::Region region{ name };
+    }
+    profile.stop();
+
+    const auto test_results = std::vector<bool>{
+        empty.ipc() == 0.0,
+        empty.per_byte( counter_t::LLC_MISSES ) == 0.0,
+        totals.ipc() == 2.5,
+        totals.per_byte( counter_t::BRANCH_MISSES ) == 0.5,
+        totals.per_byte( counter_t::LLC_MISSES ) == 0.2,
+        profile.regions().size() == PERF::Profile::max_regions,
+        profile.regions().back().name == "r15"
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_profile_report() {
+    PERF::Profile profile{};
+    profile.start();
+    { PERF::Region inflate{ "inflate", 64 }; }
+    profile.stop();
+
+    std::ostringstream report;
+    report << std::hex;
+    profile.report( report );
+    const auto text{ report.str() };
+    const auto header_end{ text.find( '\n' ) };
+    const auto line{ text.substr( header_end + 1 ) };
+
+    const auto test_results = std::vector<bool>{
+        text.starts_with( "# region calls bytes cycles instructions " ),
+        line.starts_with( "inflate 1 64 " ),
+        line.ends_with( "\n" ),
+        std::count( line.begin(), line.end(), ' ' ) == 9,
+        // The caller's formatting is restored
+        ( report.flags() & std::ios::basefield ) == std::ios::hex
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PERF_TEST
+
+int
+perf_counters_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "Perf counters",
+                                      PERF_TEST::test_functions );
+}
@@ -0,0 +1,96 @@
+#include "common/trace_test.hpp"
+
+#include "common/test_interface.hpp"
+
+#include <sstream>
+#include <thread>
+
+namespace TRACE_TEST
+{
+
+namespace
+{
+
+using TRACE::trace_level_t;
+
+constexpr bool
+compiled_in( const trace_level_t level ) noexcept {
+    return level <= TRACE::compiled_level;
+}
+
+} // namespace
+
+bool
+test_trace_buffer() {
+    TRACE::TraceBuffer buffer{};
+    for ( std::uint64_t i{ 0 }; i < 3; ++i ) {
+        buffer.record( { i, "event", i, 0, trace_level_t::CHUNK } );
+    }
+    const auto few{ buffer.events() };
+
+    // Two more events than fit, the first two are overwritten
+    for ( std::uint64_t i{ 3 }; i < TRACE::TraceBuffer::capacity + 2; ++i ) {
+        buffer.record( { i, "event", i, 0, trace_level_t::CHUNK } );
+    }
+    const auto full{ buffer.events() };
+    const auto dropped{ buffer.dropped() };
+    buffer.clear();
+
+    std::ostringstream line;
+    line << TRACE::TraceEvent{ 12, "read_chunk", 3, 4, trace_level_t::CHUNK };
+
+    const auto test_results = std::vector<bool>{
+        few.size() == 3,
+        few.front().first == 0 && few.back().first == 2,
+        full.size() == TRACE::TraceBuffer::capacity,
+        full.front().first == 2,
+        full.back().first == TRACE::TraceBuffer::capacity + 1,
+        dropped == 2,
+        buffer.events().empty() && buffer.dropped() == 0,
+        line.str() == "12 2 read_chunk 3 4"
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_trace_events() {
+    auto & buffer{ TRACE::thread_buffer() };
+    buffer.clear();
+    TRACE::event<trace_level_t::STAGE>( "stage", 1 );
+    TRACE::event<trace_level_t::CHUNK>( "chunk", 2, 3 );
+    TRACE::event<trace_level_t::DETAIL>( "detail" );
+    TRACE::event<trace_level_t::NONE>( "none" );
+    // Each thread records to its own buffer
+    std::jthread{ [] {
+        TRACE::event<trace_level_t::STAGE>( "other thread" );
+    } }.join();
+    const auto events{ buffer.events() };
+    buffer.clear();
+
+    std::size_t expected{ 0 };
+    for ( const auto level : { trace_level_t::STAGE, trace_level_t::CHUNK,
+                               trace_level_t::DETAIL } ) {
+        expected += compiled_in( level ) ? 1 : 0;
+    }
+    const bool ordered{ events.size() < 2
+                        || ( events[0].first == 1
+                             && events[1].second == 3
+                             && events[0].timestamp
+                                    <= events[1].timestamp ) };
+
+    const auto test_results = std::vector<bool>{
+        events.size() == expected,
+        ordered,
+        &TRACE::thread_buffer() == &buffer
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace TRACE_TEST
+
+int
+trace_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "Trace", TRACE_TEST::test_functions );
+}
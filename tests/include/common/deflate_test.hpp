@@ -0,0 +1,108 @@
+#pragma once
+
+#include "common/deflate.hpp"
+#include "common/inflate.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ZLIB_TEST
+{
+
+namespace
+{
+
+// Compresses `data` in pieces of `piece_size` bytes.
+inline std::vector<std::byte>
+deflate_in_pieces( ZLIB::Deflater & deflater,
+                   const std::span<const std::byte> data,
+                   const std::size_t                piece_size ) {
+    std::vector<std::byte> stream;
+    for ( std::size_t offset{ 0 }; offset < data.size();
+          offset += piece_size ) {
+        const auto size{ std::min( piece_size, data.size() - offset ) };
+        deflater.deflate( data.subspan( offset, size ),
+                          ZLIB::deflate_flush_t::NONE, stream );
+    }
+    deflater.deflate( {}, ZLIB::deflate_flush_t::FINISH, stream );
+    return stream;
+}
+
+// Inflates all of `stream`, returning the output & the final status.
+inline std::pair<std::vector<std::byte>, ZLIB::inflate_status_t>
+inflate_stream( const std::span<const std::byte> stream,
+                const std::size_t                expected_size,
+                const bool                       zlib_wrapped = true ) {
+    const auto     segments{ std::vector<ZLIB::segment_t>{ stream } };
+    ZLIB::Inflater inflater{};
+    inflater.reset( segments, zlib_wrapped );
+
+    std::vector<std::byte> output( expected_size + 1 );
+    output.resize( inflater.read( output ) );
+    return { output, zlib_wrapped ? inflater.finish() : inflater.status() };
+}
+
+inline std::vector<std::byte>
+pattern_bytes( const std::size_t size ) {
+    std::vector<std::byte> bytes( size );
+    for ( std::size_t i{ 0 }; i < size; ++i ) {
+        bytes[i] = static_cast<std::byte>( ( i * 37 + i / 251 ) & 0xFF );
+    }
+    return bytes;
+}
+
+// Words drawn from a small vocabulary, compressible like prose.
+inline std::vector<std::byte>
+text_bytes( const std::size_t size ) {
+    constexpr std::array<std::string_view, 8> words{
+        "deflate ", "window ", "the ",     "match ",
+        "huffman ", "of ",     "length\n", "distance, "
+    };
+    std::vector<std::byte> bytes;
+    bytes.reserve( size );
+    std::uint32_t state{ 12345 };
+    while ( bytes.size() < size ) {
+        state = state * 1103515245U + 12345U;
+        for ( const auto c : words[( state >> 16 ) % words.size()] ) {
+            bytes.push_back( static_cast<std::byte>( c ) );
+        }
+    }
+    bytes.resize( size );
+    return bytes;
+}
+
+// Incompressible bytes.
+inline std::vector<std::byte>
+random_bytes( const std::size_t size ) {
+    std::vector<std::byte> bytes( size );
+    std::uint64_t          state{ 0x9E37'79B9'7F4A'7C15 };
+    for ( auto & byte : bytes ) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        byte = static_cast<std::byte>( state >> 56 );
+    }
+    return bytes;
+}
+
+constexpr std::array compressing_levels{ ZLIB::CompressionLevel::FAST,
+                                         ZLIB::CompressionLevel::DEFAULT,
+                                         ZLIB::CompressionLevel::BEST };
+
+} // namespace
+
+bool test_deflate_round_trip();
+bool test_deflate_levels();
+bool test_deflate_full_flush();
+bool test_deflate_dictionary();
+
+const auto test_functions =
+    std::vector{ test_deflate_round_trip, test_deflate_levels,
+                 test_deflate_full_flush, test_deflate_dictionary };
+
+} // namespace ZLIB_TEST
+
+int deflate_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
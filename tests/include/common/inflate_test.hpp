@@ -0,0 +1,69 @@
+#pragma once
+
+#include "common/inflate.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace ZLIB_TEST
+{
+
+template <typename... Ts>
+constexpr std::array<std::byte, sizeof...( Ts )>
+make_bytes( const Ts... values ) {
+    return { static_cast<std::byte>( values )... };
+}
+
+// Inflates `segments` reading `read_size` bytes at a time, returning the
+// output & the final stream status.
+inline std::pair<std::vector<std::byte>, ZLIB::inflate_status_t>
+inflate_all( const std::span<const ZLIB::segment_t> segments,
+             const std::size_t                      read_size ) {
+    ZLIB::Inflater inflater{};
+    inflater.reset( segments );
+
+    std::vector<std::byte> output;
+    std::vector<std::byte> buffer( read_size );
+    while ( true ) {
+        const auto count{ inflater.read( buffer ) };
+        output.insert( output.end(), buffer.begin(),
+                       buffer.begin() + static_cast<std::ptrdiff_t>( count ) );
+        if ( count < read_size ) {
+            break;
+        }
+    }
+
+    return { output, inflater.finish() };
+}
+
+// Splits `data` into segments of at most `segment_size` bytes.
+inline std::vector<ZLIB::segment_t>
+split_segments( const std::span<const std::byte> data,
+                const std::size_t                segment_size ) {
+    std::vector<ZLIB::segment_t> segments;
+    for ( std::size_t offset{ 0 }; offset < data.size();
+          offset += segment_size ) {
+        segments.emplace_back(
+            data.subspan( offset, std::min( segment_size,
+                                            data.size() - offset ) ) );
+    }
+    return segments;
+}
+
+bool test_adler32();
+bool test_stored_block();
+bool test_fixed_huffman();
+bool test_dynamic_huffman();
+bool test_corrupt_streams();
+bool test_checkpoints();
+
+const auto test_functions =
+    std::vector{ test_adler32,         test_stored_block,
+                 test_fixed_huffman,   test_dynamic_huffman,
+                 test_corrupt_streams, test_checkpoints };
+
+} // namespace ZLIB_TEST
+
+int inflate_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common/metrics.hpp"
+
+#include <vector>
+
+namespace METRICS_TEST
+{
+
+bool test_stage_timer();
+bool test_stage_batch();
+bool test_metrics_export();
+
+const auto test_functions = std::vector{ test_stage_timer, test_stage_batch,
+                                         test_metrics_export };
+
+} // namespace METRICS_TEST
+
+int metrics_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
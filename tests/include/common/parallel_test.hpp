@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common/parallel.hpp"
+
+#include <vector>
+
+namespace PARALLEL_TEST
+{
+
+bool test_worker_count();
+bool test_worker_pool();
+bool test_task_errors();
+
+const auto test_functions = std::vector{ test_worker_count, test_worker_pool,
+                                         test_task_errors };
+
+} // namespace PARALLEL_TEST
+
+int parallel_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
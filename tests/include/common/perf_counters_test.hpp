@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common/perf_counters.hpp"
+
+#include <vector>
+
+namespace PERF_TEST
+{
+
+bool test_regions();
+bool test_region_rates();
+bool test_profile_report();
+
+const auto test_functions = std::vector{ test_regions, test_region_rates,
+                                         test_profile_report };
+
+} // namespace PERF_TEST
+
+int perf_counters_test( [[maybe_unused]] int argc,
+                        [[maybe_unused]] char ** argv );
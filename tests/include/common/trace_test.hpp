@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common/trace.hpp"
+
+#include <vector>
+
+namespace TRACE_TEST
+{
+
+bool test_trace_buffer();
+bool test_trace_events();
+
+const auto test_functions = std::vector{ test_trace_buffer,
+                                         test_trace_events };
+
+} // namespace TRACE_TEST
+
+int trace_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_apng.hpp"
+#include "png/png_decoder.hpp"
+#include "png/png_test_helpers.hpp"
+
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// One frame of a test animation, as 8 bit RGBA.
+struct TestFrame
+{
+    FrameControl           control;
+    std::vector<std::byte> rgba;
+};
+
+// Encodes `rgba` as a PNG of its own, with PngEncoder.
+inline std::vector<std::byte>
+encode_rgba( const std::uint32_t width, const std::uint32_t height,
+             const std::span<const std::byte> rgba ) {
+    EncodeOptions options{};
+    options.idat_size = 256;
+    options.filter = IDAT::FilterType::PAETH;
+    return encode_image(
+        make_header( width, height, 8, IHDR::ColourType::TRUE_COLOUR_ALPHA ),
+        rgba, options );
+}
+
+// Deterministic RGBA pixels, with fully transparent, opaque &
+// translucent alpha all present.
+inline std::vector<std::byte>
+test_pixels( const std::uint32_t width, const std::uint32_t height,
+             const std::uint32_t seed ) {
+    std::vector<std::byte> rgba( std::size_t{ width } * height * 4 );
+    std::uint32_t          state{ seed * 2654435761U + 1 };
+    for ( std::size_t i{ 0 }; i < rgba.size(); ++i ) {
+        state = state * 1103515245U + 12345U;
+        rgba[i] = static_cast<std::byte>( state >> 16 );
+        if ( i % 4 == 3 && ( state >> 8 ) % 4 != 0 ) {
+            rgba[i] = static_cast<std::byte>(
+                ( state >> 10 ) % 2 == 0 ? 0x00 : 0xFF );
+        }
+    }
+    return rgba;
+}
+
+// An APNG of `frames` on a width x height RGBA canvas. Frame 0 is the
+// IDAT image if `default_image_is_frame`, else the IDAT image is a static
+// fallback & every frame is stored in fdAT chunks.
+inline std::vector<std::byte>
+make_apng( const std::uint32_t width, const std::uint32_t height,
+           const std::span<const TestFrame> frames,
+           const bool default_image_is_frame ) {
+    const auto frame_data = []( const TestFrame & frame ) {
+        const auto png{ encode_rgba( frame.control.width, frame.control.height,
+                                     frame.rgba ) };
+        const PngDecoder       decoder{ png };
+        std::vector<std::byte> data;
+        for ( const auto & chunk : decoder.chunks() ) {
+            if ( chunk.type == PngChunkType::IDAT ) {
+                data.insert( data.end(), chunk.data.begin(),
+                             chunk.data.end() );
+            }
+        }
+        return data;
+    };
+
+    // The encoder writes the signature & IHDR, acTL goes right after
+    const auto fallback{ encode_rgba(
+        width, height, test_pixels( width, height, 99 ) ) };
+    std::vector<std::byte> apng( fallback.begin(),
+                                 fallback.begin() + png_signature_bytes
+                                     + chunk_overhead_bytes + 13 );
+    std::vector<std::byte> actl;
+    append_integer( actl, static_cast<std::uint32_t>( frames.size() ) );
+    append_integer( actl, std::uint32_t{ 0 } );
+    const auto actl_chunk{ make_chunk( PngChunkType::acTL, actl ) };
+    apng.insert( apng.end(), actl_chunk.begin(), actl_chunk.end() );
+
+    std::uint32_t sequence{ 0 };
+    for ( std::size_t i{ 0 }; i < frames.size(); ++i ) {
+        const auto & control{ frames[i].control };
+        std::vector<std::byte> fctl;
+        append_integer( fctl, sequence++ );
+        append_integer( fctl, control.width );
+        append_integer( fctl, control.height );
+        append_integer( fctl, control.x_offset );
+        append_integer( fctl, control.y_offset );
+        append_integer( fctl, control.delay_numerator );
+        append_integer( fctl, control.delay_denominator );
+        append_integer( fctl, control.dispose_op );
+        append_integer( fctl, control.blend_op );
+
+        if ( i == 0 && default_image_is_frame ) {
+            const auto fctl_chunk{ make_chunk( PngChunkType::fcTL, fctl ) };
+            apng.insert( apng.end(), fctl_chunk.begin(), fctl_chunk.end() );
+            const auto idat{ make_chunk( PngChunkType::IDAT,
+                                         frame_data( frames[i] ) ) };
+            apng.insert( apng.end(), idat.begin(), idat.end() );
+            continue;
+        }
+        if ( i == 0 ) {
+            const PngDecoder decoder{ fallback };
+            for ( const auto & chunk : decoder.chunks() ) {
+                if ( chunk.type == PngChunkType::IDAT ) {
+                    const auto idat{ make_chunk( PngChunkType::IDAT,
+                                                 chunk.data ) };
+                    apng.insert( apng.end(), idat.begin(), idat.end() );
+                }
+            }
+        }
+        const auto fctl_chunk{ make_chunk( PngChunkType::fcTL, fctl ) };
+        apng.insert( apng.end(), fctl_chunk.begin(), fctl_chunk.end() );
+
+        // Split over two fdAT chunks
+        const auto stream{ frame_data( frames[i] ) };
+        const auto half{ stream.size() / 2 };
+        for ( const auto piece : { std::span{ stream }.first( half ),
+                                   std::span{ stream }.subspan( half ) } ) {
+            std::vector<std::byte> fdat;
+            append_integer( fdat, sequence++ );
+            fdat.insert( fdat.end(), piece.begin(), piece.end() );
+            const auto fdat_chunk{ make_chunk( PngChunkType::fdAT, fdat ) };
+            apng.insert( apng.end(), fdat_chunk.begin(), fdat_chunk.end() );
+        }
+    }
+
+    const auto iend{ make_chunk( PngChunkType::IEND, {} ) };
+    apng.insert( apng.end(), iend.begin(), iend.end() );
+    return apng;
+}
+
+// Canvases after each frame, composited one pixel at a time as the APNG
+// specification describes.
+inline std::vector<std::vector<std::byte>>
+reference_canvases( const std::uint32_t width, const std::uint32_t height,
+                    const std::span<const TestFrame> frames ) {
+    std::vector<std::vector<std::byte>> canvases;
+    std::vector<std::byte> canvas( std::size_t{ width } * height * 4 );
+    std::vector<std::byte> saved;
+    for ( const auto & frame : frames ) {
+        const auto & control{ frame.control };
+        const auto   pixel_at = [&]( const std::uint32_t x,
+                                   const std::uint32_t y ) {
+            return std::span{ canvas }.subspan(
+                ( std::size_t{ control.y_offset + y } * width
+                  + control.x_offset + x )
+                    * 4,
+                4 );
+        };
+        saved = canvas;
+        for ( std::uint32_t y{ 0 }; y < control.height; ++y ) {
+            for ( std::uint32_t x{ 0 }; x < control.width; ++x ) {
+                const auto source{ std::span{ frame.rgba }.subspan(
+                    ( std::size_t{ y } * control.width + x ) * 4, 4 ) };
+                const auto target{ pixel_at( x, y ) };
+                const auto sa{ std::to_integer<std::uint32_t>( source[3] ) };
+                if ( control.blend_op == BlendOp::SOURCE || sa == 255 ) {
+                    std::ranges::copy( source, target.begin() );
+                    continue;
+                }
+                if ( sa == 0 ) {
+                    continue;
+                }
+                const auto u{ sa * 255 };
+                const auto v{ ( 255 - sa )
+                              * std::to_integer<std::uint32_t>( target[3] ) };
+                for ( int c{ 0 }; c < 3; ++c ) {
+                    target[c] = static_cast<std::byte>(
+                        ( std::to_integer<std::uint32_t>( source[c] ) * u
+                          + std::to_integer<std::uint32_t>( target[c] ) * v )
+                        / ( u + v ) );
+                }
+                target[3] = static_cast<std::byte>( ( u + v ) / 255 );
+            }
+        }
+        canvases.push_back( canvas );
+
+        if ( control.dispose_op == DisposeOp::PREVIOUS
+             && canvases.size() > 1 ) {
+            canvas = saved;
+        }
+        else if ( control.dispose_op != DisposeOp::NONE ) {
+            for ( std::uint32_t y{ 0 }; y < control.height; ++y ) {
+                for ( std::uint32_t x{ 0 }; x < control.width; ++x ) {
+                    std::ranges::fill( pixel_at( x, y ), std::byte{ 0 } );
+                }
+            }
+        }
+    }
+    return canvases;
+}
+
+// Frames exercising every blend & dispose op, with regions whose widths
+// aren't multiples of 8.
+inline std::vector<TestFrame>
+test_frames() {
+    const auto frame = []( const std::uint32_t x, const std::uint32_t y,
+                           const std::uint32_t width,
+                           const std::uint32_t height,
+                           const DisposeOp dispose, const BlendOp blend,
+                           const std::uint32_t seed ) {
+        return TestFrame{ FrameControl{ width, height, x, y, 1, 10, dispose,
+                                        blend },
+                          test_pixels( width, height, seed ) };
+    };
+    return { frame( 0, 0, 37, 21, DisposeOp::NONE, BlendOp::SOURCE, 1 ),
+             frame( 2, 3, 29, 11, DisposeOp::PREVIOUS, BlendOp::OVER, 2 ),
+             frame( 10, 6, 5, 5, DisposeOp::BACKGROUND, BlendOp::SOURCE, 3 ),
+             frame( 0, 0, 37, 21, DisposeOp::NONE, BlendOp::OVER, 4 ),
+             frame( 19, 13, 18, 8, DisposeOp::NONE, BlendOp::OVER, 5 ) };
+}
+
+} // namespace
+
+bool test_apng_frames();
+bool test_apng_default_image();
+bool test_apng_errors();
+
+const auto test_functions = std::vector{ test_apng_frames,
+                                         test_apng_default_image,
+                                         test_apng_errors };
+
+} // namespace PNG
+
+int png_apng_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
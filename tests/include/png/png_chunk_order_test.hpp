@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_chunk_order.hpp"
+
+#include <initializer_list>
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// The first error in the chunk sequence `types` of an image of
+// `colour_type`, or the error from finishing it.
+inline png_error_t
+order_error( const IHDR::ColourType                    colour_type,
+             const std::initializer_list<PngChunkType> types ) {
+    ChunkOrderValidator order{};
+    for ( const auto type : types ) {
+        if ( const auto error{ order.next( type ) };
+             error != png_error_t::NONE ) {
+            return error;
+        }
+        if ( type == PngChunkType::IHDR ) {
+            order.set_colour_type( colour_type );
+        }
+    }
+    return order.finish();
+}
+
+} // namespace
+
+bool test_chunk_order_valid();
+bool test_chunk_order_invalid();
+bool test_chunk_order_sticky();
+
+const auto test_functions = std::vector{ test_chunk_order_valid,
+                                         test_chunk_order_invalid,
+                                         test_chunk_order_sticky };
+
+} // namespace PNG
+
+int png_chunk_order_test( [[maybe_unused]] int    argc,
+                          [[maybe_unused]] char ** argv );
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_convert.hpp"
+
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// Pseudo-random bytes, so every sample value & bit pattern turns up.
+inline std::vector<std::byte>
+noise_bytes( const std::size_t size, std::uint32_t seed = 0x2545F491 ) {
+    std::vector<std::byte> bytes( size );
+    for ( auto & byte : bytes ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        byte = static_cast<std::byte>( seed >> 24 );
+    }
+    return bytes;
+}
+
+} // namespace
+
+bool test_unpack_samples();
+bool test_expand_palette();
+bool test_convert_16();
+
+const auto test_functions =
+    std::vector{ test_unpack_samples, test_expand_palette, test_convert_16 };
+
+} // namespace PNG
+
+int png_convert_test( [[maybe_unused]] int     argc,
+                      [[maybe_unused]] char ** argv );
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "common/adler32.hpp"
+#include "common/test_interface.hpp"
+#include "png/png_decoder.hpp"
+#include "png/png_test_helpers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// Wraps `data` in a zlib stream made of stored (uncompressed) blocks. With
+// a `flush_interval`, an empty stored block follows every flush_interval
+// bytes, as a full flush would leave.
+inline std::vector<std::byte>
+make_stored_zlib( const std::span<const std::byte> data,
+                  const std::size_t                flush_interval = 0 ) {
+    constexpr std::size_t max_stored_block{ 65535 };
+
+    const auto append_stored = [&]( std::vector<std::byte> &         stream,
+                                    const std::span<const std::byte> block,
+                                    const bool is_final ) {
+        stream.push_back( std::byte{ is_final ? std::uint8_t{ 1 } :
+                                                std::uint8_t{ 0 } } );
+        // Stored block lengths are the only little endian fields
+        append_integer<std::uint16_t, std::endian::little>(
+            stream, static_cast<std::uint16_t>( block.size() ) );
+        append_integer<std::uint16_t, std::endian::little>(
+            stream, static_cast<std::uint16_t>( ~block.size() ) );
+        append_bytes( stream, block );
+    };
+
+    std::vector<std::byte> stream{ std::byte{ 0x78 }, std::byte{ 0x01 } };
+    std::size_t            offset{ 0 };
+    std::size_t            next_flush{ flush_interval };
+    do {
+        auto length{ std::min( max_stored_block, data.size() - offset ) };
+        if ( flush_interval != 0 ) {
+            length = std::min( length, next_flush - offset );
+        }
+        const bool is_final{ offset + length == data.size() };
+        append_stored( stream, data.subspan( offset, length ), is_final );
+        offset += length;
+        if ( !is_final && offset == next_flush ) {
+            append_stored( stream, {}, false );
+            next_flush += flush_interval;
+        }
+    } while ( offset < data.size() );
+
+    ZLIB::Adler32 adler{};
+    adler.update( data );
+    append_integer( stream, adler.value() );
+    return stream;
+}
+
+// Builds a PNG from already filtered scanlines, split over IDAT chunks of
+// at most `idat_size` bytes. `extra_chunks` (serialized, e.g. PLTE & tRNS)
+// are placed between the IHDR & the first IDAT. See make_stored_zlib for
+// `flush_interval`.
+inline std::vector<std::byte>
+make_png( const std::uint32_t width, const std::uint32_t height,
+          const IHDR::BitDepth bit_depth, const IHDR::ColourType colour_type,
+          const IHDR::InterlaceMethod      interlace_method,
+          const std::span<const std::byte> scanlines,
+          const std::span<const std::byte> extra_chunks = {},
+          const std::size_t                idat_size = 1024,
+          const std::size_t                flush_interval = 0 ) {
+    std::vector<std::byte> png;
+    append_integer( png, png_signature );
+
+    std::vector<std::byte> ihdr;
+    append_integer( ihdr, width );
+    append_integer( ihdr, height );
+    append_integer( ihdr, bit_depth );
+    append_integer( ihdr, colour_type );
+    append_integer( ihdr, IHDR::CompressionMethod::COMPRESSION_METHOD_0 );
+    append_integer( ihdr, IHDR::FilterMethod::FILTER_METHOD_0 );
+    append_integer( ihdr, interlace_method );
+    append_bytes( png, make_chunk( PngChunkType::IHDR, ihdr ) );
+    append_bytes( png, extra_chunks );
+
+    const auto stream{ make_stored_zlib( scanlines, flush_interval ) };
+    for ( std::size_t offset{ 0 }; offset < stream.size();
+          offset += idat_size ) {
+        append_bytes(
+            png,
+            make_chunk( PngChunkType::IDAT,
+                        std::span{ stream }.subspan(
+                            offset,
+                            std::min( idat_size, stream.size() - offset ) ) ) );
+    }
+
+    append_bytes( png, make_chunk( PngChunkType::IEND, {} ) );
+    return png;
+}
+
+// Prefixes each row of a packed image with filter type NONE.
+inline std::vector<std::byte>
+unfiltered_scanlines( const std::span<const std::byte> image,
+                      const std::size_t                stride ) {
+    std::vector<std::byte> scanlines;
+    for ( std::size_t offset{ 0 }; offset < image.size(); offset += stride ) {
+        scanlines.push_back( std::byte{ 0 } );
+        append_bytes( scanlines, image.subspan( offset, stride ) );
+    }
+    return scanlines;
+}
+
+// Splits a packed image into Adam7 pass scanlines, each with filter type
+// NONE. Sub-byte pixels are repacked MSB first.
+inline std::vector<std::byte>
+adam7_scanlines( const std::span<const std::byte> image,
+                 const ImageLayout &              layout ) {
+    const std::size_t      bits{ layout.bits_per_pixel };
+    std::vector<std::byte> scanlines;
+    for ( const auto & pass : IHDR::adam7_passes ) {
+        const auto columns{ IHDR::pass_width( pass, layout.width ) };
+        if ( columns == 0 ) {
+            continue;
+        }
+        const auto pass_stride{ ( columns * bits + byte_bits - 1 )
+                                / byte_bits };
+        for ( std::uint32_t y{ pass.y_offset }; y < layout.height;
+              y += pass.y_step ) {
+            scanlines.push_back( std::byte{ 0 } );
+            const auto row_start{ scanlines.size() };
+            scanlines.resize( row_start + pass_stride );
+
+            std::size_t target_bit{ 0 };
+            for ( std::uint32_t x{ pass.x_offset }; x < layout.width;
+                  x += pass.x_step ) {
+                for ( std::size_t bit{ 0 }; bit < bits; ++bit ) {
+                    const auto source_bit{ x * bits + bit };
+                    const auto value{
+                        ( std::to_integer<unsigned>(
+                              image[y * layout.stride + source_bit / byte_bits] )
+                          >> ( byte_bits - 1 - source_bit % byte_bits ) )
+                        & 1U
+                    };
+                    scanlines[row_start + target_bit / byte_bits] |=
+                        static_cast<std::byte>(
+                            value << ( byte_bits - 1 - target_bit % byte_bits ) );
+                    ++target_bit;
+                }
+            }
+        }
+    }
+    return scanlines;
+}
+
+// PLTE chunk of `entries` distinct colours, see palette_colour().
+inline std::vector<std::byte>
+make_palette_chunk( const std::size_t entries ) {
+    std::vector<std::byte> palette;
+    for ( std::size_t i{ 0 }; i < entries; ++i ) {
+        palette.push_back( static_cast<std::byte>( i ) );
+        palette.push_back( static_cast<std::byte>( 255 - i ) );
+        palette.push_back( static_cast<std::byte>( i * 7 ) );
+    }
+    return make_chunk( PngChunkType::PLTE, palette );
+}
+
+// The PLTE an image of `colour_type` needs, one entry per sample value.
+inline std::vector<std::byte>
+required_chunks( const IHDR::ColourType colour_type,
+                 const IHDR::BitDepth   bit_depth ) {
+    if ( colour_type != IHDR::ColourType::INDEXED_COLOUR ) {
+        return {};
+    }
+    return make_palette_chunk( std::size_t{ 1 } << bit_depth );
+}
+
+constexpr std::array<std::byte, 3>
+palette_colour( const std::size_t index ) {
+    return { static_cast<std::byte>( index ),
+             static_cast<std::byte>( 255 - index ),
+             static_cast<std::byte>( index * 7 ) };
+}
+
+} // namespace
+
+bool test_decode_truecolour();
+bool test_decode_filters();
+bool test_decode_adam7();
+bool test_decode_progressive();
+bool test_decode_unpacked();
+bool test_decode_palette();
+bool test_decode_indexed();
+bool test_decode_16_bit();
+bool test_decode_into();
+bool test_decode_to_image();
+bool test_decode_row_range();
+bool test_decode_index();
+bool test_decode_parallel();
+bool test_decode_metrics();
+bool test_decode_errors();
+
+const auto test_functions = std::vector{
+    test_decode_truecolour,  test_decode_filters,  test_decode_adam7,
+    test_decode_progressive, test_decode_unpacked, test_decode_palette,
+    test_decode_indexed,     test_decode_16_bit,   test_decode_into,
+    test_decode_to_image,    test_decode_row_range, test_decode_index,
+    test_decode_parallel,    test_decode_metrics,  test_decode_errors
+};
+
+} // namespace PNG
+
+int png_decoder_test( [[maybe_unused]] int     argc,
+                      [[maybe_unused]] char ** argv );
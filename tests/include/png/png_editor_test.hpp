@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_decoder.hpp"
+#include "png/png_editor.hpp"
+#include "png/png_test_helpers.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// A small RGB PNG split over several IDAT chunks, with a tEXt chunk.
+inline std::vector<std::byte>
+editable_png() {
+    EncodeOptions options{};
+    options.idat_size = 256;
+    const auto png{ encode_image(
+        make_header( 64, 64, 8, IHDR::ColourType::TRUE_COLOUR ),
+        pattern_image( 64 * 64 * 3 ), options ) };
+
+    // Splice a tEXt chunk in before IEND with the editor itself
+    PngEditor              editor{ png };
+    std::vector<std::byte> edited;
+    editor.set_text( "Title", "Original" );
+    editor.write( buffer_sink( edited ) );
+    return edited;
+}
+
+// Bytes of `text`.
+inline std::vector<std::byte>
+text_bytes( const std::string_view text ) {
+    std::vector<std::byte> bytes;
+    for ( const auto c : text ) {
+        bytes.push_back( static_cast<std::byte>( c ) );
+    }
+    return bytes;
+}
+
+// The edited PNG `editor` writes to a buffer.
+inline std::vector<std::byte>
+written( const PngEditor & editor ) {
+    std::vector<std::byte> png;
+    editor.write( buffer_sink( png ) );
+    return png;
+}
+
+} // namespace
+
+bool test_edit_chunks();
+bool test_edit_file();
+bool test_edit_rechunk();
+bool test_edit_errors();
+
+const auto test_functions = std::vector{ test_edit_chunks, test_edit_file,
+                                         test_edit_rechunk, test_edit_errors };
+
+} // namespace PNG
+
+int png_editor_test( [[maybe_unused]] int     argc,
+                     [[maybe_unused]] char ** argv );
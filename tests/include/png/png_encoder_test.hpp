@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_decoder.hpp"
+#include "png/png_encoder.hpp"
+#include "png/png_test_helpers.hpp"
+
+#include <array>
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// Types of the chunks of `png`, in order.
+inline std::vector<PngChunkType>
+chunk_types( const std::span<const std::byte> png ) {
+    const PngDecoder          decoder{ png };
+    std::vector<PngChunkType> types;
+    for ( const auto & chunk : decoder.chunks() ) {
+        types.push_back( chunk.type );
+    }
+    return types;
+}
+
+} // namespace
+
+bool test_encode_round_trip();
+bool test_encode_chunks();
+bool test_encode_streaming();
+bool test_encode_segments();
+bool test_encode_parallel();
+bool test_encode_adaptive_filter();
+bool test_encode_errors();
+
+const auto test_functions =
+    std::vector{ test_encode_round_trip, test_encode_chunks,
+                 test_encode_streaming, test_encode_segments,
+                 test_encode_parallel,   test_encode_adaptive_filter,
+                 test_encode_errors };
+
+} // namespace PNG
+
+int png_encoder_test( [[maybe_unused]] int     argc,
+                      [[maybe_unused]] char ** argv );
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_image.hpp"
+
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// CountingResource: forwards to `upstream`, counting live allocations &
+// bytes so tests can see which resource an Image used.
+class CountingResource : public std::pmr::memory_resource
+{
+    public:
+    explicit CountingResource(
+        std::pmr::memory_resource * upstream =
+            std::pmr::new_delete_resource() ) noexcept :
+        m_upstream( upstream ) {}
+
+    std::size_t allocations{ 0 };
+    std::size_t live_bytes{ 0 };
+
+    private:
+    void * do_allocate( const std::size_t bytes,
+                        const std::size_t alignment ) override {
+        ++allocations;
+        live_bytes += bytes;
+        return m_upstream->allocate( bytes, alignment );
+    }
+    void do_deallocate( void * const p, const std::size_t bytes,
+                        const std::size_t alignment ) override {
+        live_bytes -= bytes;
+        m_upstream->deallocate( p, bytes, alignment );
+    }
+    [[nodiscard]] bool do_is_equal(
+        const std::pmr::memory_resource & other ) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource * m_upstream;
+};
+
+} // namespace
+
+bool test_image_layout();
+bool test_image_allocator();
+
+const auto test_functions = std::vector{ test_image_layout,
+                                         test_image_allocator };
+
+} // namespace PNG
+
+int png_image_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
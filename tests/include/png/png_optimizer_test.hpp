@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_optimizer.hpp"
+#include "png/png_test_helpers.hpp"
+
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// Encodes `image`, tightly packed rows, as an 8 or 16 bit RGBA PNG with
+// no filtering & fast compression, the kind of file there is most to gain
+// on.
+inline std::vector<std::byte>
+rgba_png( const std::uint32_t width, const std::uint32_t height,
+          const IHDR::BitDepth             bit_depth,
+          const std::span<const std::byte> image ) {
+    EncodeOptions options{};
+    options.level = ZLIB::CompressionLevel::FAST;
+    return encode_image( make_header( width, height, bit_depth,
+                                      IHDR::ColourType::TRUE_COLOUR_ALPHA ),
+                         image, options );
+}
+
+// 8 bit RGBA pixels from a function of the pixel's column & row.
+template <typename Pixel>
+std::vector<std::byte>
+rgba_image( const std::uint32_t width, const std::uint32_t height,
+            const Pixel & pixel ) {
+    std::vector<std::byte> image;
+    for ( std::uint32_t y{ 0 }; y < height; ++y ) {
+        for ( std::uint32_t x{ 0 }; x < width; ++x ) {
+            for ( const auto sample : pixel( x, y ) ) {
+                image.push_back( static_cast<std::byte>( sample ) );
+            }
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+bool test_optimize_reductions();
+bool test_optimize();
+bool test_optimize_errors();
+
+const auto test_functions = std::vector{ test_optimize_reductions,
+                                         test_optimize, test_optimize_errors };
+
+} // namespace PNG
+
+int png_optimizer_test( [[maybe_unused]] int     argc,
+                        [[maybe_unused]] char ** argv );
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "common/crc.hpp"
+#include "png/png_encoder.hpp"
+
+#include <array>
+#include <vector>
+
+// Building blocks the png tests share: raw chunk serialization for
+// hand made & damaged files, & PngEncoder fixtures for well formed ones.
+namespace PNG
+{
+
+namespace
+{
+
+// Runs `action`, returning the error code of any png_error it throws.
+template <typename Action>
+png_error_t
+error_from( Action && action ) {
+    try {
+        action();
+    }
+    catch ( const png_error & error ) {
+        return error.error();
+    }
+    return png_error_t::NONE;
+}
+
+// A chunk of a test PNG, without its length & CRC.
+struct TestChunk
+{
+    PngChunkType           type;
+    std::vector<std::byte> data;
+};
+
+template <typename... Ts>
+constexpr std::array<std::byte, sizeof...( Ts )>
+make_bytes( const Ts... values ) {
+    return { static_cast<std::byte>( values )... };
+}
+
+inline void
+append_bytes( std::vector<std::byte> &         target,
+              const std::span<const std::byte> bytes ) {
+    target.insert( target.end(), bytes.begin(), bytes.end() );
+}
+
+template <IntOrEnum T, std::endian E = std::endian::big>
+void
+append_integer( std::vector<std::byte> & target, const T value ) {
+    append_bytes( target, to_bytes<T, std::endian::native, E>( value ) );
+}
+
+// Serializes a chunk, including its length & CRC fields.
+inline std::vector<std::byte>
+make_chunk( const PngChunkType type, const std::span<const std::byte> data ) {
+    std::vector<std::byte> chunk;
+    append_integer( chunk, static_cast<std::uint32_t>( data.size() ) );
+    append_integer( chunk, type );
+    append_bytes( chunk, data );
+
+    CRC::CrcTable32 crc_calculator(
+        CRC::PNG::png_polynomial<std::endian::big>() );
+    const auto crc{ crc_calculator.crc(
+        std::span{ chunk }.subspan( 4, data.size() + 4 ) ) };
+    append_integer( chunk, static_cast<std::uint32_t>( crc.to_ulong() ) );
+    return chunk;
+}
+
+// The chunks of `png`, which must be well formed.
+inline std::vector<TestChunk>
+split_chunks( const std::span<const std::byte> png ) {
+    std::vector<TestChunk> chunks;
+    for ( std::size_t offset{ png_signature_bytes }; offset < png.size(); ) {
+        const auto length{ span_to_integer<std::uint32_t, std::endian::big>(
+            png.subspan( offset, 4 ) ) };
+        const auto type{ static_cast<PngChunkType>(
+            span_to_integer<std::uint32_t, std::endian::big>(
+                png.subspan( offset + 4, 4 ) ) ) };
+        const auto data{ png.subspan( offset + 8, length ) };
+        chunks.push_back( { type, { data.begin(), data.end() } } );
+        offset += chunk_overhead_bytes + length;
+    }
+    return chunks;
+}
+
+// A PNG of `chunks`, with correct CRCs.
+inline std::vector<std::byte>
+join_chunks( const std::span<const TestChunk> chunks ) {
+    std::vector<std::byte> png;
+    append_integer( png, png_signature );
+    for ( const auto & chunk : chunks ) {
+        append_bytes( png, make_chunk( chunk.type, chunk.data ) );
+    }
+    return png;
+}
+
+inline IHDR::IhdrChunkPayload
+make_header( const std::uint32_t width, const std::uint32_t height,
+             const IHDR::BitDepth        bit_depth,
+             const IHDR::ColourType      colour_type,
+             const IHDR::InterlaceMethod interlace =
+                 IHDR::InterlaceMethod::NO_INTERLACE ) {
+    return IHDR::IhdrChunkPayload{
+        width,
+        height,
+        bit_depth,
+        colour_type,
+        IHDR::CompressionMethod::COMPRESSION_METHOD_0,
+        IHDR::FilterMethod::FILTER_METHOD_0,
+        interlace
+    };
+}
+
+// Deterministic bytes without short repeats, so images of them neither
+// vanish under compression nor all filter alike.
+inline std::vector<std::byte>
+pattern_image( const std::size_t size ) {
+    std::vector<std::byte> image( size );
+    for ( std::size_t i{ 0 }; i < size; ++i ) {
+        image[i] = static_cast<std::byte>( ( i * 37 + i / 97 ) & 0xFF );
+    }
+    return image;
+}
+
+// A full 256 entry palette, so every 8 bit index is in range.
+inline std::vector<PLTE::Palette>
+full_palette() {
+    std::vector<PLTE::Palette> palette;
+    for ( std::size_t i{ 0 }; i < 256; ++i ) {
+        palette.push_back( PLTE::Palette{
+            .red = static_cast<PLTE::colour_t>( i ),
+            .green = static_cast<PLTE::colour_t>( 255 - i ),
+            .blue = static_cast<PLTE::colour_t>( i * 7 ) } );
+    }
+    return palette;
+}
+
+// Encodes `image`, tightly packed rows, in one write_rows call. Indexed
+// images get as much of full_palette() as their bit depth can index.
+inline std::vector<std::byte>
+encode_image( const IHDR::IhdrChunkPayload &   header,
+              const std::span<const std::byte> image,
+              const EncodeOptions &            options = {} ) {
+    std::vector<std::byte> png;
+    PngEncoder             encoder{ header, buffer_sink( png ), options };
+    if ( header.getColourType() == IHDR::ColourType::INDEXED_COLOUR ) {
+        const auto palette{ full_palette() };
+        encoder.write_palette( std::span{ palette }.first(
+            std::size_t{ 1 } << header.getBitDepth() ) );
+    }
+    encoder.write_rows( image );
+    encoder.finish();
+    return png;
+}
+
+} // namespace
+
+} // namespace PNG
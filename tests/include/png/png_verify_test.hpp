@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common/test_interface.hpp"
+#include "png/png_test_helpers.hpp"
+#include "png/png_verify.hpp"
+
+#include <vector>
+
+namespace PNG
+{
+
+namespace
+{
+
+// A small Adam7 RGB PNG split over several IDAT chunks.
+inline std::vector<std::byte>
+verifiable_png() {
+    EncodeOptions options{};
+    options.idat_size = 512;
+    return encode_image( make_header( 48, 40, 8, IHDR::ColourType::TRUE_COLOUR,
+                                      IHDR::InterlaceMethod::ADAM_7 ),
+                         pattern_image( 48 * 40 * 3 ), options );
+}
+
+} // namespace
+
+bool test_verify_intact();
+bool test_verify_layout();
+bool test_verify_data();
+bool test_verify_file();
+
+const auto test_functions = std::vector{ test_verify_intact,
+                                         test_verify_layout, test_verify_data,
+                                         test_verify_file };
+
+} // namespace PNG
+
+int png_verify_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv );
@@ -0,0 +1,192 @@
+#include "png/png_apng_test.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+namespace PNG
+{
+
+namespace
+{
+
+// Canvases of every frame `decoder` has left, copied out.
+std::vector<std::vector<std::byte>>
+decoded_canvases( ApngDecoder & decoder ) {
+    std::vector<std::vector<std::byte>> canvases;
+    for ( const auto & frame : decoder ) {
+        canvases.emplace_back( frame.canvas.begin(), frame.canvas.end() );
+    }
+    return canvases;
+}
+
+// `apng` with the data of the first chunk of `type` changed by `edit`, its
+// CRC recomputed.
+template <typename Edit>
+std::vector<std::byte>
+edited_chunk( const std::span<const std::byte> apng, const PngChunkType type,
+              const Edit & edit ) {
+    const PngDecoder decoder{ apng };
+    for ( const auto & chunk : decoder.chunks() ) {
+        if ( chunk.type != type ) {
+            continue;
+        }
+        std::vector<std::byte> data( chunk.data.begin(), chunk.data.end() );
+        edit( data );
+        std::vector<std::byte> edited( apng.begin(),
+                                       apng.begin() + chunk.offset );
+        const auto             replaced{ make_chunk( type, data ) };
+        edited.insert( edited.end(), replaced.begin(), replaced.end() );
+        edited.insert( edited.end(),
+                       apng.begin() + chunk.offset + chunk_overhead_bytes
+                           + chunk.data.size(),
+                       apng.end() );
+        return edited;
+    }
+    return { apng.begin(), apng.end() };
+}
+
+} // namespace
+
+bool
+test_apng_frames() {
+    const auto frames{ test_frames() };
+    const auto expected{ reference_canvases( 37, 21, frames ) };
+    const auto apng{ make_apng( 37, 21, frames, true ) };
+
+    ApngDecoder one_ahead{ apng, ApngOptions{ .decode_ahead = 1,
+                                              .threads = 1 } };
+    ApngDecoder threaded{ apng, ApngOptions{ .decode_ahead = 4,
+                                             .threads = 3 } };
+    const auto  serial_canvases{ decoded_canvases( one_ahead ) };
+    const auto  threaded_canvases{ decoded_canvases( threaded ) };
+
+    // Frames come back in order with their controls
+    threaded.rewind();
+    std::vector<std::uint32_t> indices;
+    bool                       controls_match{ true };
+    while ( const auto frame{ threaded.next_frame() } ) {
+        indices.push_back( frame->index );
+        controls_match = controls_match
+                         && frame->control.width
+                                == frames[frame->index].control.width
+                         && frame->control.blend_op
+                                == frames[frame->index].control.blend_op;
+    }
+
+    const auto test_results = std::vector<bool>{
+        one_ahead.frames().size() == frames.size(),
+        one_ahead.default_image_is_frame(),
+        serial_canvases == expected,
+        // Parallel batches composite the same canvases
+        threaded_canvases == expected,
+        // Rewinding replays every frame in order
+        std::ranges::equal( indices, std::views::iota( 0U, 5U ) )
+            && controls_match,
+        !one_ahead.next_frame().has_value()
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_apng_default_image() {
+    const auto frames{ test_frames() };
+    const auto expected{ reference_canvases( 37, 21, frames ) };
+    const auto apng{ make_apng( 37, 21, frames, false ) };
+    ApngDecoder animated{ apng };
+
+    // A plain PNG is one frame of its own image
+    const IHDR::IhdrChunkPayload header{
+        5,
+        3,
+        8,
+        IHDR::ColourType::TRUE_COLOUR,
+        IHDR::CompressionMethod::COMPRESSION_METHOD_0,
+        IHDR::FilterMethod::FILTER_METHOD_0,
+        IHDR::InterlaceMethod::ADAM_7
+    };
+    std::vector<std::byte> rgb( 5 * 3 * 3 );
+    for ( std::size_t i{ 0 }; i < rgb.size(); ++i ) {
+        rgb[i] = static_cast<std::byte>( i * 17 );
+    }
+    std::vector<std::byte> png;
+    PngEncoder             encoder{ header, buffer_sink( png ) };
+    encoder.write_rows( rgb );
+    encoder.finish();
+    std::vector<std::byte> rgba;
+    for ( std::size_t i{ 0 }; i < rgb.size(); i += 3 ) {
+        const auto pixel{ std::span{ rgb }.subspan( i, 3 ) };
+        rgba.insert( rgba.end(), pixel.begin(), pixel.end() );
+        rgba.push_back( std::byte{ 0xFF } );
+    }
+    ApngDecoder still{ png };
+    const auto  still_canvases{ decoded_canvases( still ) };
+
+    const auto test_results = std::vector<bool>{
+        !animated.default_image_is_frame(),
+        decoded_canvases( animated ) == expected,
+        // A PNG without acTL is a single frame
+        still.frames().size() == 1 && still_canvases.size() == 1
+            && still_canvases[0] == rgba
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_apng_errors() {
+    const auto frames{ test_frames() };
+    const auto apng{ make_apng( 37, 21, frames, true ) };
+    const auto decode_all = []( const std::span<const std::byte> data ) {
+        return error_from( [&] {
+            ApngDecoder decoder{ data };
+            while ( decoder.next_frame() ) {}
+        } );
+    };
+
+    const auto bad_sequence{ edited_chunk(
+        apng, PngChunkType::fdAT,
+        []( std::vector<std::byte> & data ) { data[3] = std::byte{ 9 }; } ) };
+    const auto outside_canvas{ edited_chunk(
+        apng, PngChunkType::fcTL,
+        []( std::vector<std::byte> & data ) { data[7] = std::byte{ 38 }; } ) };
+    const auto extra_frame{ edited_chunk(
+        apng, PngChunkType::acTL,
+        []( std::vector<std::byte> & data ) { data[3] = std::byte{ 6 }; } ) };
+    const auto bad_blend{ edited_chunk(
+        apng, PngChunkType::fcTL,
+        []( std::vector<std::byte> & data ) { data[25] = std::byte{ 2 }; } ) };
+    // The first fdAT holds the zlib header of frame 1
+    const auto corrupt_data{ edited_chunk(
+        apng, PngChunkType::fdAT,
+        []( std::vector<std::byte> & data ) { data[4] = std::byte{ 0 }; } ) };
+
+    // A bad frame is reported again, rather than composited, when asked
+    // for once more
+    const auto retry_error{ error_from( [&] {
+        ApngDecoder decoder{ corrupt_data };
+        static_cast<void>( error_from( [&] {
+            while ( decoder.next_frame() ) {}
+        } ) );
+        static_cast<void>( decoder.next_frame() );
+    } ) };
+
+    const auto test_results = std::vector<bool>{
+        decode_all( apng ) == png_error_t::NONE,
+        retry_error == png_error_t::BAD_IMAGE_DATA,
+        decode_all( bad_sequence ) == png_error_t::BAD_ANIMATION,
+        decode_all( outside_canvas ) == png_error_t::BAD_ANIMATION,
+        decode_all( extra_frame ) == png_error_t::BAD_ANIMATION,
+        decode_all( bad_blend ) == png_error_t::BAD_ANIMATION,
+        decode_all( corrupt_data ) == png_error_t::BAD_IMAGE_DATA
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_apng_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG APNG", PNG::test_functions );
+}
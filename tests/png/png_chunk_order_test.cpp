@@ -0,0 +1,154 @@
+#include "png/png_chunk_order_test.hpp"
+
+namespace PNG
+{
+
+namespace
+{
+
+using chunk = PngChunkType;
+
+constexpr auto grey{ IHDR::ColourType::GREYSCALE };
+constexpr auto indexed{ IHDR::ColourType::INDEXED_COLOUR };
+constexpr auto rgb{ IHDR::ColourType::TRUE_COLOUR };
+
+} // namespace
+
+bool
+test_chunk_order_valid() {
+    // An unknown, ancillary chunk type
+    constexpr auto private_chunk{ static_cast<chunk>( 0x70'72'56'74 ) };
+
+    const auto test_results = std::vector<bool>{
+        order_error( grey, { chunk::IHDR, chunk::IDAT, chunk::IEND } )
+            == png_error_t::NONE,
+        order_error( rgb, { chunk::IHDR, chunk::gAMA, chunk::sRGB,
+                            chunk::pHYs, chunk::tEXt, chunk::IDAT,
+                            chunk::IDAT, chunk::IDAT, chunk::zTXt,
+                            chunk::tIME, chunk::IEND } )
+            == png_error_t::NONE,
+        order_error( indexed, { chunk::IHDR, chunk::cHRM, chunk::PLTE,
+                                chunk::tRNS, chunk::bKGD, chunk::hIST,
+                                chunk::sPLT, chunk::sPLT, chunk::IDAT,
+                                chunk::IEND } )
+            == png_error_t::NONE,
+        order_error( rgb, { chunk::IHDR, chunk::tRNS, chunk::bKGD,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::NONE,
+        // Palette suggestion in a true colour image
+        order_error( rgb, { chunk::IHDR, chunk::PLTE, chunk::bKGD,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::NONE,
+        // APNG whose default image is the first frame
+        order_error( rgb, { chunk::IHDR, chunk::acTL, chunk::fcTL,
+                            chunk::IDAT, chunk::fcTL, chunk::fdAT,
+                            chunk::fcTL, chunk::fdAT, chunk::IEND } )
+            == png_error_t::NONE,
+        order_error( rgb, { chunk::IHDR, private_chunk, chunk::IDAT,
+                            private_chunk, chunk::IEND } )
+            == png_error_t::NONE
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_chunk_order_invalid() {
+    const auto test_results = std::vector<bool>{
+        order_error( grey,
+                     { chunk::tEXt, chunk::IHDR, chunk::IDAT, chunk::IEND } )
+            == png_error_t::MISSING_IHDR,
+        order_error( grey,
+                     { chunk::IHDR, chunk::IHDR, chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( grey,
+                     { chunk::IHDR, chunk::PLTE, chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_PLTE,
+        order_error( indexed, { chunk::IHDR, chunk::IDAT, chunk::IEND } )
+            == png_error_t::MISSING_PLTE,
+        order_error( rgb,
+                     { chunk::IHDR, chunk::IDAT, chunk::PLTE, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::PLTE, chunk::PLTE,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::PLTE, chunk::gAMA,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        // tRNS must follow the palette of an indexed image
+        order_error( indexed, { chunk::IHDR, chunk::tRNS, chunk::PLTE,
+                                chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        // ... & so must tRNS & bKGD when a true colour image has one
+        order_error( rgb, { chunk::IHDR, chunk::tRNS, chunk::PLTE,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::bKGD, chunk::PLTE,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb,
+                     { chunk::IHDR, chunk::hIST, chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::pHYs, chunk::pHYs,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::IDAT, chunk::tEXt,
+                            chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb,
+                     { chunk::IHDR, chunk::IDAT, chunk::sRGB, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb,
+                     { chunk::IHDR, chunk::fdAT, chunk::IDAT, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::tEXt, chunk::IEND } )
+            == png_error_t::MISSING_IDAT,
+        order_error( rgb,
+                     { chunk::IHDR, chunk::IDAT, chunk::IEND, chunk::IEND } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        order_error( rgb, { chunk::IHDR, chunk::IDAT, chunk::tEXt } )
+            == png_error_t::TRUNCATED_CHUNK,
+        order_error( rgb, {} ) == png_error_t::TRUNCATED_CHUNK
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_chunk_order_sticky() {
+    ChunkOrderValidator order{};
+    const auto          first{ order.next( chunk::IHDR ) };
+    order.set_colour_type( indexed );
+    const auto before{ order.stage() };
+    const auto missing{ order.next( chunk::IDAT ) };
+    // Nothing after the first error is accepted
+    const auto palette{ order.next( chunk::PLTE ) };
+
+    ChunkOrderValidator complete{};
+    for ( const auto type : { chunk::IHDR, chunk::IDAT, chunk::IDAT } ) {
+        static_cast<void>( complete.next( type ) );
+    }
+    const auto image_data{ complete.stage() };
+    static_cast<void>( complete.next( chunk::IEND ) );
+
+    const auto test_results = std::vector<bool>{
+        first == png_error_t::NONE,
+        before == ChunkStage::HEADER,
+        missing == png_error_t::MISSING_PLTE,
+        palette == png_error_t::MISSING_PLTE,
+        order.finish() == png_error_t::MISSING_PLTE,
+        image_data == ChunkStage::IMAGE_DATA,
+        complete.stage() == ChunkStage::END,
+        complete.finish() == png_error_t::NONE
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_chunk_order_test( [[maybe_unused]] int    argc,
+                      [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Chunk Order", PNG::test_functions );
+}
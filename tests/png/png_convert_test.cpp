@@ -0,0 +1,217 @@
+#include "png/png_convert_test.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace PNG
+{
+
+bool
+test_unpack_samples() {
+    // Compares against a bit by bit unpack, over lengths covering both the
+    // vector body & the scalar tail
+    const auto unpack_matches = []( const IHDR::BitDepth bit_depth,
+                                    const bool           scale ) {
+        const auto packed{ noise_bytes( 64 ) };
+        const auto max_count{ packed.size() * byte_bits / bit_depth };
+        const auto multiplier{ scale ? CONVERT::full_range_scale( bit_depth ) :
+                                       1U };
+
+        bool matches{ true };
+        for ( std::size_t count{ 0 }; count <= max_count; count += 3 ) {
+            std::vector<std::byte> out( count + 1, std::byte{ 0xAA } );
+            CONVERT::unpack_samples( packed, out, count, bit_depth, scale );
+
+            for ( std::size_t i{ 0 }; i < count; ++i ) {
+                const auto bit{ i * bit_depth };
+                const auto sample{
+                    ( std::to_integer<unsigned>( packed[bit / byte_bits] )
+                      >> ( byte_bits - bit_depth - bit % byte_bits ) )
+                    & ( ( 1U << bit_depth ) - 1 )
+                };
+                matches &= std::to_integer<unsigned>( out[i] )
+                           == ( ( sample * multiplier ) & 0xFF );
+            }
+            // Nothing past `count` is written
+            matches &= out[count] == std::byte{ 0xAA };
+        }
+        return matches;
+    };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( unpack_matches, true,
+                                       IHDR::BitDepth{ 1 }, false ),
+        TEST_INTERFACE::test_function( unpack_matches, true,
+                                       IHDR::BitDepth{ 2 }, false ),
+        TEST_INTERFACE::test_function( unpack_matches, true,
+                                       IHDR::BitDepth{ 4 }, false ),
+        TEST_INTERFACE::test_function( unpack_matches, true,
+                                       IHDR::BitDepth{ 1 }, true ),
+        TEST_INTERFACE::test_function( unpack_matches, true,
+                                       IHDR::BitDepth{ 2 }, true ),
+        TEST_INTERFACE::test_function( unpack_matches, true,
+                                       IHDR::BitDepth{ 4 }, true ),
+        // Spot check the full range scale
+        CONVERT::full_range_scale( 1 ) == 0xFF,
+        CONVERT::full_range_scale( 2 ) == 0x55,
+        CONVERT::full_range_scale( 4 ) == 0x11
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_expand_palette() {
+    // Small palettes take the pshufb path, full ones the gather / permute
+    // path. Indices are drawn from all 256 values, so both also meet
+    // indices past the end of the palette.
+    const auto expand_matches = []( const std::size_t entries,
+                                    const std::size_t transparent,
+                                    const bool        with_alpha ) {
+        std::vector<std::byte> palette_bytes{ noise_bytes( 3 * entries, 7 ) };
+        const PLTE::PlteChunkPayload palette{ palette_bytes };
+        const auto                   transparency{ noise_bytes( transparent, 11 ) };
+        const CONVERT::PaletteLookup lookup{ palette, transparency };
+
+        auto indices{ noise_bytes( 300, 13 ) };
+        // Mostly in range, so small palettes also exercise the vector path
+        for ( std::size_t i{ 0 }; i < indices.size(); ++i ) {
+            if ( i % 97 != 0 ) {
+                indices[i] = static_cast<std::byte>(
+                    std::to_integer<std::size_t>( indices[i] ) % entries );
+            }
+        }
+
+        const std::size_t channels{ with_alpha ? 4U : 3U };
+        bool              matches{ true };
+        for ( std::size_t count{ 0 }; count <= indices.size(); count += 7 ) {
+            std::vector<std::byte> out( count * channels + 1,
+                                        std::byte{ 0xAA } );
+            CONVERT::expand_palette( indices, out, count, lookup, with_alpha );
+
+            for ( std::size_t i{ 0 }; i < count; ++i ) {
+                const auto index{ std::to_integer<std::size_t>( indices[i] ) };
+                const bool in_range{ index < entries };
+                for ( std::size_t c{ 0 }; c < 3; ++c ) {
+                    matches &= out[i * channels + c]
+                               == ( in_range ? palette_bytes[3 * index + c] :
+                                               std::byte{ 0 } );
+                }
+                if ( with_alpha ) {
+                    matches &= out[i * channels + 3]
+                               == ( index < transparent ? transparency[index] :
+                                                          std::byte{ 0xFF } );
+                }
+            }
+            // Nothing past `count` pixels is written
+            matches &= out[count * channels] == std::byte{ 0xAA };
+        }
+        return matches;
+    };
+
+    const auto test_results = std::vector<bool>{
+        TEST_INTERFACE::test_function( expand_matches, true, std::size_t{ 2 },
+                                       std::size_t{ 0 }, false ),
+        TEST_INTERFACE::test_function( expand_matches, true, std::size_t{ 16 },
+                                       std::size_t{ 5 }, true ),
+        TEST_INTERFACE::test_function( expand_matches, true, std::size_t{ 17 },
+                                       std::size_t{ 17 }, true ),
+        TEST_INTERFACE::test_function( expand_matches, true, std::size_t{ 200 },
+                                       std::size_t{ 0 }, false ),
+        TEST_INTERFACE::test_function( expand_matches, true, std::size_t{ 256 },
+                                       std::size_t{ 0 }, false ),
+        TEST_INTERFACE::test_function( expand_matches, true, std::size_t{ 256 },
+                                       std::size_t{ 100 }, true )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_convert_16() {
+    const auto samples{ noise_bytes( 2 * 301, 17 ) };
+    const auto sample_at = [&samples]( const std::size_t i ) {
+        return ( std::to_integer<std::uint32_t>( samples[2 * i] ) << 8 )
+               | std::to_integer<std::uint32_t>( samples[2 * i + 1] );
+    };
+
+    const auto swap_matches = [&]( const std::size_t count ) {
+        std::vector<std::byte> out( 2 * count );
+        CONVERT::swap_samples_16( samples, out, count );
+
+        bool matches{ true };
+        for ( std::size_t i{ 0 }; i < count; ++i ) {
+            std::uint16_t value{};
+            std::memcpy( &value, out.data() + 2 * i, sizeof( value ) );
+            matches &= value == sample_at( i );
+        }
+        return matches;
+    };
+
+    const auto reduce_matches =
+        [&]( const std::size_t pixels, const std::size_t channels,
+             const CONVERT::pixel_offsets_t & offsets ) {
+        std::vector<std::byte> out( pixels * channels + 1, std::byte{ 0xAA } );
+        CONVERT::reduce_samples_16( samples, out, pixels, channels, offsets );
+
+        bool matches{ out[pixels * channels] == std::byte{ 0xAA } };
+        for ( std::size_t i{ 0 }; i < pixels * channels; ++i ) {
+            const auto offset{ offsets[( i / channels ) % 8] };
+            matches &= std::to_integer<std::uint32_t>( out[i] )
+                       == ( sample_at( i ) * 255 + offset ) >> 16;
+        }
+        return matches;
+    };
+
+    // Rounding is exact over every 16 bit value
+    const auto rounds_to_nearest = [] {
+        std::vector<std::byte> all_samples( 2 * 65536 );
+        for ( std::size_t value{ 0 }; value < 65536; ++value ) {
+            all_samples[2 * value] = static_cast<std::byte>( value >> 8 );
+            all_samples[2 * value + 1] = static_cast<std::byte>( value );
+        }
+        std::vector<std::byte> out( 65536 );
+        CONVERT::reduce_samples_16( all_samples, out, out.size(), 1,
+                                    CONVERT::rounding_offsets );
+
+        bool matches{ true };
+        for ( std::size_t value{ 0 }; value < 65536; ++value ) {
+            matches &= std::to_integer<std::size_t>( out[value] )
+                       == ( 2 * value * 255 + 65535 ) / ( 2 * 65535 );
+        }
+        return matches;
+    };
+
+    // Every threshold of the 8 x 8 matrix is used exactly once
+    const auto dither_covers_matrix = [] {
+        std::array<bool, 64> seen{};
+        for ( std::uint32_t y{ 0 }; y < 8; ++y ) {
+            for ( const auto offset : CONVERT::dither_offsets( y ) ) {
+                seen[offset / 1024] = true;
+            }
+        }
+        return std::ranges::all_of( seen, []( const bool s ) { return s; } );
+    };
+
+    const auto test_results = std::vector<bool>{
+        swap_matches( 0 ),
+        swap_matches( 7 ),
+        swap_matches( 301 ),
+        reduce_matches( 300, 1, CONVERT::rounding_offsets ),
+        reduce_matches( 45, 3, CONVERT::dither_offsets( 3 ) ),
+        reduce_matches( 75, 4, CONVERT::dither_offsets( 6, 1, 2 ) ),
+        reduce_matches( 150, 2, CONVERT::dither_offsets( 0, 4, 8 ) ),
+        rounds_to_nearest(),
+        dither_covers_matrix()
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_convert_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Convert",
+                                      PNG::test_functions );
+}
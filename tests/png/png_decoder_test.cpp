@@ -0,0 +1,1198 @@
+#include "png/png_decoder_test.hpp"
+
+#include "common/deflate.hpp"
+#include "common/perf_counters.hpp"
+#include "common/trace.hpp"
+#include "png/png_convert.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace PNG
+{
+
+bool
+test_decode_truecolour() {
+    constexpr std::uint32_t width{ 7 };
+    constexpr std::uint32_t height{ 5 };
+    constexpr std::size_t   stride{ width * 3 };
+
+    const auto image{ pattern_image( stride * height ) };
+    const auto png{ make_png(
+        width, height, IHDR::BitDepth{ 8 }, IHDR::ColourType::TRUE_COLOUR,
+        IHDR::InterlaceMethod::NO_INTERLACE,
+        unfiltered_scanlines( image, stride ), {}, 16 ) };
+
+    PngDecoder decoder{ png };
+    const auto layout{ decoder.layout() };
+
+    const auto test_results = std::vector<bool>{
+        layout.width == width && layout.height == height,
+        layout.bits_per_pixel == 24 && layout.stride == stride,
+        // IDAT split into 16 byte chunks
+        std::ranges::count( decoder.chunks(), PngChunkType::IDAT,
+                            &PngChunkView::type )
+            > 1,
+        std::ranges::equal( decoder.decode(), image ),
+        // Decoding is repeatable
+        std::ranges::equal( decoder.decode(), image )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_filters() {
+    // 4 x 4 greyscale, one row per filter type after the first
+    // clang-format off
+    const auto scanlines{ make_bytes(
+        1, 10, 10, 10, 10,  // Sub:     10 20 30 40
+        2,  1,  2,  3,  4,  // Up:      11 22 33 44
+        3,  7,  7,  8,  8,  // Average: 12 24 36 48
+        4,  1,  2,  3,  4 ) // Paeth:   13 26 39 52
+    };
+    const auto expected{ make_bytes(
+        10, 20, 30, 40,
+        11, 22, 33, 44,
+        12, 24, 36, 48,
+        13, 26, 39, 52 ) };
+    // clang-format on
+
+    const auto png{ make_png( 4, 4, IHDR::BitDepth{ 8 },
+                              IHDR::ColourType::GREYSCALE,
+                              IHDR::InterlaceMethod::NO_INTERLACE,
+                              scanlines ) };
+
+    PngDecoder decoder{ png };
+    return std::ranges::equal( decoder.decode(), expected );
+}
+
+bool
+test_decode_adam7() {
+    const auto decode_adam7 = []( const std::uint32_t width,
+                                  const std::uint32_t height,
+                                  const IHDR::BitDepth bit_depth,
+                                  const IHDR::ColourType colour_type ) {
+        const ImageLayout layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = IHDR::bits_per_pixel( colour_type, bit_depth ),
+            .stride = IHDR::scanline_bytes( width, colour_type, bit_depth )
+        };
+
+        // Padding bits at the end of each row are not part of the image
+        auto image{ pattern_image( layout.size() ) };
+        const auto padding_bits{ layout.stride * byte_bits
+                                 - width * layout.bits_per_pixel };
+        for ( std::size_t y{ 0 }; y < height; ++y ) {
+            auto & last{ image[( y + 1 ) * layout.stride - 1] };
+            last &= static_cast<std::byte>( 0xFF << padding_bits );
+        }
+
+        const auto png{ make_png(
+            width, height, bit_depth, colour_type,
+            IHDR::InterlaceMethod::ADAM_7, adam7_scanlines( image, layout ),
+            required_chunks( colour_type, bit_depth ) ) };
+
+        PngDecoder decoder{ png };
+        return std::ranges::equal( decoder.decode(), image );
+    };
+
+    const auto test_results = std::vector<bool>{
+        decode_adam7( 9, 9, 8, IHDR::ColourType::GREYSCALE ),
+        decode_adam7( 13, 11, 16, IHDR::ColourType::TRUE_COLOUR_ALPHA ),
+        decode_adam7( 10, 5, 1, IHDR::ColourType::GREYSCALE ),
+        decode_adam7( 3, 17, 4, IHDR::ColourType::INDEXED_COLOUR ),
+        // Narrower than some passes, which are then empty
+        decode_adam7( 1, 1, 8, IHDR::ColourType::GREYSCALE ),
+        decode_adam7( 2, 3, 2, IHDR::ColourType::GREYSCALE )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_progressive() {
+    constexpr std::uint32_t size{ 9 };
+
+    const ImageLayout layout{
+        .width = size, .height = size, .bits_per_pixel = 8, .stride = size
+    };
+    const auto image{ pattern_image( layout.size() ) };
+    const auto png{ make_png( size, size, IHDR::BitDepth{ 8 },
+                              IHDR::ColourType::GREYSCALE,
+                              IHDR::InterlaceMethod::ADAM_7,
+                              adam7_scanlines( image, layout ) ) };
+
+    std::vector<std::uint8_t> passes;
+    bool                      first_pass_replicated{ false };
+
+    DecodeOptions options{};
+    options.on_pass_complete = [&]( const std::uint8_t               pass,
+                                    const std::span<const std::byte> preview,
+                                    const ImageLayout & ) {
+        passes.push_back( pass );
+        if ( pass != 1 ) {
+            return;
+        }
+        // Each pass 1 pixel covers the 8 x 8 block at its top left
+        first_pass_replicated = true;
+        for ( std::uint32_t y{ 0 }; y < size; ++y ) {
+            for ( std::uint32_t x{ 0 }; x < size; ++x ) {
+                first_pass_replicated &=
+                    preview[y * size + x]
+                    == image[( y / 8 * 8 ) * size + x / 8 * 8];
+            }
+        }
+    };
+
+    PngDecoder decoder{ png };
+    const auto decoded{ decoder.decode( options ) };
+
+    const auto test_results = std::vector<bool>{
+        passes == std::vector<std::uint8_t>{ 1, 2, 3, 4, 5, 6, 7 },
+        first_pass_replicated, std::ranges::equal( decoded, image )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_unpacked() {
+    const auto decode_unpacked = []( const std::uint32_t         width,
+                                     const std::uint32_t         height,
+                                     const IHDR::BitDepth        bit_depth,
+                                     const IHDR::ColourType      colour_type,
+                                     const IHDR::InterlaceMethod interlace ) {
+        const ImageLayout packed_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = bit_depth,
+            .stride = IHDR::scanline_bytes( width, colour_type, bit_depth )
+        };
+        const auto packed{ pattern_image( packed_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( packed, packed_layout ) :
+                                  unfiltered_scanlines( packed,
+                                                        packed_layout.stride ) };
+        const auto png{ make_png( width, height, bit_depth, colour_type,
+                                  interlace, scanlines,
+                                  required_chunks( colour_type, bit_depth ) ) };
+
+        const bool scale{ colour_type == IHDR::ColourType::GREYSCALE };
+        const auto multiplier{ scale ? CONVERT::full_range_scale( bit_depth ) :
+                                       1U };
+
+        DecodeOptions options{};
+        options.unpack_samples = true;
+        options.scale_greyscale = true;
+
+        PngDecoder decoder{ png };
+        const auto layout{ decoder.layout( options ) };
+        const auto image{ decoder.decode( options ) };
+
+        bool matches{ layout.bits_per_pixel == 8 && layout.stride == width
+                      && image.size() == std::size_t{ width } * height };
+        for ( std::uint32_t y{ 0 }; matches && y < height; ++y ) {
+            for ( std::uint32_t x{ 0 }; x < width; ++x ) {
+                const auto bit{ x * bit_depth };
+                const auto sample{
+                    ( std::to_integer<unsigned>(
+                          packed[y * packed_layout.stride + bit / byte_bits] )
+                      >> ( byte_bits - bit_depth - bit % byte_bits ) )
+                    & ( ( 1U << bit_depth ) - 1 )
+                };
+                matches &= std::to_integer<unsigned>( image[y * width + x] )
+                           == ( ( sample * multiplier ) & 0xFF );
+            }
+        }
+        return matches;
+    };
+
+    const auto test_results = std::vector<bool>{
+        decode_unpacked( 37, 3, 1, IHDR::ColourType::GREYSCALE,
+                         IHDR::InterlaceMethod::NO_INTERLACE ),
+        decode_unpacked( 21, 9, 2, IHDR::ColourType::GREYSCALE,
+                         IHDR::InterlaceMethod::ADAM_7 ),
+        // Palette indices are unpacked but not scaled
+        decode_unpacked( 40, 4, 4, IHDR::ColourType::INDEXED_COLOUR,
+                         IHDR::InterlaceMethod::NO_INTERLACE ),
+        decode_unpacked( 11, 13, 4, IHDR::ColourType::INDEXED_COLOUR,
+                         IHDR::InterlaceMethod::ADAM_7 )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_palette() {
+    const auto decode_palette = []( const std::uint32_t         width,
+                                    const std::uint32_t         height,
+                                    const IHDR::BitDepth        bit_depth,
+                                    const IHDR::InterlaceMethod interlace,
+                                    const std::size_t           transparent ) {
+        const ImageLayout packed_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = bit_depth,
+            .stride = IHDR::scanline_bytes(
+                width, IHDR::ColourType::INDEXED_COLOUR, bit_depth )
+        };
+        const auto packed{ pattern_image( packed_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( packed, packed_layout ) :
+                                  unfiltered_scanlines( packed,
+                                                        packed_layout.stride ) };
+
+        // tRNS alpha is the inverted index
+        auto chunks{ required_chunks( IHDR::ColourType::INDEXED_COLOUR,
+                                      bit_depth ) };
+        std::vector<std::byte> alpha( transparent );
+        for ( std::size_t i{ 0 }; i < transparent; ++i ) {
+            alpha[i] = static_cast<std::byte>( ~i );
+        }
+        if ( transparent != 0 ) {
+            append_bytes( chunks, make_chunk( PngChunkType::tRNS, alpha ) );
+        }
+
+        const auto png{ make_png( width, height, bit_depth,
+                                  IHDR::ColourType::INDEXED_COLOUR, interlace,
+                                  scanlines, chunks ) };
+
+        DecodeOptions options{};
+        options.expand_palette = true;
+
+        PngDecoder        decoder{ png };
+        const auto        layout{ decoder.layout( options ) };
+        const auto        image{ decoder.decode( options ) };
+        const std::size_t channels{ transparent != 0 ? 4U : 3U };
+
+        bool matches{ layout.bits_per_pixel == 8 * channels
+                      && layout.stride == width * channels
+                      && image.size() == layout.size() };
+        for ( std::uint32_t y{ 0 }; matches && y < height; ++y ) {
+            for ( std::uint32_t x{ 0 }; x < width; ++x ) {
+                const auto bit{ x * bit_depth };
+                const auto index{
+                    ( std::to_integer<std::size_t>(
+                          packed[y * packed_layout.stride + bit / byte_bits] )
+                      >> ( byte_bits - bit_depth - bit % byte_bits ) )
+                    & ( ( 1U << bit_depth ) - 1 )
+                };
+                const auto pixel{ std::span{ image }.subspan(
+                    ( std::size_t{ y } * width + x ) * channels, channels ) };
+                matches &= std::ranges::equal( pixel.first( 3 ),
+                                               palette_colour( index ) );
+                if ( channels == 4 ) {
+                    matches &= pixel[3]
+                               == ( index < transparent ? alpha[index] :
+                                                          std::byte{ 0xFF } );
+                }
+            }
+        }
+        return matches;
+    };
+
+    const auto test_results = std::vector<bool>{
+        decode_palette( 45, 3, 8, IHDR::InterlaceMethod::NO_INTERLACE, 0 ),
+        decode_palette( 70, 4, 8, IHDR::InterlaceMethod::NO_INTERLACE, 200 ),
+        decode_palette( 19, 9, 8, IHDR::InterlaceMethod::ADAM_7, 3 ),
+        decode_palette( 33, 5, 2, IHDR::InterlaceMethod::NO_INTERLACE, 0 ),
+        decode_palette( 30, 7, 4, IHDR::InterlaceMethod::ADAM_7, 16 )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_indexed() {
+    const auto decode_indexed = []( const std::uint32_t         width,
+                                    const std::uint32_t         height,
+                                    const IHDR::BitDepth        bit_depth,
+                                    const IHDR::InterlaceMethod interlace ) {
+        const ImageLayout packed_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = bit_depth,
+            .stride = IHDR::scanline_bytes(
+                width, IHDR::ColourType::INDEXED_COLOUR, bit_depth )
+        };
+        const auto packed{ pattern_image( packed_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( packed, packed_layout ) :
+                                  unfiltered_scanlines( packed,
+                                                        packed_layout.stride ) };
+        auto chunks{ required_chunks( IHDR::ColourType::INDEXED_COLOUR,
+                                      bit_depth ) };
+        append_bytes( chunks,
+                      make_chunk( PngChunkType::tRNS, make_bytes( 0, 128 ) ) );
+        const auto png{ make_png( width, height, bit_depth,
+                                  IHDR::ColourType::INDEXED_COLOUR, interlace,
+                                  scanlines, chunks ) };
+
+        PngDecoder decoder{ png };
+        // Palette expansion is ignored for indexed output
+        DecodeOptions options{};
+        options.expand_palette = true;
+        const auto image{ decoder.decode_indexed( options ) };
+
+        const auto entries{ std::size_t{ 1 } << bit_depth };
+        bool       matches{
+            image.layout.bits_per_pixel == 8 && image.layout.stride == width
+            && image.indices.size() == std::size_t{ width } * height
+            && image.palette.getEntries() == entries
+            && std::ranges::equal( image.transparency, make_bytes( 0, 128 ) )
+        };
+        for ( std::size_t i{ 0 }; matches && i < entries; ++i ) {
+            const auto colour{ image.palette[i] };
+            matches &= std::ranges::equal(
+                std::array{ std::byte{ colour.red }, std::byte{ colour.green },
+                            std::byte{ colour.blue } },
+                palette_colour( i ) );
+        }
+        for ( std::uint32_t y{ 0 }; matches && y < height; ++y ) {
+            for ( std::uint32_t x{ 0 }; x < width; ++x ) {
+                const auto bit{ x * bit_depth };
+                const auto index{
+                    ( std::to_integer<unsigned>(
+                          packed[y * packed_layout.stride + bit / byte_bits] )
+                      >> ( byte_bits - bit_depth - bit % byte_bits ) )
+                    & ( ( 1U << bit_depth ) - 1 )
+                };
+                matches &= std::to_integer<unsigned>(
+                               image.indices[y * width + x] )
+                           == index;
+            }
+        }
+        return matches;
+    };
+
+    const auto grey{ make_png( 2, 2, IHDR::BitDepth{ 8 },
+                               IHDR::ColourType::GREYSCALE,
+                               IHDR::InterlaceMethod::NO_INTERLACE,
+                               unfiltered_scanlines( pattern_image( 4 ), 2 ) ) };
+
+    const auto test_results = std::vector<bool>{
+        decode_indexed( 50, 3, 8, IHDR::InterlaceMethod::NO_INTERLACE ),
+        decode_indexed( 17, 10, 4, IHDR::InterlaceMethod::ADAM_7 ),
+        decode_indexed( 9, 2, 1, IHDR::InterlaceMethod::NO_INTERLACE ),
+        error_from( [&] {
+            PngDecoder decoder{ grey };
+            static_cast<void>( decoder.decode_indexed() );
+        } ) == png_error_t::NOT_INDEXED
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_16_bit() {
+    const auto decode_16_bit = []( const std::uint32_t         width,
+                                   const std::uint32_t         height,
+                                   const IHDR::ColourType      colour_type,
+                                   const IHDR::InterlaceMethod interlace,
+                                   const SampleDepth16         sixteen_bit ) {
+        const ImageLayout source_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = IHDR::bits_per_pixel( colour_type, 16 ),
+            .stride = IHDR::scanline_bytes( width, colour_type, 16 )
+        };
+        const auto source{ pattern_image( source_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( source, source_layout ) :
+                                  unfiltered_scanlines( source,
+                                                        source_layout.stride ) };
+        const auto png{ make_png( width, height, IHDR::BitDepth{ 16 },
+                                  colour_type, interlace, scanlines ) };
+
+        DecodeOptions options{};
+        options.sixteen_bit = sixteen_bit;
+
+        PngDecoder decoder{ png };
+        const auto layout{ decoder.layout( options ) };
+        const auto image{ decoder.decode( options ) };
+
+        const std::size_t channels{ IHDR::channel_count( colour_type ) };
+        const bool        reduced{ sixteen_bit == SampleDepth16::ROUND_TO_8
+                            || sixteen_bit == SampleDepth16::DITHER_TO_8 };
+        const std::size_t sample_bytes{ reduced ? 1U : 2U };
+
+        bool matches{ layout.stride == width * channels * sample_bytes
+                      && image.size() == layout.size() };
+        for ( std::size_t i{ 0 }; matches && i < width * height * channels;
+              ++i ) {
+            const std::uint16_t sample{ static_cast<std::uint16_t>(
+                ( std::to_integer<unsigned>( source[2 * i] ) << 8 )
+                | std::to_integer<unsigned>( source[2 * i + 1] ) ) };
+            const auto x{ ( i / channels ) % width };
+            const auto y{ static_cast<std::uint32_t>( i / channels / width ) };
+
+            switch ( sixteen_bit ) {
+            case SampleDepth16::UNCHANGED: {
+                matches &= image[2 * i] == source[2 * i]
+                           && image[2 * i + 1] == source[2 * i + 1];
+            } break;
+            case SampleDepth16::NATIVE_ENDIAN: {
+                std::uint16_t value{};
+                std::memcpy( &value, image.data() + 2 * i, sizeof( value ) );
+                matches &= value == sample;
+            } break;
+            case SampleDepth16::ROUND_TO_8: {
+                matches &= std::to_integer<unsigned>( image[i] )
+                           == ( sample * 255U + 32895 ) >> 16;
+            } break;
+            case SampleDepth16::DITHER_TO_8: {
+                const auto offset{ CONVERT::dither_offsets( y )[x % 8] };
+                matches &= std::to_integer<unsigned>( image[i] )
+                           == ( sample * 255U + offset ) >> 16;
+            } break;
+            }
+        }
+        return matches;
+    };
+
+    constexpr auto rgba{ IHDR::ColourType::TRUE_COLOUR_ALPHA };
+    constexpr auto grey_alpha{ IHDR::ColourType::GREYSCALE_ALPHA };
+    constexpr auto none{ IHDR::InterlaceMethod::NO_INTERLACE };
+    constexpr auto adam7{ IHDR::InterlaceMethod::ADAM_7 };
+
+    const auto test_results = std::vector<bool>{
+        decode_16_bit( 21, 5, rgba, none, SampleDepth16::UNCHANGED ),
+        decode_16_bit( 21, 5, rgba, none, SampleDepth16::NATIVE_ENDIAN ),
+        decode_16_bit( 21, 5, rgba, none, SampleDepth16::ROUND_TO_8 ),
+        decode_16_bit( 21, 5, rgba, none, SampleDepth16::DITHER_TO_8 ),
+        decode_16_bit( 13, 11, grey_alpha, adam7,
+                       SampleDepth16::NATIVE_ENDIAN ),
+        decode_16_bit( 13, 11, IHDR::ColourType::TRUE_COLOUR, adam7,
+                       SampleDepth16::ROUND_TO_8 ),
+        // Dithering follows image coordinates through the Adam7 passes
+        decode_16_bit( 19, 17, grey_alpha, adam7, SampleDepth16::DITHER_TO_8 ),
+        decode_16_bit( 30, 3, IHDR::ColourType::GREYSCALE, none,
+                       SampleDepth16::DITHER_TO_8 )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_into() {
+    static constexpr auto padding_byte{ std::byte{ 0xA5 } };
+
+    // Decodes twice into the same padded buffer, rows must match decode()
+    // & padding must be left as it was.
+    const auto decode_padded = []( const std::uint32_t         width,
+                                   const std::uint32_t         height,
+                                   const IHDR::BitDepth        bit_depth,
+                                   const IHDR::ColourType      colour_type,
+                                   const IHDR::InterlaceMethod interlace,
+                                   const std::size_t           padding_bytes,
+                                   const DecodeOptions &       options ) {
+        const ImageLayout source_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = IHDR::bits_per_pixel( colour_type, bit_depth ),
+            .stride = IHDR::scanline_bytes( width, colour_type, bit_depth )
+        };
+        const auto source{ pattern_image( source_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( source, source_layout ) :
+                                  unfiltered_scanlines( source,
+                                                        source_layout.stride ) };
+        const auto png{ make_png( width, height, bit_depth, colour_type,
+                                  interlace, scanlines,
+                                  required_chunks( colour_type, bit_depth ) ) };
+
+        PngDecoder decoder{ png };
+        const auto expected{ decoder.decode( options ) };
+        const auto packed{ decoder.layout( options ) };
+        const auto stride{ packed.stride + padding_bytes };
+        const auto layout{ decoder.layout( options, stride ) };
+
+        std::vector<std::byte> image( layout.required_size(), padding_byte );
+        bool matches{ layout.stride == stride
+                      && layout.row_bytes() == packed.stride };
+        for ( int repeat{ 0 }; repeat < 2; ++repeat ) {
+            decoder.decode_into( image, stride, options );
+            for ( std::size_t y{ 0 }; matches && y < height; ++y ) {
+                const auto row{ std::span{ image }.subspan(
+                    y * stride, layout.row_bytes() ) };
+                const auto row_padding{ std::span{ image }.subspan(
+                    y * stride + layout.row_bytes(),
+                    y + 1 < height ? padding_bytes : 0 ) };
+                matches &= std::ranges::equal(
+                    row, std::span{ expected }.subspan( y * packed.stride,
+                                                        packed.stride ) );
+                matches &= std::ranges::all_of(
+                    row_padding, []( const auto b ) { return b == padding_byte; } );
+            }
+        }
+        return matches;
+    };
+
+    DecodeOptions expanded{};
+    expanded.expand_palette = true;
+    DecodeOptions rounded{};
+    rounded.sixteen_bit = SampleDepth16::ROUND_TO_8;
+    DecodeOptions progressive{};
+    progressive.on_pass_complete = []( const std::uint8_t,
+                                       const std::span<const std::byte>,
+                                       const ImageLayout & ) {};
+
+    constexpr auto none{ IHDR::InterlaceMethod::NO_INTERLACE };
+    constexpr auto adam7{ IHDR::InterlaceMethod::ADAM_7 };
+
+    const auto png{ make_png( 4, 4, IHDR::BitDepth{ 8 },
+                              IHDR::ColourType::GREYSCALE, none,
+                              unfiltered_scanlines( pattern_image( 16 ), 4 ) ) };
+    const auto decode_into_size = [&]( const std::size_t size,
+                                       const std::size_t stride ) {
+        std::vector<std::byte> image( size );
+        PngDecoder             decoder{ png };
+        decoder.decode_into( image, stride );
+    };
+
+    const auto test_results = std::vector<bool>{
+        decode_padded( 17, 6, IHDR::BitDepth{ 8 }, IHDR::ColourType::TRUE_COLOUR,
+                       none, 13, {} ),
+        decode_padded( 23, 9, IHDR::BitDepth{ 2 }, IHDR::ColourType::GREYSCALE,
+                       adam7, 5, {} ),
+        decode_padded( 23, 9, IHDR::BitDepth{ 2 }, IHDR::ColourType::GREYSCALE,
+                       adam7, 64, progressive ),
+        decode_padded( 19, 7, IHDR::BitDepth{ 4 },
+                       IHDR::ColourType::INDEXED_COLOUR, none, 3, expanded ),
+        decode_padded( 11, 13, IHDR::BitDepth{ 16 },
+                       IHDR::ColourType::TRUE_COLOUR_ALPHA, adam7, 20, rounded ),
+        // Exactly ( height - 1 ) * stride + row bytes is enough
+        error_from( [&] { decode_into_size( 3 * 6 + 4, 6 ); } )
+            == png_error_t::NONE,
+        error_from( [&] { decode_into_size( 3 * 6 + 3, 6 ); } )
+            == png_error_t::BAD_OUTPUT,
+        error_from( [&] { decode_into_size( 64, 3 ); } )
+            == png_error_t::BAD_OUTPUT
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_to_image() {
+    const auto decode_aligned = []( const std::uint32_t         width,
+                                    const std::uint32_t         height,
+                                    const IHDR::BitDepth        bit_depth,
+                                    const IHDR::ColourType      colour_type,
+                                    const IHDR::InterlaceMethod interlace,
+                                    const DecodeOptions &       options ) {
+        const ImageLayout source_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = IHDR::bits_per_pixel( colour_type, bit_depth ),
+            .stride = IHDR::scanline_bytes( width, colour_type, bit_depth )
+        };
+        const auto source{ pattern_image( source_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( source, source_layout ) :
+                                  unfiltered_scanlines( source,
+                                                        source_layout.stride ) };
+        const auto png{ make_png( width, height, bit_depth, colour_type,
+                                  interlace, scanlines,
+                                  required_chunks( colour_type, bit_depth ) ) };
+
+        PngDecoder decoder{ png };
+        const auto expected{ decoder.decode( options ) };
+        const auto packed{ decoder.layout( options ) };
+        const auto image{ decoder.decode_to_image( options ) };
+
+        bool matches{ image.stride() % Image::row_alignment == 0
+                      && image.layout().row_bytes() == packed.stride };
+        for ( std::uint32_t y{ 0 }; matches && y < height; ++y ) {
+            matches &= std::ranges::equal(
+                image.row( y ), std::span{ expected }.subspan(
+                                    y * packed.stride, packed.stride ) );
+        }
+        return matches;
+    };
+
+    DecodeOptions expanded{};
+    expanded.expand_palette = true;
+    DecodeOptions unpacked{};
+    unpacked.unpack_samples = true;
+
+    const auto test_results = std::vector<bool>{
+        decode_aligned( 29, 5, IHDR::BitDepth{ 8 },
+                        IHDR::ColourType::TRUE_COLOUR,
+                        IHDR::InterlaceMethod::NO_INTERLACE, {} ),
+        decode_aligned( 21, 13, IHDR::BitDepth{ 2 },
+                        IHDR::ColourType::INDEXED_COLOUR,
+                        IHDR::InterlaceMethod::ADAM_7, expanded ),
+        decode_aligned( 70, 3, IHDR::BitDepth{ 1 }, IHDR::ColourType::GREYSCALE,
+                        IHDR::InterlaceMethod::NO_INTERLACE, unpacked )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_row_range() {
+    // Rows [first_row, end_row) must match the same rows of a full decode
+    const auto decode_range = []( const std::uint32_t         width,
+                                  const std::uint32_t         height,
+                                  const IHDR::BitDepth        bit_depth,
+                                  const IHDR::ColourType      colour_type,
+                                  const IHDR::InterlaceMethod interlace,
+                                  const std::uint32_t         first_row,
+                                  const std::uint32_t         end_row,
+                                  DecodeOptions               options ) {
+        const ImageLayout source_layout{
+            .width = width,
+            .height = height,
+            .bits_per_pixel = IHDR::bits_per_pixel( colour_type, bit_depth ),
+            .stride = IHDR::scanline_bytes( width, colour_type, bit_depth )
+        };
+        const auto source{ pattern_image( source_layout.size() ) };
+        const auto scanlines{ interlace == IHDR::InterlaceMethod::ADAM_7 ?
+                                  adam7_scanlines( source, source_layout ) :
+                                  unfiltered_scanlines( source,
+                                                        source_layout.stride ) };
+        const auto png{ make_png( width, height, bit_depth, colour_type,
+                                  interlace, scanlines,
+                                  required_chunks( colour_type, bit_depth ) ) };
+
+        PngDecoder decoder{ png };
+        const auto full{ decoder.decode( options ) };
+        const auto stride{ decoder.layout( options ).stride };
+
+        options.first_row = first_row;
+        options.end_row = end_row;
+        const auto layout{ decoder.layout( options ) };
+        const auto image{ decoder.decode( options ) };
+
+        return layout.height == std::min( end_row, height ) - first_row
+               && layout.stride == stride && image.size() == layout.size()
+               && std::ranges::equal(
+                   image, std::span{ full }.subspan( first_row * stride,
+                                                     layout.size() ) );
+    };
+
+    // Only the first rows are present, decoding must stop before the end
+    const auto decode_truncated = []( const std::uint32_t end_row ) {
+        const auto source{ pattern_image( 16 * 20 ) };
+        const auto scanlines{ unfiltered_scanlines( source, 16 ) };
+        const auto png{ make_png(
+            16, 20, IHDR::BitDepth{ 8 }, IHDR::ColourType::GREYSCALE,
+            IHDR::InterlaceMethod::NO_INTERLACE,
+            std::span{ scanlines }.first( std::size_t{ end_row } * 17 ) ) };
+
+        DecodeOptions options{};
+        options.end_row = end_row;
+        PngDecoder decoder{ png };
+        return std::ranges::equal(
+            decoder.decode( options ),
+            std::span{ source }.first( std::size_t{ end_row } * 16 ) );
+    };
+
+    DecodeOptions progressive{};
+    progressive.on_pass_complete = []( const std::uint8_t,
+                                       const std::span<const std::byte>,
+                                       const ImageLayout & ) {};
+    DecodeOptions expanded{};
+    expanded.expand_palette = true;
+    DecodeOptions dithered{};
+    dithered.sixteen_bit = SampleDepth16::DITHER_TO_8;
+
+    constexpr auto grey{ IHDR::ColourType::GREYSCALE };
+    constexpr auto rgb{ IHDR::ColourType::TRUE_COLOUR };
+    constexpr auto indexed{ IHDR::ColourType::INDEXED_COLOUR };
+    constexpr auto none{ IHDR::InterlaceMethod::NO_INTERLACE };
+    constexpr auto adam7{ IHDR::InterlaceMethod::ADAM_7 };
+
+    const auto test_results = std::vector<bool>{
+        decode_range( 13, 20, 8, rgb, none, 0, 5, {} ),
+        decode_range( 13, 20, 8, rgb, none, 7, 20, {} ),
+        decode_range( 13, 20, 8, rgb, none, 3, 3, {} ),
+        decode_range( 21, 19, 4, indexed, none, 2, 11, expanded ),
+        decode_range( 23, 17, 2, grey, adam7, 0, 4, {} ),
+        decode_range( 23, 17, 2, grey, adam7, 5, 14, {} ),
+        decode_range( 23, 17, 2, grey, adam7, 3, 12, progressive ),
+        decode_range( 9, 30, 16, rgb, adam7, 9, 21, dithered ),
+        decode_range( 9, 30, 16, rgb, none, 9, 21, dithered ),
+        // Ranges past the image are clamped
+        decode_range( 8, 6, 8, grey, none, 4, 100, {} ),
+        decode_truncated( 1 ),
+        decode_truncated( 7 )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_index() {
+    constexpr std::uint32_t width{ 37 };
+    constexpr std::uint32_t height{ 50 };
+    constexpr std::size_t   stride{ width * 3 };
+
+    // Every filter type in turn, so rows depend on the rows above them
+    auto scanlines{ pattern_image( ( stride + 1 ) * height ) };
+    for ( std::size_t y{ 0 }; y < height; ++y ) {
+        scanlines[y * ( stride + 1 )] = static_cast<std::byte>( y % 5 );
+    }
+    const auto png{ make_png( width, height, IHDR::BitDepth{ 8 },
+                              IHDR::ColourType::TRUE_COLOUR,
+                              IHDR::InterlaceMethod::NO_INTERLACE, scanlines,
+                              {}, 100 ) };
+
+    PngDecoder decoder{ png };
+    const auto full{ decoder.decode() };
+    const auto index{ decoder.build_index( 8 ) };
+
+    const auto decode_range = [&]( const DecodeIndex & decode_index,
+                                   const std::uint32_t first_row,
+                                   const std::uint32_t end_row ) {
+        DecodeOptions options{};
+        options.first_row = first_row;
+        options.end_row = end_row;
+        options.index = &decode_index;
+        return std::ranges::equal(
+            decoder.decode( options ),
+            std::span{ full }.subspan( first_row * stride,
+                                       ( end_row - first_row ) * stride ) );
+    };
+
+    // Sidecar round trip
+    const auto sidecar{ std::filesystem::temp_directory_path()
+                        / "png_decoder_test.pngx" };
+    index.save( sidecar );
+    const auto loaded{ DecodeIndex::load( sidecar ) };
+    std::filesystem::remove( sidecar );
+
+    auto truncated{ index.serialize() };
+    truncated.pop_back();
+
+    const auto other_png{ make_png( width, height, IHDR::BitDepth{ 8 },
+                                    IHDR::ColourType::TRUE_COLOUR,
+                                    IHDR::InterlaceMethod::NO_INTERLACE,
+                                    scanlines, {}, 99 ) };
+    const auto interlaced_png{ make_png(
+        4, 4, IHDR::BitDepth{ 8 }, IHDR::ColourType::GREYSCALE,
+        IHDR::InterlaceMethod::ADAM_7,
+        adam7_scanlines( pattern_image( 16 ),
+                         ImageLayout{ 4, 4, 8, 4 } ) ) };
+    PngDecoder interlaced{ interlaced_png };
+
+    const auto test_results = std::vector<bool>{
+        index.checkpoints().size() == 6 && index.rows_per_checkpoint() == 8,
+        index.nearest( 7 ) == nullptr && index.nearest( 8 )->row == 8
+            && index.nearest( 49 )->row == 48,
+        decode_range( index, 0, 3 ),
+        decode_range( index, 8, 9 ),
+        decode_range( index, 13, 30 ),
+        decode_range( index, 44, 50 ),
+        decode_range( loaded, 21, 50 ),
+        loaded.serialize() == index.serialize(),
+        interlaced.build_index( 2 ).checkpoints().empty(),
+        error_from( [&] {
+            static_cast<void>( DecodeIndex::deserialize( truncated ) );
+        } ) == png_error_t::BAD_INDEX,
+        // IDAT chunked differently, so the CRCs differ
+        error_from( [&] {
+            PngDecoder    other{ other_png };
+            DecodeOptions options{};
+            options.index = &index;
+            static_cast<void>( other.decode( options ) );
+        } ) == png_error_t::BAD_INDEX
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_parallel() {
+    constexpr std::uint32_t width{ 29 };
+    constexpr std::uint32_t height{ 40 };
+    constexpr std::size_t   stride{ width * 3 };
+
+    // Every filter type in turn, so rows depend on the rows above them
+    auto scanlines{ pattern_image( ( stride + 1 ) * height ) };
+    for ( std::size_t y{ 0 }; y < height; ++y ) {
+        scanlines[y * ( stride + 1 )] = static_cast<std::byte>( y % 5 );
+    }
+
+    const auto make_flushed = [&]( const std::span<const std::byte> data,
+                                   const std::size_t rows_per_flush,
+                                   const std::size_t idat_size ) {
+        return make_png( width, height, IHDR::BitDepth{ 8 },
+                         IHDR::ColourType::TRUE_COLOUR,
+                         IHDR::InterlaceMethod::NO_INTERLACE, data, {},
+                         idat_size, rows_per_flush * ( stride + 1 ) );
+    };
+
+    // Parallel decodes must match the sequential decode
+    const auto decode_parallel = [&]( const std::span<const std::byte> png,
+                                      const std::size_t sync_points ) {
+        PngDecoder decoder{ png };
+        const auto sequential{ decoder.decode() };
+        return decoder.sync_points().size() == sync_points
+               && std::ranges::all_of(
+                   std::array<std::uint32_t, 3>{ 2, 4, 0 },
+                   [&]( const std::uint32_t threads ) {
+                       DecodeOptions options{};
+                       options.threads = threads;
+                       return decoder.decode( options ) == sequential;
+                   } );
+    };
+
+    // A stored row holding the marker bytes, a false match when scanning
+    // that an index leaves out
+    auto spurious{ scanlines };
+    std::ranges::copy( make_bytes( 0x00, 0x00, 0x00, 0xFF, 0xFF ),
+                       spurious.begin() + 3 * ( stride + 1 ) );
+    spurious[3 * ( stride + 1 )] = std::byte{ 0 };
+
+    // The syNc chunk lists the sync points, & is preferred to scanning when
+    // every offset is just past a flush marker
+    const auto sync_points_of = [&]( const std::span<const std::byte>
+                                            png ) {
+        PngDecoder decoder{ png };
+        return std::vector<std::uint64_t>{ decoder.sync_points().begin(),
+                                           decoder.sync_points().end() };
+    };
+    const auto sync_points{ sync_points_of(
+        make_flushed( scanlines, 8, 1024 ) ) };
+    const auto with_sync_chunk = [&]( const std::span<const std::byte> data,
+                                      const SyncIndex & index ) {
+        const auto chunk{ make_chunk( PngChunkType::syNc,
+                                      index.serialize() ) };
+        return make_png( width, height, IHDR::BitDepth{ 8 },
+                         IHDR::ColourType::TRUE_COLOUR,
+                         IHDR::InterlaceMethod::NO_INTERLACE, data, chunk, 1024,
+                         8 * ( stride + 1 ) );
+    };
+    const SyncIndex sync_index{ .rows_per_segment = 8,
+                                .offsets = sync_points };
+    const SyncIndex stale_index{ .rows_per_segment = 8,
+                                 .offsets = { sync_points.front() + 1 } };
+    const SyncIndex overlapping_index{
+        .rows_per_segment = 8,
+        .offsets = { sync_points.front(), sync_points.front() + 2 }
+    };
+    // Corrupt the Adler-32 trailer, the last byte of the last IDAT chunk,
+    // which follows the IEND chunk, & index the stream so it is inflated
+    // in parallel
+    auto bad_adler{ make_flushed( scanlines, 8, 1000 ) };
+    {
+        constexpr std::size_t iend_bytes{ 12 };
+        std::size_t           offset{ png_signature_bytes };
+        std::size_t           last_idat{ 0 };
+        while ( offset < bad_adler.size() - iend_bytes ) {
+            if ( std::to_integer<char>( bad_adler[offset + 4] ) == 'I'
+                 && std::to_integer<char>( bad_adler[offset + 5] ) == 'D' ) {
+                last_idat = offset;
+            }
+            offset += 12
+                      + span_to_integer<std::uint32_t, std::endian::big>(
+                          std::span{ bad_adler }.subspan( offset, 4 ) );
+        }
+        auto payload{ std::vector( bad_adler.begin() + last_idat + 8,
+                                   bad_adler.end() - iend_bytes - 4 ) };
+        payload.back() ^= std::byte{ 0x01 };
+        auto rebuilt{ std::vector( bad_adler.begin(),
+                                   bad_adler.begin() + last_idat ) };
+        append_bytes( rebuilt, make_chunk( PngChunkType::IDAT, payload ) );
+        append_bytes( rebuilt, make_chunk( PngChunkType::syNc,
+                                           sync_index.serialize() ) );
+        append_bytes( rebuilt, make_chunk( PngChunkType::IEND, {} ) );
+        bad_adler = std::move( rebuilt );
+    }
+
+    // Bands are inflated in one call, rows in one call each
+    const auto inflate_calls = [&]( const std::span<const std::byte> png ) {
+        PngDecoder    decoder{ png };
+        DecodeOptions options{};
+        options.threads = 2;
+        METRICS::set_enabled( true );
+        static_cast<void>( decoder.decode( options ) );
+        METRICS::set_enabled( false );
+        return decoder.metrics()[METRICS::stage_t::INFLATE].calls;
+    };
+    // `png` with its image data replaced by `data` deflated, flushed with
+    // `flush` every `flush_interval` bytes
+    const auto deflated = [&]( const std::span<const std::byte> png,
+                               const std::span<const std::byte> data,
+                               const std::size_t           flush_interval,
+                               const ZLIB::deflate_flush_t flush ) {
+        ZLIB::Deflater         deflater{ ZLIB::CompressionLevel::DEFAULT };
+        std::vector<std::byte> stream;
+        for ( std::size_t offset{ 0 }; offset < data.size();
+              offset += flush_interval ) {
+            const auto piece{ data.subspan(
+                offset, std::min( flush_interval, data.size() - offset ) ) };
+            deflater.deflate( piece,
+                              offset + piece.size() == data.size() ?
+                                  ZLIB::deflate_flush_t::FINISH :
+                                  flush,
+                              stream );
+        }
+        auto chunks{ split_chunks( png ) };
+        std::erase_if( chunks, []( const TestChunk & chunk ) {
+            return chunk.type == PngChunkType::IDAT;
+        } );
+        chunks.insert( chunks.end() - 1,
+                       TestChunk{ PngChunkType::IDAT, stream } );
+        return join_chunks( chunks );
+    };
+    // Identical rows, so later rows match earlier ones across flushes that
+    // keep the dictionary
+    auto repeated{ std::vector( scanlines.begin(),
+                                scanlines.begin() + stride + 1 ) };
+    for ( std::uint32_t y{ 1 }; y < height; ++y ) {
+        append_bytes( repeated, std::span{ scanlines }.first( stride + 1 ) );
+    }
+    const auto band_bytes{ 8 * ( stride + 1 ) };
+    const auto full_flushed{ deflated( make_flushed( scanlines, 0, 1024 ),
+                                       repeated, band_bytes,
+                                       ZLIB::deflate_flush_t::FULL ) };
+    const auto sync_flushed{ deflated( make_flushed( scanlines, 0, 1024 ),
+                                       repeated, band_bytes,
+                                       ZLIB::deflate_flush_t::SYNC ) };
+    // A 1 x 1 image followed by a large run of surplus image data, which
+    // the bands must not inflate all of
+    auto surplus{ std::vector<std::byte>( std::size_t{ 1 } << 20 ) };
+    surplus[1] = std::byte{ 0x80 };
+    const auto bomb{ deflated(
+        make_png( 1, 1, IHDR::BitDepth{ 8 }, IHDR::ColourType::GREYSCALE,
+                  IHDR::InterlaceMethod::NO_INTERLACE,
+                  std::span{ surplus }.first( 2 ) ),
+        surplus, std::size_t{ 1 } << 16, ZLIB::deflate_flush_t::FULL ) };
+    const auto bomb_decodes = [&] {
+        PngDecoder    decoder{ bomb };
+        DecodeOptions options{};
+        options.threads = 4;
+        return decoder.decode( options )
+               == std::vector{ std::byte{ 0x80 } };
+    };
+
+    auto unordered_index{ sync_index.serialize() };
+    // Swap the last two offsets
+    std::rotate( unordered_index.end() - 16, unordered_index.end() - 8,
+                 unordered_index.end() );
+
+    const auto test_results = std::vector<bool>{
+        decode_parallel( make_flushed( scanlines, 8, 1024 ), 4 ),
+        decode_parallel( make_flushed( scanlines, 1, 1024 ), 39 ),
+        // Markers straddling IDAT chunk boundaries
+        decode_parallel( make_flushed( scanlines, 5, 7 ), 7 ),
+        decode_parallel( make_flushed( scanlines, 3, 1 ), 13 ),
+        // No flush points, decoded sequentially
+        decode_parallel( make_flushed( scanlines, 0, 1024 ), 0 ),
+        decode_parallel( make_flushed( spurious, 8, 1024 ), 5 ),
+        sync_points.size() == 4,
+        sync_points_of( with_sync_chunk( spurious, sync_index ) )
+            == sync_points,
+        decode_parallel( with_sync_chunk( spurious, sync_index ), 4 ),
+        // Flushes between rows, so bands are unfiltered as they inflate
+        decode_parallel( make_png( width, height, IHDR::BitDepth{ 8 },
+                                   IHDR::ColourType::TRUE_COLOUR,
+                                   IHDR::InterlaceMethod::NO_INTERLACE,
+                                   scanlines, {}, 1024, 100 ),
+                         35 ),
+        inflate_calls( with_sync_chunk( scanlines, sync_index ) ) == 1,
+        // Without a valid syNc chunk the scanned markers are tried
+        inflate_calls( with_sync_chunk( scanlines, overlapping_index ) ) == 1,
+        inflate_calls( make_flushed( scanlines, 8, 1024 ) ) == 1,
+        decode_parallel( full_flushed, 4 ),
+        inflate_calls( full_flushed ) == 1,
+        // Sync flushes keep the dictionary, the bands refer back past their
+        // start & the rows are inflated again in order
+        decode_parallel( sync_flushed, 4 ),
+        inflate_calls( sync_flushed ) == height + 1,
+        bomb_decodes(),
+        // Offsets not at flush markers, the stream is scanned
+        sync_points_of( with_sync_chunk( scanlines, stale_index ) )
+            == sync_points,
+        SyncIndex::parse( sync_index.serialize() ).offsets == sync_points,
+        error_from( [&] {
+            static_cast<void>( SyncIndex::parse( unordered_index ) );
+        } ) == png_error_t::BAD_INDEX,
+        SyncIndex::try_parse( unordered_index ).error()
+            == png_error_t::BAD_INDEX,
+        SyncIndex::try_parse( std::span{ unordered_index }.first( 7 ) )
+                .error()
+            == png_error_t::BAD_INDEX,
+        error_from( [&] {
+            PngDecoder    decoder{ bad_adler };
+            DecodeOptions options{};
+            options.threads = 4;
+            static_cast<void>( decoder.decode( options ) );
+        } ) == png_error_t::BAD_IMAGE_DATA
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_metrics() {
+    constexpr std::uint32_t width{ 6 };
+    constexpr std::uint32_t height{ 4 };
+
+    // Indices 0 to 255 of a full palette, expanded to RGB
+    const auto indices{ pattern_image( width * height ) };
+    const auto png{ make_png(
+        width, height, IHDR::BitDepth{ 8 }, IHDR::ColourType::INDEXED_COLOUR,
+        IHDR::InterlaceMethod::NO_INTERLACE,
+        unfiltered_scanlines( indices, width ), make_palette_chunk( 256 ) ) };
+    DecodeOptions options{};
+    options.expand_palette = true;
+
+    PngDecoder untimed{ png };
+    static_cast<void>( untimed.decode( options ) );
+
+    PERF::Profile profile{};
+    TRACE::thread_buffer().clear();
+    profile.start();
+    METRICS::set_enabled( true );
+    PngDecoder decoder{ png };
+    static_cast<void>( decoder.decode( options ) );
+    METRICS::set_enabled( false );
+    profile.stop();
+    const auto events{ TRACE::thread_buffer().events() };
+    TRACE::thread_buffer().clear();
+    const auto event_count = [&]( const std::string_view name ) {
+        return static_cast<std::uint64_t>(
+            std::ranges::count_if( events, [&]( const auto & event ) {
+                return event.name == name;
+            } ) );
+    };
+    const bool detail_traced{ TRACE::trace_level_t::DETAIL
+                              <= TRACE::compiled_level };
+    const auto region_calls = [&]( const std::string_view name ) {
+        const auto regions{ profile.regions() };
+        const auto region{ std::ranges::find( regions, name,
+                                              &PERF::RegionTotals::name ) };
+        return region == regions.end() ? std::uint64_t{ 0 } : region->calls;
+    };
+
+    const auto & metrics{ decoder.metrics() };
+    const auto & walk{ metrics[METRICS::stage_t::CHUNK_WALK] };
+    const auto & crc{ metrics[METRICS::stage_t::CRC] };
+    const auto & inflate{ metrics[METRICS::stage_t::INFLATE] };
+    const auto & unfilter{ metrics[METRICS::stage_t::UNFILTER] };
+    const auto & convert{ metrics[METRICS::stage_t::CONVERT] };
+
+    const auto test_results = std::vector<bool>{
+        untimed.metrics().images == 0,
+        untimed.metrics()[METRICS::stage_t::INFLATE].calls == 0,
+        metrics.images == 1,
+        walk.calls == 1 && walk.bytes_in == png.size(),
+        crc.calls == decoder.chunks().size(),
+        // A row per call, filter type byte included
+        inflate.calls == height
+            && inflate.bytes_out == height * ( width + 1 ),
+        inflate.bytes_in > 0 && inflate.bytes_in <= png.size(),
+        unfilter.calls == height
+            && unfilter.bytes_out == height * width,
+        convert.calls == height
+            && convert.bytes_in == height * width
+            && convert.bytes_out == height * width * 3,
+        // Profiled regions cover whole stages, the rows as one region
+        region_calls( "header_check" ) == 1,
+        region_calls( "chunk_walk" ) == 1,
+        region_calls( "crc" ) == crc.calls,
+        region_calls( "decode_rows" ) == 1,
+        region_calls( "inflate" ) == 0,
+        region_calls( "unfilter" ) == 0,
+        region_calls( "convert" ) == 0,
+        // A row event per scanline, a block event for the one stored block
+        event_count( "read_scanline" ) == ( detail_traced ? height : 0 ),
+        event_count( "inflate_block" ) == ( detail_traced ? 1 : 0 )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_decode_errors() {
+    const auto image{ pattern_image( 16 ) };
+    const auto scanlines{ unfiltered_scanlines( image, 4 ) };
+    const auto make_grey = []( const std::span<const std::byte> data ) {
+        return make_png( 4, 4, IHDR::BitDepth{ 8 }, IHDR::ColourType::GREYSCALE,
+                         IHDR::InterlaceMethod::NO_INTERLACE, data );
+    };
+
+    auto bad_signature{ make_grey( scanlines ) };
+    bad_signature[1] = std::byte{ 'J' };
+
+    // Corrupt the IHDR width, which follows the signature, length & type
+    auto bad_crc{ make_grey( scanlines ) };
+    bad_crc[png_signature_bytes + 8] ^= std::byte{ 0x01 };
+
+    auto bad_filter{ scanlines };
+    bad_filter[0] = std::byte{ 5 };
+
+    const auto truncated_scanlines{ std::span{ scanlines }.first( 12 ) };
+
+    auto bad_transparency{ make_palette_chunk( 4 ) };
+    append_bytes( bad_transparency,
+                  make_chunk( PngChunkType::tRNS, pattern_image( 5 ) ) );
+    const auto make_indexed = []( const std::span<const std::byte> data,
+                                  const std::span<const std::byte> chunks ) {
+        return make_png( 4, 4, IHDR::BitDepth{ 8 },
+                         IHDR::ColourType::INDEXED_COLOUR,
+                         IHDR::InterlaceMethod::NO_INTERLACE, data, chunks );
+    };
+
+    const auto grey{ make_grey( scanlines ) };
+    // IEND is a chunk with no data
+    const auto no_iend{ std::span{ grey }.first( grey.size()
+                                                 - chunk_overhead_bytes ) };
+    // hIST without a palette, ordering is checked before its bad CRC
+    auto histogram{ make_chunk( PngChunkType::hIST, image ) };
+    histogram.back() ^= std::byte{ 0x01 };
+    const auto out_of_order{ make_png(
+        4, 4, IHDR::BitDepth{ 8 }, IHDR::ColourType::GREYSCALE,
+        IHDR::InterlaceMethod::NO_INTERLACE, scanlines, histogram ) };
+
+    const auto test_results = std::vector<bool>{
+        error_from( [&] { PngDecoder{ bad_signature }; } )
+            == png_error_t::BAD_HEADER,
+        error_from( [&] { PngDecoder{ bad_crc }; } ) == png_error_t::BAD_CRC,
+        error_from( [&] { PngDecoder{ no_iend }; } )
+            == png_error_t::TRUNCATED_CHUNK,
+        // try_parse returns the errors the constructor throws
+        PngDecoder::try_parse( bad_signature ).error()
+            == png_error_t::BAD_HEADER,
+        PngDecoder::try_parse( bad_crc ).error() == png_error_t::BAD_CRC,
+        PngDecoder::try_parse( no_iend ).error()
+            == png_error_t::TRUNCATED_CHUNK,
+        [&] {
+            auto decoder{ PngDecoder::try_parse( grey ) };
+            return decoder.has_value() && decoder->decode() == image;
+        }(),
+        error_from( [&] { PngDecoder{ out_of_order }; } )
+            == png_error_t::BAD_CHUNK_ORDER,
+        error_from( [&] {
+            const auto png{ make_grey( bad_filter ) };
+            PngDecoder decoder{ png };
+            static_cast<void>( decoder.decode() );
+        } ) == png_error_t::BAD_FILTER_TYPE,
+        error_from( [&] {
+            const auto png{ make_grey( truncated_scanlines ) };
+            PngDecoder decoder{ png };
+            static_cast<void>( decoder.decode() );
+        } ) == png_error_t::BAD_IMAGE_DATA,
+        error_from( [&] { PngDecoder{ make_indexed( scanlines, {} ) }; } )
+            == png_error_t::MISSING_PLTE,
+        error_from( [&] {
+            PngDecoder{ make_indexed( scanlines, bad_transparency ) };
+        } ) == png_error_t::BAD_TRNS
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_decoder_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Decoder", PNG::test_functions );
+}
@@ -0,0 +1,311 @@
+#include "png/png_editor_test.hpp"
+
+#include "common/metrics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <ranges>
+#include <string>
+
+#if defined( __linux__ )
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace PNG
+{
+
+namespace
+{
+
+// Whole IDAT chunks of `png`, header & CRC included, concatenated.
+std::vector<std::byte>
+idat_chunks( const std::span<const std::byte> png ) {
+    const PngDecoder       decoder{ png };
+    std::vector<std::byte> chunks;
+    for ( const auto & chunk : decoder.chunks() ) {
+        if ( chunk.type == PngChunkType::IDAT ) {
+            const auto whole{ png.subspan(
+                chunk.offset, chunk.data.size() + chunk_overhead_bytes ) };
+            chunks.insert( chunks.end(), whole.begin(), whole.end() );
+        }
+    }
+    return chunks;
+}
+
+// Data of the first chunk of `type` in `png`, empty if none.
+std::vector<std::byte>
+chunk_data( const std::span<const std::byte> png, const PngChunkType type ) {
+    const PngDecoder decoder{ png };
+    for ( const auto & chunk : decoder.chunks() ) {
+        if ( chunk.type == type ) {
+            return { chunk.data.begin(), chunk.data.end() };
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+bool
+test_edit_chunks() {
+    const auto source{ editable_png() };
+    PngDecoder source_decoder{ source };
+    const auto pixels{ source_decoder.decode() };
+    const auto idat_count{ static_cast<std::size_t>(
+        std::ranges::count( PngEditor{ source }.chunk_types(),
+                            PngChunkType::IDAT ) ) };
+    const auto types_with = [&]( const std::vector<PngChunkType> & before,
+                                 const std::vector<PngChunkType> & after ) {
+        auto types{ before };
+        types.insert( types.end(), idat_count, PngChunkType::IDAT );
+        types.insert( types.end(), after.begin(), after.end() );
+        return types;
+    };
+
+    // Nothing edited: the source comes back as is, less anything after
+    // IEND
+    auto trailing{ source };
+    trailing.insert( trailing.end(), 5, std::byte{ 0x2A } );
+    const auto unchanged{ written( PngEditor{ trailing } ) };
+
+    PngEditor                    editor{ source };
+    const std::array<std::byte, 4> gamma{ std::byte{ 0 }, std::byte{ 0 },
+                                          std::byte{ 0xB1 },
+                                          std::byte{ 0x8F } };
+    const std::vector<std::byte> dimensions( 9, std::byte{ 1 } );
+    editor.set( PngChunkType::gAMA, gamma );
+    editor.set( PngChunkType::pHYs, dimensions );
+    editor.set_text( "Title", "Edited" );
+    editor.set_text( "Author", "Someone" );
+    const auto edited{ written( editor ) };
+    const auto edited_types{ editor.chunk_types() };
+    // The new chunks must be valid, CRCs included, for this to decode
+    PngDecoder edited_decoder{ edited };
+    const auto edited_pixels{ edited_decoder.decode() };
+
+    // Replacing a chunk keeps its position
+    editor.set( PngChunkType::gAMA, std::array<std::byte, 4>{} );
+    const auto replaced_types{ editor.chunk_types() };
+
+    editor.remove_text( "Title" );
+    editor.remove( PngChunkType::pHYs );
+    const auto removed_types{ editor.chunk_types() };
+    editor.strip_metadata();
+    const auto stripped{ written( editor ) };
+
+    const auto test_results = std::vector<bool>{
+        unchanged == source,
+        edited_types
+            == types_with( { PngChunkType::IHDR, PngChunkType::gAMA,
+                             PngChunkType::pHYs },
+                           { PngChunkType::tEXt, PngChunkType::tEXt,
+                             PngChunkType::IEND } ),
+        edited_pixels == pixels,
+        chunk_data( edited, PngChunkType::tEXt )
+            == text_bytes( std::string_view{ "Title\0Edited", 12 } ),
+        chunk_data( edited, PngChunkType::gAMA )
+            == std::vector<std::byte>( gamma.begin(), gamma.end() ),
+        // Image data is copied byte for byte
+        idat_chunks( edited ) == idat_chunks( source ),
+        replaced_types == edited_types,
+        removed_types
+            == types_with( { PngChunkType::IHDR, PngChunkType::gAMA },
+                           { PngChunkType::tEXt, PngChunkType::IEND } ),
+        chunk_data( written( editor ), PngChunkType::tEXt ).empty(),
+        PngEditor{ stripped }.chunk_types()
+            == types_with( { PngChunkType::IHDR }, { PngChunkType::IEND } ),
+        idat_chunks( stripped ) == idat_chunks( source )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_edit_file() {
+    auto test_results = std::vector<bool>{};
+#if defined( __linux__ )
+    const auto source{ editable_png() };
+    const auto directory{ std::filesystem::temp_directory_path() };
+    const auto source_path{ directory / "png_editor_test_in.png" };
+    const auto output_path{ directory / "png_editor_test_out.png" };
+    {
+        std::ofstream out_file{ source_path, std::ios::binary };
+        out_file.write( reinterpret_cast<const char *>( source.data() ),
+                        static_cast<std::streamsize>( source.size() ) );
+    }
+
+    METRICS::reset_process_metrics();
+    METRICS::set_enabled( true );
+    PngEditor file_editor{ source_path };
+    METRICS::set_enabled( false );
+    const auto read{ METRICS::process_metrics()[METRICS::stage_t::READ] };
+    METRICS::reset_process_metrics();
+    file_editor.set_text( "Comment", "Edited from a file" );
+    // Moving keeps the mapping
+    const PngEditor editor{ std::move( file_editor ) };
+    const auto      expected{ written( editor ) };
+
+    // File to file, where the kernel may copy
+    const int output_fd{ ::open( output_path.c_str(),
+                                 O_WRONLY | O_CREAT | O_TRUNC, 0600 ) };
+    editor.write( output_fd );
+    ::close( output_fd );
+    std::ifstream           in_file{ output_path, std::ios::binary };
+    const std::vector<char> chars{ std::istreambuf_iterator<char>( in_file ),
+                                   std::istreambuf_iterator<char>() };
+
+    // Into a pipe, which copy_file_range may refuse. The image fits in the
+    // pipe's buffer.
+    std::array<int, 2> pipe_fds{};
+    static_cast<void>( ::pipe( pipe_fds.data() ) );
+    editor.write( pipe_fds[1] );
+    ::close( pipe_fds[1] );
+    std::vector<std::byte> piped( expected.size() + 1 );
+    std::size_t            piped_size{ 0 };
+    for ( ssize_t count{ 1 }; count > 0; ) {
+        count = ::read( pipe_fds[0], piped.data() + piped_size,
+                        piped.size() - piped_size );
+        piped_size += count > 0 ? static_cast<std::size_t>( count ) : 0;
+    }
+    ::close( pipe_fds[0] );
+    piped.resize( piped_size );
+
+    std::filesystem::remove( source_path );
+    std::filesystem::remove( output_path );
+
+    test_results = {
+        // Opening & mapping the file is timed as the read stage
+        read.calls == 1 && read.bytes_out == source.size(),
+        expected.size() > source.size(),
+        std::ranges::equal( std::as_bytes( std::span{ chars } ), expected ),
+        piped == expected,
+        error_from( [&] { PngEditor missing{ source_path }; } )
+            == png_error_t::READ_FAILED
+    };
+#endif
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_edit_rechunk() {
+    const auto source{ editable_png() };
+    PngDecoder source_decoder{ source };
+    const auto pixels{ source_decoder.decode() };
+    const auto idat_data = []( const std::span<const std::byte> png ) {
+        const PngDecoder       decoder{ png };
+        std::vector<std::byte> data;
+        std::vector<std::size_t> sizes;
+        for ( const auto & chunk : decoder.chunks() ) {
+            if ( chunk.type == PngChunkType::IDAT ) {
+                data.insert( data.end(), chunk.data.begin(), chunk.data.end() );
+                sizes.push_back( chunk.data.size() );
+            }
+        }
+        return std::pair{ data, sizes };
+    };
+    const auto [source_data, source_sizes]{ idat_data( source ) };
+
+    // Split finer, with chunk boundaries falling inside source chunks, &
+    // other edits alongside. The decoder checks every CRC.
+    PngEditor split_editor{ source };
+    split_editor.rechunk_idat( 100 );
+    split_editor.set_text( "Title", "Split" );
+    const auto split{ written( split_editor ) };
+    PngDecoder split_decoder{ split };
+    const auto [split_data, split_sizes]{ idat_data( split ) };
+
+    // Coalesced into one chunk
+    PngEditor joined_editor{ source };
+    joined_editor.rechunk_idat( 1 << 20 );
+    const auto joined{ written( joined_editor ) };
+    PngDecoder joined_decoder{ joined };
+    const auto [joined_data, joined_sizes]{ idat_data( joined ) };
+
+    auto written_to_fd{ true };
+#if defined( __linux__ )
+    const auto path{ std::filesystem::temp_directory_path()
+                     / "png_editor_rechunk_test.png" };
+    const int  fd{ ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600 ) };
+    split_editor.write( fd );
+    ::close( fd );
+    std::ifstream           in_file{ path, std::ios::binary };
+    const std::vector<char> chars{ std::istreambuf_iterator<char>( in_file ),
+                                   std::istreambuf_iterator<char>() };
+    std::filesystem::remove( path );
+    written_to_fd = std::ranges::equal( std::as_bytes( std::span{ chars } ),
+                                        split );
+#endif
+
+    const auto test_results = std::vector<bool>{
+        source_sizes.size() > 1,
+        split_decoder.decode() == pixels,
+        split_data == source_data,
+        split_sizes.size() == ( source_data.size() + 99 ) / 100,
+        std::ranges::all_of( split_sizes | std::views::take(
+                                               split_sizes.size() - 1 ),
+                             []( const auto size ) { return size == 100; } ),
+        split_editor.chunk_types() == PngEditor{ split }.chunk_types(),
+        chunk_data( split, PngChunkType::tEXt )
+            == text_bytes( std::string_view{ "Title\0Split", 11 } ),
+        joined_decoder.decode() == pixels,
+        joined_sizes == std::vector{ source_data.size() },
+        joined_data == source_data,
+        written_to_fd,
+        error_from( [&] { joined_editor.rechunk_idat( 0 ); } )
+            == png_error_t::BAD_EDIT
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_edit_errors() {
+    const auto source{ editable_png() };
+    PngEditor  editor{ source };
+
+    auto not_png{ source };
+    not_png[1] = std::byte{ 0 };
+    const auto truncated{ std::span{ source }.first( source.size() - 4 ) };
+    // The IHDR chunk dropped, so IDAT comes first
+    auto headless{ std::vector( source.begin(), source.begin() + 8 ) };
+    headless.insert( headless.end(), source.begin() + 8 + 25, source.end() );
+
+    const std::string long_keyword( 80, 'k' );
+    const auto        test_results = std::vector<bool>{
+        error_from( [&] { editor.remove( PngChunkType::IDAT ); } )
+            == png_error_t::BAD_EDIT,
+        error_from( [&] { editor.set( PngChunkType::IHDR, source ); } )
+            == png_error_t::BAD_EDIT,
+        error_from( [&] { editor.set( PngChunkType::tEXt, source ); } )
+            == png_error_t::BAD_EDIT,
+        error_from( [&] { editor.set_text( "", "text" ); } )
+            == png_error_t::BAD_EDIT,
+        error_from( [&] { editor.set_text( long_keyword, "text" ); } )
+            == png_error_t::BAD_EDIT,
+        error_from( [&] {
+            editor.set_text( "Title", std::string_view{ "a\0b", 3 } );
+        } ) == png_error_t::BAD_EDIT,
+        // Failed edits change nothing
+        written( editor ) == source,
+        error_from( [&] { PngEditor bad{ not_png }; } )
+            == png_error_t::BAD_HEADER,
+        error_from( [&] { PngEditor bad{ truncated }; } )
+            == png_error_t::TRUNCATED_CHUNK,
+        error_from( [&] { PngEditor bad{ headless }; } )
+            == png_error_t::MISSING_IHDR
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_editor_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Editor", PNG::test_functions );
+}
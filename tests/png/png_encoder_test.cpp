@@ -0,0 +1,548 @@
+#include "png/png_encoder_test.hpp"
+
+#include "png/png_filter.hpp"
+#include "png/png_index.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#if defined( __linux__ )
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace PNG
+{
+
+bool
+test_encode_round_trip() {
+    // Decoding the encoded image must give back the input
+    const auto round_trip = []( const std::uint32_t         width,
+                                const std::uint32_t         height,
+                                const IHDR::BitDepth        bit_depth,
+                                const IHDR::ColourType      colour_type,
+                                const IHDR::InterlaceMethod interlace,
+                                const IDAT::FilterType      filter ) {
+        const auto header{ make_header( width, height, bit_depth, colour_type,
+                                        interlace ) };
+        const auto row_bytes{ IHDR::scanline_bytes( width, colour_type,
+                                                    bit_depth ) };
+        auto       image{ pattern_image( row_bytes * height ) };
+        // Padding bits after the last sub-byte pixel don't survive Adam7
+        const auto padding_bits{ row_bytes * byte_bits
+                                 - width * IHDR::bits_per_pixel( colour_type,
+                                                                 bit_depth ) };
+        for ( std::size_t y{ 1 }; y <= height; ++y ) {
+            image[y * row_bytes - 1] &= static_cast<std::byte>(
+                0xFF << padding_bits );
+        }
+
+        EncodeOptions options{};
+        options.filter = filter;
+        options.idat_size = 100;
+        const auto png{ encode_image( header, image, options ) };
+
+        PngDecoder decoder{ png };
+        return decoder.decode() == image;
+    };
+
+    constexpr auto grey{ IHDR::ColourType::GREYSCALE };
+    constexpr auto grey_alpha{ IHDR::ColourType::GREYSCALE_ALPHA };
+    constexpr auto rgb{ IHDR::ColourType::TRUE_COLOUR };
+    constexpr auto rgba{ IHDR::ColourType::TRUE_COLOUR_ALPHA };
+    constexpr auto indexed{ IHDR::ColourType::INDEXED_COLOUR };
+    constexpr auto none{ IHDR::InterlaceMethod::NO_INTERLACE };
+    constexpr auto adam7{ IHDR::InterlaceMethod::ADAM_7 };
+
+    std::vector<bool> test_results;
+    for ( std::uint8_t filter{ 0 }; filter < 5; ++filter ) {
+        const auto type{ static_cast<IDAT::FilterType>( filter ) };
+        for ( const auto interlace : { none, adam7 } ) {
+            test_results.push_back(
+                round_trip( 13, 11, 8, rgb, interlace, type ) );
+            test_results.push_back(
+                round_trip( 9, 7, 16, rgba, interlace, type ) );
+            test_results.push_back(
+                round_trip( 21, 10, 1, grey, interlace, type ) );
+            test_results.push_back(
+                round_trip( 11, 9, 4, indexed, interlace, type ) );
+            test_results.push_back(
+                round_trip( 5, 17, 8, grey_alpha, interlace, type ) );
+        }
+    }
+    // Images smaller than the first Adam7 pass block
+    test_results.push_back( round_trip( 1, 1, 2, grey, adam7, {} ) );
+    test_results.push_back( round_trip( 3, 2, 8, rgb, adam7, {} ) );
+
+    // Every compression level, on an image spanning several deflate
+    // windows
+    const auto header{ make_header( 300, 120, 8, rgb, none ) };
+    const auto image{ pattern_image( 300 * 3 * 120 ) };
+    for ( const auto level :
+          { ZLIB::CompressionLevel::STORE, ZLIB::CompressionLevel::FAST,
+            ZLIB::CompressionLevel::DEFAULT, ZLIB::CompressionLevel::BEST } ) {
+        EncodeOptions options{};
+        options.level = level;
+        options.filter = IDAT::FilterType::PAETH;
+        const auto png{ encode_image( header, image, options ) };
+        PngDecoder decoder{ png };
+        test_results.push_back( decoder.decode() == image );
+    }
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_encode_chunks() {
+    const auto header{ make_header( 30, 40, 8,
+                                    IHDR::ColourType::INDEXED_COLOUR ) };
+    const auto image{ pattern_image( 30 * 40 ) };
+    const auto transparency{ pattern_image( 10 ) };
+
+    EncodeOptions options{};
+    options.idat_size = 256;
+    std::vector<std::byte> png;
+    PngEncoder             encoder{ header, buffer_sink( png ), options };
+    encoder.write_palette( full_palette() );
+    encoder.write_transparency( transparency );
+    encoder.write_rows( image );
+    encoder.finish();
+
+    PngDecoder decoder{ png };
+    const auto chunks{ decoder.chunks() };
+    // Every IDAT but the last is full
+    const auto idat_sizes_ok = std::ranges::all_of(
+        chunks.subspan( 3, chunks.size() - 5 ),
+        []( const PngChunkView & chunk ) {
+            return chunk.type == PngChunkType::IDAT
+                   && chunk.data.size() == 256;
+        } );
+    const auto & last_idat{ chunks[chunks.size() - 2] };
+
+    const auto test_results = std::vector<bool>{
+        chunks.size() > 5 && chunks[0].type == PngChunkType::IHDR
+            && chunks[1].type == PngChunkType::PLTE
+            && chunks[2].type == PngChunkType::tRNS
+            && chunks.back().type == PngChunkType::IEND,
+        idat_sizes_ok,
+        last_idat.type == PngChunkType::IDAT && !last_idat.data.empty()
+            && last_idat.data.size() <= 256,
+        decoder.palette().has_value()
+            && decoder.palette()->getEntries() == 256,
+        std::ranges::equal( decoder.transparency(), transparency ),
+        decoder.decode() == image,
+        encoder.finished() && encoder.rows_written() == 40
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_encode_streaming() {
+    constexpr std::uint32_t width{ 17 };
+    constexpr std::uint32_t height{ 23 };
+    constexpr std::size_t   row_bytes{ width * 3 };
+    constexpr std::size_t   stride{ 64 };
+    const auto header{ make_header( width, height, 8,
+                                    IHDR::ColourType::TRUE_COLOUR ) };
+    const auto image{ pattern_image( row_bytes * height ) };
+    const auto whole{ encode_image( header, image ) };
+
+    // The same image from padded rows, a few rows per call
+    auto padded{ pattern_image( stride * height ) };
+    for ( std::size_t y{ 0 }; y < height; ++y ) {
+        std::ranges::copy( std::span{ image }.subspan( y * row_bytes,
+                                                       row_bytes ),
+                           padded.begin()
+                               + static_cast<std::ptrdiff_t>( y * stride ) );
+    }
+    std::vector<std::byte> streamed;
+    std::size_t            sink_calls{ 0 };
+    PngEncoder             encoder{ header,
+                        [&]( const std::span<const std::byte> bytes ) {
+                            ++sink_calls;
+                            streamed.insert( streamed.end(), bytes.begin(),
+                                             bytes.end() );
+                        } };
+    for ( std::uint32_t y{ 0 }; y < height; y += 5 ) {
+        const auto rows{ std::min( 5U, height - y ) };
+        encoder.write_rows( std::span{ padded }.subspan( y * stride,
+                                                         rows * stride ),
+                            stride );
+    }
+    encoder.finish();
+
+    // Unpadded last row
+    std::vector<std::byte> unpadded_last;
+    PngEncoder unpadded{ header, buffer_sink( unpadded_last ) };
+    unpadded.write_rows( std::span{ padded }.first( ( height - 1 ) * stride
+                                                    + row_bytes ),
+                         stride );
+    unpadded.finish();
+
+    bool fd_round_trip{ true };
+#if defined( __linux__ )
+    const auto path{ std::filesystem::temp_directory_path()
+                     / "png_encoder_test.png" };
+    const int  fd{ ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600 ) };
+    PngEncoder file_encoder{ header, fd_sink( fd ) };
+    file_encoder.write_rows( image );
+    file_encoder.finish();
+    ::close( fd );
+    std::ifstream           in_file{ path, std::ios::binary };
+    const std::vector<char> chars{ std::istreambuf_iterator<char>( in_file ),
+                                   std::istreambuf_iterator<char>() };
+    std::filesystem::remove( path );
+    fd_round_trip = std::ranges::equal( std::as_bytes( std::span{ chars } ),
+                                        whole );
+#endif
+
+    const auto test_results = std::vector<bool>{
+        streamed == whole, sink_calls > 3, unpadded_last == whole,
+        fd_round_trip
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_encode_segments() {
+    constexpr std::uint32_t width{ 31 };
+    constexpr std::uint32_t height{ 45 };
+    const auto header{ make_header( width, height, 8,
+                                    IHDR::ColourType::TRUE_COLOUR ) };
+    const auto image{ pattern_image( width * 3 * height ) };
+
+    const auto encode_segmented = [&]( const std::uint32_t rows_per_segment,
+                                       const IDAT::FilterType filter ) {
+        EncodeOptions options{};
+        options.rows_per_segment = rows_per_segment;
+        options.filter = filter;
+        options.idat_size = 500;
+        return encode_image( header, image, options );
+    };
+
+    // The decoder must pick up the syNc chunk's offsets & decode the
+    // segments in parallel
+    const auto decodes_segmented = [&]( const std::uint32_t rows_per_segment,
+                                        const IDAT::FilterType filter ) {
+        const auto png{ encode_segmented( rows_per_segment, filter ) };
+        const auto types{ chunk_types( png ) };
+        const auto sync_chunk{ std::ranges::find( types, PngChunkType::syNc ) };
+        if ( sync_chunk == types.end()
+             || *std::prev( sync_chunk ) != PngChunkType::IDAT ) {
+            return false;
+        }
+
+        PngDecoder    decoder{ png };
+        DecodeOptions options{};
+        options.threads = 3;
+        const auto index{ SyncIndex::parse(
+            std::ranges::find( decoder.chunks(), PngChunkType::syNc,
+                               &PngChunkView::type )
+                ->data ) };
+        return index.rows_per_segment == rows_per_segment
+               && index.offsets.size()
+                      == ( height + rows_per_segment - 1 ) / rows_per_segment
+                             - 1
+               && std::ranges::equal( decoder.sync_points(), index.offsets )
+               && decoder.decode( options ) == image;
+    };
+
+    const auto unsegmented{ chunk_types( encode_segmented( 0, {} ) ) };
+    const auto one_segment{ chunk_types( encode_segmented( height, {} ) ) };
+
+    const auto test_results = std::vector<bool>{
+        decodes_segmented( 8, IDAT::FilterType::NONE ),
+        decodes_segmented( 1, IDAT::FilterType::UP ),
+        decodes_segmented( 44, IDAT::FilterType::PAETH ),
+        !std::ranges::contains( unsegmented, PngChunkType::syNc ),
+        !std::ranges::contains( one_segment, PngChunkType::syNc )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_encode_parallel() {
+    // 1023 rows per 1 MiB band, so 3 bands & 2 batches on 2 threads
+    constexpr std::uint32_t width{ 256 };
+    constexpr std::uint32_t height{ 2500 };
+    const auto header{ make_header( width, height, 8,
+                                    IHDR::ColourType::TRUE_COLOUR_ALPHA ) };
+    const auto image{ pattern_image( width * 4 * height ) };
+
+    const auto encode = [&]( const std::uint32_t          threads,
+                             const ZLIB::CompressionLevel level,
+                             const std::uint32_t rows_per_segment = 0 ) {
+        EncodeOptions options{};
+        options.threads = threads;
+        options.level = level;
+        options.filter = IDAT::FilterType::SUB;
+        options.rows_per_segment = rows_per_segment;
+        return encode_image( header, image, options );
+    };
+    const auto decodes = [&]( const std::span<const std::byte> png ) {
+        PngDecoder decoder{ png };
+        return decoder.decode() == image;
+    };
+
+    constexpr auto fast{ ZLIB::CompressionLevel::FAST };
+    const auto     sequential{ encode( 1, fast ) };
+    const auto     parallel{ encode( 2, fast ) };
+
+    // Rows supplied one at a time
+    std::vector<std::byte> streamed;
+    {
+        EncodeOptions options{};
+        options.threads = 3;
+        options.filter = IDAT::FilterType::SUB;
+        PngEncoder encoder{ header, buffer_sink( streamed ), options };
+        for ( std::uint32_t row{ 0 }; row < height; ++row ) {
+            encoder.write_rows(
+                std::span{ image }.subspan( row * width * 4, width * 4 ) );
+        }
+        encoder.finish();
+    }
+
+    // Bands that are segments are recorded in the syNc chunk & decode in
+    // parallel
+    const auto segmented{ encode( 4, fast, 100 ) };
+    PngDecoder segment_decoder{ segmented };
+    DecodeOptions threaded{};
+    threaded.threads = 4;
+
+    // Fewer rows than a band: one band holding the whole stream
+    const auto small_header{ make_header( 40, 30, 8,
+                                          IHDR::ColourType::TRUE_COLOUR ) };
+    const auto small_image{ pattern_image( 40 * 3 * 30 ) };
+    EncodeOptions small_options{};
+    small_options.threads = 4;
+    const auto small_png{ encode_image( small_header, small_image,
+                                        small_options ) };
+    PngDecoder small_decoder{ small_png };
+
+    const auto test_results = std::vector<bool>{
+        decodes( parallel ),
+        decodes( encode( 0, ZLIB::CompressionLevel::DEFAULT ) ),
+        decodes( encode( 2, ZLIB::CompressionLevel::STORE ) ),
+        decodes( streamed ),
+        // Priming keeps matches reaching across bands
+        parallel.size() <= sequential.size() + sequential.size() / 100,
+        segment_decoder.sync_points().size() == height / 100 - 1,
+        segment_decoder.decode( threaded ) == image,
+        small_decoder.decode() == small_image
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_encode_adaptive_filter() {
+    // Costs match filtering with each type & summing by hand, across the
+    // vector body, the first pixel & the scalar tail
+    const auto reference_costs = []( const std::span<const std::byte> row,
+                                     const std::span<const std::byte> above,
+                                     const std::size_t                bpp ) {
+        std::array<std::uint64_t, IDAT::filter_type_count> costs{};
+        std::vector<std::byte>                             out( row.size() );
+        for ( std::size_t type{ 0 }; type < costs.size(); ++type ) {
+            static_cast<void>( IDAT::filter_row(
+                static_cast<IDAT::FilterType>( type ), row, above, out,
+                bpp ) );
+            for ( const auto byte : out ) {
+                const auto value{ std::to_integer<std::uint32_t>( byte ) };
+                costs[type] += value < 128 ? value : 256 - value;
+            }
+        }
+        return costs;
+    };
+    auto          costs_match{ true };
+    auto          choice_minimal{ true };
+    std::uint32_t state{ 7 };
+    for ( const std::size_t bpp : { 1, 2, 3, 4, 6, 8 } ) {
+        for ( const std::size_t pixels : { 1, 7, 11, 64, 133 } ) {
+            std::vector<std::byte> row( bpp * pixels );
+            std::vector<std::byte> above( row.size() );
+            for ( std::size_t i{ 0 }; i < row.size(); ++i ) {
+                state = state * 1103515245U + 12345U;
+                // Mostly smooth, so the filters' costs differ
+                row[i] = static_cast<std::byte>( i + ( state >> 28 ) );
+                above[i] = static_cast<std::byte>( state >> 16 );
+            }
+            const auto costs{ IDAT::filter_costs( row, above, bpp ) };
+            const auto choice{ IDAT::choose_filter( row, above, bpp ) };
+            costs_match = costs_match
+                          && costs == reference_costs( row, above, bpp );
+            choice_minimal =
+                choice_minimal
+                && costs[static_cast<std::size_t>( choice )]
+                       == std::ranges::min( costs );
+        }
+    }
+
+    // A smooth gradient compresses better filtered than not
+    constexpr std::uint32_t width{ 300 };
+    constexpr std::uint32_t height{ 200 };
+    const auto header{ make_header( width, height, 16,
+                                    IHDR::ColourType::TRUE_COLOUR ) };
+    std::vector<std::byte> image( std::size_t{ width } * height * 6 );
+    for ( std::size_t i{ 0 }; i < image.size(); ++i ) {
+        const auto pixel{ i / 6 };
+        image[i] = static_cast<std::byte>(
+            i % 2 == 0 ? ( pixel % width + pixel / width ) / 4 :
+                         ( pixel % width ) * ( i % 6 + 1 ) );
+    }
+    const auto encode = [&]( const bool adaptive, const std::uint32_t threads,
+                             const IHDR::IhdrChunkPayload &   png_header,
+                             const std::span<const std::byte> pixels ) {
+        EncodeOptions options{};
+        options.adaptive_filter = adaptive;
+        options.threads = threads;
+        return encode_image( png_header, pixels, options );
+    };
+    const auto unfiltered{ encode( false, 1, header, image ) };
+    const auto adaptive{ encode( true, 1, header, image ) };
+    const auto parallel{ encode( true, 2, header, image ) };
+    const auto interlaced{ encode(
+        true, 1,
+        make_header( width, height, 16, IHDR::ColourType::TRUE_COLOUR,
+                     IHDR::InterlaceMethod::ADAM_7 ),
+        image ) };
+    // Indexed images keep the fixed filter
+    const auto indexed_header{ make_header(
+        64, 16, 8, IHDR::ColourType::INDEXED_COLOUR ) };
+    const auto indexed_image{ pattern_image( 64 * 16 ) };
+    const auto indexed{ encode( true, 1, indexed_header, indexed_image ) };
+
+    PngDecoder adaptive_decoder{ adaptive };
+    PngDecoder parallel_decoder{ parallel };
+    PngDecoder interlaced_decoder{ interlaced };
+    PngDecoder indexed_decoder{ indexed };
+
+    const auto test_results = std::vector<bool>{
+        costs_match,
+        choice_minimal,
+        adaptive_decoder.decode() == image,
+        parallel_decoder.decode() == image,
+        interlaced_decoder.decode() == image,
+        adaptive.size() < unfiltered.size(),
+        indexed_decoder.decode() == indexed_image,
+        indexed == encode( false, 1, indexed_header, indexed_image )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_encode_errors() {
+    const auto grey{ make_header( 4, 4, 8, IHDR::ColourType::GREYSCALE ) };
+    const auto indexed{ make_header( 4, 4, 8,
+                                     IHDR::ColourType::INDEXED_COLOUR ) };
+    const auto indexed_1_bit{ make_header(
+        4, 4, 1, IHDR::ColourType::INDEXED_COLOUR ) };
+    const auto image{ pattern_image( 16 ) };
+    const auto palette{ full_palette() };
+
+    std::vector<std::byte> png;
+    const auto             with_encoder = [&]( const IHDR::IhdrChunkPayload &
+                                                   header,
+                                               auto && action ) {
+        return error_from( [&] {
+            PngEncoder encoder{ header, buffer_sink( png ) };
+            action( encoder );
+        } );
+    };
+
+    EncodeOptions no_idat{};
+    no_idat.idat_size = 0;
+
+    const auto test_results = std::vector<bool>{
+        error_from( [&] {
+            PngEncoder{ make_header( 0, 4, 8, IHDR::ColourType::GREYSCALE ),
+                        buffer_sink( png ) };
+        } ) == png_error_t::BAD_IHDR,
+        error_from( [&] {
+            PngEncoder{ grey, buffer_sink( png ), no_idat };
+        } ) == png_error_t::BAD_ENCODE,
+        with_encoder( grey,
+                      [&]( PngEncoder & encoder ) {
+                          // One row past the image
+                          encoder.write_rows( image );
+                          encoder.write_rows( std::span{ image }.first( 4 ) );
+                      } )
+            == png_error_t::BAD_ENCODE,
+        with_encoder( grey,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_rows( std::span{ image }.first( 6 ) );
+                      } )
+            == png_error_t::BAD_ENCODE,
+        with_encoder( grey,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_rows( std::span{ image }.first( 8 ) );
+                          encoder.finish();
+                      } )
+            == png_error_t::BAD_ENCODE,
+        with_encoder( grey,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_palette( palette );
+                      } )
+            == png_error_t::BAD_PLTE,
+        with_encoder( grey,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_transparency(
+                              std::span{ image }.first( 3 ) );
+                      } )
+            == png_error_t::BAD_TRNS,
+        // Two entries are all 1 bit indices can reach
+        with_encoder( indexed_1_bit,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_palette(
+                              std::span{ palette }.first( 3 ) );
+                      } )
+            == png_error_t::BAD_PLTE,
+        with_encoder( indexed_1_bit,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_palette(
+                              std::span{ palette }.first( 2 ) );
+                      } )
+            == png_error_t::NONE,
+        with_encoder( indexed,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_rows( image );
+                      } )
+            == png_error_t::MISSING_PLTE,
+        with_encoder( indexed,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_transparency(
+                              std::span{ image }.first( 3 ) );
+                      } )
+            == png_error_t::MISSING_PLTE,
+        with_encoder( indexed,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_palette(
+                              std::span{ palette }.first( 2 ) );
+                          encoder.write_transparency(
+                              std::span{ image }.first( 3 ) );
+                      } )
+            == png_error_t::BAD_TRNS,
+        with_encoder( indexed,
+                      [&]( PngEncoder & encoder ) {
+                          encoder.write_palette( palette );
+                          encoder.write_rows( image );
+                          encoder.write_palette( palette );
+                      } )
+            == png_error_t::BAD_ENCODE
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_encoder_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Encoder", PNG::test_functions );
+}
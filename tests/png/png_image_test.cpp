@@ -0,0 +1,139 @@
+#include "png/png_image_test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace PNG
+{
+
+bool
+test_image_layout() {
+    const auto check_layout = []( const std::uint32_t    width,
+                                  const std::uint32_t    height,
+                                  const IHDR::ColourType colour_type,
+                                  const IHDR::BitDepth   bit_depth,
+                                  const std::size_t      min_stride,
+                                  const std::uint8_t     channels,
+                                  const std::size_t      row_bytes,
+                                  const std::size_t      stride ) {
+        Image image{ width, height, colour_type, bit_depth, min_stride };
+
+        bool matches{ image.width() == width && image.height() == height
+                      && image.channels() == channels
+                      && image.bits_per_pixel() == channels * bit_depth
+                      && image.stride() == stride
+                      && image.layout().row_bytes() == row_bytes
+                      && image.data().size() == stride * height };
+        for ( std::uint32_t y{ 0 }; matches && y < height; ++y ) {
+            const auto row{ image.row( y ) };
+            matches &= row.size() == row_bytes
+                       && reinterpret_cast<std::uintptr_t>( row.data() )
+                                  % Image::row_alignment
+                              == 0;
+            // Rows must be writable end to end
+            std::ranges::fill( row, std::byte{ 0xFF } );
+        }
+        return matches;
+    };
+
+    const auto invalid_format = [] {
+        try {
+            Image image{ 4, 4, IHDR::ColourType::TRUE_COLOUR,
+                         IHDR::BitDepth{ 4 } };
+        }
+        catch ( const png_error & error ) {
+            return error.error() == png_error_t::BAD_IHDR;
+        }
+        return false;
+    };
+
+    const auto test_results = std::vector<bool>{
+        check_layout( 1, 1, IHDR::ColourType::GREYSCALE, 1, 0, 1, 1, 64 ),
+        check_layout( 100, 3, IHDR::ColourType::TRUE_COLOUR, 8, 0, 3, 300,
+                      320 ),
+        check_layout( 16, 5, IHDR::ColourType::TRUE_COLOUR_ALPHA, 8, 0, 4, 64,
+                      64 ),
+        check_layout( 33, 7, IHDR::ColourType::GREYSCALE_ALPHA, 16, 0, 2, 132,
+                      192 ),
+        check_layout( 17, 9, IHDR::ColourType::INDEXED_COLOUR, 4, 0, 1, 9,
+                      64 ),
+        // A larger minimum stride is still rounded up to the alignment
+        check_layout( 16, 5, IHDR::ColourType::TRUE_COLOUR_ALPHA, 8, 65, 4,
+                      64, 128 ),
+        invalid_format()
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_image_allocator() {
+    CountingResource counting{};
+
+    const auto allocates_from = [&] {
+        bool matches{ true };
+        {
+            Image image{ 10,
+                         10,
+                         IHDR::ColourType::GREYSCALE,
+                         IHDR::BitDepth{ 8 },
+                         0,
+                         &counting };
+            matches &= counting.allocations == 1
+                       && counting.live_bytes == image.data().size()
+                       && image.resource() == &counting;
+
+            // Moving hands the buffer over without reallocating
+            Image moved{ std::move( image ) };
+            matches &= counting.allocations == 1 && image.data().empty()
+                       && moved.data().size() == 640;
+        }
+        return matches && counting.live_bytes == 0;
+    };
+
+    // Everything above a 4KB threshold is mapped, falling back to
+    // transparent huge pages where none are reserved
+    const auto huge_pages = [&] {
+        HugePageResource huge{ &counting, 4096 };
+        const auto       before{ counting.allocations };
+
+        Image small{ 8, 8, IHDR::ColourType::GREYSCALE, IHDR::BitDepth{ 8 },
+                     0, &huge };
+        Image large{ 1024,
+                     64,
+                     IHDR::ColourType::TRUE_COLOUR_ALPHA,
+                     IHDR::BitDepth{ 8 },
+                     0,
+                     &huge };
+
+        std::ranges::fill( large.data(), std::byte{ 0x5A } );
+
+        // Mappings honour alignments up to a huge page
+        constexpr auto huge_page{ HugePageResource::huge_page_bytes };
+        void *         aligned{ huge.allocate( 3 * huge_page, huge_page ) };
+        const bool     huge_aligned{
+            reinterpret_cast<std::uintptr_t>( aligned ) % huge_page == 0
+        };
+        huge.deallocate( aligned, 3 * huge_page, huge_page );
+
+        return counting.allocations == before + 1 && huge_aligned
+               && reinterpret_cast<std::uintptr_t>( large.data().data() )
+                          % Image::row_alignment
+                      == 0
+               && std::ranges::all_of( large.row( 63 ), []( const auto b ) {
+                      return b == std::byte{ 0x5A };
+                  } );
+    };
+
+    const auto test_results = std::vector<bool>{ allocates_from(),
+                                                 huge_pages() };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_image_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Image", PNG::test_functions );
+}
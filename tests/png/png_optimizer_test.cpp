@@ -0,0 +1,180 @@
+#include "png/png_optimizer_test.hpp"
+
+#include <array>
+
+namespace PNG
+{
+
+bool
+test_optimize_reductions() {
+    using rgba = std::array<std::uint8_t, 4>;
+    const auto reduce = []( const std::uint32_t width,
+                            const std::uint32_t height,
+                            const IHDR::BitDepth             bit_depth,
+                            const std::span<const std::byte> image ) {
+        return lossless_reductions( rgba_png( width, height, bit_depth,
+                                              image ) );
+    };
+
+    // Three opaque colours: truecolour, or 2 bit indexed
+    constexpr std::array<rgba, 3> primaries{ rgba{ 200, 10, 10, 255 },
+                                             rgba{ 10, 200, 10, 255 },
+                                             rgba{ 10, 10, 200, 255 } };
+    const auto three{ rgba_image( 16, 8, [&]( const auto x, const auto y ) {
+        return primaries[( x + y ) % 3];
+    } ) };
+    const auto three_reduced{ reduce( 16, 8, 8, three ) };
+    std::vector<std::byte> rgb;
+    for ( std::size_t i{ 0 }; i < three.size(); ++i ) {
+        if ( i % 4 != 3 ) {
+            rgb.push_back( three[i] );
+        }
+    }
+
+    // 16 bit grey of repeated bytes, multiples of 85: 2 bit greyscale
+    std::vector<std::byte> grey;
+    for ( std::uint32_t x{ 0 }; x < 4; ++x ) {
+        const auto level{ static_cast<std::byte>( x * 85 ) };
+        for ( std::size_t i{ 0 }; i < 6; ++i ) {
+            grey.push_back( level );
+        }
+        grey.insert( grey.end(), 2, std::byte{ 0xFF } );
+    }
+    const auto grey_reduced{ reduce( 4, 1, 16, grey ) };
+
+    // Only one fully transparent colour: tRNS instead of alpha. Over 256
+    // colours, so not indexed.
+    const auto keyed{ rgba_image( 32, 32, []( const auto x, const auto y ) {
+        return x == y ? rgba{ 0, 0, 0, 0 } :
+                        rgba{ static_cast<std::uint8_t>( x ),
+                              static_cast<std::uint8_t>( y ), 100, 255 };
+    } ) };
+    const auto keyed_reduced{ reduce( 32, 32, 8, keyed ) };
+    // A translucent pixel keeps alpha
+    auto translucent{ keyed };
+    translucent[3] = std::byte{ 128 };
+    const auto translucent_reduced{ reduce( 32, 32, 8, translucent ) };
+
+    // Translucent palette entries come first, in order of appearance
+    const std::array<rgba, 3> mixed_colours{ rgba{ 1, 2, 3, 255 },
+                                             rgba{ 4, 5, 6, 100 },
+                                             rgba{ 7, 8, 9, 0 } };
+    const auto mixed{ rgba_image( 3, 1, [&]( const auto x, const auto ) {
+        return mixed_colours[x];
+    } ) };
+    const auto mixed_reduced{ reduce( 3, 1, 8, mixed ) };
+
+    const auto test_results = std::vector<bool>{
+        three_reduced.size() == 2,
+        three_reduced[0].colour_type == IHDR::ColourType::TRUE_COLOUR,
+        three_reduced[0].bit_depth == 8,
+        three_reduced[0].pixels == rgb,
+        three_reduced[0].transparency.empty(),
+        three_reduced[1].colour_type == IHDR::ColourType::INDEXED_COLOUR,
+        three_reduced[1].bit_depth == 2,
+        three_reduced[1].palette->getEntries() == 3,
+        three_reduced[1].transparency.empty(),
+        grey_reduced[0].colour_type == IHDR::ColourType::GREYSCALE,
+        grey_reduced[0].bit_depth == 2,
+        grey_reduced[0].pixels == std::vector{ std::byte{ 0b0001'1011 } },
+        keyed_reduced.size() == 1,
+        keyed_reduced[0].colour_type == IHDR::ColourType::TRUE_COLOUR,
+        keyed_reduced[0].transparency == std::vector<std::byte>( 6 ),
+        translucent_reduced[0].colour_type
+            == IHDR::ColourType::TRUE_COLOUR_ALPHA,
+        mixed_reduced[1].palette->rChannel()
+            == std::vector<PLTE::colour_t>{ 4, 7, 1 },
+        mixed_reduced[1].transparency
+            == std::vector{ std::byte{ 100 }, std::byte{ 0 } }
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_optimize() {
+    // Few colours in blocks, stored as unfiltered RGBA
+    constexpr std::uint32_t size{ 64 };
+    const auto image{ rgba_image( size, size, []( const auto x, const auto y ) {
+        const auto shade{ static_cast<std::uint8_t>( ( x / 8 + y / 8 ) * 16 ) };
+        return std::array<std::uint8_t, 4>{ shade, 255, shade, 255 };
+    } ) };
+    const auto input{ rgba_png( size, size, 8, image ) };
+
+    OptimizeOptions options{};
+    options.levels = { ZLIB::CompressionLevel::FAST,
+                       ZLIB::CompressionLevel::DEFAULT };
+    options.threads = 1;
+    const auto sequential{ optimize( input, options ) };
+    options.threads = 3;
+    const auto parallel{ optimize( input, options ) };
+    // Optimizing the winner again finds nothing better
+    const auto again{ optimize( sequential.png, options ) };
+
+    // 16 bit samples that can't be reduced
+    std::vector<std::byte> deep;
+    for ( std::uint32_t i{ 0 }; i < 16 * 16 * 4; ++i ) {
+        deep.push_back( static_cast<std::byte>( i * 7 ) );
+        deep.push_back( static_cast<std::byte>( i ) );
+    }
+    const auto deep_input{ rgba_png( 16, 16, 16, deep ) };
+    const auto deep_result{ optimize( deep_input, options ) };
+
+    const auto test_results = std::vector<bool>{
+        sequential.reduced,
+        sequential.png.size() < input.size(),
+        // Direct: 2 levels of 5 filters & adaptive. Indexed: 2 levels of 5.
+        sequential.trials == 22,
+        parallel.png == sequential.png,
+        // The pixels survive exactly
+        lossless_reductions( sequential.png )[0].pixels
+            == lossless_reductions( input )[0].pixels,
+        !again.reduced,
+        again.png == sequential.png,
+        deep_result.bit_depth == 16,
+        lossless_reductions( deep_result.png )[0].pixels
+            == lossless_reductions( deep_input )[0].pixels
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_optimize_errors() {
+    const auto error_from = []( const std::span<const std::byte> png,
+                                const OptimizeOptions &          options ) {
+        try {
+            static_cast<void>( optimize( png, options ) );
+        }
+        catch ( const png_error & error ) {
+            return error.error();
+        }
+        return png_error_t::NONE;
+    };
+    const auto image{ rgba_image( 4, 4, []( const auto, const auto ) {
+        return std::array<std::uint8_t, 4>{ 1, 2, 3, 4 };
+    } ) };
+    const auto png{ rgba_png( 4, 4, 8, image ) };
+
+    OptimizeOptions no_levels{};
+    no_levels.levels.clear();
+    OptimizeOptions no_filters{};
+    no_filters.filters.clear();
+    no_filters.adaptive_filter = false;
+    const std::vector<std::byte> not_png( 64, std::byte{ 0x42 } );
+
+    const auto test_results = std::vector<bool>{
+        error_from( png, no_levels ) == png_error_t::BAD_ENCODE,
+        error_from( png, no_filters ) == png_error_t::BAD_ENCODE,
+        error_from( not_png, {} ) == png_error_t::BAD_HEADER
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_optimizer_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Optimizer", PNG::test_functions );
+}
@@ -0,0 +1,233 @@
+#include "png/png_verify_test.hpp"
+
+#include "common/metrics.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace PNG
+{
+
+namespace
+{
+
+// Offset of chunk `index` of `chunks` once joined.
+std::size_t
+chunk_offset( const std::span<const TestChunk> chunks,
+              const std::size_t                index ) {
+    std::size_t offset{ png_signature_bytes };
+    for ( const auto & chunk : chunks.first( index ) ) {
+        offset += chunk_overhead_bytes + chunk.data.size();
+    }
+    return offset;
+}
+
+// Index of the first chunk of `type` in `chunks`.
+std::size_t
+find_chunk( const std::span<const TestChunk> chunks,
+            const PngChunkType               type ) {
+    std::size_t index{ 0 };
+    while ( chunks[index].type != type ) {
+        ++index;
+    }
+    return index;
+}
+
+bool
+fails_with( const std::span<const std::byte> png, const png_error_t error,
+            const std::size_t offset ) {
+    const auto result{ verify_png( png ) };
+    return result.error == error && result.offset == offset;
+}
+
+} // namespace
+
+bool
+test_verify_intact() {
+    const auto png{ verifiable_png() };
+    const auto chunks{ split_chunks( png ) };
+
+    const auto test_results = std::vector<bool>{
+        join_chunks( chunks ) == png,
+        chunks.size() > 4,
+        fails_with( png, png_error_t::NONE, 0 )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_verify_layout() {
+    const auto png{ verifiable_png() };
+    const auto chunks{ split_chunks( png ) };
+    const auto first_idat{ find_chunk( chunks, PngChunkType::IDAT ) };
+    const TestChunk text{ PngChunkType::tEXt,
+                          { std::byte{ 'a' }, std::byte{ 0 } } };
+    const TestChunk palette{ PngChunkType::PLTE,
+                             std::vector<std::byte>( 6 ) };
+
+    auto bad_signature{ png };
+    bad_signature[1] = std::byte{ 'Q' };
+
+    const std::span truncated{ png.data(), png.size() - 5 };
+
+    auto no_iend{ chunks };
+    no_iend.pop_back();
+
+    auto ihdr_second{ chunks };
+    ihdr_second.insert( ihdr_second.begin(), text );
+
+    // Text between the first & second IDAT chunk
+    auto split_idat{ chunks };
+    split_idat.insert( split_idat.begin()
+                           + static_cast<std::ptrdiff_t>( first_idat + 1 ),
+                       text );
+
+    auto late_palette{ chunks };
+    late_palette.insert( late_palette.end() - 1, palette );
+
+    auto no_idat{ chunks };
+    std::erase_if( no_idat, []( const TestChunk & chunk ) {
+        return chunk.type == PngChunkType::IDAT;
+    } );
+
+    auto trailing{ png };
+    trailing.push_back( std::byte{ 0 } );
+
+    // tRNS sized for the colour type, & none at all with an alpha channel
+    const auto with_transparency = []( const IHDR::ColourType colour_type,
+                                       const std::size_t      channels,
+                                       const std::size_t      bytes ) {
+        auto transparent{ split_chunks( encode_image(
+            make_header( 8, 8, 8, colour_type ),
+            pattern_image( 8 * 8 * channels ) ) ) };
+        transparent.insert( transparent.begin() + 1,
+                            { PngChunkType::tRNS,
+                              std::vector<std::byte>( bytes ) } );
+        return join_chunks( transparent );
+    };
+    const auto trns_offset{ chunk_offset( chunks, 1 ) };
+
+    const auto test_results = std::vector<bool>{
+        fails_with( bad_signature, png_error_t::BAD_HEADER, 0 ),
+        fails_with( truncated, png_error_t::TRUNCATED_CHUNK,
+                    chunk_offset( chunks, chunks.size() - 1 ) ),
+        fails_with( join_chunks( no_iend ), png_error_t::TRUNCATED_CHUNK,
+                    chunk_offset( no_iend, no_iend.size() ) ),
+        fails_with( join_chunks( ihdr_second ), png_error_t::MISSING_IHDR,
+                    png_signature_bytes ),
+        fails_with( join_chunks( split_idat ), png_error_t::BAD_CHUNK_ORDER,
+                    chunk_offset( split_idat, first_idat + 2 ) ),
+        fails_with( join_chunks( late_palette ), png_error_t::BAD_CHUNK_ORDER,
+                    chunk_offset( late_palette, late_palette.size() - 2 ) ),
+        fails_with( join_chunks( no_idat ), png_error_t::MISSING_IDAT,
+                    chunk_offset( no_idat, no_idat.size() - 1 ) ),
+        fails_with( trailing, png_error_t::BAD_CHUNK_ORDER, png.size() ),
+        fails_with( with_transparency( IHDR::ColourType::GREYSCALE, 1, 2 ),
+                    png_error_t::NONE, 0 ),
+        fails_with( with_transparency( IHDR::ColourType::GREYSCALE, 1, 6 ),
+                    png_error_t::BAD_TRNS, trns_offset ),
+        fails_with( with_transparency( IHDR::ColourType::TRUE_COLOUR, 3, 6 ),
+                    png_error_t::NONE, 0 ),
+        fails_with( with_transparency( IHDR::ColourType::TRUE_COLOUR, 3, 2 ),
+                    png_error_t::BAD_TRNS, trns_offset ),
+        fails_with(
+            with_transparency( IHDR::ColourType::TRUE_COLOUR_ALPHA, 4, 6 ),
+            png_error_t::BAD_TRNS, trns_offset )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_verify_data() {
+    const auto png{ verifiable_png() };
+    const auto chunks{ split_chunks( png ) };
+    const auto first_idat{ find_chunk( chunks, PngChunkType::IDAT ) };
+    const auto idat_offset{ chunk_offset( chunks, first_idat ) };
+    const auto last_idat{ chunks.size() - 2 };
+
+    // CRC of the second IDAT chunk
+    auto bad_crc{ png };
+    const auto second_idat{ chunk_offset( chunks, first_idat + 1 ) };
+    bad_crc[second_idat + chunk_overhead_bytes
+            + chunks[first_idat + 1].data.size() - 1] ^= std::byte{ 1 };
+
+    // Deflate data, CRCs kept valid
+    auto corrupt{ chunks };
+    corrupt[first_idat + 1].data[7] ^= std::byte{ 0x5A };
+
+    auto bad_adler{ chunks };
+    bad_adler[last_idat].data.back() ^= std::byte{ 1 };
+
+    auto short_stream{ chunks };
+    short_stream.erase( short_stream.begin()
+                        + static_cast<std::ptrdiff_t>( last_idat ) );
+
+    // One row fewer than the stream holds
+    auto extra_rows{ chunks };
+    extra_rows[0].data[7] = std::byte{ 39 };
+
+    const auto test_results = std::vector<bool>{
+        fails_with( bad_crc, png_error_t::BAD_CRC, second_idat ),
+        fails_with( join_chunks( corrupt ), png_error_t::BAD_IMAGE_DATA,
+                    idat_offset ),
+        fails_with( join_chunks( bad_adler ), png_error_t::BAD_IMAGE_DATA,
+                    idat_offset ),
+        fails_with( join_chunks( short_stream ), png_error_t::BAD_IMAGE_DATA,
+                    idat_offset ),
+        fails_with( join_chunks( extra_rows ), png_error_t::BAD_IMAGE_DATA,
+                    idat_offset )
+    };
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+bool
+test_verify_file() {
+    auto test_results = std::vector<bool>{};
+#if defined( __linux__ )
+    const auto png{ verifiable_png() };
+    const auto path{ std::filesystem::temp_directory_path()
+                     / "png_verify_test.png" };
+    const auto write_file = [&]( const std::span<const std::byte> bytes ) {
+        std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+        file.write( reinterpret_cast<const char *>( bytes.data() ),
+                    static_cast<std::streamsize>( bytes.size() ) );
+    };
+
+    write_file( png );
+    METRICS::reset_process_metrics();
+    METRICS::set_enabled( true );
+    const auto intact{ verify_png( path ) };
+    METRICS::set_enabled( false );
+    const auto read{ METRICS::process_metrics()[METRICS::stage_t::READ] };
+    METRICS::reset_process_metrics();
+    auto       corrupt{ png };
+    corrupt[png_signature_bytes + 8] ^= std::byte{ 1 };
+    write_file( corrupt );
+    const auto damaged{ verify_png( path ) };
+    write_file( {} );
+    const auto empty{ verify_png( path ) };
+    std::filesystem::remove( path );
+
+    test_results = {
+        intact.error == png_error_t::NONE,
+        // Opening & mapping the file is timed as the read stage
+        read.calls == 1 && read.bytes_out == png.size(),
+        damaged.error == png_error_t::BAD_CRC
+            && damaged.offset == png_signature_bytes,
+        empty.error == png_error_t::BAD_HEADER,
+        verify_png( path ).error == png_error_t::READ_FAILED
+    };
+#endif
+
+    return TEST_INTERFACE::confirm_results( test_results );
+}
+
+} // namespace PNG
+
+int
+png_verify_test( [[maybe_unused]] int argc, [[maybe_unused]] char ** argv ) {
+    return TEST_INTERFACE::run_tests( "PNG Verify", PNG::test_functions );
+}